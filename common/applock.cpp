@@ -11,7 +11,9 @@
 #include "applock.h"
 
 #include <QtScript>
+#include <QHash>
 #include <QMessageBox>
+#include <QStringList>
 #include <QSqlError>
 #include <QVariant>
 #include <QWidget>
@@ -107,8 +109,136 @@ class AppLockPrivate
       }
     }
 
+    /* Look up the oids of any @a tables we haven't seen yet in one query.
+       Table oids don't change during a session so they are cached for the
+       life of the process.
+     */
+    bool cacheTableOids(const QStringList &tables) {
+      QStringList missing;
+      foreach (QString table, tables)
+        if (! _tableOids.contains(table) && ! missing.contains(table))
+          missing.append(table);
+      if (missing.isEmpty())
+        return true;
+
+      XSqlQuery q;
+      q.prepare("SELECT relname, CAST(oid AS INTEGER) AS oid"
+                "  FROM pg_class"
+                " WHERE relname = ANY(CAST(:tables AS TEXT[]));");
+      q.bindValue(":tables", arrayLiteral(missing));
+      q.exec();
+      while (q.next()) {
+        if (! _tableOids.contains(q.value("relname").toString()))
+          _tableOids.insert(q.value("relname").toString(), q.value("oid").toInt());
+      }
+      if (ErrorReporter::error(QtCriticalMsg,
+                               qobject_cast<QWidget*>(_parent->parent()),
+                               _parent->tr("Locking Error"),
+                               q, __FILE__, __LINE__)) {
+        _error = q.lastError().databaseText();
+        return false;
+      }
+      return true;
+    }
+
+    /* Find out who holds the locks we could not get, one query for all of
+       them. Records this session already holds through another AppLock are
+       added to _sessionHeld; they are not ours to release. If the lock
+       tables can't be read with the user names, try pg_locks alone, and if
+       that fails too report the records as held by an unknown user rather
+       than failing the whole acquireAll().
+     */
+    void updateContention(const QList<QPair<QString, int> > &records) {
+      QStringList oids;
+      QStringList ids;
+      for (int i = 0; i < records.size(); i++) {
+        oids << QString::number(_tableOids.value(records.at(i).first));
+        ids  << QString::number(records.at(i).second);
+      }
+
+      QStringList queries;
+      if (_mobilizedDb.toBool())
+        queries << "SELECT CAST(lock_table_oid AS INTEGER) AS oid,"
+                   "       lock_record_id AS id,"
+                   "       lock_pid = pg_backend_pid() AS mylock,"
+                   "       lock_username AS username"
+                   "  FROM xt.lock"
+                   " WHERE CAST(lock_table_oid AS INTEGER) = ANY(CAST(:oids AS INTEGER[]))"
+                   "   AND lock_record_id = ANY(CAST(:ids AS INTEGER[]));";
+      if (! _actPidCol.isEmpty())
+        queries << "SELECT CAST(classid AS INTEGER) AS oid,"
+                   "       CAST(objid AS INTEGER) AS id,"
+                   "       l.pid = pg_backend_pid() AS mylock,"
+                   "       usename AS username"
+                   "  FROM pg_locks l"
+                   "  JOIN pg_database d on database = d.oid"
+                   "  JOIN pg_stat_activity a ON l.pid = a." + _actPidCol +
+                   " WHERE d.datname = current_database()"
+                   "   AND locktype = 'advisory'"
+                   "   AND CAST(classid AS INTEGER) = ANY(CAST(:oids AS INTEGER[]))"
+                   "   AND CAST(objid AS INTEGER) = ANY(CAST(:ids AS INTEGER[]));";
+      queries << "SELECT CAST(classid AS INTEGER) AS oid,"
+                 "       CAST(objid AS INTEGER) AS id,"
+                 "       l.pid = pg_backend_pid() AS mylock,"
+                 "       NULL AS username"
+                 "  FROM pg_locks l"
+                 "  JOIN pg_database d on database = d.oid"
+                 " WHERE d.datname = current_database()"
+                 "   AND locktype = 'advisory'"
+                 "   AND CAST(classid AS INTEGER) = ANY(CAST(:oids AS INTEGER[]))"
+                 "   AND CAST(objid AS INTEGER) = ANY(CAST(:ids AS INTEGER[]));";
+
+      QHash<QPair<int, int>, QVariant> holders;
+      foreach (QString query, queries) {
+        XSqlQuery q;
+        q.prepare(query);
+        q.bindValue(":oids", arrayLiteral(oids));
+        q.bindValue(":ids",  arrayLiteral(ids));
+        q.exec();
+        while (q.next()) {
+          QPair<int, int> key(q.value("oid").toInt(), q.value("id").toInt());
+          if (q.value("mylock").toBool())
+            holders.insert(key, QVariant(true));
+          else if (! holders.contains(key))
+            holders.insert(key, q.value("username"));
+        }
+        if (q.lastError().type() == QSqlError::NoError)
+          break;
+        qWarning("AppLock could not read the lock holders: %s",
+                 qPrintable(q.lastError().databaseText()));
+        holders.clear();
+      }
+
+      for (int i = 0; i < records.size(); i++) {
+        QPair<int, int> key(_tableOids.value(records.at(i).first),
+                            records.at(i).second);
+        QVariant holder = holders.value(key);
+        if (holder.type() == QVariant::Bool)
+          _sessionHeld.append(records.at(i));
+        else {
+          QVariantMap contended;
+          contended.insert("table",    records.at(i).first);
+          contended.insert("id",       records.at(i).second);
+          contended.insert("username", holder.toString().isEmpty()
+                                       ? _parent->tr("unknown user")
+                                       : holder.toString());
+          _contended.append(contended);
+        }
+      }
+    }
+
+    static QString arrayLiteral(const QStringList &list) {
+      QStringList quoted;
+      foreach (QString elem, list)
+        quoted << "\"" + elem.replace("\\", "\\\\").replace("\"", "\\\"") + "\"";
+      return "{" + quoted.join(",") + "}";
+    }
+
     QString  _actPidCol;
+    QVariantList _contended;
     QString  _error;
+    QHash<QPair<QString, int>, int> _held;          // acquired here, with counts
+    QList<QPair<QString, int> >     _sessionHeld;   // by another AppLock
     int      _id;
     bool     _myLock;
     bool     _otherLock;
@@ -117,9 +247,11 @@ class AppLockPrivate
     QString  _username;
 
     static QVariant _mobilizedDb;
+    static QHash<QString, int> _tableOids;
 };
 
 QVariant AppLockPrivate::_mobilizedDb;
+QHash<QString, int> AppLockPrivate::_tableOids;
 
 AppLock::AppLock(QObject *parent)
   : QObject(parent)
@@ -137,6 +269,7 @@ AppLock::AppLock(QString table, int id, QObject *parent)
 AppLock::~AppLock()
 {
   (void)release();
+  (void)releaseAll();
   delete _p;
   _p = 0;
 }
@@ -163,12 +296,15 @@ bool AppLock::acquire(AppLock::AcquireMode mode)
 
   bool result = false;
   _p->_error.clear();
+  if (! _p->cacheTableOids(QStringList() << _p->_table))
+    return false;
+  if (! _p->_tableOids.contains(_p->_table))
+    return false;
+
   XSqlQuery q;
-  q.prepare("SELECT tryLock(CAST(oid AS INTEGER), :id) AS locked"
-            "  FROM pg_class"
-            " WHERE relname=:table;");
+  q.prepare("SELECT tryLock(:oid, :id) AS locked;");
+  q.bindValue(":oid",   _p->_tableOids.value(_p->_table));
   q.bindValue(":id",    _p->_id);
-  q.bindValue(":table", _p->_table);
   q.exec();
   if (q.first())
   {
@@ -214,12 +350,160 @@ bool AppLock::acquire(QString table, int id, AppLock::AcquireMode mode)
   return acquire(mode);
 }
 
+/** Try to acquire application-level locks on many records at once.
+
+    This takes one round trip to the database for the locks themselves plus
+    one to describe any contention, regardless of the number of records.
+    The locks that could be acquired are kept even if others could not;
+    call releaseAll() to give them up if the operation needs all of them.
+
+    @param records A list of (table name, record id) pairs
+    @param mode    Interactive shows one message listing all of the records
+                   locked by other users
+
+    @return true if this AppLock holds locks on all of the records
+
+    @see contended()
+    @see releaseAll()
+ */
+bool AppLock::acquireAll(const QList<QPair<QString, int> > &records,
+                         AppLock::AcquireMode mode)
+{
+  _p->_error.clear();
+  _p->_contended.clear();
+
+  QStringList tables;
+  for (int i = 0; i < records.size(); i++)
+    tables << records.at(i).first;
+  if (! _p->cacheTableOids(tables))
+    return false;
+
+  QList<QPair<QString, int> > wanted;
+  QStringList oids;
+  QStringList ids;
+  for (int i = 0; i < records.size(); i++)
+  {
+    if (_p->_held.contains(records.at(i)) ||
+        _p->_sessionHeld.contains(records.at(i)) || wanted.contains(records.at(i)))
+      continue;
+    if (! _p->_tableOids.contains(records.at(i).first))
+    {
+      _p->_error = tr("Cannot lock records in %1 because the table could "
+                      "not be found.").arg(records.at(i).first);
+      if (mode == Interactive)
+        QMessageBox::critical(0, tr("Cannot Acquire Lock"), _p->_error);
+      return false;
+    }
+    wanted << records.at(i);
+    oids   << QString::number(_p->_tableOids.value(records.at(i).first));
+    ids    << QString::number(records.at(i).second);
+  }
+  if (wanted.isEmpty())
+    return true;
+
+  XSqlQuery q;
+  q.prepare("SELECT i, tryLock((CAST(:oids AS INTEGER[]))[i],"
+            "                  (CAST(:ids  AS INTEGER[]))[i]) AS locked"
+            "  FROM generate_series(1, :count) AS i"
+            " ORDER BY i;");
+  q.bindValue(":oids",  AppLockPrivate::arrayLiteral(oids));
+  q.bindValue(":ids",   AppLockPrivate::arrayLiteral(ids));
+  q.bindValue(":count", wanted.size());
+  q.exec();
+
+  QList<QPair<QString, int> > failed;
+  while (q.next())
+  {
+    int i = q.value("i").toInt() - 1;
+    if (q.value("locked").toBool())
+      _p->_held[wanted.at(i)]++;
+    else
+      failed.append(wanted.at(i));
+  }
+  if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
+                           tr("Locking Error"),
+                           q, __FILE__, __LINE__))
+  {
+    _p->_error = q.lastError().databaseText();
+    return false;
+  }
+
+  if (! failed.isEmpty())
+    _p->updateContention(failed);
+
+  if (! _p->_contended.isEmpty())
+  {
+    QStringList lines;
+    foreach (QVariant contended, _p->_contended)
+    {
+      QVariantMap record = contended.toMap();
+      lines << tr("%1 #%2 (%3)").arg(record.value("table").toString(),
+                                     record.value("id").toString(),
+                                     record.value("username").toString());
+    }
+    _p->_error = tr("%n record(s) you are trying to edit are currently being "
+                    "edited by other users:\n%1", 0, _p->_contended.size())
+                   .arg(lines.join("\n"));
+    if (mode == Interactive)
+      QMessageBox::critical(0, tr("Cannot Acquire Lock"), _p->_error);
+  }
+
+  return _p->_contended.isEmpty();
+}
+
+/** Script-friendly version of acquireAll().
+
+    @param records A list of records, each either an array of
+                   [ table, id ] or an object with table and id properties
+ */
+bool AppLock::acquireAll(const QVariantList &records, AppLock::AcquireMode mode)
+{
+  QList<QPair<QString, int> > pairs;
+  foreach (QVariant record, records)
+  {
+    if (record.type() == QVariant::Map)
+      pairs << qMakePair(record.toMap().value("table").toString(),
+                         record.toMap().value("id").toInt());
+    else if (record.toList().size() == 2)
+      pairs << qMakePair(record.toList().at(0).toString(),
+                         record.toList().at(1).toInt());
+    else
+    {
+      _p->_error = tr("Cannot acquire a lock without a table and record id.");
+      if (mode == Interactive)
+        QMessageBox::critical(0, tr("Cannot Acquire Lock"), _p->_error);
+      return false;
+    }
+  }
+
+  return acquireAll(pairs, mode);
+}
+
+/** @return the records the last acquireAll() could not lock, as a list of
+            objects with table, id and username properties
+ */
+QVariantList AppLock::contended() const
+{
+  return _p->_contended;
+}
+
 /** @return true if _this_ instance of AppLock holds the lock */
 bool AppLock::holdsLock() const
 {
   return _p->_myLock;
 }
 
+/** @return true if _this_ instance of AppLock holds the lock on the given
+            record through acquire() or acquireAll()
+ */
+bool AppLock::holdsLock(QString table, int id) const
+{
+  if (_p->_myLock && table == _p->_table && id == _p->_id)
+    return true;
+  return _p->_held.contains(qMakePair(table, id)) ||
+         _p->_sessionHeld.contains(qMakePair(table, id));
+}
+
 /** @return true if the object appears locked by some other entity */
 bool AppLock::isLockedOut() const
 {
@@ -268,6 +552,76 @@ bool AppLock::release()
   return released;
 }
 
+/** Release all of the locks acquired by acquireAll() in one round trip.
+
+    Only the locks this AppLock actually acquired are released, as many
+    times as it acquired each one. Records that acquireAll() found already
+    locked by this session, through another AppLock, are left alone.
+
+    @return true if no locks from acquireAll() are still held
+ */
+bool AppLock::releaseAll()
+{
+  _p->_sessionHeld.clear();
+  if (_p->_held.isEmpty())
+    return true;
+
+  _p->_error.clear();
+  QList<QPair<QString, int> > records;
+  QStringList oids;
+  QStringList ids;
+  QHash<QPair<QString, int>, int>::const_iterator it;
+  for (it = _p->_held.constBegin(); it != _p->_held.constEnd(); ++it)
+  {
+    for (int i = 0; i < it.value(); i++)
+    {
+      records << it.key();
+      oids    << QString::number(AppLockPrivate::_tableOids.value(it.key().first));
+      ids     << QString::number(it.key().second);
+    }
+  }
+
+  XSqlQuery q;
+  q.prepare("SELECT i, pg_advisory_unlock((CAST(:oids AS INTEGER[]))[i],"
+            "                             (CAST(:ids  AS INTEGER[]))[i]) AS released"
+            "  FROM generate_series(1, :count) AS i"
+            " ORDER BY i;");
+  q.bindValue(":oids",  AppLockPrivate::arrayLiteral(oids));
+  q.bindValue(":ids",   AppLockPrivate::arrayLiteral(ids));
+  q.bindValue(":count", records.size());
+  q.exec();
+
+  while (q.next())
+  {
+    if (! q.value("released").toBool())
+      continue;
+    QPair<QString, int> record = records.at(q.value("i").toInt() - 1);
+    if (--_p->_held[record] <= 0)
+      _p->_held.remove(record);
+  }
+  if (ErrorReporter::error(QtCriticalMsg, qobject_cast<QWidget*>(parent()),
+                           tr("Unlocking Error"),
+                           q, __FILE__, __LINE__))
+  {
+    _p->_error = q.lastError().text();
+    return false;
+  }
+
+  if (! _p->_held.isEmpty())
+    _p->_error = tr("Could not release %n lock(s).", 0, _p->_held.size());
+
+  return _p->_held.isEmpty();
+}
+
+/** Forget the cached table oids, for example after reconnecting to a
+    different database.
+ */
+void AppLock::clearTableCache()
+{
+  AppLockPrivate::_tableOids.clear();
+  AppLockPrivate::_mobilizedDb = QVariant();
+}
+
 QString AppLock::lastError() const
 {
   return _p->_error;
@@ -350,6 +704,30 @@ bool AppLockProto::acquire(QString table, int id, enum AppLock::AcquireMode mode
   return false;
 }
 
+bool AppLockProto::acquireAll(const QVariantList &records, enum AppLock::AcquireMode mode)
+{
+  AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
+  if (lock)
+    return lock->acquireAll(records, mode);
+  return false;
+}
+
+QVariantList AppLockProto::contended() const
+{
+  AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
+  if (lock)
+    return lock->contended();
+  return QVariantList();
+}
+
+bool AppLockProto::holdsLock(QString table, int id) const
+{
+  AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
+  if (lock)
+    return lock->holdsLock(table, id);
+  return false;
+}
+
 bool AppLockProto::holdsLock() const
 {
   AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
@@ -382,6 +760,14 @@ bool AppLockProto::release()
   return false;
 }
 
+bool AppLockProto::releaseAll()
+{
+  AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
+  if (lock)
+    return lock->releaseAll();
+  return false;
+}
+
 QString AppLockProto::toString() const
 {
   AppLock *lock = qscriptvalue_cast<AppLock*>(thisObject());
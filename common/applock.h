@@ -11,8 +11,11 @@
 #ifndef __APPLOCK_H__
 #define __APPLOCK_H__
 
+#include <QList>
 #include <QMetaType>
 #include <QObject>
+#include <QPair>
+#include <QVariant>
 #include <QtScript>
 
 class AppLockPrivate;
@@ -33,12 +36,21 @@ class AppLock : public QObject
 
     Q_INVOKABLE bool    acquire(AcquireMode mode = Silent);
     Q_INVOKABLE bool    acquire(QString table, int id, AcquireMode mode = Silent);
+                bool    acquireAll(const QList<QPair<QString, int> > &records,
+                                   AcquireMode mode = Silent);
+    Q_INVOKABLE bool    acquireAll(const QVariantList &records,
+                                   AcquireMode mode = Silent);
+    Q_INVOKABLE QVariantList contended() const;
     Q_INVOKABLE bool    holdsLock()   const;
+    Q_INVOKABLE bool    holdsLock(QString table, int id) const;
     Q_INVOKABLE bool    isLockedOut() const;
     Q_INVOKABLE QString lastError()   const;
     Q_INVOKABLE bool    release();
+    Q_INVOKABLE bool    releaseAll();
     Q_INVOKABLE QString toString()    const;
 
+    static void clearTableCache();
+
   private:
     AppLockPrivate *_p;
 };
@@ -57,10 +69,14 @@ class AppLockProto : public QObject, public QScriptable
 
     Q_INVOKABLE bool    acquire(AppLock::AcquireMode mode);
     Q_INVOKABLE bool    acquire(QString table, int id, AppLock::AcquireMode mode);
+    Q_INVOKABLE bool    acquireAll(const QVariantList &records, AppLock::AcquireMode mode);
+    Q_INVOKABLE QVariantList contended() const;
     Q_INVOKABLE bool    holdsLock()   const;
+    Q_INVOKABLE bool    holdsLock(QString table, int id) const;
     Q_INVOKABLE bool    isLockedOut() const;
     Q_INVOKABLE QString lastError()   const;
     Q_INVOKABLE bool    release();
+    Q_INVOKABLE bool    releaseAll();
     Q_INVOKABLE QString toString()    const;
 };
 
@@ -10,8 +10,14 @@
 
 #include "calendarcontrol.h"
 
+// cached contents older than this are fetched again
+#define CACHESECONDS 120
+// forget everything rather than keep contents for more filters than this
+#define MAXCACHEKEYS 20
+
 CalendarControl::CalendarControl(QObject * parent)
-  : QObject(parent)
+  : QObject(parent),
+    _prefetchMonths(0)
 {
 }
 
@@ -23,3 +29,81 @@ void CalendarControl::setSelectedDay(const QDate & day)
 {
   emit selectedDayChanged(day);
 }
+
+/* Return the contents of every day from start through end. Days missing
+   from the cache are loaded with a single call to fetchContents(), which
+   also loads prefetchMonths() on either side of the range so moving to
+   the next or previous month doesn't need another trip to the database.
+   The cache is kept separately for each cacheKey().
+ */
+QMap<QDate, QString> CalendarControl::rangeContents(const QDate & start, const QDate & end)
+{
+  QString   key = cacheKey();
+  QDateTime now = QDateTime::currentDateTime();
+  if (_loaded.contains(key) && _loaded.value(key).secsTo(now) > CACHESECONDS)
+  {
+    _cache.remove(key);
+    _loaded.remove(key);
+  }
+  if (! _cache.contains(key) && _cache.size() >= MAXCACHEKEYS)
+    invalidate();
+
+  QMap<QDate, QString> &days = _cache[key];
+
+  bool complete = true;
+  for (QDate date = start; complete && date <= end; date = date.addDays(1))
+    complete = days.contains(date);
+
+  if (! complete)
+  {
+    QDate from = start.addMonths(-_prefetchMonths);
+    QDate to   = end.addMonths(_prefetchMonths);
+    QMap<QDate, QString> fetched = fetchContents(from, to);
+    for (QDate date = from; date <= to; date = date.addDays(1))
+      days.insert(date, fetched.value(date));
+    if (! _loaded.contains(key))
+      _loaded.insert(key, now);
+  }
+
+  QMap<QDate, QString> result;
+  for (QDate date = start; date <= end; date = date.addDays(1))
+    result.insert(date, days.value(date));
+  return result;
+}
+
+/* Forget all cached contents. Call this when the underlying data change. */
+void CalendarControl::invalidate()
+{
+  _cache.clear();
+  _loaded.clear();
+}
+
+int CalendarControl::prefetchMonths() const
+{
+  return _prefetchMonths;
+}
+
+void CalendarControl::setPrefetchMonths(int months)
+{
+  _prefetchMonths = qMax(months, 0);
+}
+
+/* Identify whatever besides the date affects contents(), such as the
+   filters on the window showing the calendar.
+ */
+QString CalendarControl::cacheKey() const
+{
+  return QString();
+}
+
+/* Load the contents for a range of days. Subclasses that can get a whole
+   range in one query should reimplement this; the default asks
+   contents() for one day at a time.
+ */
+QMap<QDate, QString> CalendarControl::fetchContents(const QDate & start, const QDate & end)
+{
+  QMap<QDate, QString> result;
+  for (QDate date = start; date <= end; date = date.addDays(1))
+    result.insert(date, contents(date));
+  return result;
+}
@@ -13,6 +13,9 @@
 
 #include <QObject>
 #include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
 
 class CalendarControl : public QObject
 {
@@ -23,10 +26,26 @@ class CalendarControl : public QObject
     ~CalendarControl();
 
     virtual QString contents(const QDate &) = 0;
+    virtual QMap<QDate, QString> rangeContents(const QDate & start, const QDate & end);
     virtual void setSelectedDay(const QDate & day);
 
+    int  prefetchMonths() const;
+    void setPrefetchMonths(int months);
+
+  public slots:
+    virtual void invalidate();
+
   signals:
     void selectedDayChanged(const QDate &);
+
+  protected:
+    virtual QString cacheKey() const;
+    virtual QMap<QDate, QString> fetchContents(const QDate & start, const QDate & end);
+
+  private:
+    QHash<QString, QMap<QDate, QString> > _cache;
+    QHash<QString, QDateTime> _loaded;
+    int _prefetchMonths;
 };
 
 #endif
@@ -133,6 +133,9 @@ CalendarGraphicsItem::CalendarGraphicsItem(CalendarControl * cc, QGraphicsItem *
   QDate date;
   qreal dayWidth = __width / 7.0;
   QApplication::setOverrideCursor(Qt::WaitCursor);
+  QMap<QDate, QString> contents;
+  if(_controller)
+    contents = _controller->rangeContents(firstCalendarDay, firstCalendarDay.addDays(41));
   for(int wday = 0; wday < 7; wday++)
   {
     for(int week = 0; week < 6; week++)
@@ -182,9 +185,7 @@ CalendarGraphicsItem::CalendarGraphicsItem(CalendarControl * cc, QGraphicsItem *
 
       rt = QRectF(textItem->pos(), textItem->boundingRect().size());
 
-      QString additionalText;
-      if(_controller)
-        additionalText = _controller->contents(date);
+      QString additionalText = contents.value(date);
       textItem = new QGraphicsSimpleTextItem(additionalText, this);
       textItem->setFont(notesfont);
       textItem->setZValue(2);
@@ -237,6 +238,10 @@ void CalendarGraphicsItem::setSelectedDay(const QDate & sDate)
 
   QDate date;
   QApplication::setOverrideCursor(Qt::WaitCursor);
+  // one query for all 42 days instead of one per day
+  QMap<QDate, QString> contents;
+  if(_controller)
+    contents = _controller->rangeContents(firstCalendarDay, firstCalendarDay.addDays(41));
   for(int wday = 0; wday < 42; wday++)
   {
     date = firstCalendarDay.addDays(wday);
@@ -255,9 +260,7 @@ void CalendarGraphicsItem::setSelectedDay(const QDate & sDate)
     else if(date.dayOfWeek() > 5)
       fill = weekendFill;
 
-    QString additionalText;
-    if(_controller)
-      additionalText = _controller->contents(date);
+    QString additionalText = contents.value(date);
 
     QGraphicsRectItem * ri = static_cast<QGraphicsRectItem*>(_items[QString("day%1").arg(wday)]);
     if(ri)
@@ -40,15 +40,20 @@ SOURCES = applock.cpp              \
           login2.cpp \
           metrics.cpp \
           metricsenc.cpp \
+          preparedquery.cpp \
           qbase64encode.cpp \
           qmd5.cpp \
+          querytrace.cpp \
+          readreplica.cpp \
           shortcuts.cpp \
           storedProcErrorLookup.cpp \
           tarfile.cpp \
+          workerconnection.cpp \
           xbase32.cpp \
           xtupleproductkey.cpp \
           xtNetworkRequestManager.cpp \
-          xtsettings.cpp
+          xtsettings.cpp \
+          zipwriter.cpp
 HEADERS = applock.h              \
           calendarcontrol.h      \
           calendargraphicsitem.h \
@@ -62,15 +67,20 @@ HEADERS = applock.h              \
           login2.h \
           metrics.h \
           metricsenc.h \
+          preparedquery.h \
           qbase64encode.h \
           qmd5.h \
+          querytrace.h \
+          readreplica.h \
           shortcuts.h \
           storedProcErrorLookup.h \
           tarfile.h \
+          workerconnection.h \
           xbase32.h \
           xtupleproductkey.h \
           xtNetworkRequestManager.h \
-          xtsettings.h
+          xtsettings.h \
+          zipwriter.h
 
 FORMS = login2.ui checkForUpdates.ui
 
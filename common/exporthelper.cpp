@@ -25,6 +25,7 @@
 
 #include "metasql.h"
 #include "mqlutil.h"
+#include "readreplica.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -227,7 +228,7 @@ QString ExportHelper::generateDelimited(QString qtext, ParameterList &params, QS
 
   QStringList line;
   MetaSQLQuery mql(qtext);
-  XSqlQuery qry = mql.toQuery(params);
+  XSqlQuery qry = ReadReplica::query(mql, params);
   if (qry.first())
   {
     QStringList field;
@@ -325,7 +326,7 @@ QString ExportHelper::generateHTML(QString qtext, ParameterList &params, QString
            includeheader, valid);
 
   MetaSQLQuery mql(qtext);
-  XSqlQuery qry = mql.toQuery(params);
+  XSqlQuery qry = ReadReplica::query(mql, params);
   if (qry.first())
   {
     int cols = qry.record().count();
@@ -409,7 +410,7 @@ QString ExportHelper::generateXML(const int qryheadid, ParameterList &params, QS
     if (! qtext.isEmpty())
     {
       MetaSQLQuery mql(qtext);
-      XSqlQuery qry = mql.toQuery(params);
+      XSqlQuery qry = ReadReplica::query(mql, params);
       if (qry.first())
       {
         do {
@@ -465,7 +466,7 @@ QString ExportHelper::generateXML(QString qtext, QString tableElemName, Paramete
   if (! qtext.isEmpty())
   {
     MetaSQLQuery mql(qtext);
-    XSqlQuery qry = mql.toQuery(params);
+    XSqlQuery qry = ReadReplica::query(mql, params);
     if (qry.first())
     {
       do {
@@ -10,8 +10,10 @@
 
 #include "gunzip.h"
 
+#include <string.h>
 #include <zlib.h>
 #include <qbuffer.h>
+#include <qiodevice.h>
 
 QByteArray gunzipFile(const QString & file)
 {
@@ -45,3 +47,121 @@ QByteArray gunzipFile(const QString & file)
 
   return data;
 }
+
+GunzipReader::GunzipReader(QIODevice *source)
+  : _end(false),
+    _source(source),
+    _stream(new z_stream)
+{
+  _stream->zalloc   = Z_NULL;
+  _stream->zfree    = Z_NULL;
+  _stream->opaque   = Z_NULL;
+  _stream->next_in  = Z_NULL;
+  _stream->avail_in = 0;
+
+  // 16 + MAX_WBITS tells zlib to expect a gzip header and trailer
+  if (inflateInit2(_stream, 16 + MAX_WBITS) != Z_OK)
+  {
+    _error = QString("Could not initialize zlib: %1").arg(_stream->msg);
+    _end = true;
+  }
+}
+
+GunzipReader::~GunzipReader()
+{
+  inflateEnd(_stream);
+  delete _stream;
+  _stream = 0;
+}
+
+bool GunzipReader::atEnd() const
+{
+  return _end;
+}
+
+QString GunzipReader::errorString() const
+{
+  return _error;
+}
+
+/* Fill data with up to maxlen uncompressed bytes. Returns the number of
+   bytes read, 0 at the end of the data, or -1 on error.
+ */
+qint64 GunzipReader::read(char *data, qint64 maxlen)
+{
+  if (_end)
+    return _error.isEmpty() ? 0 : -1;
+
+  _stream->next_out  = (Bytef *)data;
+  _stream->avail_out = (uInt)qMin(maxlen, (qint64)0x7fffffff);
+
+  while (_stream->avail_out > 0)
+  {
+    if (_stream->avail_in == 0)
+    {
+      qint64 count = _source->read(_in, sizeof(_in));
+      if (count < 0)
+      {
+        _error = _source->errorString();
+        _end = true;
+        return -1;
+      }
+      if (count == 0)
+      {
+        _end = true;
+        break;
+      }
+      _stream->next_in  = (Bytef *)_in;
+      _stream->avail_in = (uInt)count;
+    }
+
+    int result = inflate(_stream, Z_NO_FLUSH);
+    if (result == Z_STREAM_END)
+    {
+      // concatenated gzip members are legal, but anything else after the
+      // end of a member, such as the zeros some tools pad archives with,
+      // is not gzip data and is ignored
+      if (nextMember())
+        inflateReset(_stream);
+      else
+      {
+        _end = true;
+        break;
+      }
+    }
+    else if (result != Z_OK && result != Z_BUF_ERROR)
+    {
+      _error = QString("Could not uncompress: %1").arg(_stream->msg ? _stream->msg : "");
+      _end = true;
+      return -1;
+    }
+  }
+
+  return maxlen - _stream->avail_out;
+}
+
+/* Is another gzip member next in the input? Reads ahead if fewer than the
+   two bytes of the magic number are left in the buffer.
+ */
+bool GunzipReader::nextMember()
+{
+  if (_stream->avail_in < 2)
+  {
+    if (_stream->avail_in > 0)
+      memmove(_in, _stream->next_in, _stream->avail_in);
+    qint64 count = _source->read(_in + _stream->avail_in, sizeof(_in) - _stream->avail_in);
+    _stream->next_in   = (Bytef *)_in;
+    _stream->avail_in += (uInt)qMax(count, (qint64)0);
+  }
+
+  return _stream->avail_in >= 2 &&
+         _stream->next_in[0] == 0x1f && _stream->next_in[1] == 0x8b;
+}
+
+/* Does source start with the gzip magic number? Doesn't consume anything. */
+bool GunzipReader::isGzip(QIODevice *source)
+{
+  QByteArray magic = source->peek(2);
+  return magic.size() == 2 &&
+         (unsigned char)magic.at(0) == 0x1f && (unsigned char)magic.at(1) == 0x8b;
+}
@@ -13,6 +13,34 @@
 
 #include <QString>
 
+class QIODevice;
+struct z_stream_s;
+
 QByteArray gunzipFile(const QString & file);
 
+/* Decompress gzip data from a QIODevice a buffer at a time instead of
+   holding the whole uncompressed result in memory.
+ */
+class GunzipReader
+{
+  public:
+    GunzipReader(QIODevice *source);
+    virtual ~GunzipReader();
+
+    bool    atEnd() const;
+    QString errorString() const;
+    qint64  read(char *data, qint64 maxlen);
+
+    static bool isGzip(QIODevice *source);
+
+  private:
+    bool nextMember();
+
+    bool        _end;
+    QString     _error;
+    char        _in[16384];
+    QIODevice  *_source;
+    z_stream_s *_stream;
+};
+
 #endif
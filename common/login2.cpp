@@ -28,6 +28,7 @@
 #include "errorReporter.h"
 #include "qmd5.h"
 #include "storedProcErrorLookup.h"
+#include "workerconnection.h"
 #include "xsqlquery.h"
 #include "xtsettings.h"
 
@@ -496,6 +497,8 @@ void login2::sLogin()
         _user = login.value("user").toString();
       // no error check - older databases don't have getEffectiveXtUser
 
+      WorkerConnection::setLoginSearchPath();
+
       accept();
     }
     else if (login.lastError().type() != QSqlError::NoError)
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "preparedquery.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QList>
+#include <QThread>
+#include <QVariant>
+
+#define DEBUG false
+
+#define DEFAULTSIZE 100     // statements
+#define MAXIDLE       4     // idle copies kept of any one statement
+
+/* Idle queries for one statement on one connection. _lastUse orders the
+   entries for eviction; queries that are checked out aren't in _idle.
+ */
+struct PreparedQueryEntry
+{
+  PreparedQueryEntry() : lastUse(0) {}
+  ~PreparedQueryEntry() { qDeleteAll(idle); }
+
+  QList<XSqlQuery*> idle;
+  qint64            lastUse;
+};
+
+static QHash<QString, PreparedQueryEntry*> _entries;
+static PreparedQuery::Stats                _stats;
+static int                                 _cacheSize         = DEFAULTSIZE;
+static int                                 _currentGeneration = 0;
+static qint64                              _clock             = 0;
+
+static bool onGuiThread()
+{
+  return QCoreApplication::instance() &&
+         QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+static void evict()
+{
+  while (_entries.size() > _cacheSize)
+  {
+    QString oldest;
+    qint64  oldestUse = -1;
+    QHashIterator<QString, PreparedQueryEntry*> it(_entries);
+    while (it.hasNext())
+    {
+      it.next();
+      if (oldestUse < 0 || it.value()->lastUse < oldestUse)
+      {
+        oldest    = it.key();
+        oldestUse = it.value()->lastUse;
+      }
+    }
+    if (DEBUG)
+      qDebug("PreparedQuery evicting %s", qPrintable(oldest));
+    delete _entries.take(oldest);
+    _stats.evictions++;
+  }
+}
+
+PreparedQuery::Stats::Stats()
+  : hits(0),
+    misses(0),
+    evictions(0),
+    statements(0)
+{
+}
+
+PreparedQuery::PreparedQuery(const QString &sql, const QSqlDatabase &db)
+  : _cached(onGuiThread()),
+    _generation(_currentGeneration),
+    _key(db.connectionName() + "\n" + sql),
+    _query(0)
+{
+  if (_cached)
+  {
+    PreparedQueryEntry *entry = _entries.value(_key);
+    if (entry && ! entry->idle.isEmpty())
+    {
+      _query = entry->idle.takeLast();
+      // a placeholder the caller forgets to bind must not keep the value
+      // from the query's last use
+      for (int i = _query->boundValues().size() - 1; i >= 0; i--)
+        _query->bindValue(i, QVariant());
+      entry->lastUse = ++_clock;
+      _stats.hits++;
+      return;
+    }
+    _stats.misses++;
+  }
+
+  _query = new XSqlQuery(db);
+  if (! _query->prepare(sql))
+    _cached = false;    // don't keep a statement the server rejected
+}
+
+PreparedQuery::~PreparedQuery()
+{
+  if (! _cached || _generation != _currentGeneration)
+  {
+    delete _query;
+    return;
+  }
+
+  _query->finish();
+
+  PreparedQueryEntry *entry = _entries.value(_key);
+  if (! entry)
+  {
+    entry = new PreparedQueryEntry();
+    _entries.insert(_key, entry);
+  }
+  entry->lastUse = ++_clock;
+
+  if (entry->idle.size() < MAXIDLE)
+    entry->idle.append(_query);
+  else
+    delete _query;
+
+  evict();
+}
+
+int PreparedQuery::cacheSize()
+{
+  return _cacheSize;
+}
+
+void PreparedQuery::setCacheSize(int statements)
+{
+  _cacheSize = qMax(0, statements);
+  evict();
+}
+
+/** @brief Forget every cached statement.
+
+    Queries that are checked out when this is called are deleted instead
+    of being returned to the cache.
+ */
+void PreparedQuery::invalidate()
+{
+  qDeleteAll(_entries);
+  _entries.clear();
+  _currentGeneration++;
+}
+
+PreparedQuery::Stats PreparedQuery::stats()
+{
+  Stats result = _stats;
+  result.statements = _entries.size();
+  return result;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PREPAREDQUERY_H__
+#define __PREPAREDQUERY_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+#include "xsqlquery.h"
+
+/** @brief Borrow an already-prepared XSqlQuery for a statement that runs often.
+
+    The PostgreSQL driver turns every prepare() into a named server-side
+    statement and drops it again when the query is destroyed, so a local
+    XSqlQuery that prepares the same text on every call makes the server
+    parse and plan it every time. A PreparedQuery checks a query for its
+    SQL text out of a per-connection cache, preparing it only the first
+    time, and gives it back when it goes out of scope:
+
+    @code
+    PreparedQuery convq("SELECT currToCurr(:from, :to, :amount, :date) AS result;");
+    convq->bindValue(":from", from);
+    ...
+    convq->exec();
+    if (convq->first())
+      return convq->value("result").toDouble();
+    else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error"), *convq, __FILE__, __LINE__))
+      ...
+    @endcode
+
+    Nested uses of the same text each get their own query. The cache holds
+    at most cacheSize() statements and drops the least recently used one
+    when it fills. Only the GUI thread uses the cache; elsewhere a
+    PreparedQuery is just a freshly prepared XSqlQuery. Bound values are
+    cleared when a cached query is handed out again. Call invalidate()
+    before reconnecting to the database, since the old statements are gone.
+ */
+class PreparedQuery
+{
+  public:
+    struct Stats
+    {
+      Stats();
+      qint64 hits;
+      qint64 misses;
+      qint64 evictions;
+      int    statements;
+    };
+
+    PreparedQuery(const QString &sql, const QSqlDatabase &db = QSqlDatabase::database());
+    ~PreparedQuery();
+
+    inline XSqlQuery *operator->() { return _query; }
+    inline XSqlQuery &operator*()  { return *_query; }
+
+    static int   cacheSize();
+    static void  setCacheSize(int statements);
+    static void  invalidate();
+    static Stats stats();
+
+  private:
+    Q_DISABLE_COPY(PreparedQuery)
+
+    bool       _cached;
+    int        _generation;
+    QString    _key;
+    XSqlQuery *_query;
+};
+
+#endif
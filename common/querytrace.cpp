@@ -0,0 +1,249 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "querytrace.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QIODevice>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QSqlQuery>
+#include <QTextStream>
+
+#define MAXSAMPLES    5000      // most recent samples kept for export
+#define MAXSTATEMENTS 1000      // least recently run statements are dropped
+#define STATEMENTLEN   200      // longer statements are truncated for grouping
+
+// upper bounds of the histogram buckets in msecs; the last one is open ended
+static const qint64 _bounds[QUERYTRACEBUCKETS - 1] = {
+  1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+struct QueryTraceSample
+{
+  qint64  when;
+  QString source;
+  QString statement;
+  QString sql;
+  int     params;
+  qint64  msecs;
+  int     rows;
+};
+
+static QMutex                            _lock;
+static bool                              _enabled = false;
+static QHash<QString, QueryTrace::Stats> _bySource;
+static QHash<QString, QueryTrace::Stats> _byStatement;
+static QHash<QString, qint64>            _lastRun;   // by statement
+static qint64                            _runCount = 0;
+static QList<QueryTraceSample>           _samples;
+
+static void addTo(QHash<QString, QueryTrace::Stats> &hash, const QString &name,
+                  qint64 msecs, int rows)
+{
+  QueryTrace::Stats &stats = hash[name];
+  stats.name = name;
+  stats.count++;
+  stats.totalMsecs += msecs;
+  stats.maxMsecs    = qMax(stats.maxMsecs, msecs);
+  if (rows > 0)
+    stats.rows += rows;
+
+  int bucket = 0;
+  while (bucket < QUERYTRACEBUCKETS - 1 && msecs >= _bounds[bucket])
+    bucket++;
+  stats.histogram[bucket]++;
+}
+
+static QString csv(const QString &field)
+{
+  QString result = field;
+  return "\"" + result.replace("\"", "\"\"") + "\"";
+}
+
+QueryTrace::Stats::Stats()
+  : count(0),
+    totalMsecs(0),
+    maxMsecs(0),
+    rows(0)
+{
+  for (int i = 0; i < QUERYTRACEBUCKETS; i++)
+    histogram[i] = 0;
+}
+
+QueryTrace::Timer::Timer(const QString &source, const QString &statement)
+  : _finished(false),
+    _source(source),
+    _statement(statement)
+{
+  if (QueryTrace::enabled())
+    _timer.start();
+}
+
+// a query abandoned on an early return still took time
+QueryTrace::Timer::~Timer()
+{
+  if (! _finished)
+    finish(QString());
+}
+
+void QueryTrace::Timer::finish(const QSqlQuery &query, int params)
+{
+  finish(query.lastQuery(), params, query.isSelect() ? query.size() : query.numRowsAffected());
+}
+
+void QueryTrace::Timer::finish(const QString &sql, int params, int rows)
+{
+  if (_finished)
+    return;
+  _finished = true;
+
+  if (_timer.isValid())
+    QueryTrace::record(_source, _statement, sql, params, _timer.elapsed(), rows);
+}
+
+bool QueryTrace::enabled()
+{
+  QMutexLocker locker(&_lock);
+  return _enabled;
+}
+
+void QueryTrace::setEnabled(bool enabled)
+{
+  QMutexLocker locker(&_lock);
+  _enabled = enabled;
+}
+
+/** @brief Add a sample.
+
+    @param source    Where the query came from, usually a window's objectName
+    @param statement A name for the statement, such as a MetaSQL group and
+                     name. If this is empty the SQL text is used.
+    @param sql       The SQL text that was run
+    @param params    The number of parameters bound to it
+    @param msecs     How long it took
+    @param rows      The number of rows returned or affected, or -1 if unknown
+ */
+void QueryTrace::record(const QString &source, const QString &statement,
+                        const QString &sql, int params, qint64 msecs, int rows)
+{
+  QueryTraceSample sample;
+  sample.when      = QDateTime::currentMSecsSinceEpoch();
+  sample.source    = source.isEmpty() ? QObject::tr("(unknown)") : source;
+  sample.statement = statement;
+  if (sample.statement.isEmpty())
+    sample.statement = sql.simplified().left(STATEMENTLEN);
+  sample.sql       = sql;
+  sample.params    = params;
+  sample.msecs     = msecs;
+  sample.rows      = rows;
+
+  QMutexLocker locker(&_lock);
+  if (! _enabled)
+    return;
+
+  // statements built with literal values are all different, so keep the
+  // number of them bounded by dropping the one that ran longest ago
+  if (_byStatement.size() >= MAXSTATEMENTS &&
+      ! _byStatement.contains(sample.statement))
+  {
+    QHash<QString, qint64>::const_iterator oldest = _lastRun.constBegin();
+    for (QHash<QString, qint64>::const_iterator it = _lastRun.constBegin();
+         it != _lastRun.constEnd(); ++it)
+      if (it.value() < oldest.value())
+        oldest = it;
+    if (oldest != _lastRun.constEnd())
+    {
+      QString statement = oldest.key();
+      _byStatement.remove(statement);
+      _lastRun.remove(statement);
+    }
+  }
+
+  addTo(_bySource,    sample.source,    msecs, rows);
+  addTo(_byStatement, sample.statement, msecs, rows);
+  _lastRun.insert(sample.statement, ++_runCount);
+  _samples.append(sample);
+  while (_samples.size() > MAXSAMPLES)
+    _samples.removeFirst();
+}
+
+QStringList QueryTrace::bucketLabels()
+{
+  QStringList labels;
+  for (int i = 0; i < QUERYTRACEBUCKETS - 1; i++)
+    labels << QObject::tr("< %1 ms").arg(_bounds[i]);
+  labels << QObject::tr(">= %1 ms").arg(_bounds[QUERYTRACEBUCKETS - 2]);
+  return labels;
+}
+
+QList<QueryTrace::Stats> QueryTrace::bySource()
+{
+  QMutexLocker locker(&_lock);
+  return _bySource.values();
+}
+
+QList<QueryTrace::Stats> QueryTrace::byStatement()
+{
+  QMutexLocker locker(&_lock);
+  return _byStatement.values();
+}
+
+int QueryTrace::sampleCount()
+{
+  QMutexLocker locker(&_lock);
+  return _samples.size();
+}
+
+void QueryTrace::clear()
+{
+  QMutexLocker locker(&_lock);
+  _bySource.clear();
+  _byStatement.clear();
+  _lastRun.clear();
+  _samples.clear();
+}
+
+/** @brief Write the recent samples to a device as CSV.
+
+    There is one line per sample with its time, source, statement,
+    parameter count, elapsed msecs, row count and SQL text.
+ */
+bool QueryTrace::exportTo(QIODevice *device, QString *errmsg)
+{
+  QList<QueryTraceSample> samples;
+  {
+    QMutexLocker locker(&_lock);
+    samples = _samples;
+  }
+
+  QTextStream out(device);
+  out.setCodec("UTF-8");
+  out << "time,source,statement,params,msecs,rows,sql\n";
+  foreach (const QueryTraceSample &sample, samples)
+    out << QDateTime::fromMSecsSinceEpoch(sample.when).toString(Qt::ISODate) << ","
+        << csv(sample.source)    << ","
+        << csv(sample.statement) << ","
+        << sample.params         << ","
+        << sample.msecs          << ","
+        << sample.rows           << ","
+        << csv(sample.sql)       << "\n";
+  out.flush();
+
+  if (out.status() != QTextStream::Ok)
+  {
+    if (errmsg)
+      *errmsg = device->errorString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __QUERYTRACE_H__
+#define __QUERYTRACE_H__
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+class QSqlQuery;
+
+#define QUERYTRACEBUCKETS 13
+
+/** @brief Collect timings of the queries the client runs.
+
+    Each sample records where a query came from, usually the name of the
+    window, the statement, how many parameters were bound, how long it took
+    and how many rows it returned. Samples are aggregated by source and by
+    statement into latency histograms, and the most recent ones are kept
+    for export. Tracing is off until setEnabled() turns it on. All of the
+    static methods may be called from any thread.
+
+    The usual way to add a sample is with a QueryTrace::Timer:
+
+    @code
+    QueryTrace::Timer timer(objectName(), "bankrec-receipts");
+    XSqlQuery qry = mql.toQuery(params);
+    timer.finish(qry, params.count());
+    @endcode
+ */
+class QueryTrace
+{
+  public:
+    struct Stats
+    {
+      Stats();
+      QString name;
+      int     count;
+      qint64  totalMsecs;
+      qint64  maxMsecs;
+      qint64  rows;
+      int     histogram[QUERYTRACEBUCKETS];
+    };
+
+    class Timer
+    {
+      public:
+        Timer(const QString &source, const QString &statement = QString());
+        ~Timer();
+
+        void finish(const QSqlQuery &query, int params = 0);
+        void finish(const QString &sql, int params = 0, int rows = -1);
+
+      private:
+        bool          _finished;
+        QString       _source;
+        QString       _statement;
+        QElapsedTimer _timer;
+    };
+
+    static bool enabled();
+    static void setEnabled(bool enabled);
+
+    static void record(const QString &source, const QString &statement,
+                       const QString &sql, int params, qint64 msecs, int rows);
+
+    static QStringList  bucketLabels();
+    static QList<Stats> bySource();
+    static QList<Stats> byStatement();
+    static int          sampleCount();
+    static void         clear();
+    static bool         exportTo(QIODevice *device, QString *errmsg = 0);
+};
+
+#endif
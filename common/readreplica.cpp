@@ -0,0 +1,264 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "readreplica.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QVariant>
+
+#include "dbtools.h"
+#include "metasql.h"
+
+#define DEBUG false
+
+#define CONNECTIONNAME "readReplica"
+#define CHECKINTERVAL  30000    // msecs between health checks
+#define MAXINTERVAL   600000    // longest wait between checks after failures
+#define CONNECTTIMEOUT     5    // seconds to wait for the replica to answer
+#define DEFAULTMAXLAG     30    // seconds
+
+static bool          _open     = false;
+static bool          _healthy  = false;
+static int           _interval = CHECKINTERVAL;
+static int           _maxLag   = DEFAULTMAXLAG;
+static QString       _searchPath;
+static QString       _status;
+static QElapsedTimer _lastCheck;
+
+static bool onGuiThread()
+{
+  return QCoreApplication::instance() &&
+         QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+/* Wait longer between checks each time one fails, so an unreachable
+   replica doesn't stall the GUI thread every CHECKINTERVAL.
+ */
+static void failed(const QString &status)
+{
+  _healthy  = false;
+  _status   = status;
+  _interval = qMin(_interval * 2, MAXINTERVAL);
+}
+
+/* Is the replica reachable and close enough to the primary? A server
+   that isn't in recovery is a stand-in, so it's never behind. A replica
+   that has replayed everything it received is current even if the last
+   replayed transaction is old because the primary has been idle, but
+   only while its WAL receiver is connected; otherwise there may be WAL
+   on the primary that it hasn't received, so the age of the last
+   replayed transaction is all there is to go on.
+ */
+static void check()
+{
+  _lastCheck.start();
+
+  QSqlDatabase db = QSqlDatabase::database(CONNECTIONNAME, false);
+  if (! db.isOpen())
+  {
+    if (! db.open())
+    {
+      failed(QObject::tr("Cannot connect: %1").arg(db.lastError().text()));
+      return;
+    }
+    if (! _searchPath.isEmpty())
+      QSqlQuery(db).exec(QString("SET search_path TO %1;").arg(_searchPath));
+  }
+
+  QSqlQuery lagq(db);
+  QString   lagsql;
+  if (lagq.exec("SELECT pg_is_in_recovery() AS recovery,"
+                "       current_setting('server_version_num')::integer AS version;") &&
+      lagq.first() && lagq.value("recovery").toBool())
+  {
+    // the functions were renamed in 10; pg_stat_wal_receiver is new in 9.6
+    int  version = lagq.value("version").toInt();
+    bool renamed = version >= 100000;
+    lagsql = QString("SELECT CASE WHEN %1 AND %2() = %3() THEN 0"
+                     "            ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()), 0)"
+                     "        END AS lag,"
+                     "       %1 AS receiving;")
+               .arg(version >= 90600 ? "EXISTS(SELECT 1 FROM pg_stat_wal_receiver)" : "false",
+                    renamed ? "pg_last_wal_receive_lsn" : "pg_last_xlog_receive_location",
+                    renamed ? "pg_last_wal_replay_lsn"  : "pg_last_xlog_replay_location");
+  }
+  else
+    lagsql = "SELECT 0 AS lag, true AS receiving;";
+  if (! lagq.exec(lagsql) || ! lagq.first())
+  {
+    failed(QObject::tr("Cannot check replication lag: %1").arg(lagq.lastError().text()));
+    db.close();         // reconnect on the next check
+    return;
+  }
+
+  double lag = lagq.value("lag").toDouble();
+  _interval = CHECKINTERVAL;
+  _healthy  = lag <= _maxLag;
+  _status   = _healthy ? QObject::tr("%1 seconds behind").arg(lag, 0, 'f', 0)
+                       : QObject::tr("%1 seconds behind, more than the %2 allowed")
+                           .arg(lag, 0, 'f', 0).arg(_maxLag);
+  if (! lagq.value("receiving").toBool())
+    _status += QObject::tr(" (not receiving from the primary)");
+  if (DEBUG)
+    qDebug("ReadReplica::check() %s", qPrintable(_status));
+}
+
+/** @brief Open the replica connection.
+
+    @param databaseURL The replica, in the same psql://host:port/database
+                       form as the main connection.
+    @param primary     The connection whose user, password and search_path
+                       the replica connection copies.
+    @param errmsg      Set to the reason if the replica can't be opened.
+
+    @return true if the replica is open. The client carries on with the
+            primary alone if it isn't.
+ */
+bool ReadReplica::open(const QString &databaseURL, const QSqlDatabase &primary,
+                       QString *errmsg)
+{
+  close();
+
+  QString protocol;
+  QString hostName;
+  QString dbName;
+  QString port;
+  parseDatabaseURL(databaseURL, protocol, hostName, dbName, port);
+
+  // don't let an unreachable replica hang the GUI thread
+  QString options = primary.connectOptions();
+  if (! options.contains("connect_timeout"))
+    options += QString("%1connect_timeout=%2").arg(options.isEmpty() ? "" : ";")
+                                              .arg(CONNECTTIMEOUT);
+
+  QSqlDatabase db = QSqlDatabase::addDatabase(primary.driverName(), CONNECTIONNAME);
+  db.setConnectOptions(options);
+  db.setDatabaseName(dbName);
+  db.setHostName(hostName);
+  db.setPassword(primary.password());
+  db.setPort(port.toInt());
+  db.setUserName(primary.userName());
+
+  if (! db.open())
+  {
+    if (errmsg)
+      *errmsg = db.lastError().text();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(CONNECTIONNAME);
+    return false;
+  }
+
+  QSqlQuery pathq(primary);
+  if (pathq.exec("SHOW search_path;") && pathq.first())
+    _searchPath = pathq.value(0).toString();
+  if (! _searchPath.isEmpty())
+    QSqlQuery(db).exec(QString("SET search_path TO %1;").arg(_searchPath));
+
+  _open     = true;
+  _interval = CHECKINTERVAL;
+  check();
+  if (! _healthy && errmsg)
+    *errmsg = _status;
+  return true;
+}
+
+void ReadReplica::close()
+{
+  if (! _open)
+    return;
+
+  _open    = false;
+  _healthy = false;
+  _status  = QString();
+  {
+    QSqlDatabase db = QSqlDatabase::database(CONNECTIONNAME, false);
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(CONNECTIONNAME);
+}
+
+bool ReadReplica::isOpen()
+{
+  return _open;
+}
+
+/** @brief The connection read-only queries should use right now.
+
+    This is the replica if one is open, healthy at the last check and
+    the caller is on the GUI thread, otherwise the default connection.
+ */
+QSqlDatabase ReadReplica::database()
+{
+  if (! _open || ! onGuiThread())
+    return QSqlDatabase::database();
+
+  if (! _lastCheck.isValid() || _lastCheck.elapsed() > _interval)
+    check();
+
+  return _healthy ? QSqlDatabase::database(CONNECTIONNAME, false)
+                  : QSqlDatabase::database();
+}
+
+bool ReadReplica::isReplica(const QSqlDatabase &db)
+{
+  return _open && db.connectionName() == CONNECTIONNAME;
+}
+
+/** @brief Run @a mql on the replica, falling back to the primary if it fails there.
+ */
+XSqlQuery ReadReplica::query(MetaSQLQuery &mql, const ParameterList &params)
+{
+  QSqlDatabase db = database();
+  XSqlQuery qry = mql.toQuery(params, db);
+  if (qry.lastError().type() != QSqlError::NoError && isReplica(db))
+    qry = mql.toQuery(params, fallBack(db, qry.lastError().text()));
+  return qry;
+}
+
+/** @brief Give up on @a db after work on it failed and return the primary.
+
+    Callers that run their own queries on database(), such as report
+    rendering, use this to retry on the primary the way query() does.
+    If the replica connection was lost it is not used again until the
+    next successful check.
+ */
+QSqlDatabase ReadReplica::fallBack(const QSqlDatabase &db, const QString &reason)
+{
+  if (isReplica(db))
+  {
+    qWarning("ReadReplica falling back to the primary: %s", qPrintable(reason));
+    if (! db.isOpen())
+      failed(QObject::tr("Connection lost: %1").arg(reason));
+  }
+  return QSqlDatabase::database();
+}
+
+int ReadReplica::maxLag()
+{
+  return _maxLag;
+}
+
+void ReadReplica::setMaxLag(int seconds)
+{
+  _maxLag = qMax(0, seconds);
+  _lastCheck.invalidate();
+}
+
+/** @brief Describe the replica's state for display. */
+QString ReadReplica::status()
+{
+  if (! _open)
+    return QObject::tr("No replica");
+  return _status;
+}
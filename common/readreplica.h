@@ -0,0 +1,65 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __READREPLICA_H__
+#define __READREPLICA_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+#include <parameter.h>
+
+#include "xsqlquery.h"
+
+class MetaSQLQuery;
+
+/** @brief Send read-only work to a streaming replica of the main database.
+
+    If the client was started with -replicaURL=psql://host:port/database,
+    or the replicaDatabaseURL setting names one, main() opens a second
+    connection there after login, using the same user, password and
+    search_path as the main connection. Display windows, report data and
+    data exports then run their queries on the replica so month-end
+    reporting doesn't compete with order entry on the primary.
+
+    database() returns the replica only while it looks healthy. The
+    replica is checked every CHECKINTERVAL msecs, less often while it
+    can't be reached. If it has fallen more than maxLag() seconds behind
+    the primary or can't be reached, callers get the primary connection
+    until a later check passes. query() also
+    reruns a statement on the primary if it fails on the replica, for
+    example because it tried to write; callers that run their own
+    queries use fallBack() to do the same.
+
+    Any PostgreSQL server with the same schema can stand in for a replica
+    when testing; one that isn't in recovery is treated as never behind.
+    The replica connection belongs to the GUI thread; other threads
+    always get the primary.
+ */
+class ReadReplica
+{
+  public:
+    static bool         open(const QString &databaseURL,
+                             const QSqlDatabase &primary = QSqlDatabase::database(),
+                             QString *errmsg = 0);
+    static void         close();
+    static bool         isOpen();
+
+    static QSqlDatabase database();
+    static bool         isReplica(const QSqlDatabase &db);
+    static XSqlQuery    query(MetaSQLQuery &mql, const ParameterList &params);
+    static QSqlDatabase fallBack(const QSqlDatabase &db, const QString &reason);
+
+    static int          maxLag();
+    static void         setMaxLag(int seconds);
+    static QString      status();
+};
+
+#endif
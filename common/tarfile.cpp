@@ -12,6 +12,12 @@
 
 #include <qtextstream.h>
 #include <qbuffer.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qobject.h>
+
+#include "gunzip.h"
 
 struct tarHeaderBlock {
     char name[100];     // name of file
@@ -43,7 +49,12 @@ const char TYPE_FIFO        = '6';  // FIFO special file
 const char TYPE_CONTIGUOS   = '7';  // RESERVERED/Contiguous file
 
 
-TarFile::TarFile(const QByteArray & bytes)
+TarReader::TarReader(QIODevice *source)
+  : _gunzip(0),
+    _padding(0),
+    _remaining(0),
+    _size(0),
+    _source(source)
 {
   Q_UNUSED(TYPE_LINK);
   Q_UNUSED(TYPE_SYMLINK);
@@ -52,62 +63,263 @@ TarFile::TarFile(const QByteArray & bytes)
   Q_UNUSED(TYPE_DIR);
   Q_UNUSED(TYPE_FIFO);
   Q_UNUSED(TYPE_CONTIGUOS);
-  _valid = false;
 
-  QByteArray localBytes(bytes);
-  QBuffer fin(&localBytes);
-  if(!fin.open(QIODevice::ReadOnly))
-    return;
+  if (! _source || ! _source->isReadable())
+    _error = QObject::tr("Could not read the archive");
+  else if (GunzipReader::isGzip(_source))
+    _gunzip = new GunzipReader(_source);
+}
+
+TarReader::~TarReader()
+{
+  if (_gunzip)
+    delete _gunzip;
+  _gunzip = 0;
+}
+
+bool TarReader::isValid() const
+{
+  return _error.isEmpty();
+}
+
+QString TarReader::errorString() const
+{
+  return _error;
+}
+
+/* One message for each entry extract() or extractAll() could not write.
+   These don't make the archive invalid; later entries are still read.
+ */
+QStringList TarReader::fileErrors() const
+{
+  return _fileErrors;
+}
+
+/* Name and size of the current entry, valid after next() returns true. */
+QString TarReader::name() const
+{
+  return _name;
+}
+
+qint64 TarReader::size() const
+{
+  return _size;
+}
+
+qint64 TarReader::readRaw(char *data, qint64 maxlen)
+{
+  qint64 total = 0;
+  while (total < maxlen)
+  {
+    qint64 count = _gunzip ? _gunzip->read(data + total, maxlen - total)
+                           : _source->read(data + total, maxlen - total);
+    if (count < 0)
+    {
+      _error = _gunzip ? _gunzip->errorString() : _source->errorString();
+      return -1;
+    }
+    if (count == 0)
+      break;
+    total += count;
+  }
+  return total;
+}
 
-  bool valid = false;
-  long size = 0;
-  long blocks = 0;
+bool TarReader::skip(qint64 bytes)
+{
   char block[512];
-  QString name, str;
+  while (bytes > 0)
+  {
+    qint64 count = readRaw(block, qMin(bytes, (qint64)sizeof(block)));
+    if (count <= 0)
+      return false;
+    bytes -= count;
+  }
+  return true;
+}
 
-  while(!fin.atEnd())
+/* Advance to the next regular file in the archive, skipping whatever is
+   left of the current entry. Returns false at the end of the archive or
+   on error; check isValid() to tell the two apart.
+ */
+bool TarReader::next()
+{
+  if (! isValid())
+    return false;
+
+  if (! skip(_remaining + _padding))
+  {
+    if (isValid())
+      _error = QObject::tr("The archive is truncated");
+    return false;
+  }
+  _remaining = _padding = 0;
+  _name.clear();
+  _size = 0;
+
+  tarHeaderBlock head;
+  while (true)
   {
-    tarHeaderBlock head;
-    fin.read((char*)&head, sizeof(head));
+    qint64 count = readRaw((char*)&head, sizeof(head));
+    if (count <= 0)
+      return false;
+    if (count != sizeof(head))
+    {
+      _error = QObject::tr("The archive is truncated");
+      return false;
+    }
 
     if(head.name[0] == '\0' && head.size[0] == '\0' && head.typeflag == '\0')
       continue;
 
-    QString magic(head.magic);
-    if(magic.trimmed() != "ustar")
-      return;
+    if (qstrncmp(head.magic, "ustar", 5) != 0)
+    {
+      _error = QObject::tr("The file is not a tar archive");
+      return false;
+    }
 
-    name = QString(head.name);
-    str = QString(head.size);
-    str.remove(sizeof head.size, sizeof head);
-    size = str.toLong(&valid, 8);
+    bool valid = false;
+    qint64 size = QString::fromLatin1(head.size, qstrnlen(head.size, sizeof head.size))
+                    .trimmed().toLongLong(&valid, 8);
+    if (! valid || size < 0)
+    {
+      _error = QObject::tr("The archive has an invalid header");
+      return false;
+    }
 
     if(head.typeflag == TYPE_REGULAR_ALT)
       head.typeflag = TYPE_REGULAR;
 
-    blocks = (size + 511) / 512;
-
-    if(head.typeflag == TYPE_REGULAR)
+    qint64 padding = (512 - size % 512) % 512;
+    if (head.typeflag != TYPE_REGULAR)
     {
-      QByteArray mybytes;
-      QBuffer fout(&mybytes);
-      fout.open(QIODevice::WriteOnly);
-      for(int i = 0; i < blocks; i++)
+      if (! skip(size + padding))
       {
-        fin.read(&block[0], 512);
-        fout.write(&block[0], qMin(size,512L));
-        size -= 512;
+        if (isValid())
+          _error = QObject::tr("The archive is truncated");
+        return false;
       }
-      fout.close();
-      _list.insert(name, mybytes);
+      continue;
+    }
+
+    _name = QString::fromLocal8Bit(head.name, qstrnlen(head.name, sizeof head.name));
+    // only POSIX ustar uses the prefix; old GNU headers store times there
+    if (memcmp(head.magic, "ustar\0", 6) == 0 && head.prefix[0] != '\0')
+      _name = QString::fromLocal8Bit(head.prefix, qstrnlen(head.prefix, sizeof head.prefix))
+            + "/" + _name;
+    _size      = size;
+    _remaining = size;
+    _padding   = padding;
+    return true;
+  }
+}
+
+/* Read up to maxlen bytes of the current entry's contents. */
+qint64 TarReader::read(char *data, qint64 maxlen)
+{
+  qint64 count = readRaw(data, qMin(maxlen, _remaining));
+  if (count > 0)
+    _remaining -= count;
+  return count;
+}
+
+QByteArray TarReader::readAll()
+{
+  QByteArray bytes;
+  bytes.resize((int)_remaining);
+  qint64 count = read(bytes.data(), _remaining);
+  bytes.resize((int)qMax(count, (qint64)0));
+  return bytes;
+}
+
+/* Write the rest of the current entry to filename in fixed-size chunks.
+   If the file can't be written the failure is added to fileErrors() and
+   the rest of the entry is skipped by the next call to next().
+ */
+bool TarReader::extract(const QString &filename)
+{
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly))
+  {
+    _fileErrors.append(QObject::tr("Could not write %1: %2").arg(filename, file.errorString()));
+    return false;
+  }
+
+  char block[16384];
+  while (_remaining > 0)
+  {
+    qint64 count = read(block, sizeof(block));
+    if (count <= 0)
+    {
+      if (isValid())
+        _error = QObject::tr("The archive is truncated");
+      return false;
+    }
+    if (file.write(block, count) != count)
+    {
+      _fileErrors.append(QObject::tr("Could not write %1: %2").arg(filename, file.errorString()));
+      return false;
+    }
+  }
+  file.close();
+  return true;
+}
+
+/* Extract every regular file into dir, creating subdirectories as needed.
+   Entries that would land outside dir are rejected. The names of files
+   written are appended to files if it is given. A file that can't be
+   written doesn't stop the others; returns true only if every entry was
+   extracted, with fileErrors() saying why each failed one did not.
+ */
+bool TarReader::extractAll(const QString &dir, QStringList *files)
+{
+  QDir target(dir);
+  if (! target.exists() && ! target.mkpath("."))
+  {
+    _fileErrors.append(QObject::tr("Could not create %1").arg(dir));
+    return false;
+  }
+  QString root = QDir::cleanPath(target.absolutePath()) + "/";
+
+  while (next())
+  {
+    QString filename = QDir::cleanPath(target.absoluteFilePath(_name));
+    if (QDir::isAbsolutePath(_name) || ! filename.startsWith(root))
+    {
+      _fileErrors.append(QObject::tr("The archive entry %1 is outside %2").arg(_name, dir));
+      continue;
+    }
+    if (! QDir().mkpath(QFileInfo(filename).absolutePath()))
+    {
+      _fileErrors.append(QObject::tr("Could not create %1").arg(QFileInfo(filename).absolutePath()));
+      continue;
     }
-    else
+    if (! extract(filename))
     {
-      for(int i = 0; i < blocks; i++)
-        fin.read(&block[0], 512);
+      if (! isValid())
+        return false;
+      continue;
     }
+    if (files)
+      files->append(_name);
   }
-  _valid = true;
+  return isValid() && _fileErrors.isEmpty();
+}
+
+TarFile::TarFile(const QByteArray & bytes)
+{
+  _valid = false;
+
+  QBuffer fin;
+  fin.setData(bytes);
+  if(!fin.open(QIODevice::ReadOnly))
+    return;
+
+  TarReader reader(&fin);
+  while (reader.next())
+    _list.insert(reader.name(), reader.readAll());
+
+  _valid = reader.isValid();
 }
 
 TarFile::~TarFile()
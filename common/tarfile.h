@@ -12,8 +12,47 @@
 #define __TARFILE_H__
 
 #include <QString>
+#include <QStringList>
 #include <QMap>
 
+class GunzipReader;
+class QIODevice;
+
+/* Walk a tar archive one entry at a time, reading from a QIODevice.
+   gzip-compressed archives are detected and uncompressed on the fly so
+   callers can extract large archives without holding them in memory.
+ */
+class TarReader {
+  public:
+    TarReader(QIODevice *source);
+    virtual ~TarReader();
+
+    bool       next();
+    QString    name() const;
+    qint64     size() const;
+    qint64     read(char *data, qint64 maxlen);
+    QByteArray readAll();
+    bool       extract(const QString &filename);
+    bool       extractAll(const QString &dir, QStringList *files = 0);
+
+    bool        isValid() const;
+    QString     errorString() const;
+    QStringList fileErrors() const;
+
+  private:
+    qint64 readRaw(char *data, qint64 maxlen);
+    bool   skip(qint64 bytes);
+
+    QString       _error;
+    QStringList   _fileErrors;
+    GunzipReader *_gunzip;
+    QString       _name;
+    qint64        _padding;
+    qint64        _remaining;
+    qint64        _size;
+    QIODevice    *_source;
+};
+
 class TarFile {
   public:
     TarFile(const QByteArray &);
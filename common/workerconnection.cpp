@@ -0,0 +1,113 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "workerconnection.h"
+
+#include <QAtomicInt>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+static QAtomicInt _connectionCounter(0);
+
+QString WorkerConnection::_loginSearchPath;
+
+/** @brief Capture the parameters of @a source.
+
+    This must be called on the thread that owns @a source, normally the
+    GUI thread. The session search_path is copied too so that worker
+    queries resolve package tables and functions the same way the main
+    connection does without calling login() again. For the default
+    connection the path saved by setLoginSearchPath() is used, so no
+    query is run on the GUI connection.
+ */
+WorkerConnection::WorkerConnection(const QSqlDatabase &source)
+  : _connectOptions(source.connectOptions()),
+    _databaseName(source.databaseName()),
+    _driverName(source.driverName()),
+    _hostName(source.hostName()),
+    _password(source.password()),
+    _port(source.port()),
+    _userName(source.userName())
+{
+  if (! _loginSearchPath.isEmpty() &&
+      source.connectionName() == QLatin1String(QSqlDatabase::defaultConnection))
+    _searchPath = _loginSearchPath;
+  else if (source.isOpen())
+  {
+    QSqlQuery pathq(source);
+    if (pathq.exec("SHOW search_path;") && pathq.first())
+      _searchPath = pathq.value(0).toString();
+  }
+}
+
+bool WorkerConnection::isValid() const
+{
+  return ! _driverName.isEmpty() && ! _databaseName.isEmpty();
+}
+
+/** @brief Open a new connection from the calling thread.
+
+    The connection gets a unique name starting with @a prefix.
+    Close it with WorkerConnection::close() from the same thread.
+
+    @return The open connection or an invalid QSqlDatabase on failure,
+            in which case @a errmsg describes the problem.
+ */
+QSqlDatabase WorkerConnection::open(const QString &prefix, QString *errmsg) const
+{
+  QString name = QString("%1_%2").arg(prefix)
+                                 .arg(_connectionCounter.fetchAndAddOrdered(1));
+  QSqlDatabase db = QSqlDatabase::addDatabase(_driverName, name);
+  db.setConnectOptions(_connectOptions);
+  db.setDatabaseName(_databaseName);
+  db.setHostName(_hostName);
+  db.setPassword(_password);
+  db.setPort(_port);
+  db.setUserName(_userName);
+
+  if (! db.open())
+  {
+    if (errmsg)
+      *errmsg = db.lastError().text();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+    return QSqlDatabase();
+  }
+
+  if (! _searchPath.isEmpty())
+  {
+    QSqlQuery pathq(db);
+    if (! pathq.exec(QString("SET search_path TO %1;").arg(_searchPath)) && errmsg)
+      *errmsg = pathq.lastError().text();
+  }
+
+  return db;
+}
+
+/** @brief Remember the search_path that login() set on @a db.
+
+    Call this once after logging in, and again after reconnecting.
+ */
+void WorkerConnection::setLoginSearchPath(const QSqlDatabase &db)
+{
+  QSqlQuery pathq(db);
+  if (pathq.exec("SHOW search_path;") && pathq.first())
+    _loginSearchPath = pathq.value(0).toString();
+}
+
+void WorkerConnection::close(QSqlDatabase &db)
+{
+  QString name = db.connectionName();
+  db.close();
+  db = QSqlDatabase();
+  if (! name.isEmpty())
+    QSqlDatabase::removeDatabase(name);
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __WORKERCONNECTION_H__
+#define __WORKERCONNECTION_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+/** @brief Describe a database connection that a worker thread can open.
+
+    QSqlDatabase connections may only be used by the thread that opened
+    them. Construct a WorkerConnection on the GUI thread to capture the
+    connection parameters and session search_path of an existing
+    connection, then call open() from the worker thread to get a private
+    connection to the same database as the same user.
+ */
+class WorkerConnection
+{
+  public:
+    WorkerConnection(const QSqlDatabase &source = QSqlDatabase::database());
+
+    bool         isValid() const;
+    QSqlDatabase open(const QString &prefix, QString *errmsg = 0) const;
+
+    static void  close(QSqlDatabase &db);
+    static void  setLoginSearchPath(const QSqlDatabase &db = QSqlDatabase::database());
+
+  private:
+    QString _connectOptions;
+    QString _databaseName;
+    QString _driverName;
+    QString _hostName;
+    QString _password;
+    int     _port;
+    QString _searchPath;
+    QString _userName;
+
+    static QString _loginSearchPath;
+};
+
+#endif
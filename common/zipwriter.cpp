@@ -0,0 +1,263 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "zipwriter.h"
+
+#include <zlib.h>
+#include <qdatetime.h>
+#include <qiodevice.h>
+#include <qobject.h>
+
+#define ZIP_LOCAL_HEADER   0x04034b50
+#define ZIP_DESCRIPTOR     0x08074b50
+#define ZIP_CENTRAL_HEADER 0x02014b50
+#define ZIP_END_OF_CENTRAL 0x06054b50
+#define ZIP_VERSION        20
+#define ZIP_HAS_DESCRIPTOR 0x0008
+
+static void putShort(QByteArray &buf, quint16 value)
+{
+  buf.append((char)(value & 0xff));
+  buf.append((char)((value >> 8) & 0xff));
+}
+
+static void putLong(QByteArray &buf, quint32 value)
+{
+  putShort(buf, (quint16)(value & 0xffff));
+  putShort(buf, (quint16)((value >> 16) & 0xffff));
+}
+
+ZipWriter::ZipWriter(QIODevice *dest)
+  : _dest(dest),
+    _inFile(false),
+    _offset(0),
+    _stream(new z_stream)
+{
+  _stream->zalloc = Z_NULL;
+  _stream->zfree  = Z_NULL;
+  _stream->opaque = Z_NULL;
+}
+
+ZipWriter::~ZipWriter()
+{
+  if (_inFile)
+    deflateEnd(_stream);
+  delete _stream;
+  _stream = 0;
+}
+
+QString ZipWriter::errorString() const
+{
+  return _error;
+}
+
+/* Add a complete member in one call. Uncompressed members are needed for
+   things like the OpenDocument mimetype, which readers expect to find
+   stored as the first entry of the archive.
+ */
+bool ZipWriter::addFile(const QString &name, const QByteArray &data, bool compress)
+{
+  if (compress)
+    return beginFile(name) && write(data) && endFile();
+
+  if (_inFile && ! endFile())
+    return false;
+
+  Entry entry;
+  entry.name           = name.toUtf8();
+  entry.method         = 0;
+  entry.flags          = 0;
+  entry.crc            = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data.constData(), data.size());
+  entry.compressedSize = data.size();
+  entry.size           = data.size();
+  entry.offset         = _offset;
+
+  if (! writeLocalHeader(entry) || ! writeRaw(data))
+    return false;
+
+  _entries.append(entry);
+  return true;
+}
+
+/* Start a deflated member whose size isn't known yet. The crc and sizes
+   follow the data in a descriptor record written by endFile().
+ */
+bool ZipWriter::beginFile(const QString &name)
+{
+  if (_inFile && ! endFile())
+    return false;
+
+  _current.name           = name.toUtf8();
+  _current.method         = Z_DEFLATED;
+  _current.flags          = ZIP_HAS_DESCRIPTOR;
+  _current.crc            = crc32(0L, Z_NULL, 0);
+  _current.compressedSize = 0;
+  _current.size           = 0;
+  _current.offset         = _offset;
+
+  // negative window bits give a raw deflate stream, which is what zip wants
+  if (deflateInit2(_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    _error = QObject::tr("Could not initialize zlib: %1").arg(_stream->msg ? _stream->msg : "");
+    return false;
+  }
+  _inFile = true;
+
+  return writeLocalHeader(_current);
+}
+
+bool ZipWriter::write(const QByteArray &data)
+{
+  if (! _inFile)
+  {
+    _error = QObject::tr("No zip entry is open for writing");
+    return false;
+  }
+  if (data.isEmpty())
+    return true;
+
+  _current.crc   = crc32(_current.crc, (const Bytef *)data.constData(), data.size());
+  _current.size += data.size();
+
+  return deflateData(data.constData(), data.size(), Z_NO_FLUSH);
+}
+
+bool ZipWriter::endFile()
+{
+  if (! _inFile)
+    return true;
+
+  bool ok = deflateData(0, 0, Z_FINISH);
+  deflateEnd(_stream);
+  _inFile = false;
+  if (! ok)
+    return false;
+
+  QByteArray descriptor;
+  putLong(descriptor, ZIP_DESCRIPTOR);
+  putLong(descriptor, _current.crc);
+  putLong(descriptor, _current.compressedSize);
+  putLong(descriptor, _current.size);
+  if (! writeRaw(descriptor))
+    return false;
+
+  _entries.append(_current);
+  return true;
+}
+
+/* Finish the open member, if any, and write the central directory.
+   The destination device is left open for the caller to close.
+ */
+bool ZipWriter::close()
+{
+  if (_inFile && ! endFile())
+    return false;
+
+  quint32    start = _offset;
+  QByteArray central;
+  foreach (const Entry &entry, _entries)
+  {
+    putLong(central,  ZIP_CENTRAL_HEADER);
+    putShort(central, ZIP_VERSION);         // made by
+    putShort(central, ZIP_VERSION);         // needed to extract
+    putShort(central, entry.flags);
+    putShort(central, entry.method);
+    putShort(central, entry.time);
+    putShort(central, entry.date);
+    putLong(central,  entry.crc);
+    putLong(central,  entry.compressedSize);
+    putLong(central,  entry.size);
+    putShort(central, entry.name.size());
+    putShort(central, 0);                   // extra field length
+    putShort(central, 0);                   // comment length
+    putShort(central, 0);                   // disk number
+    putShort(central, 0);                   // internal attributes
+    putLong(central,  0);                   // external attributes
+    putLong(central,  entry.offset);
+    central.append(entry.name);
+  }
+  if (! writeRaw(central))
+    return false;
+
+  QByteArray end;
+  putLong(end,  ZIP_END_OF_CENTRAL);
+  putShort(end, 0);                         // this disk
+  putShort(end, 0);                         // disk with the central directory
+  putShort(end, _entries.size());
+  putShort(end, _entries.size());
+  putLong(end,  central.size());
+  putLong(end,  start);
+  putShort(end, 0);                         // comment length
+
+  return writeRaw(end);
+}
+
+bool ZipWriter::deflateData(const char *data, int len, int flush)
+{
+  char out[16384];
+
+  _stream->next_in  = (Bytef *)data;
+  _stream->avail_in = (uInt)len;
+  do
+  {
+    _stream->next_out  = (Bytef *)out;
+    _stream->avail_out = sizeof(out);
+    if (deflate(_stream, flush) == Z_STREAM_ERROR)
+    {
+      _error = QObject::tr("Could not compress: %1").arg(_stream->msg ? _stream->msg : "");
+      return false;
+    }
+
+    int have = sizeof(out) - _stream->avail_out;
+    if (have > 0)
+    {
+      if (! writeRaw(QByteArray::fromRawData(out, have)))
+        return false;
+      _current.compressedSize += have;
+    }
+  } while (_stream->avail_out == 0);
+
+  return true;
+}
+
+bool ZipWriter::writeLocalHeader(Entry &e)
+{
+  QDateTime now = QDateTime::currentDateTime();
+  e.time = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2);
+  e.date = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+
+  QByteArray header;
+  putLong(header,  ZIP_LOCAL_HEADER);
+  putShort(header, ZIP_VERSION);
+  putShort(header, e.flags);
+  putShort(header, e.method);
+  putShort(header, e.time);
+  putShort(header, e.date);
+  putLong(header,  e.crc);
+  putLong(header,  e.compressedSize);
+  putLong(header,  e.size);
+  putShort(header, e.name.size());
+  putShort(header, 0);                      // extra field length
+  header.append(e.name);
+
+  return writeRaw(header);
+}
+
+bool ZipWriter::writeRaw(const QByteArray &data)
+{
+  if (_dest->write(data) != data.size())
+  {
+    _error = _dest->errorString();
+    return false;
+  }
+  _offset += data.size();
+  return true;
+}
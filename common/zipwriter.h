@@ -0,0 +1,66 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __ZIPWRITER_H__
+#define __ZIPWRITER_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QIODevice;
+struct z_stream_s;
+
+/* Write a zip archive to a QIODevice one entry at a time. Entries opened
+   with beginFile() are deflated as they are written so large members,
+   like the content.xml of an OpenDocument file, never have to be held
+   in memory.
+ */
+class ZipWriter
+{
+  public:
+    ZipWriter(QIODevice *dest);
+    virtual ~ZipWriter();
+
+    bool addFile(const QString &name, const QByteArray &data, bool compress = true);
+    bool beginFile(const QString &name);
+    bool write(const QByteArray &data);
+    bool endFile();
+    bool close();
+
+    QString errorString() const;
+
+  private:
+    struct Entry {
+      QByteArray name;
+      quint16    method;
+      quint16    flags;
+      quint16    time;
+      quint16    date;
+      quint32    crc;
+      quint32    compressedSize;
+      quint32    size;
+      quint32    offset;
+    };
+
+    bool deflateData(const char *data, int len, int flush);
+    bool writeLocalHeader(Entry &entry);
+    bool writeRaw(const QByteArray &data);
+
+    Entry        _current;
+    QIODevice   *_dest;
+    QList<Entry> _entries;
+    QString      _error;
+    bool         _inFile;
+    quint32      _offset;
+    z_stream_s  *_stream;
+};
+
+#endif
@@ -22,7 +22,6 @@
 #include <QTranslator>
 
 #include <parameter.h>
-#include <gunzip.h>
 #include <tarfile.h>
 #include <xtHelp.h>
 
@@ -81,48 +80,26 @@ void dictionaries::finished(QNetworkReply * nwrep)
         {
           file.write(ba);
           file.close();
-          QByteArray data = gunzipFile(file.fileName());
-          if(!data.isEmpty())
+          // stream the archive straight to disk instead of unpacking it in memory
+          if(file.open(QIODevice::ReadOnly))
           {
-            TarFile *_files = new TarFile(data);
-            if(_files->isValid())
+            TarReader reader(&file);
+            if(reader.extractAll(dir.absolutePath()))
             {
-              bool error = false;
-              QMapIterator<QString, QByteArray> i(_files->_list);
-              while (i.hasNext())
-              {
-                i.next();
-                //cout << i.key() << ": " << i.value() << endl;
-                #if QT_VERSION >= 0x050000
-                QFile ff(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + i.key());
-                #else
-                QFile ff(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/" + i.key());
-                #endif
-                if(ff.open(QIODevice::WriteOnly | QIODevice::Truncate))
-                {
-                  ff.write(i.value());
-                  ff.close();
-                }
-                else
-                {
-                  error = true;
-                }
-              }
-              if(error)
-              {
-                _label->setText(tr("Could not save one or more files."));
-              }
-              else
-              {
-                _label->setText(tr("Dictionaries downloaded."));
-                xtHelp::reload();
-              }
+              _label->setText(tr("Dictionaries downloaded."));
+              xtHelp::reload();
+            }
+            else if(! reader.isValid())
+            {
+              _label->setText(tr("Could not read archive format:\n%1")
+                                .arg(reader.errorString()));
             }
             else
             {
-              _label->setText(tr("Could not read archive format."));
+              _label->setText(tr("Could not save one or more files:\n%1")
+                                .arg(reader.fileErrors().join("\n")));
             }
-            delete _files;
+            file.close();
           }
           else
           {
@@ -30,6 +30,8 @@
 
 #include "../scriptapi/parameterlistsetup.h"
 #include "errorReporter.h"
+#include "querytrace.h"
+#include "readreplica.h"
 
 class displayPrivate : public Ui::display
 {
@@ -223,10 +225,18 @@ void displayPrivate::print(ParameterList pParams, bool showPreview, bool forceSe
     return;
   }
 
+  QSqlDatabase db = ReadReplica::database();
   ORPreRender pre;
+  pre.setDatabase(db);
   pre.setDom(_doc);
   pre.setParamList(params);
   ORODocument * doc = pre.generate();
+  if ((! doc || ! db.isOpen()) && ReadReplica::isReplica(db))
+  {
+    delete doc;
+    pre.setDatabase(ReadReplica::fallBack(db, ::display::tr("Could not render %1").arg(reportName)));
+    doc = pre.generate();
+  }
 
   if(doc)
   {
@@ -799,7 +809,9 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
                          errorString, __FILE__, __LINE__);
     return;
   }
-  XSqlQuery xq = mql.toQuery(pParams);
+  QueryTrace::Timer timer(objectName(), _data->metasqlGroup + "-" + _data->metasqlName);
+  XSqlQuery xq = ReadReplica::query(mql, pParams);
+  timer.finish(xq, pParams.count());
   _data->_list->populate(xq, itemid, _data->_useAltId);
   if (xq.lastError().type() != QSqlError::NoError)
   {
@@ -0,0 +1,345 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "displayBenchmark.h"
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QDate>
+#include <QDir>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QTreeWidgetItemIterator>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include <orprerender.h>
+#include <orprintrender.h>
+#include <renderobjects.h>
+
+#include "display.h"
+#include "getscreen.h"
+#include "guiclient.h"
+#include "querytrace.h"
+#include "xtreewidget.h"
+#include "xtreewidgetexporter.h"
+
+#define DEBUG false
+
+// how often to look for a message box nobody is going to answer
+#define MODALCHECK 1000
+
+static QString csv(const QString &field)
+{
+  QString result = field;
+  if (result.contains(',') || result.contains('"') || result.contains('\n'))
+    result = "\"" + result.replace("\"", "\"\"") + "\"";
+  return result;
+}
+
+DisplayBenchmark::DisplayBenchmark(const QString &config, const QString &output, QObject *parent)
+  : QObject(parent),
+    _config(config),
+    _output(output)
+{
+  setObjectName("DisplayBenchmark");
+}
+
+/** @brief Run every job in the configuration file and write the results.
+
+    @return 0 if every run succeeded, 1 if any failed, -1 if the
+            configuration or output file could not be opened
+ */
+int DisplayBenchmark::run()
+{
+  QString errmsg;
+  if (! load(&errmsg))
+  {
+    fprintf(stderr, "%s\n", qPrintable(errmsg));
+    return -1;
+  }
+
+  QFile out;
+  bool opened = _output.isEmpty() ? out.open(stdout, QIODevice::WriteOnly | QIODevice::Text)
+                                  : (out.setFileName(_output),
+                                     out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
+  if (! opened)
+  {
+    fprintf(stderr, "%s\n", qPrintable(tr("Could not open %1: %2")
+                                         .arg(_output, out.errorString())));
+    return -1;
+  }
+
+  QTextStream stream(&out);
+  stream << "window,run,fill_ms,query_ms,rows,sort_ms,export_ms,preview_ms,peak_rss_kb,error\n";
+  stream.flush();
+
+  QueryTrace::setEnabled(true);
+
+  QTimer modalTimer;
+  connect(&modalTimer, SIGNAL(timeout()), this, SLOT(sDismissModal()));
+  modalTimer.start(MODALCHECK);
+
+  int failures = 0;
+  foreach (const Job &job, _jobs)
+  {
+    for (int i = 1; i <= job.repeat; i++)
+    {
+      Result result = runJob(job);
+      if (! result.error.isEmpty())
+        failures++;
+
+      stream << csv(job.window)    << ","
+             << i                  << ","
+             << result.fillMsecs    << ","
+             << result.queryMsecs   << ","
+             << result.rows         << ","
+             << result.sortMsecs    << ","
+             << result.exportMsecs  << ","
+             << result.previewMsecs << ","
+             << result.peakRss      << ","
+             << csv(result.error)   << "\n";
+      stream.flush();
+    }
+  }
+
+  return failures ? 1 : 0;
+}
+
+bool DisplayBenchmark::load(QString *errmsg)
+{
+  QFile file(_config);
+  if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+  {
+    *errmsg = tr("Could not open %1: %2").arg(_config, file.errorString());
+    return false;
+  }
+
+  QTextStream in(&file);
+  while (! in.atEnd())
+  {
+    QString line = in.readLine().trimmed();
+    if (line.isEmpty() || line.startsWith('#'))
+      continue;
+
+    QStringList words = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    Job job;
+    job.window = words.takeFirst();
+    job.repeat = 1;
+    foreach (QString word, words)
+    {
+      int equals = word.indexOf('=');
+      if (equals < 0)
+        job.params.append(word);
+      else if (word.left(equals) == "repeat")
+        job.repeat = qMax(1, word.mid(equals + 1).toInt());
+      else
+        job.params.append(word.left(equals), parseValue(word.mid(equals + 1)));
+    }
+    _jobs.append(job);
+  }
+
+  if (_jobs.isEmpty())
+  {
+    *errmsg = tr("%1 does not name any windows to run").arg(_config);
+    return false;
+  }
+  return true;
+}
+
+DisplayBenchmark::Result DisplayBenchmark::runJob(const Job &job)
+{
+  Result result;
+  _modals.clear();
+
+  QWidget *widget = xtGetScreen(job.window, 0);
+  display *window = qobject_cast<display*>(widget);
+  if (! window)
+  {
+    result.error = tr("%1 is not a display window").arg(job.window);
+    delete widget;
+    return result;
+  }
+
+  window->setAttribute(Qt::WA_DeleteOnClose);
+  window->setQueryOnStartEnabled(false);
+  window->set(job.params);
+  window->show();
+  qApp->processEvents();
+
+  QueryTrace::clear();
+  QElapsedTimer timer;
+  timer.start();
+  window->sFillList();
+  qApp->processEvents();
+  result.fillMsecs = timer.elapsed();
+
+  result.queryMsecs = 0;
+  foreach (const QueryTrace::Stats &stats, QueryTrace::bySource())
+    result.queryMsecs += stats.totalMsecs;
+
+  XTreeWidget *list = window->list();
+  result.rows = 0;
+  for (QTreeWidgetItemIterator it(list); *it; ++it)
+    result.rows++;
+
+  timer.restart();
+  list->sortItems(0, Qt::DescendingOrder);
+  list->sortItems(0, Qt::AscendingOrder);
+  result.sortMsecs = timer.elapsed();
+
+  QString errmsg;
+  result.exportMsecs = exportList(window, &errmsg);
+  if (errmsg.isEmpty())
+    result.previewMsecs = preview(window, &errmsg);
+
+  window->close();
+  qApp->processEvents();
+
+  if (errmsg.isEmpty() && ! _modals.isEmpty())
+    errmsg = tr("dismissed %1").arg(_modals.join("; "));
+  result.error   = errmsg;
+  result.peakRss = peakRss();
+
+  if (DEBUG)
+    qDebug("DisplayBenchmark %s: %lld ms, %d rows", qPrintable(job.window),
+           result.fillMsecs, result.rows);
+  return result;
+}
+
+qint64 DisplayBenchmark::exportList(display *window, QString *errmsg)
+{
+  QString filename = QDir::temp().filePath(QString("xtbench-%1.csv")
+                                           .arg(QCoreApplication::applicationPid()));
+  QEventLoop  loop;
+  QElapsedTimer timer;
+  timer.start();
+
+  XTreeWidgetExporter *exporter = new XTreeWidgetExporter(window->list(), filename,
+                                                          XTreeWidgetExporter::Csv);
+  connect(exporter, SIGNAL(finished(bool)), &loop, SLOT(quit()));
+  if (exporter->start())
+    loop.exec();
+  else
+    *errmsg = exporter->errorString();
+
+  qint64 elapsed = timer.elapsed();
+  QFile::remove(filename);
+  return elapsed;
+}
+
+/* Do what the Preview button does without the preview and print dialogs:
+   generate the report and render it to a PDF.
+ */
+qint64 DisplayBenchmark::preview(display *window, QString *errmsg)
+{
+  if (window->reportName().isEmpty())
+    return -1;
+
+  ParameterList params = window->getParams();
+  params.append("isReport", true);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  XSqlQuery report;
+  report.prepare("SELECT report_source "
+                 "  FROM report "
+                 " WHERE (report_name=:report_name)"
+                 " ORDER BY report_grade DESC LIMIT 1");
+  report.bindValue(":report_name", window->reportName());
+  report.exec();
+  QDomDocument dom;
+  if (! report.first() || ! dom.setContent(report.value("report_source").toString()))
+  {
+    *errmsg = tr("Could not load report %1").arg(window->reportName());
+    return -1;
+  }
+
+  ORPreRender pre;
+  pre.setDom(dom);
+  pre.setParamList(params);
+  ORODocument *doc = pre.generate();
+  if (! doc)
+  {
+    *errmsg = tr("Could not generate report %1").arg(window->reportName());
+    return -1;
+  }
+
+  QString filename = QDir::temp().filePath(QString("xtbench-%1.pdf")
+                                           .arg(QCoreApplication::applicationPid()));
+  bool exported = ORPrintRender::exportToPDF(doc, filename);
+  delete doc;
+
+  qint64 elapsed = timer.elapsed();
+  QFile::remove(filename);
+  if (! exported)
+  {
+    *errmsg = tr("Could not write report %1 to %2").arg(window->reportName(), filename);
+    return -1;
+  }
+  return elapsed;
+}
+
+/* Nobody can answer a message box in a headless run, so close it and
+   remember what it said for the results.
+ */
+void DisplayBenchmark::sDismissModal()
+{
+  QWidget *modal = QApplication::activeModalWidget();
+  if (! modal)
+    return;
+
+  _modals.append(modal->windowTitle());
+  modal->close();
+}
+
+QVariant DisplayBenchmark::parseValue(const QString &text)
+{
+  if (text == "true" || text == "false")
+    return QVariant(text == "true");
+
+  QDate date = QDate::fromString(text, Qt::ISODate);
+  if (date.isValid())
+    return date;
+
+  bool ok = false;
+  int intval = text.toInt(&ok);
+  if (ok)
+    return intval;
+
+  double dblval = text.toDouble(&ok);
+  if (ok)
+    return dblval;
+
+  return text;
+}
+
+// in kilobytes, or -1 where we don't know how to ask
+qint64 DisplayBenchmark::peakRss()
+{
+#ifdef Q_OS_UNIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef Q_OS_MAC
+    return usage.ru_maxrss / 1024;      // bytes on OS X
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+  return -1;
+}
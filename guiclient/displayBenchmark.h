@@ -0,0 +1,90 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __DISPLAYBENCHMARK_H__
+#define __DISPLAYBENCHMARK_H__
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <parameter.h>
+
+class display;
+
+/* Time display windows without anyone at the keyboard.
+
+   Built only when qmake is run with CONFIG+=benchmarks. Started by main()
+   when that client is run with -benchmark=<file>. Each
+   line of the file names a display window followed by the parameters to
+   open it with, for example
+
+     dspInventoryHistory  warehous_id=1 startDate=2015-01-01 endDate=2015-12-31
+     dspGLTransactions    startDate=2015-01-01 endDate=2015-12-31 repeat=3
+
+   Blank lines and lines starting with # are ignored. repeat=n runs the
+   window n times. Each run opens the window, fills its list, sorts it,
+   exports it to CSV, renders its report to PDF and closes it again.
+
+   One CSV line per run goes to the file named by -benchmarkOutput=, or to
+   stdout, with the wall time of each step, the time spent in queries, the
+   rows shown and the peak resident set size so far. Run the client with
+   -platform offscreen to keep the windows off the screen.
+ */
+class DisplayBenchmark : public QObject
+{
+  Q_OBJECT
+
+  public:
+    DisplayBenchmark(const QString &config, const QString &output, QObject *parent = 0);
+
+    int run();
+
+  private slots:
+    void sDismissModal();
+
+  private:
+    struct Job
+    {
+      QString       window;
+      ParameterList params;
+      int           repeat;
+    };
+
+    struct Result
+    {
+      Result() : fillMsecs(-1), queryMsecs(-1), rows(-1), sortMsecs(-1),
+                 exportMsecs(-1), previewMsecs(-1), peakRss(-1) {}
+      qint64  fillMsecs;
+      qint64  queryMsecs;
+      int     rows;
+      qint64  sortMsecs;
+      qint64  exportMsecs;
+      qint64  previewMsecs;
+      qint64  peakRss;
+      QString error;
+    };
+
+    bool    load(QString *errmsg);
+    Result  runJob(const Job &job);
+    qint64  exportList(display *window, QString *errmsg);
+    qint64  preview(display *window, QString *errmsg);
+
+    static QVariant parseValue(const QString &text);
+    static qint64   peakRss();
+
+    QString     _config;
+    QList<Job>  _jobs;
+    QStringList _modals;
+    QString     _output;
+};
+
+#endif
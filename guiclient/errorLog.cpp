@@ -8,8 +8,6 @@
  * to be bound by its terms.
  */
 
-#include <stdio.h>
-
 #include "errorLog.h"
 #include "guiclient.h"
 
@@ -17,21 +15,22 @@
 #include <QVariant>
 #include <QMessageBox>
 #include <QStringList>
-#include <QDateTime>
 #include <QSqlError>
 
+#include "logWriter.h"
 #include "xtsettings.h"
 
-static QStringList _errorList;
 static errorLogListener * listener = 0;
 
 void errorLogListener::initialize()
 {
   listener = new errorLogListener();
+  LogWriter::startWriter();
 }
 
 void errorLogListener::destroy()
 {
+  LogWriter::stopWriter();
   if(listener)
     delete listener;
   listener = 0;
@@ -42,13 +41,14 @@ errorLog::errorLog(QWidget* parent, const char * name, Qt::WindowFlags flags)
 {
   setupUi(this);
 
-  for(int i = 0; i < _errorList.size(); i++)
-    _errorLog->append(_errorList.at(i));
+  QStringList errors = LogWriter::recent();
+  for(int i = 0; i < errors.size(); i++)
+    _errorLog->append(errors.at(i));
 
-  _debug->setChecked(xtsettingsValue("catchQDebug").toBool());
-  _warning->setChecked(xtsettingsValue("catchQWarning").toBool());
-  _critical->setChecked(xtsettingsValue("catchQCritical").toBool());
-  _fatal->setChecked(xtsettingsValue("catchQFatal").toBool());
+  _debug->setChecked(LogWriter::notify(QtDebugMsg));
+  _warning->setChecked(LogWriter::notify(QtWarningMsg));
+  _critical->setChecked(LogWriter::notify(QtCriticalMsg));
+  _fatal->setChecked(LogWriter::notify(QtFatalMsg));
 
   connect(_clear,   SIGNAL(clicked()),           _errorLog, SLOT(clear()));
   connect(_clear,   SIGNAL(clicked()),            listener, SLOT(clear()));
@@ -78,27 +78,36 @@ void errorLog::updateErrors(const QString & msg)
 void errorLog::toggleDebug(bool y)
 {
   xtsettingsSetValue("catchQDebug", y);
+  LogWriter::setNotify(QtDebugMsg, y);
 }
 
 void errorLog::toggleWarning(bool y)
 {
   xtsettingsSetValue("catchQWarning", y);
+  LogWriter::setNotify(QtWarningMsg, y);
 }
 
 void errorLog::toggleCritical(bool y)
 {
   xtsettingsSetValue("catchQCritical", y);
+  LogWriter::setNotify(QtCriticalMsg, y);
 }
 
 void errorLog::toggleFatal(bool y)
 {
   xtsettingsSetValue("catchQFatal", y);
+  LogWriter::setNotify(QtFatalMsg, y);
 }
 
 errorLogListener::errorLogListener(QObject * parent)
   : QObject(parent)
 {
   XSqlQuery::addErrorListener(this);
+
+  // always queued: the writer may be holding its lock when it emits
+  connect(LogWriter::instance(), SIGNAL(logged(const QString &, bool, bool)),
+          this,                  SLOT(sLogged(const QString &, bool, bool)),
+          Qt::QueuedConnection);
 }
 
 errorLogListener::~errorLogListener()
@@ -106,26 +115,26 @@ errorLogListener::~errorLogListener()
   XSqlQuery::removeErrorListener(this);
 }
 
+/* This can be called from any thread that runs queries,
+   so all it does is hand the error to the LogWriter.
+ */
 void errorLogListener::error(const QString & sql, const QSqlError & error)
 {
-  QString msg;
-  msg = QDateTime::currentDateTime().toString();
-  msg += " " + error.text();
-  msg += "\n" + sql;
-
-  _errorList.append(msg);
-  if(_errorList.size() > 20)
-    _errorList.removeFirst();
+  LogWriter::log(QtCriticalMsg, error.text(), sql, -1, LogWriter::SqlError);
+}
 
-  emit updated(msg);
-  if(omfgThis)
+void errorLogListener::sLogged(const QString & msg, bool notify, bool iserror)
+{
+  if(notify)
+    emit updated(msg);
+  if(omfgThis && notify && iserror)
     omfgThis->sNewErrorMessage();
 }
 
 void errorLogListener::clear()
 {
   bool blocked = blockSignals(true);
-  _errorList.clear();
+  LogWriter::clearRecent();
   (void)blockSignals(blocked);
 }
 
@@ -136,46 +145,5 @@ void xTupleMessageOutput(QtMsgType type, const QMessageLogContext&, const QStrin
 void xTupleMessageOutput(QtMsgType type, const char *pMsg)
 #endif
 {
-  QString msg;
-  msg = QDateTime::currentDateTime().toString();
-  bool notify = false;
-  bool iserror= (type == QtCriticalMsg) || (type == QtFatalMsg);
-
-  switch (type) {
-    case QtDebugMsg:
-      notify = xtsettingsValue("catchQDebug").toBool();
-      msg += " Debug: ";
-      break;
-#if QT_VERSION >= 0x050500
-    case QtInfoMsg:
-      notify = xtsettingsValue("catchQWarning").toBool();
-      msg += " Info: ";
-      break;
-#endif
-    case QtWarningMsg:
-      notify = xtsettingsValue("catchQWarning").toBool();
-      msg += " Warning: ";
-      break;
-    case QtCriticalMsg:
-      notify = xtsettingsValue("catchQCritical").toBool();
-      msg += " Critical: ";
-      break;
-    case QtFatalMsg:
-      notify = xtsettingsValue("catchQFatal").toBool();
-      msg += " Fatal: ";
-      //abort();
-      break;
-  }
-  msg += pMsg;
-  _errorList.append(msg);
-  if(_errorList.size() > 20)
-    _errorList.removeFirst();
-
-  if(listener && notify)
-    listener->updated(msg);
-  if(omfgThis && notify && iserror)
-    omfgThis->sNewErrorMessage();
-
-  printf("%s\n", qPrintable(msg));
+  LogWriter::log(type, QString(pMsg));
 }
-
@@ -52,6 +52,9 @@ class errorLogListener : public QObject, public XSqlQueryErrorListener {
 
   signals:
     void updated(const QString &);
+
+  private slots:
+    void sLogged(const QString &, bool, bool);
 };
 
 
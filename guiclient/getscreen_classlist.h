@@ -475,6 +475,7 @@ CLASSITEM(purgeInvoices)
 CLASSITEM(purgePostedCounts)
 CLASSITEM(purgePostedCountSlips)
 CLASSITEM(quickRelocateLot)
+CLASSITEM(queryProfile)
 CLASSITEM(quotes)
 CLASSITEM(reasonCode)
 CLASSITEM(reasonCodes)
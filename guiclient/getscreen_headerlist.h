@@ -475,6 +475,7 @@
 #include "purgePostedCounts.h"
 #include "purgePostedCountSlips.h"
 #include "quickRelocateLot.h"
+#include "queryProfile.h"
 #include "quotes.h"
 #include "reasonCode.h"
 #include "reasonCodes.h"
@@ -16,6 +16,9 @@
 #include <QPushButton>
 #include <QMenuBar>
 #include <QMenu>
+#include <QPointer>
+#include <QReadLocker>
+#include <QWriteLocker>
 #include <QToolBar>
 #include <QSqlDatabase>
 #include <QSqlDriver>
@@ -24,6 +27,7 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QDir>
+#include <QFileInfo>
 #include <QPixmap>
 #include <QTextStream>
 #include <QCloseEvent>
@@ -37,9 +41,9 @@
 
 #include <parameter.h>
 #include <dbtools.h>
-#include <quuencode.h>
 #include <xvariant.h>
 
+#include "applock.h"
 #include "xtsettings.h"
 #include "xuiloader.h"
 #include "guiclient.h"
@@ -49,6 +53,8 @@
 #include "errorLog.h"
 #include "errorReporter.h"
 #include "login2.h"
+#include "preparedquery.h"
+#include "scriptAsyncQuery.h"
 #include "storedProcErrorLookup.h"
 
 #include "systemMessage.h"
@@ -70,13 +76,18 @@
 
 #include "distributeInventory.h"
 #include "documents.h"
+#include "imagecache.h"
+#include "itemcluster.h"
 #include "splashconst.h"
 #include "scripttoolbox.h"
 #include "menubutton.h"
 #include "guiErrorCheck.h"
 
 #include "setup.h"
+#include "scriptcache.h"
+#include "uiFormCache.h"
 #include "setupscriptapi.h"
+#include "workerconnection.h"
 
 #if defined(Q_OS_WIN)
 #define NOCRYPT
@@ -152,6 +163,25 @@ static SaveSizePositionEventFilter * __saveSizePositionEventFilter = 0;
 static int __interval = 0;
 static int __intervalCount = 0;
 
+/* Hundreds of Actions share a few hundred privilege strings, and
+   #superuser costs a query, so each string is checked once per
+   privilege load. __privActions remembers which Actions use each string
+   so a reload only touches the Actions whose answer changed.
+ */
+static QHash<QString, bool> __privCache;
+static QHash<QString, QList<QPointer<QAction> > > __privActions;
+
+static bool __privCheck(const QString &privs)
+{
+  QHash<QString, bool>::const_iterator it = __privCache.constFind(privs);
+  if (it != __privCache.constEnd())
+    return it.value();
+
+  bool allowed = _privileges->check(privs);
+  __privCache.insert(privs, allowed);
+  return allowed;
+}
+
 /** @brief Check if the current user has privileges to use the given Action.
     @sa    Action
   */
@@ -165,7 +195,48 @@ static void __menuEvaluate(QAction * act)
     act->setEnabled(false);
   else if(!privs.isEmpty())
   {
-    act->setEnabled(_privileges->check(privs));
+    act->setEnabled(__privCheck(privs));
+  }
+}
+
+/** @brief Evaluate the given Action and remember it for __menuReevaluate. */
+static void __menuRegister(QAction * act)
+{
+  QString privs = act->data().toString();
+  if (! privs.isEmpty() && privs != "true" && privs != "false")
+    __privActions[privs].append(act);
+  __menuEvaluate(act);
+}
+
+/** @brief Check every privilege string again and update only the Actions
+           whose answer changed.
+  */
+static void __menuReevaluate()
+{
+  QHash<QString, bool> old = __privCache;
+  __privCache.clear();
+
+  QMutableHashIterator<QString, QList<QPointer<QAction> > > it(__privActions);
+  while (it.hasNext())
+  {
+    it.next();
+    bool allowed = __privCheck(it.key());
+    if (old.contains(it.key()) && old.value(it.key()) == allowed)
+      continue;
+
+    QMutableListIterator<QPointer<QAction> > act(it.value());
+    while (act.hasNext())
+    {
+      QAction *action = act.next();
+      if (! action)
+        act.remove();
+      else if (action->data().toString() == it.key())
+        action->setEnabled(allowed);
+      else
+        __menuEvaluate(action);  // someone changed its privileges
+    }
+    if (it.value().isEmpty())
+      it.remove();
   }
 }
 
@@ -279,7 +350,7 @@ void Action::init(QWidget *pParent, const char *pName, const QString &pDisplayNa
 
   if(!pEnabled.isEmpty())
     setData(pEnabled);
-  __menuEvaluate(this);
+  __menuRegister(this);
   if (QRegExp(".*\\.setup").exactMatch(pName))
   {
     setMenuRole(QAction::NoRole);
@@ -369,6 +440,11 @@ class xTupleGuiClientInterface : public GuiClientInterface
   {
       return omfgThis->hunspell_ignore(word);
   }
+
+  QList<QPair<int, int> > hunspell_check_text(const QString &text)
+  {
+      return omfgThis->hunspell_check_text(text);
+  }
 };
 
 /** @class GUIClient
@@ -468,18 +544,9 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
 
   if (_preferences->value("BackgroundImageid").toInt() > 0)
   {
-    _GGUIClient.prepare( "SELECT image_data "
-                "FROM image "
-                "WHERE (image_id=:image_id);" );
-    _GGUIClient.bindValue(":image_id", _preferences->value("BackgroundImageid").toInt());
-    _GGUIClient.exec();
-    if (_GGUIClient.first())
-    {
-      QImage background;
-
-      background.loadFromData(QUUDecode(_GGUIClient.value("image_data").toString()));
+    QImage background = ImageCache::instance()->image(_preferences->value("BackgroundImageid").toInt());
+    if (! background.isNull())
       _workspace->setBackground(QBrush(QPixmap::fromImage(background)));
-    }
   }
 
   _splash->showMessage(tr("Initializing Internal Timers"), SplashTextAlignment, SplashTextColor);
@@ -710,15 +777,7 @@ void GUIClient::initMenuBar()
   qApp->setOverrideCursor(Qt::WaitCursor);
 
   if(!firstRun)
-  {
-    QList<QMenu*> menulist = findChildren<QMenu*>();
-    for(int m = 0; m < menulist.size(); ++m)
-    {
-      QList<QAction*> actionlist = menulist.at(m)->actions();
-      for(int i = 0; i < actionlist.size(); ++i)
-        __menuEvaluate(actionlist.at(i));
-    }
-  }
+    __menuReevaluate();
   else
   {
     menuBar()->clear();
@@ -799,10 +858,34 @@ void GUIClient::initMenuBar()
   findChild<QToolBar*>("Sales Tools")->setVisible(_preferences->boolean("ShowSOToolbar"));
   findChild<QToolBar*>("Accounting Tools")->setVisible(_preferences->boolean("ShowGLToolbar"));
 
+  // actions added by scripts are not Actions, so check them when shown
+  foreach (QMenu *menu, findChildren<QMenu*>())
+    connect(menu, SIGNAL(aboutToShow()), this, SLOT(sMenuAboutToShow()),
+            Qt::UniqueConnection);
+
   firstRun = false;
   qApp->restoreOverrideCursor();
 }
 
+/** @brief Make sure the actions in a menu match the user's privileges
+           just before the menu appears.
+  */
+void GUIClient::sMenuAboutToShow()
+{
+  QMenu *menu = qobject_cast<QMenu*>(sender());
+  if (! menu)
+    return;
+
+  foreach (QAction *act, menu->actions())
+  {
+    // literal "true" and "false" are managed by the menu itself, like the
+    // Window menu disabling Cascade and Tile when no windows are open
+    QString privs = act->data().toString();
+    if (! privs.isEmpty() && privs != "true" && privs != "false")
+      __menuEvaluate(act);
+  }
+}
+
 /** @brief Save the position and visibility of application toolbars in
            user preferences.
   */
@@ -895,7 +978,7 @@ void GUIClient::showEvent(QShowEvent *event)
     // We only want the scripting to work on the NEO menu
     // START script code
       XSqlQuery sq;
-      sq.prepare("SELECT script_source "
+      sq.prepare("SELECT script_id, script_source "
                  "  FROM script "
                  "JOIN (SELECT c.oid, n.nspname AS schema "
                  "  FROM pg_class AS c "
@@ -925,7 +1008,8 @@ void GUIClient::showEvent(QShowEvent *event)
           loadScriptGlobals(engine);
         }
 
-        QScriptValue result = engine->evaluate(script, "initMenu");
+        QScriptValue result = ScriptCache::evaluate(engine, sq.value("script_id").toInt(),
+                                                    script, "initMenu");
         if (engine->hasUncaughtException())
         {
           int line = engine->uncaughtExceptionLineNumber();
@@ -1059,8 +1143,13 @@ void GUIClient::sTick()
         qApp->quit();
       else
       {
+        // the old connection's statements are gone, and the queries holding
+        // them must be dropped before the driver reuses the connection
+        PreparedQuery::invalidate();
         if (QSqlDatabase::database().open())
         {
+          AppLock::clearTableCache();   // it may not be the same database
+
           QString loginqry ="SELECT login() AS result, CURRENT_USER AS user;";
           XSqlQuery login( loginqry );
           if (login.first())
@@ -1072,6 +1161,8 @@ void GUIClient::sTick()
                                     storedProcErrorLookup("login", result));
               return;
             }
+            WorkerConnection::setLoginSearchPath();
+            ScriptAsyncQuery::reconnect();
           }
           else if (login.lastError().type() != QSqlError::NoError)
             QMessageBox::critical(this, tr("System Error"),
@@ -1194,12 +1285,14 @@ void GUIClient::sSystemMessageAdded()
   */
 void GUIClient::sItemsUpdated(int pItemid, bool pLocal)
 {
+  ItemLineEdit::invalidateResolutions();   // the item may no longer qualify
   emit itemsUpdated(pItemid, pLocal);
 }
 
 /** @brief This slot tells other open windows the definition or status of one or more Itemsites has changed. */
 void GUIClient::sItemsitesUpdated()
 {
+  ItemLineEdit::invalidateResolutions();   // barcodes depend on active sites
   emit itemsitesUpdated();
 }
 
@@ -1883,40 +1976,20 @@ void GUIClient::sCustomCommand()
       }
       if(asName.isEmpty())
         return;
-      GCustomCommand.prepare("SELECT *"
-                "  FROM uiform"
-                " WHERE((uiform_name=:uiform_name)"
-                "   AND (uiform_enabled))"
-                " ORDER BY uiform_order DESC"
-                " LIMIT 1;");
-      GCustomCommand.bindValue(":uiform_name", asName);
-      GCustomCommand.exec();
-      if(!GCustomCommand.first())
+      QString  errmsg;
+      QWidget *ui = UiFormCache::build(asName, 0, &errmsg);
+      if(!ui)
       {
         QMessageBox::critical(this, tr("Could Not Create Form"),
-                              tr("<p>Could not create the '%1' form. Either an "
-                                 "error occurred or the specified form does "
-                                 "not exist.").arg(asName) );
+                              tr("<p>%1").arg(errmsg));
         return;
       }
-
-      XUiLoader loader;
-      QByteArray ba = GCustomCommand.value("uiform_source").toString().toUtf8();
-      QBuffer uiFile(&ba);
-      if(!uiFile.open(QIODevice::ReadOnly))
-      {
-        QMessageBox::critical(this, tr("Could not load file"),
-            tr("There was an error loading the UI Form from the database."));
-        return;
-      }
-      QWidget *ui = loader.load(&uiFile);
       QSize size = ui->size();
-      uiFile.close();
 
       if(asDialog)
       {
         XDialog dlg(this);
-        dlg.setObjectName(GCustomCommand.value("uiform_name").toString());
+        dlg.setObjectName(asName);
         QVBoxLayout *layout = new QVBoxLayout;
         layout->addWidget(ui);
         dlg.setLayout(layout);
@@ -1927,7 +2000,7 @@ void GUIClient::sCustomCommand()
       else
       {
         XMainWindow * wnd = new XMainWindow();
-        wnd->setObjectName(GCustomCommand.value("uiform_name").toString());
+        wnd->setObjectName(asName);
         wnd->setCentralWidget(ui);
         wnd->setWindowTitle(ui->windowTitle());
         wnd->resize(size);
@@ -2479,30 +2552,65 @@ void GUIClient::handleDocument(QString path)
   addDocumentWatch(path, id);
 }
 
-void GUIClient::hunspell_initialize()
+/** @brief Return the path of the spell checking dictionary for the current
+           locale, without the .aff or .dic extension.
+
+    The files may not exist; the locale's language name is tried first,
+    then its lang_country name.
+  */
+QString GUIClient::hunspell_dictionary()
 {
-    _spellReady = false;
     QString langName = QLocale::languageToString(QLocale().language());
     QString appPath("/usr/lib/postbooks");
     if (! QFile::exists(appPath))
       appPath = QApplication::applicationDirPath();
     QString fullPathWithoutExt = appPath + "/" + langName;
-    QFile affFile(fullPathWithoutExt + tr(".aff"));
-    QFile dicFile(fullPathWithoutExt + tr(".dic"));
     // If we don't have files for the first name lets try a more common naming convention
-    if(!(affFile.exists() && dicFile.exists()))
+    if(!(QFile::exists(fullPathWithoutExt + ".aff") && QFile::exists(fullPathWithoutExt + ".dic")))
     {
       langName = QLocale().name().toLower(); // retruns lang_cntry format en_us for example
       fullPathWithoutExt = appPath + "/" + langName;
-      affFile.setFileName(fullPathWithoutExt + tr(".aff"));
-      dicFile.setFileName(fullPathWithoutExt + tr(".dic"));
     }
-    if(affFile.exists() && dicFile.exists())
+    return fullPathWithoutExt;
+}
+
+/** @brief Return where to keep the precompiled image of @a dictionary.
+
+    The image goes in the user's cache directory, since the directory the
+    dictionary is installed in is usually not writable. The directory is
+    created if necessary; an empty string means there is nowhere to put it.
+  */
+QString GUIClient::hunspell_image(const QString &dictionary)
+{
+#if QT_VERSION >= 0x050000
+  QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+  QString cachePath = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+  if (cachePath.isEmpty() || ! QDir().mkpath(cachePath + "/spell"))
+    return QString();
+  return cachePath + "/spell/" + QFileInfo(dictionary).fileName() + ".dic.img";
+}
+
+void GUIClient::hunspell_initialize()
+{
+    _spellReady = false;
+    QString fullPathWithoutExt = hunspell_dictionary();
+    if(QFile::exists(fullPathWithoutExt + tr(".aff")) && QFile::exists(fullPathWithoutExt + tr(".dic")))
     {
       _spellReady = true;
     }
+    QString image = hunspell_image(fullPathWithoutExt);
     _spellChecker = new Hunspell(QString(fullPathWithoutExt+tr(".aff")).toLatin1(),
-                                 QString(fullPathWithoutExt+tr(".dic")).toLatin1());
+                                 QString(fullPathWithoutExt+tr(".dic")).toLatin1(),
+                                 0,
+                                 image.isEmpty() ? 0 : QFile::encodeName(image).constData());
+
+    // leave a precompiled image in the user's cache so later starts map it
+    // instead of parsing the text
+    if (_spellReady && ! image.isEmpty() && ! _spellChecker->is_image())
+      _spellChecker->save_image(QString(fullPathWithoutExt+tr(".dic")).toLatin1(),
+                                QFile::encodeName(image));
 
     QString spell_encoding = QString(_spellChecker->get_dic_encoding());
     _spellCodec = QTextCodec::codecForName(spell_encoding.toLocal8Bit());
@@ -2521,7 +2629,9 @@ void GUIClient::hunspell_initialize()
 
 void GUIClient::hunspell_uninitialize()
 {
+    QWriteLocker locker(&_spellLock);   // wait for background checks
     delete (Hunspell *)(_spellChecker);
+    _spellChecker = 0;
     QString homePath = QDir::homePath().toLatin1();
     QFile file(homePath + tr("/xTuple/user.dic"));
 
@@ -2574,14 +2684,78 @@ bool GUIClient::hunspell_ready()
 
 int GUIClient::hunspell_check(const QString word)
 {
+      QReadLocker locker(&_spellLock);
       QByteArray encodedString = _spellCodec->fromUnicode(word);
       return _spellChecker->spell(encodedString.data());
 }
 
+/** @brief Spell check a whole block of text at once.
+
+    The text is split into words the same way the XTextEdit context menu
+    finds the word under the cursor, and each distinct word is checked
+    once. Words shorter than two characters and words following a
+    backslash are skipped.
+
+    Unlike the other hunspell_ functions this may be called from any
+    thread, so long comments, notes and imported text can be checked in
+    the background. Checks share the dictionary and run concurrently;
+    adding, ignoring and suggesting words wait for them to finish.
+
+    @return The start and length of each misspelled word, in order
+  */
+QList<QPair<int, int> > GUIClient::hunspell_check_text(const QString &text)
+{
+    QList<QPair<int, int> > misspelled;
+    if (! _spellReady)
+      return misspelled;
+
+    QReadLocker locker(&_spellLock);
+    if (! _spellChecker)
+      return misspelled;
+
+    QHash<QString, bool> checked;
+    int length = text.length();
+    int start  = 0;
+    while (start < length)
+    {
+      int end = start;
+      while (end < length && (text.at(end).isLetterOrNumber() ||
+                              text.at(end).isMark() || text.at(end) == '_'))
+        end++;
+
+      if (end == start)
+      {
+        start++;
+        continue;
+      }
+
+      if (end - start > 1 && (start == 0 || text.at(start - 1) != '\\'))
+      {
+        QString word = text.mid(start, end - start);
+        QHash<QString, bool>::const_iterator it = checked.constFind(word);
+        bool ok;
+        if (it != checked.constEnd())
+          ok = it.value();
+        else
+        {
+          ok = _spellChecker->spell(_spellCodec->fromUnicode(word).constData()) > 0;
+          checked.insert(word, ok);
+        }
+        if (! ok)
+          misspelled.append(qMakePair(start, end - start));
+      }
+      start = end;
+    }
+
+    return misspelled;
+}
+
 const QStringList GUIClient::hunspell_suggest(const QString word)
 {
     char **wlst;
     QStringList wordList;
+    // suggesting builds and updates indexes inside the checker
+    QWriteLocker locker(&_spellLock);
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     if(_spellChecker->spell(encodedString.data()) < 1)
     {
@@ -2598,6 +2772,7 @@ const QStringList GUIClient::hunspell_suggest(const QString word)
 
 int GUIClient::hunspell_add(const QString word)
 {
+    QWriteLocker locker(&_spellLock);
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     //check if word has been added before
     if(!_spellAddWords.contains(encodedString.data()))
@@ -2607,6 +2782,7 @@ int GUIClient::hunspell_add(const QString word)
 
 int GUIClient::hunspell_ignore(const QString word)
 {
+    QWriteLocker locker(&_spellLock);
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     return _spellChecker->add(encodedString.data());
 }
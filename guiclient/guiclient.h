@@ -14,6 +14,8 @@
 #include <QAction>
 #include <QDate>
 #include <QMainWindow>
+#include <QPair>
+#include <QReadWriteLock>
 #include <QTimer>
 
 #include <xsqlquery.h>
@@ -248,6 +250,8 @@ class GUIClient : public QMainWindow
     void removeFromMacDockMenu(QWidget *w);
 #endif
 
+    static QString hunspell_dictionary();
+    static QString hunspell_image(const QString &dictionary);
     //check hunspell is ready
     Q_INVOKABLE bool hunspell_ready();
     //spellcheck word, returns 1 if word ok otherwise 0
@@ -258,6 +262,8 @@ class GUIClient : public QMainWindow
     Q_INVOKABLE int hunspell_add(const QString word);
     //add word to dict (word is valid until spell object is not destroyed)
     Q_INVOKABLE int hunspell_ignore(const QString word);
+    //spellcheck a whole text, returns start and length of each misspelled word
+    QList<QPair<int, int> > hunspell_check_text(const QString &text);
 
   public slots:
     void sReportError(const QString &);
@@ -290,6 +296,7 @@ class GUIClient : public QMainWindow
     void sItemGroupsUpdated(int, bool);
     void sItemsUpdated(int, bool);
     void sItemsitesUpdated();
+    void sMenuAboutToShow();
     void sPaymentsUpdated(int, int, bool);
     void sProjectsUpdated(int);
     void sProspectsUpdated();
@@ -461,6 +468,7 @@ class GUIClient : public QMainWindow
     QMap<QString, int> _fileMap;
     QTextCodec * _spellCodec;
     Hunspell * _spellChecker;
+    QReadWriteLock _spellLock;
     bool _spellReady;
     QStringList _spellAddWords;
 
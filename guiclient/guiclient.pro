@@ -470,6 +470,7 @@ FORMS =   absoluteCalendarItem.ui               \
           purgePostedCountSlips.ui              \
           purgePostedCounts.ui                  \
           quickRelocateLot.ui                   \
+          queryProfile.ui                       \
           quotes.ui                             \
           reasonCode.ui                         \
           reasonCodes.ui                        \
@@ -912,6 +913,7 @@ HEADERS = ../common/format.h                    \
           incidentWorkbench.h           \
           inputManager.h                \
           inputManagerPrivate.h         \
+          invTransactionBatch.h         \
           invoice.h                     \
           invoiceItem.h                 \
           invoiceList.h                 \
@@ -950,6 +952,7 @@ HEADERS = ../common/format.h                    \
           locales.h                     \
           location.h                    \
           locations.h                   \
+          logWriter.h                   \
           lotSerial.h                   \
           lotSerialSequence.h           \
           lotSerialSequences.h          \
@@ -1072,6 +1075,7 @@ HEADERS = ../common/format.h                    \
           purgePostedCountSlips.h       \
           purgePostedCounts.h           \
           quickRelocateLot.h            \
+          queryProfile.h                \
           quotes.h                      \
           reasonCode.h                  \
           reasonCodes.h                 \
@@ -1124,6 +1128,7 @@ HEADERS = ../common/format.h                    \
           saleTypes.h                           \
           scrapTrans.h                          \
           scrapWoMaterialFromWIP.h              \
+          scriptAsyncQuery.h                    \
           scriptablePrivate.h                   \
           scriptEditor.h                        \
           scripts.h                             \
@@ -1210,6 +1215,7 @@ HEADERS = ../common/format.h                    \
           translations.h                \
           uiform.h                      \
           uiformchooser.h               \
+          uiFormCache.h                 \
           uiforms.h                     \
           unappliedAPCreditMemos.h      \
           unappliedARCreditMemos.h      \
@@ -1531,6 +1537,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           incidentSeverity.cpp          \
           incidentWorkbench.cpp         \
           inputManager.cpp              \
+          invTransactionBatch.cpp       \
           invoice.cpp                   \
           invoiceItem.cpp               \
           invoiceList.cpp               \
@@ -1569,6 +1576,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           locales.cpp                   \
           location.cpp                  \
           locations.cpp                 \
+          logWriter.cpp                 \
           lotSerial.cpp                 \
           lotSerialSequence.cpp         \
           lotSerialSequences.cpp        \
@@ -1692,6 +1700,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           purgePostedCountSlips.cpp             \
           purgePostedCounts.cpp                 \
           quickRelocateLot.cpp                  \
+          queryProfile.cpp                      \
           quotes.cpp                            \
           reasonCode.cpp                        \
           reasonCodes.cpp                       \
@@ -1744,6 +1753,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           saleTypes.cpp                         \
           scrapTrans.cpp                        \
           scrapWoMaterialFromWIP.cpp            \
+          scriptAsyncQuery.cpp                  \
           scriptablePrivate.cpp                 \
           scriptEditor.cpp                      \
           scripts.cpp                           \
@@ -1830,6 +1840,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           translations.cpp                      \
           uiform.cpp                            \
           uiformchooser.cpp                     \
+          uiFormCache.cpp                       \
           uiforms.cpp                           \
           unappliedAPCreditMemos.cpp            \
           unappliedARCreditMemos.cpp            \
@@ -1903,5 +1914,12 @@ SOURCES = absoluteCalendarItem.cpp              \
 include( displays/displays.pri )
 include( hunspell.pri )
 
+# measurement modes for developers, off unless qmake is run with CONFIG+=benchmarks
+benchmarks {
+  DEFINES += XTUPLE_BENCHMARKS
+  HEADERS += displayBenchmark.h spellBenchmark.h
+  SOURCES += displayBenchmark.cpp spellBenchmark.cpp
+}
+
 RESOURCES += guiclient.qrc $${OPENRPT_IMAGE_DIR}/OpenRPTMetaSQL.qrc
 
@@ -17,7 +17,8 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QScrollArea>
-#include <quuencode.h>
+
+#include "imagecache.h"
 
 image::image(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : XDialog(parent, name, modal, fl)
@@ -102,7 +103,7 @@ enum SetResponse image::set(const ParameterList &pParams)
 void image::populate()
 {
   XSqlQuery image;
-  image.prepare( "SELECT image_name, image_descrip, image_data "
+  image.prepare( "SELECT image_name, image_descrip "
                  "FROM image "
                  "WHERE (image_id=:image_id);" );
   image.bindValue(":image_id", _imageid);
@@ -112,7 +113,7 @@ void image::populate()
     _name->setText(image.value("image_name").toString());
     _descrip->setText(image.value("image_descrip").toString());
 
-    __image.loadFromData(QUUDecode(image.value("image_data").toString()));
+    __image = ImageCache::instance()->image(_imageid);
     _image->setPixmap(QPixmap::fromImage(__image));
   }
 }
@@ -135,24 +136,6 @@ void image::sSave()
       _imageid = imageid.value("_image_id").toInt();
 //  ToDo
 
-    QImageWriter imageIo;
-    QBuffer  imageBuffer;
-    QString  imageString;
-
-    imageBuffer.open(QIODevice::ReadWrite);
-    imageIo.setDevice(&imageBuffer);
-    imageIo.setFormat("PNG");
-
-    if (!imageIo.write(__image))
-    {
-      QMessageBox::critical(this, tr("Error Saving Image"),
-        tr("There was an error trying to save the image.") );
-      return;
-    }
-
-    imageBuffer.close();
-    imageString = QUUEncode(imageBuffer);
-
     newImage.prepare( "INSERT INTO image "
                       "(image_id, image_name, image_descrip, image_data) "
                       "VALUES "
@@ -160,7 +143,12 @@ void image::sSave()
     newImage.bindValue(":image_id", _imageid);
     newImage.bindValue(":image_name", _name->text());
     newImage.bindValue(":image_descrip", _descrip->toPlainText());
-    newImage.bindValue(":image_data", imageString);
+    if (! ImageCache::instance()->bindImageData(newImage, __image))
+    {
+      QMessageBox::critical(this, tr("Error Saving Image"),
+        tr("There was an error trying to save the image.") );
+      return;
+    }
   }
   else if (_mode == cEdit)
   {
@@ -173,6 +161,7 @@ void image::sSave()
   }
 
   newImage.exec();
+  ImageCache::instance()->invalidate(_imageid);
 
   done(_imageid);
 }
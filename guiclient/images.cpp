@@ -18,6 +18,7 @@
 #include "mqlutil.h"
 
 #include "image.h"
+#include "imagecache.h"
 #include "guiclient.h"
 #include "errorReporter.h"
 
@@ -104,6 +105,7 @@ void images::sDelete()
   {
     return;
   }
+  ImageCache::instance()->invalidate(_image->id());
 
   sFillList();
 }
@@ -0,0 +1,254 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "invTransactionBatch.h"
+
+#include <QApplication>
+#include <QSqlError>
+#include <QVariant>
+
+#include "distributeInventory.h"
+#include "storedProcErrorLookup.h"
+#include "xdialog.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+/* proc is the name of the stored procedure and args its argument list,
+   with :placeholders for the values passed to addLine(), e.g.
+   InvTransactionBatch("issueWoMaterial", ":womatl_id, :qty, 0, true, :date").
+ */
+InvTransactionBatch::InvTransactionBatch(const QString &proc, const QString &args, QWidget *parent)
+  : _args(args),
+    _canceled(false),
+    _parent(parent),
+    _proc(proc),
+    _stopOnError(false),
+    _succeeded(0)
+{
+}
+
+InvTransactionBatch::~InvTransactionBatch()
+{
+}
+
+void InvTransactionBatch::addLine(const QString &label, const ParameterList &params)
+{
+  Line line;
+  line.label  = label;
+  line.params = params;
+  _lines.append(line);
+}
+
+int InvTransactionBatch::count() const
+{
+  return _lines.size();
+}
+
+/* sql runs after each successful line that produced an itemloc series,
+   inside the line's savepoint. It can use the line's parameters plus
+   :itemlocseries.
+ */
+void InvTransactionBatch::setAfterLine(const QString &sql)
+{
+  _after = sql;
+}
+
+/* By default a failed line is reported and the rest of the batch carries
+   on. With stopOnError the transaction holding the failed line is rolled
+   back and no further lines are posted. Lines with nothing to distribute
+   share a transaction, so they are posted all or none.
+ */
+void InvTransactionBatch::setStopOnError(bool stop)
+{
+  _stopOnError = stop;
+}
+
+bool InvTransactionBatch::canceled() const
+{
+  return _canceled;
+}
+
+QStringList InvTransactionBatch::errors() const
+{
+  return _errors;
+}
+
+QStringList InvTransactionBatch::failed() const
+{
+  return _failed;
+}
+
+int InvTransactionBatch::succeeded() const
+{
+  return _succeeded;
+}
+
+bool InvTransactionBatch::fail(int line, const QString &error)
+{
+  XSqlQuery rollback;
+  rollback.exec("ROLLBACK TO SAVEPOINT invtransactionbatch;");
+
+  _failed.append(_lines.at(line).label);
+  _errors.append(error);
+  if (DEBUG)
+    qDebug("InvTransactionBatch::fail(%d, %s)", line, qPrintable(error));
+
+  return ! _stopOnError;
+}
+
+/* Run every line and commit.
+
+   Lot, serial and location distributions are interactive, so they are kept
+   out of the batch transaction. The first pass posts every line in one
+   transaction; a line whose itemloc series needs distributing is rolled
+   back to its savepoint and set aside. Each of those lines is then posted
+   again in its own transaction with the distribution dialogs, so an open
+   dialog only holds the locks of its own line. The itemlocdist rows the
+   dialogs fill in are created by the posting procedure itself, so the
+   distributions cannot be collected before the line has been posted.
+
+   Returns false if stopOnError was set and a line failed or was canceled,
+   or if a commit failed. Lines committed before that are counted in
+   succeeded().
+ */
+bool InvTransactionBatch::exec()
+{
+  _canceled  = false;
+  _succeeded = 0;
+  _errors.clear();
+  _failed.clear();
+
+  if (_lines.isEmpty())
+    return true;
+
+  QList<int> all;
+  for (int i = 0; i < _lines.size(); i++)
+    all.append(i);
+
+  QList<int> deferred;
+  bool ok = postLines(all, &deferred);
+  for (int i = 0; (ok || ! _stopOnError) && i < deferred.size(); i++)
+    ok = postLines(QList<int>() << deferred.at(i), 0) && ok;
+
+  return ok;
+}
+
+/* Post lines in one transaction. If deferred is set, lines that need
+   distribution are rolled back and appended to it; otherwise the
+   distribution dialogs are shown for them.
+ */
+bool InvTransactionBatch::postLines(const QList<int> &lines, QList<int> *deferred)
+{
+  XSqlQuery txn;
+  txn.exec("BEGIN;");
+  if (txn.lastError().type() != QSqlError::NoError)
+  {
+    _failed.append(QString());
+    _errors.append(txn.lastError().text());
+    return false;
+  }
+
+  XSqlQuery call;
+  call.prepare(QString("SELECT result, EXISTS(SELECT 1"
+                       "                        FROM itemlocdist"
+                       "                       WHERE itemlocdist_series=result) AS needsdist"
+                       "  FROM (SELECT %1(%2) AS result) AS data;").arg(_proc, _args));
+
+  XSqlQuery after;
+  if (! _after.isEmpty())
+    after.prepare(_after);
+
+  bool ok        = true;
+  int  succeeded = 0;
+  for (int l = 0; ok && l < lines.size(); l++)
+  {
+    int                  i      = lines.at(l);
+    const ParameterList &params = _lines.at(i).params;
+
+    txn.exec(l == 0 ? "SAVEPOINT invtransactionbatch;"
+                    : "RELEASE SAVEPOINT invtransactionbatch;"
+                      "SAVEPOINT invtransactionbatch;");
+    if (txn.lastError().type() != QSqlError::NoError)
+    {
+      _failed.append(_lines.at(i).label);
+      _errors.append(txn.lastError().text());
+      ok = false;
+      break;
+    }
+
+    for (int p = 0; p < params.count(); p++)
+      call.bindValue(":" + params.name(p), params.value(p));
+    call.exec();
+    if (! call.first())
+    {
+      ok = fail(i, call.lastError().text());
+      continue;
+    }
+
+    int result = call.value("result").toInt();
+    if (result < 0)
+    {
+      ok = fail(i, storedProcErrorLookup(_proc, result));
+      continue;
+    }
+
+    if (call.value("needsdist").toBool())
+    {
+      if (deferred)
+      {
+        txn.exec("ROLLBACK TO SAVEPOINT invtransactionbatch;");
+        deferred->append(i);
+        continue;
+      }
+      if (distributeInventory::SeriesAdjust(result, _parent) == XDialog::Rejected)
+      {
+        _canceled = true;
+        ok = fail(i, QApplication::translate("InvTransactionBatch", "Transaction Canceled"));
+        continue;
+      }
+    }
+
+    if (! _after.isEmpty() && result > 0)
+    {
+      for (int p = 0; p < params.count(); p++)
+        after.bindValue(":" + params.name(p), params.value(p));
+      after.bindValue(":itemlocseries", result);
+      after.exec();
+      if (after.lastError().type() != QSqlError::NoError)
+      {
+        ok = fail(i, after.lastError().text());
+        continue;
+      }
+    }
+
+    succeeded++;
+  }
+
+  if (! ok)
+  {
+    txn.exec("ROLLBACK;");
+    return false;
+  }
+
+  txn.exec("RELEASE SAVEPOINT invtransactionbatch;"
+           "COMMIT;");
+  if (txn.lastError().type() != QSqlError::NoError)
+  {
+    QString error = txn.lastError().text();
+    txn.exec("ROLLBACK;");
+    _failed.append(QString());
+    _errors.append(error);
+    return false;
+  }
+
+  _succeeded += succeeded;
+  return true;
+}
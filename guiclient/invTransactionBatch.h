@@ -0,0 +1,71 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef INVTRANSACTIONBATCH_H
+#define INVTRANSACTIONBATCH_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <parameter.h>
+
+class QWidget;
+
+/* Post a list of inventory transactions with as few database transactions
+   as possible.
+
+   Each line calls the same stored procedure, which must return an itemloc
+   series or a negative error code. The call is prepared once and each
+   line runs inside its own savepoint, so a failed line only rolls back
+   that line. Lines with nothing to distribute are committed together in
+   one short transaction. Lines that need lot/serial/location distribution
+   are posted afterwards, one transaction each, so no dialog is ever open
+   while the rest of the batch holds its locks.
+ */
+class InvTransactionBatch
+{
+  public:
+    InvTransactionBatch(const QString &proc, const QString &args, QWidget *parent = 0);
+    virtual ~InvTransactionBatch();
+
+    virtual void addLine(const QString &label, const ParameterList &params);
+    virtual int  count() const;
+    virtual bool exec();
+
+    virtual void setAfterLine(const QString &sql);
+    virtual void setStopOnError(bool stop);
+
+    virtual bool        canceled()  const;
+    virtual QStringList errors()    const;
+    virtual QStringList failed()    const;
+    virtual int         succeeded() const;
+
+  protected:
+    virtual bool fail(int line, const QString &error);
+    virtual bool postLines(const QList<int> &lines, QList<int> *deferred);
+
+    struct Line {
+      QString       label;
+      ParameterList params;
+    };
+
+    QString     _after;
+    QString     _args;
+    bool        _canceled;
+    QStringList _errors;
+    QStringList _failed;
+    QList<Line> _lines;
+    QWidget    *_parent;
+    QString     _proc;
+    bool        _stopOnError;
+    int         _succeeded;
+};
+
+#endif
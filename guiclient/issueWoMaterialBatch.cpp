@@ -15,8 +15,8 @@
 #include <QMessageBox>
 #include <metasql.h>
 #include "inputManager.h"
-#include "distributeInventory.h"
 #include "errorReporter.h"
+#include "invTransactionBatch.h"
 
 issueWoMaterialBatch::issueWoMaterialBatch(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : XDialog(parent, name, modal, fl)
@@ -148,9 +148,6 @@ void issueWoMaterialBatch::sIssue()
                                QMessageBox::No | QMessageBox::Default, QMessageBox::Yes) == QMessageBox::No)
         return;
 
-  XSqlQuery rollback;
-  rollback.prepare("ROLLBACK;");
-
   QString sqlitems =
                ("SELECT womatl_id,"
                 "       CASE WHEN (womatl_qtyreq >= 0) THEN"
@@ -169,70 +166,39 @@ void issueWoMaterialBatch::sIssue()
   MetaSQLQuery mqlitems(sqlitems);
   XSqlQuery items = mqlitems.toQuery(params);
 
-  int succeeded = 0;;
-  QList<QString> failedItems;
-  QList<QString> errors;
-  while(items.next())
+  InvTransactionBatch batch("issueWoMaterial", ":womatl_id, :qty, 0, true, :date", this);
+  if (_metrics->boolean("LotSerialControl"))
   {
-    issue.exec("BEGIN;");	// because of possible lot, serial, or location distribution cancelations
-    issue.prepare("SELECT issueWoMaterial(:womatl_id, :qty, 0, true, :date) AS result;");
-    issue.bindValue(":womatl_id", items.value("womatl_id").toInt());
-    issue.bindValue(":qty", items.value("qty").toDouble());
-    issue.bindValue(":date",  _transDate->date());
-    issue.exec();
-  
-    if (issue.first())
-    {
-      if (issue.value("result").toInt() < 0)
-      {
-        rollback.exec();
-        ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information; Work Order ID #%1")
-                             .arg(_wo->id()),
-                             issue, __FILE__, __LINE__);
-        continue;
-      }
-      if (distributeInventory::SeriesAdjust(issue.value("result").toInt(), this) == XDialog::Rejected)
-      {
-        rollback.exec();
-        QMessageBox::information( this, tr("Material Issue"), tr("Transaction Canceled") );
-        continue;
-      }
-
-      if (_metrics->boolean("LotSerialControl"))
-      {
-        // Insert special pre-assign records for the lot/serial#
-        // so they are available when the material is returned
-        XSqlQuery lsdetail;
-        lsdetail.prepare("INSERT INTO lsdetail "
-                         "            (lsdetail_itemsite_id, lsdetail_created, lsdetail_source_type, "
-                         "             lsdetail_source_id, lsdetail_source_number, lsdetail_ls_id, lsdetail_qtytoassign) "
-                         "SELECT invhist_itemsite_id, NOW(), 'IM', "
-                         "       :orderitemid, invhist_ordnumber, invdetail_ls_id, (invdetail_qty * -1.0) "
-                         "FROM invhist JOIN invdetail ON (invdetail_invhist_id=invhist_id) "
-                         "WHERE (invhist_series=:itemlocseries)"
-                         "  AND (COALESCE(invdetail_ls_id, -1) > 0);");
-        lsdetail.bindValue(":orderitemid", items.value("womatl_id").toInt());
-        lsdetail.bindValue(":itemlocseries", issue.value("result").toInt());
-        lsdetail.exec();
-        if (lsdetail.lastError().type() != QSqlError::NoError)
-        {
-          rollback.exec();
-          ErrorReporter::error(QtCriticalMsg, this, tr("Error Issuing Material"),
-                               lsdetail, __FILE__, __LINE__);
-          continue;
-        }
-      }
+    // Insert special pre-assign records for the lot/serial#
+    // so they are available when the material is returned
+    batch.setAfterLine("INSERT INTO lsdetail "
+                       "            (lsdetail_itemsite_id, lsdetail_created, lsdetail_source_type, "
+                       "             lsdetail_source_id, lsdetail_source_number, lsdetail_ls_id, lsdetail_qtytoassign) "
+                       "SELECT invhist_itemsite_id, NOW(), 'IM', "
+                       "       :womatl_id, invhist_ordnumber, invdetail_ls_id, (invdetail_qty * -1.0) "
+                       "FROM invhist JOIN invdetail ON (invdetail_invhist_id=invhist_id) "
+                       "WHERE (invhist_series=:itemlocseries)"
+                       "  AND (COALESCE(invdetail_ls_id, -1) > 0);");
+  }
 
-      succeeded++;
-      issue.exec("COMMIT;");      
-    }
-    else
-    {
-      rollback.exec();
-      failedItems.append(items.value("item_number").toString());
-      errors.append(issue.lastError().text());
-    }
+  while(items.next())
+  {
+    ParameterList lineParams;
+    lineParams.append("womatl_id", items.value("womatl_id").toInt());
+    lineParams.append("qty",       items.value("qty").toDouble());
+    lineParams.append("date",      _transDate->date());
+    batch.addLine(items.value("item_number").toString(), lineParams);
   }
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information; Work Order ID #%1")
+                           .arg(_wo->id()),
+                           items, __FILE__, __LINE__))
+    return;
+
+  // lines without distributions commit together; the rest one at a time
+  batch.exec();
+  int succeeded = batch.succeeded();
+  QStringList failedItems = batch.failed();
+  QStringList errors = batch.errors();
 
   QMessageBox dlg(QMessageBox::Critical, "Errors Issuing Material", "", QMessageBox::Ok, this);
   dlg.setText(tr("%1 Items succeeded.\n%2 Items failed.").arg(succeeded).arg(failedItems.size()));
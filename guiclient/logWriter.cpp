@@ -0,0 +1,493 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "logWriter.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+#include <QApplication>
+#include <QDateTime>
+#include <QMutexLocker>
+
+#include "xtsettings.h"
+#include "xwidget.h"
+
+#define RINGSIZE     1024       // must be a power of two
+#define REPEATWINDOW 2000       // msecs identical messages are collapsed for
+#define RECENTSIZE     20       // messages kept for the log window
+
+/* Bounded multi-producer ring. Each slot's sequence number says whose turn
+   it is: a producer may fill slot i when its sequence equals the position
+   it claimed and the consumer may empty it when the sequence is one more.
+   Producers never take a lock; the single consumer runs under _writeLock.
+   Positions are compared as unsigned differences so they can wrap.
+
+   The writer thread sleeps on _wake when the ring is empty. It sets
+   _sleeping before its last look at the ring and a producer reads it
+   after filling a slot, so one of them always sees the other; a producer
+   only takes _wakeLock, to set _woken, when the writer may be asleep.
+   The writer never holds _wakeLock while it waits for _writeLock.
+ */
+class LogRing
+{
+  public:
+    struct Slot
+    {
+      QAtomicInt        seq;
+      LogWriter::Record record;
+    };
+
+    LogRing() : head(0), tail(0)
+    {
+      for (int i = 0; i < RINGSIZE; i++)
+        slots[i].seq.fetchAndStoreOrdered(i);
+    }
+
+    Slot       slots[RINGSIZE];
+    int        head;
+    QAtomicInt tail;
+};
+
+static LogRing    _ring;
+static LogWriter *_instance = 0;
+
+// the last message written and how often it has been repeated since
+static LogWriter::Record _last;
+static int               _repeats = 0;
+
+QFile       LogWriter::_file;
+QMutex      LogWriter::_writeLock(QMutex::Recursive);
+int         LogWriter::_writing = 0;
+QWaitCondition LogWriter::_wake;
+QMutex      LogWriter::_wakeLock;
+bool        LogWriter::_woken = false;
+QAtomicInt  LogWriter::_sleeping(0);
+QAtomicInt  LogWriter::_dropped(0);
+QAtomicInt  LogWriter::_notify(0);
+QAtomicInt  LogWriter::_running(0);
+QStringList LogWriter::_recent;
+
+static inline int ringAdd(int pos, int n)
+{
+  return (int)((uint)pos + (uint)n);
+}
+
+static inline int ringDiff(int a, int b)
+{
+  return (int)((uint)a - (uint)b);
+}
+
+LogWriter::LogWriter()
+  : QThread(0),
+    _stopping(0)
+{
+  setObjectName("LogWriter");
+}
+
+LogWriter *LogWriter::instance()
+{
+  if (! _instance)
+    _instance = new LogWriter();
+  return _instance;
+}
+
+/** @brief Queue a message for the writer thread.
+
+    @param type    The message's severity
+    @param message The text of the message
+    @param sql     The query the message is about, if any
+    @param elapsed How long the operation being reported took in msecs, or -1
+    @param source  Whether this is ordinary output or a database error
+
+    The name of the window with focus is recorded too when this is
+    called from the GUI thread. Fatal messages, and critical ones that
+    find the ring full, are written before this returns.
+ */
+void LogWriter::log(QtMsgType type, const QString &message,
+                    const QString &sql, qint64 elapsed, Source source)
+{
+  Record record;
+  record.type    = type;
+  record.time    = QDateTime::currentMSecsSinceEpoch();
+  record.elapsed = elapsed;
+  record.source  = source;
+  record.message = message;
+  record.sql     = sql;
+  record.window  = currentWindow();
+
+  if (type != QtFatalMsg && _running.fetchAndAddOrdered(0))
+  {
+    if (enqueue(record))
+    {
+      if (_sleeping.fetchAndAddOrdered(0))
+      {
+        QMutexLocker wakeLocker(&_wakeLock);
+        _woken = true;
+        _wake.wakeOne();
+      }
+      return;
+    }
+    if (type == QtDebugMsg || type == QtWarningMsg)
+    {
+      _dropped.fetchAndAddOrdered(1);
+      return;
+    }
+  }
+
+  // _writeLock is recursive, so this thread may already be in write()
+  QMutexLocker locker(&_writeLock);
+  if (_writing > 0 && type != QtFatalMsg)
+  {
+    if (! enqueue(record))
+      _dropped.fetchAndAddOrdered(1);
+    return;
+  }
+
+  Record pending;
+  while (dequeue(pending))        // keep everything in order
+    write(pending);
+  write(record);
+  while (dequeue(pending))        // and anything logged while writing it
+    write(pending);
+  if (type == QtFatalMsg)
+  {
+    writeRepeated();
+    fflush(stdout);
+    if (_file.isOpen())
+      _file.flush();
+  }
+}
+
+bool LogWriter::notify(QtMsgType type)
+{
+#if QT_VERSION >= 0x050500
+  if (type == QtInfoMsg)
+    type = QtWarningMsg;
+#endif
+  return _notify.fetchAndAddOrdered(0) & (1 << type);
+}
+
+void LogWriter::setNotify(QtMsgType type, bool notify)
+{
+  int bits;
+  int newbits;
+  do
+  {
+    bits    = _notify.fetchAndAddOrdered(0);
+    newbits = notify ? (bits | (1 << type)) : (bits & ~(1 << type));
+  } while (! _notify.testAndSetOrdered(bits, newbits));
+}
+
+/** @brief Write everything waiting in the ring now. */
+void LogWriter::flush()
+{
+  QMutexLocker locker(&_writeLock);
+
+  bool   wrote = false;
+  Record record;
+  while (dequeue(record))
+  {
+    write(record);
+    wrote = true;
+  }
+
+  if (_repeats > 0 &&
+      QDateTime::currentMSecsSinceEpoch() - _last.time >= REPEATWINDOW)
+  {
+    writeRepeated();
+    wrote = true;
+  }
+
+  if (wrote)
+  {
+    fflush(stdout);
+    if (_file.isOpen())
+      _file.flush();
+  }
+}
+
+QStringList LogWriter::recent()
+{
+  QMutexLocker locker(&_writeLock);
+  return _recent;
+}
+
+void LogWriter::clearRecent()
+{
+  QMutexLocker locker(&_writeLock);
+  _recent.clear();
+}
+
+/** @brief Read the settings and start writing in the background.
+
+    This should be called from the GUI thread once the application
+    exists, since that is where the settings live and where the
+    logged() signal's receivers are.
+ */
+void LogWriter::startWriter()
+{
+  LogWriter *writer = instance();
+  if (writer->isRunning())
+    return;
+
+  loadSettings();
+  writer->_stopping.fetchAndStoreOrdered(0);
+  _running.fetchAndStoreOrdered(1);
+  writer->QThread::start(QThread::LowPriority);
+}
+
+/** @brief Stop the writer thread after it empties the ring.
+
+    Messages logged afterwards are written synchronously.
+ */
+void LogWriter::stopWriter()
+{
+  if (! _instance)
+    return;
+
+  _running.fetchAndStoreOrdered(0);
+  _instance->_stopping.fetchAndStoreOrdered(1);
+  _wakeLock.lock();
+  _woken = true;
+  _wake.wakeAll();
+  _wakeLock.unlock();
+  _instance->wait();
+  flush();
+
+  QMutexLocker locker(&_writeLock);
+  writeRepeated();
+  if (_file.isOpen())
+    _file.close();
+}
+
+/* Write whatever is queued, then sleep until more arrives. While a
+   message is being counted as repeated the writer also wakes up after
+   REPEATWINDOW to report the repeats.
+ */
+void LogWriter::run()
+{
+  forever
+  {
+    flush();
+
+    _writeLock.lock();
+    bool repeating = (_repeats > 0);
+    _writeLock.unlock();
+
+    _sleeping.fetchAndStoreOrdered(1);
+    bool idle = ! pending();
+
+    QMutexLocker locker(&_wakeLock);
+    if (_stopping.fetchAndAddOrdered(0))
+      break;
+    if (idle && ! _woken)
+      _wake.wait(&_wakeLock, repeating ? REPEATWINDOW : ULONG_MAX);
+    _woken = false;
+    _sleeping.fetchAndStoreOrdered(0);
+  }
+  _sleeping.fetchAndStoreOrdered(0);
+  flush();
+}
+
+// is a message waiting in the ring?
+bool LogWriter::pending()
+{
+  QMutexLocker locker(&_writeLock);
+  LogRing::Slot &slot = _ring.slots[_ring.head & (RINGSIZE - 1)];
+  return ringDiff(slot.seq.fetchAndAddOrdered(0), ringAdd(_ring.head, 1)) >= 0;
+}
+
+bool LogWriter::enqueue(const Record &record)
+{
+  int pos = _ring.tail.fetchAndAddOrdered(0);
+  forever
+  {
+    LogRing::Slot &slot = _ring.slots[pos & (RINGSIZE - 1)];
+    int diff = ringDiff(slot.seq.fetchAndAddOrdered(0), pos);
+    if (diff == 0)
+    {
+      if (_ring.tail.testAndSetOrdered(pos, ringAdd(pos, 1)))
+      {
+        slot.record = record;
+        slot.seq.fetchAndStoreOrdered(ringAdd(pos, 1));
+        return true;
+      }
+    }
+    else if (diff < 0)
+      return false;     // the writer hasn't caught up
+
+    pos = _ring.tail.fetchAndAddOrdered(0);
+  }
+}
+
+// only called with _writeLock held
+bool LogWriter::dequeue(Record &record)
+{
+  LogRing::Slot &slot = _ring.slots[_ring.head & (RINGSIZE - 1)];
+  if (ringDiff(slot.seq.fetchAndAddOrdered(0), ringAdd(_ring.head, 1)) < 0)
+    return false;
+
+  record      = slot.record;
+  slot.record = Record();
+  slot.seq.fetchAndStoreOrdered(ringAdd(_ring.head, RINGSIZE));
+  _ring.head  = ringAdd(_ring.head, 1);
+  return true;
+}
+
+/* Reading QSettings is far too slow to do for every message, so the
+   catchQ* preferences are cached here and kept up to date by setNotify().
+ */
+void LogWriter::loadSettings()
+{
+  int bits = 0;
+  if (xtsettingsValue("catchQDebug").toBool())
+    bits |= (1 << QtDebugMsg);
+  if (xtsettingsValue("catchQWarning").toBool())
+    bits |= (1 << QtWarningMsg);
+  if (xtsettingsValue("catchQCritical").toBool())
+    bits |= (1 << QtCriticalMsg);
+  if (xtsettingsValue("catchQFatal").toBool())
+    bits |= (1 << QtFatalMsg);
+  _notify.fetchAndStoreOrdered(bits);
+
+  QString filename = xtsettingsValue("logFile").toString();
+  QMutexLocker locker(&_writeLock);
+  if (! filename.isEmpty() && ! _file.isOpen())
+  {
+    _file.setFileName(filename);
+    if (! _file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+      printf("Could not open log file %s: %s\n", qPrintable(filename),
+             qPrintable(_file.errorString()));
+  }
+}
+
+static QString escaped(const QString &field)
+{
+  QString result = field;
+  return result.replace('\\', "\\\\").replace('\t', "\\t").replace('\n', "\\n");
+}
+
+// only called with _writeLock held
+void LogWriter::write(const Record &record)
+{
+  _writing++;
+  int dropped = _dropped.fetchAndStoreOrdered(0);
+  if (dropped > 0)
+  {
+    Record note;
+    note.type    = QtWarningMsg;
+    note.time    = record.time;
+    note.message = QString("%1 log messages were dropped").arg(dropped);
+    write(note);
+  }
+
+  if (record.type    == _last.type    &&
+      record.source  == _last.source  &&
+      record.message == _last.message &&
+      record.sql     == _last.sql     &&
+      record.time - _last.time < REPEATWINDOW)
+  {
+    _repeats++;
+    _writing--;
+    return;
+  }
+  writeRepeated();
+  _last    = record;
+  _repeats = 0;
+
+  QString level;
+  switch (record.type)
+  {
+    case QtDebugMsg:    level = "Debug";    break;
+#if QT_VERSION >= 0x050500
+    case QtInfoMsg:     level = "Info";     break;
+#endif
+    case QtWarningMsg:  level = "Warning";  break;
+    case QtCriticalMsg: level = "Critical"; break;
+    case QtFatalMsg:    level = "Fatal";    break;
+  }
+
+  QDateTime time = QDateTime::fromMSecsSinceEpoch(record.time);
+  QString   msg  = time.toString();
+  bool      notified;
+  bool      iserror;
+  if (record.source == SqlError)
+  {
+    msg     += " " + record.message + "\n" + record.sql;
+    notified = true;
+    iserror  = true;
+  }
+  else
+  {
+    msg     += " " + level + ": " + record.message;
+    notified = notify(record.type);
+    iserror  = (record.type == QtCriticalMsg) || (record.type == QtFatalMsg);
+    printf("%s\n", qPrintable(msg));
+  }
+
+  if (_file.isOpen())
+  {
+    QStringList fields;
+    fields << time.toString(Qt::ISODate)
+           << (record.source == SqlError ? QString("SQL") : level)
+           << escaped(record.window)
+           << (record.elapsed >= 0 ? QString::number(record.elapsed) : QString())
+           << escaped(record.message)
+           << escaped(record.sql);
+    _file.write(fields.join("\t").toUtf8() + "\n");
+  }
+
+  _recent.append(msg);
+  while (_recent.size() > RECENTSIZE)
+    _recent.removeFirst();
+
+  if (_instance)
+    emit _instance->logged(msg, notified, iserror);
+  _writing--;
+}
+
+// only called with _writeLock held
+void LogWriter::writeRepeated()
+{
+  if (_repeats <= 0)
+    return;
+
+  QString msg = QString("%1 last message repeated %2 times")
+                  .arg(QDateTime::currentDateTime().toString()).arg(_repeats);
+  if (_last.source != SqlError)
+    printf("%s\n", qPrintable(msg));
+  if (_file.isOpen())
+    _file.write(QString("%1\t%2\t\t\t%3\t\n")
+                  .arg(QDateTime::currentDateTime().toString(Qt::ISODate))
+                  .arg("Repeated").arg(_repeats).toUtf8());
+  _recent.append(msg);
+  while (_recent.size() > RECENTSIZE)
+    _recent.removeFirst();
+  _repeats = 0;
+  _last    = Record();
+}
+
+/* The window a message came from, if it came from the GUI thread.
+   XWidgets are found before the window that contains them so MDI
+   windows are named rather than the main window.
+ */
+QString LogWriter::currentWindow()
+{
+  QCoreApplication *app = QCoreApplication::instance();
+  if (! app || QThread::currentThread() != app->thread() || ! qobject_cast<QApplication*>(app))
+    return QString();
+
+  for (QWidget *w = QApplication::focusWidget(); w; w = w->parentWidget())
+    if (qobject_cast<XWidget*>(w) || w->isWindow())
+      return w->objectName();
+
+  return QString();
+}
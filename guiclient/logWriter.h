@@ -0,0 +1,103 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __LOGWRITER_H__
+#define __LOGWRITER_H__
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+/* Background writer for everything that goes through xTupleMessageOutput
+   and errorLogListener.
+
+   Producers only fill a slot in a fixed size ring buffer and return, so
+   logging from any thread is cheap and never blocks on the console, the
+   log file or the GUI. The writer thread formats the messages, writes them
+   to stdout and, if the logFile setting names one, to a file of tab
+   separated records with the window, elapsed time and SQL of each message.
+   Identical messages arriving in quick succession are collapsed into a
+   single "repeated" line.
+
+   Until startWriter() is called, and after stopWriter(), messages are written
+   synchronously by the thread that logs them. A message logged while one
+   is being written on the same thread, say by a receiver of logged(), is
+   queued and written right after it.
+ */
+class LogWriter : public QThread
+{
+  Q_OBJECT
+
+  public:
+    enum Source { Message, SqlError };
+
+    struct Record
+    {
+      Record() : type(QtDebugMsg), time(0), elapsed(-1), source(Message) {}
+      QtMsgType type;
+      qint64    time;
+      qint64    elapsed;
+      Source    source;
+      QString   message;
+      QString   sql;
+      QString   window;
+    };
+
+    static LogWriter *instance();
+
+    static void log(QtMsgType type, const QString &message,
+                    const QString &sql = QString(), qint64 elapsed = -1,
+                    Source source = Message);
+
+    static bool        notify(QtMsgType type);
+    static void        setNotify(QtMsgType type, bool notify);
+    static void        flush();
+    static QStringList recent();
+    static void        clearRecent();
+    static void        startWriter();
+    static void        stopWriter();
+
+  signals:
+    void logged(const QString &message, bool notify, bool iserror);
+
+  protected:
+    virtual void run();
+
+  private:
+    LogWriter();
+
+    static bool    dequeue(Record &record);
+    static bool    enqueue(const Record &record);
+    static bool    pending();
+    static void    loadSettings();
+    static void    write(const Record &record);
+    static void    writeRepeated();
+    static QString currentWindow();
+
+    QAtomicInt _stopping;
+
+    static QFile      _file;
+    static QMutex     _writeLock;
+    static int        _writing;
+    static QWaitCondition _wake;
+    static QMutex     _wakeLock;
+    static bool       _woken;
+    static QAtomicInt _sleeping;
+    static QAtomicInt _dropped;
+    static QAtomicInt _notify;
+    static QAtomicInt _running;
+    static QStringList _recent;
+};
+
+#endif
@@ -115,11 +115,16 @@
 #include "errorReporter.h"
 #include "login2.h"
 #include "currenciesDialog.h"
+#ifdef XTUPLE_BENCHMARKS
+#include "displayBenchmark.h"
+#include "spellBenchmark.h"
+#endif
 #include "registrationKeyDialog.h"
 #include "guiclient.h"
 #include "version.h"
 #include "metrics.h"
 #include "metricsenc.h"
+#include "readreplica.h"
 #include "scripttoolbox.h"
 #include "xmainwindow.h"
 #include "checkForUpdates.h"
@@ -161,6 +166,13 @@ int main(int argc, char *argv[])
   bool    _enhancedAuth   = false;
   bool    havePasswd      = false;
   bool    forceWelcomeStub= false;
+#ifdef XTUPLE_BENCHMARKS
+  QString benchmarkConfig;
+  QString benchmarkOutput;
+  bool    spellBenchmark  = false;
+  QString spellBenchmarkWords;
+#endif
+  QString replicaURL;
 #if QT_VERSION >= 0x050000
   qInstallMessageHandler(xTupleMessageOutput);
 #else
@@ -220,9 +232,29 @@ int main(int argc, char *argv[])
       }
       else if (argument.contains("-forceWelcomeStub", Qt::CaseInsensitive))
         forceWelcomeStub = true;
+      else if (argument.contains("-replicaURL=", Qt::CaseInsensitive))
+        replicaURL = argument.right(argument.length() - 12);
+#ifdef XTUPLE_BENCHMARKS
+      else if (argument.contains("-spellBenchmark", Qt::CaseInsensitive))
+      {
+        spellBenchmark = true;
+        if (argument.contains("="))
+          spellBenchmarkWords = argument.mid(argument.indexOf("=") + 1);
+      }
+      else if (argument.contains("-benchmarkOutput=", Qt::CaseInsensitive))
+        benchmarkOutput = argument.right(argument.length() - 17);
+      else if (argument.contains("-benchmark=", Qt::CaseInsensitive))
+        benchmarkConfig = argument.right(argument.length() - 11);
+#endif
     }
   }
 
+#ifdef XTUPLE_BENCHMARKS
+  // the spell checker needs neither a database nor a main window
+  if (spellBenchmark)
+    return SpellBenchmark(spellBenchmarkWords, benchmarkOutput).run();
+#endif
+
   // Try and load a default translation file and install it
   // otherwise if we are non-english inform the user that translation are available
   bool checkLanguage = false;
@@ -697,6 +729,23 @@ int main(int argc, char *argv[])
 
   initializePlugin(_preferences, _metrics, _privileges, omfgThis->username(), omfgThis->workspace());
 
+  // settings can only be read once the application has its name
+  if (replicaURL.isEmpty())
+    replicaURL = xtsettingsValue("replicaDatabaseURL").toString();
+  if (! replicaURL.isEmpty())
+  {
+    _splash->showMessage(QObject::tr("Connecting to Read Replica"), SplashTextAlignment, SplashTextColor);
+    qApp->processEvents();
+    ReadReplica::setMaxLag(xtsettingsValue("replicaMaxLag", ReadReplica::maxLag()).toInt());
+    QString errmsg;
+    if (! ReadReplica::open(replicaURL, QSqlDatabase::database(), &errmsg))
+      qWarning("Could not connect to the read replica %s, using the primary for everything: %s",
+               qPrintable(replicaURL), qPrintable(errmsg));
+    else if (! errmsg.isEmpty())
+      qWarning("The read replica %s is not usable yet: %s",
+               qPrintable(replicaURL), qPrintable(errmsg));
+  }
+
 // START code for updating the locale settings if they haven't been already
   XSqlQuery lc;
   lc.exec("SELECT count(*) FROM metric WHERE metric_name='AutoUpdateLocaleHasRun';");
@@ -717,6 +766,25 @@ int main(int argc, char *argv[])
   }
 // END code for updating locale settings
 
+#ifdef XTUPLE_BENCHMARKS
+  if (! benchmarkConfig.isEmpty())
+  {
+    _splash->hide();
+    DisplayBenchmark benchmark(benchmarkConfig, benchmarkOutput);
+    int result = benchmark.run();
+
+    ReadReplica::close();
+    delete omfgThis;
+    delete _metrics;
+    delete _preferences;
+    delete _privileges;
+    if (0 != _metricsenc)
+      delete _metricsenc;
+
+    return result;
+  }
+#endif
+
   QObject::connect(&app, SIGNAL(aboutToQuit()), &app, SLOT(closeAllWindows()));
   if (omfgThis->_singleWindow.isEmpty())
   {
@@ -867,6 +935,7 @@ int main(int argc, char *argv[])
   app.exec();
 
 //  Clean up
+  ReadReplica::close();
   delete _metrics;
   delete _preferences;
   delete _privileges;
@@ -44,6 +44,8 @@
 #include "userPreferences.h"
 #include "hotkeys.h"
 #include "errorLog.h"
+#include "queryProfile.h"
+#include "querytrace.h"
 
 #include "customCommands.h"
 #include "employee.h"
@@ -85,6 +87,7 @@ menuSystem::menuSystem(GUIClient *Pparent) :
   QList<QToolBar *> toolbars = parent->findChildren<QToolBar *>();
 
   errorLogListener::initialize();
+  QueryTrace::setEnabled(xtsettingsValue("traceQueries", false).toBool());
 
   systemMenu		= new QMenu(parent);
   masterInfoMenu	= new QMenu(parent);
@@ -104,6 +107,7 @@ menuSystem::menuSystem(GUIClient *Pparent) :
 
     { "sys.eventManager",             tr("E&vent Manager..."),              SLOT(sEventManager()),             systemMenu, "true",                                      NULL, NULL, true },
     { "sys.viewDatabaseLog",          tr("View Database &Log..."),          SLOT(sErrorLog()),                 systemMenu, "true",                                      NULL, NULL, true },
+    { "sys.viewQueryProfile",         tr("View &Query Profile..."),         SLOT(sQueryProfile()),             systemMenu, "true",                                      NULL, NULL, true },
     { "separator",                    NULL,                                 NULL,                              systemMenu, "true",                                      NULL, NULL, true },
     { "sys.preferences",              tr("&Preferences..."),                SLOT(sPreferences()),              systemMenu, "MaintainPreferencesSelf MaintainPreferencesOthers",  NULL,   NULL,   true },
     { "sys.hotkeys",                  tr("&Hot Keys..."),                   SLOT(sHotKeys()),                  systemMenu, "true",  NULL,   NULL,   !(_privileges->check("MaintainPreferencesSelf") || _privileges->check("MaintainPreferencesOthers")) },
@@ -337,6 +341,11 @@ void menuSystem::sErrorLog()
   omfgThis->handleNewWindow(new errorLog());
 }
 
+void menuSystem::sQueryProfile()
+{
+  omfgThis->handleNewWindow(new queryProfile());
+}
+
 void menuSystem::sPrintAlignment()
 {
   orReport report("Alignment");
@@ -53,6 +53,7 @@ class menuSystem : public QObject
     void sSearchEmployees();
     void sEmployeeGroups();
     void sErrorLog();
+    void sQueryProfile();
 
     void sCustomCommands();
     void sScripts();
@@ -10,17 +10,228 @@
 
 #include "printMulticopyDocument.h"
 
+#include <QApplication>
+#include <QDir>
+#include <QDomDocument>
+#include <QMap>
 #include <QMessageBox>
+#include <QMutex>
+#include <QRegExp>
 #include <QSqlError>
+#include <QSqlQuery>
 #include <QSqlRecord>
+#include <QThread>
 #include <QVariant>
+#include <QWaitCondition>
 
 #include <metasql.h>
 #include <openreports.h>
+#include <orprerender.h>
+#include <orprintrender.h>
+#include <renderobjects.h>
 
 #include "distributeInventory.h"
 #include "errorReporter.h"
 #include "storedProcErrorLookup.h"
+#include "workerconnection.h"
+
+/* A document in a pipelined batch. The GUI thread fills in everything but
+   _docs and _error before the workers start; a worker fills those and sets
+   _done. Ownership of _docs passes to whoever takes the job.
+ */
+class PrerenderJob
+{
+  public:
+    PrerenderJob() : _docid(-1), _done(false) {}
+    ~PrerenderJob() { qDeleteAll(_docs); }
+
+    int                  _docid;
+    QString              _docnumber;
+    QString              _reportname;
+    QList<ParameterList> _copies;
+
+    bool                 _done;
+    QList<ORODocument*>  _docs;
+    QString              _error;
+};
+
+class PrerenderPipeline;
+
+class PrerenderWorker : public QThread
+{
+  public:
+    PrerenderWorker(PrerenderPipeline *pipeline) : _pipeline(pipeline) {}
+
+  protected:
+    void run();
+
+  private:
+    PrerenderPipeline *_pipeline;
+};
+
+/* Pre-render the documents of a batch on worker threads so the GUI thread
+   can spool one document while the next ones are fetched and laid out.
+   Only connection parameters are captured here; each worker opens its own
+   clone of the connection in run() and ORPreRender never sees a connection
+   owned by another thread. Workers stay at most _lookahead documents ahead
+   of the consumer to bound memory use.
+ */
+class PrerenderPipeline
+{
+  friend class PrerenderWorker;
+
+  public:
+    PrerenderPipeline(QList<PrerenderJob*> jobs, int threads, int lookahead)
+      : _conn(QSqlDatabase::database()),
+        _consumed(0),
+        _jobs(jobs),
+        _lookahead(qMax(lookahead, 1)),
+        _next(0),
+        _stop(false)
+    {
+      for (int i = 0; i < _jobs.size(); i++)
+        _index.insert(_jobs.at(i)->_docid, i);
+      for (int i = 0; i < qMin(threads, _jobs.size()); i++)
+      {
+        PrerenderWorker *worker = new PrerenderWorker(this);
+        _workers.append(worker);
+        worker->start(QThread::LowPriority);
+      }
+    }
+
+    ~PrerenderPipeline()
+    {
+      _mutex.lock();
+      _stop = true;
+      _canRender.wakeAll();
+      _mutex.unlock();
+      foreach (PrerenderWorker *worker, _workers)
+        worker->wait();
+      qDeleteAll(_workers);
+      qDeleteAll(_jobs);
+    }
+
+    bool contains(int docid) const { return _index.contains(docid); }
+
+    /* Wait for the document to finish rendering and hand the rendered
+       pages to the caller. Workers are normally well ahead of the spooler
+       so this rarely blocks.
+     */
+    QList<ORODocument*> take(int docid, QString &error)
+    {
+      QList<ORODocument*> result;
+      if (! _index.contains(docid))
+        return result;
+
+      int           idx = _index.value(docid);
+      PrerenderJob *job = _jobs.at(idx);
+      _mutex.lock();
+      // documents skipped by script overrides must not stall the workers
+      _consumed = qMax(_consumed, idx - _lookahead + 1);
+      _canRender.wakeAll();
+      while (! job->_done && ! _workers.isEmpty())
+        _rendered.wait(&_mutex);
+      result = job->_docs;
+      job->_docs.clear();
+      error = job->_error;
+      _consumed = qMax(_consumed, idx + 1);
+      _canRender.wakeAll();
+      _mutex.unlock();
+
+      return result;
+    }
+
+  private:
+    PrerenderJob *nextJob()
+    {
+      QMutexLocker locker(&_mutex);
+      while (! _stop && _next < _jobs.size() &&
+             _next - _consumed >= _lookahead)
+        _canRender.wait(&_mutex);
+      if (_stop || _next >= _jobs.size())
+        return 0;
+      return _jobs.at(_next++);
+    }
+
+    void finished(PrerenderJob *job)
+    {
+      QMutexLocker locker(&_mutex);
+      job->_done = true;
+      _rendered.wakeAll();
+    }
+
+    WorkerConnection         _conn;
+    int                      _consumed;
+    QMap<int, int>           _index;
+    QList<PrerenderJob*>     _jobs;
+    int                      _lookahead;
+    QMutex                   _mutex;
+    int                      _next;
+    QWaitCondition           _canRender;
+    QWaitCondition           _rendered;
+    bool                     _stop;
+    QList<PrerenderWorker*>  _workers;
+};
+
+void PrerenderWorker::run()
+{
+  QString      errmsg;
+  QSqlDatabase db = _pipeline->_conn.open("prerender", &errmsg);
+  QMap<QString, QDomDocument> definitions;
+
+  while (PrerenderJob *job = _pipeline->nextJob())
+  {
+    if (! db.isOpen())
+    {
+      job->_error = errmsg;
+      _pipeline->finished(job);
+      continue;
+    }
+
+    if (! definitions.contains(job->_reportname))
+    {
+      QDomDocument definition;
+      QSqlQuery reportq(db);
+      reportq.prepare("SELECT report_source "
+                      "  FROM report "
+                      " WHERE (report_name=:report_name) "
+                      "ORDER BY report_grade DESC LIMIT 1;");
+      reportq.bindValue(":report_name", job->_reportname);
+      if (reportq.exec() && reportq.first())
+        definition.setContent(reportq.value("report_source").toString());
+      definitions.insert(job->_reportname, definition);
+    }
+
+    QDomDocument definition = definitions.value(job->_reportname);
+    if (definition.isNull())
+      job->_error = QApplication::translate("printMulticopyDocument",
+                                            "Cannot find form %1")
+                      .arg(job->_reportname);
+    else
+    {
+      foreach (ParameterList params, job->_copies)
+      {
+        ORPreRender pre;
+        pre.setDatabase(db);
+        pre.setDom(definition);
+        pre.setParamList(params);
+        ORODocument *doc = pre.generate();
+        if (! doc)
+        {
+          job->_error = QApplication::translate("printMulticopyDocument",
+                                                "Could not render %1 for %2")
+                          .arg(job->_reportname, job->_docnumber);
+          break;
+        }
+        job->_docs.append(doc);
+      }
+    }
+    _pipeline->finished(job);
+  }
+
+  if (db.isValid())
+    WorkerConnection::close(db);
+}
 
 class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
 {
@@ -33,17 +244,26 @@ class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
       _parent(parent),
       _postPrivilege(postPrivilege),
       _printer(0),
-      _mpIsInitialized(false)
+      _mpIsInitialized(false),
+      _pipeline(0),
+      _pipelined(false)
     {
       setupUi(_parent);
 
-      _printer = new QPrinter(QPrinter::HighResolution);
+      _printer = new ReportPrinter(QPrinter::HighResolution);
 
       _print->setFocus();
+
+      _pipelined = _metrics->boolean("PipelinedBatchPrinting");
     }
 
     ~printMulticopyDocumentPrivate()
     {
+      if (_pipeline)
+      {
+        delete _pipeline;
+        _pipeline = 0;
+      }
       if (_printer)
       {
         delete _printer;
@@ -58,10 +278,22 @@ class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
     QString                   _doctypefull;
     ::printMulticopyDocument *_parent;
     QString                   _postPrivilege;
-    QPrinter                 *_printer;
+    ReportPrinter            *_printer;
     bool                      _mpIsInitialized;
+    QString                   _pdfDirectory;
+    PrerenderPipeline        *_pipeline;
+    bool                      _pipelined;
     QList<QVariant>           _printed;
     QString                   _reportKey;
+
+    QString pdfFileName(const QString &docnumber, int copy) const
+    {
+      QString filename = QString("%1-%2").arg(_doctype, docnumber);
+      if (copy > 0)
+        filename += QString("-%1").arg(copy + 1);
+      filename.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+      return QDir(_pdfDirectory).filePath(filename + ".pdf");
+    }
 };
 
 printMulticopyDocument::printMulticopyDocument(QWidget    *parent,
@@ -151,6 +383,14 @@ enum SetResponse printMulticopyDocument::set(const ParameterList &pParams)
   if (valid)
     setId(param.toInt());
 
+  param = pParams.value("pdfDirectory", &valid);
+  if (valid)
+    setPdfDirectory(param.toString());
+
+  param = pParams.value("pipelined", &valid);
+  if (valid)
+    setPipelined(param.toBool());
+
   if (pParams.inList("print"))
   {
     sPrint();
@@ -315,6 +555,7 @@ void printMulticopyDocument::sPrint()
   MetaSQLQuery  docinfom(_docinfoQueryString);
   ParameterList alldocsp = getParamsDocList();
   XSqlQuery     docinfoq = docinfom.toQuery(alldocsp);
+  startPipeline(docinfoq);
   while (docinfoq.next())
   {
     message(tr("Processing %1 #%2")
@@ -329,6 +570,12 @@ void printMulticopyDocument::sPrint()
     message("");
   }
 
+  if (_data->_pipeline)
+  {
+    delete _data->_pipeline;
+    _data->_pipeline = 0;
+  }
+
 //  if (! mpStartedInitialized)
   if (!_data->_captive)
   {
@@ -336,13 +583,21 @@ void printMulticopyDocument::sPrint()
     _data->_mpIsInitialized = false;
   }
 
+  bool toPdf = ! _data->_pdfDirectory.isEmpty();
   if (_data->_printed.size() == 0)
-    QMessageBox::information(this, tr("No Documents to Print"),
-                             tr("There aren't any documents to print."));
+  {
+    if (toPdf)
+      qWarning("printMulticopyDocument did not write any %s documents to %s",
+               qPrintable(_data->_doctypefull), qPrintable(_data->_pdfDirectory));
+    else
+      QMessageBox::information(this, tr("No Documents to Print"),
+                               tr("There aren't any documents to print."));
+  }
   else if (! _markAllPrintedQry.isEmpty() &&
-           QMessageBox::question(this, tr("Mark Documents as Printed?"),
-                                 tr("<p>Did all of the documents print correctly?"),
-                                 QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+           (toPdf ||
+            QMessageBox::question(this, tr("Mark Documents as Printed?"),
+                                  tr("<p>Did all of the documents print correctly?"),
+                                  QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes))
   {
     ParameterList allp;
     allp.append("printedDocs", QVariant(_data->_printed));
@@ -374,6 +629,27 @@ bool printMulticopyDocument::sPrintOneDoc(XSqlQuery *docq)
   QString docnumber  = docq->value("docnumber").toString();
   bool    printedOk  = false;
 
+  if (_data->_pipeline && _data->_pipeline->contains(docq->value("docid").toInt()))
+    return printPrerendered(docq);
+
+  if (! _data->_pdfDirectory.isEmpty())
+  {
+    orReport report(reportname);
+    for (int i = 0; report.isValid() && i < _data->_copies->numCopies(); i++)
+    {
+      report.setParamList(getParamsOneCopy(i, docq));
+      printedOk = report.isValid() &&
+                  report.exportToPDF(_data->pdfFileName(docnumber, i));
+      if (! printedOk)
+        break;
+    }
+    if (printedOk)
+      emit finishedPrinting(docq->value("docid").toInt());
+    else
+      report.reportError(this);
+    return printedOk;
+  }
+
   if (! _data->_mpIsInitialized)
   {
     bool userCanceled = false;
@@ -429,6 +705,118 @@ bool printMulticopyDocument::sPrintOneDoc(XSqlQuery *docq)
   return printedOk;
 }
 
+/** @brief Spool or save one document that was rendered by the batch pipeline.
+
+    This is the pipelined counterpart of the orReport-based printing in
+    sPrintOneDoc(). The first document brings up the print dialog; later
+    documents reuse the printer settings. Like sPrintOneDoc() it opens the
+    print job with orReport::beginMultiPrint() and sPrint() closes it with
+    orReport::endMultiPrint(). When a PDF directory is set the documents are
+    written there instead and no dialog is shown.
+ */
+bool printMulticopyDocument::printPrerendered(XSqlQuery *docq)
+{
+  QString docnumber = docq->value("docnumber").toString();
+  QString error;
+  QList<ORODocument*> docs = _data->_pipeline->take(docq->value("docid").toInt(),
+                                                    error);
+  bool printedOk = ! docs.isEmpty() && error.isEmpty();
+
+  if (! printedOk)
+    ErrorReporter::error(QtCriticalMsg, this, tr("Cannot Print"),
+                         tr("<p>%1 #%2 could not be rendered: %3")
+                           .arg(_data->_doctypefull, docnumber, error),
+                         __FILE__, __LINE__);
+  else if (! _data->_pdfDirectory.isEmpty())
+  {
+    for (int i = 0; printedOk && i < docs.size(); i++)
+    {
+      QString filename = _data->pdfFileName(docnumber, i);
+      printedOk = ORPrintRender::exportToPDF(docs.at(i), filename);
+      if (! printedOk)
+        ErrorReporter::error(QtCriticalMsg, this, tr("Cannot Print"),
+                             tr("<p>Could not write %1").arg(filename),
+                             __FILE__, __LINE__);
+    }
+  }
+  else
+  {
+    ORPrintRender render;
+    if (! _data->_mpIsInitialized)
+    {
+      render.setupPrinter(docs.first(), _data->_printer);
+      bool userCanceled = false;
+      if (orReport::beginMultiPrint(_data->_printer, userCanceled))
+        _data->_mpIsInitialized = true;
+      else
+      {
+        if (! userCanceled)
+          ErrorReporter::error(QtCriticalMsg, this, tr("Error Occurred"),
+                               tr("%1: Could not initialize printing system "
+                                  "for multiple reports. ").arg(windowTitle()),
+                               __FILE__, __LINE__);
+        printedOk = false;
+      }
+    }
+    for (int i = 0; printedOk && i < docs.size(); i++)
+      printedOk = render.render(docs.at(i), _data->_printer);
+  }
+  qDeleteAll(docs);
+
+  if (printedOk)
+    emit finishedPrinting(docq->value("docid").toInt());
+
+  return printedOk;
+}
+
+/** @brief Start pre-rendering the documents in @a docinfoq if the batch
+           should be pipelined.
+
+    The rendering parameters for every copy of every document are collected
+    here on the GUI thread with getParamsOneCopy() so subclasses and scripts
+    still control them. @a docinfoq is left positioned before its first row.
+
+    Batches are not pipelined when anything is connected to aboutToStart().
+    Those handlers may change the document, such as printInvoices assigning
+    the invoice number, so it must not be rendered until they have run.
+ */
+void printMulticopyDocument::startPipeline(XSqlQuery &docinfoq)
+{
+  if (_data->_pipeline)
+  {
+    delete _data->_pipeline;
+    _data->_pipeline = 0;
+  }
+
+  bool toPdf = ! _data->_pdfDirectory.isEmpty();
+  if (! toPdf && (! _data->_pipelined || _data->_mpIsInitialized))
+    return;
+  if (receivers(SIGNAL(aboutToStart(XSqlQuery*))) > 0)
+    return;
+
+  QList<PrerenderJob*> jobs;
+  while (docinfoq.next())
+  {
+    PrerenderJob *job = new PrerenderJob();
+    job->_docid      = docinfoq.value("docid").toInt();
+    job->_docnumber  = docinfoq.value("docnumber").toString();
+    job->_reportname = docinfoq.value("reportname").toString();
+    for (int i = 0; i < _data->_copies->numCopies(); i++)
+      job->_copies.append(getParamsOneCopy(i, &docinfoq));
+    jobs.append(job);
+  }
+  docinfoq.seek(-1);
+
+  if (jobs.size() < 2 && ! toPdf)
+  {
+    qDeleteAll(jobs);
+    return;
+  }
+
+  int threads = qBound(1, QThread::idealThreadCount() - 1, 4);
+  _data->_pipeline = new PrerenderPipeline(jobs, threads, threads * 2);
+}
+
 void printMulticopyDocument::populate()
 {
   ParameterList getp = getParamsDocList();
@@ -510,6 +898,16 @@ QWidget *printMulticopyDocument::optionsWidget()
   return _data->_optionsFrame;
 }
 
+QString printMulticopyDocument::pdfDirectory()
+{
+  return _data->_pdfDirectory;
+}
+
+bool printMulticopyDocument::isPipelined()
+{
+  return _data->_pipelined;
+}
+
 QString printMulticopyDocument::reportKey()
 {
   return _data->_reportKey;
@@ -551,6 +949,25 @@ void printMulticopyDocument::setNumCopiesMetric(QString metric)
   _data->_copies->setNumCopiesMetric(metric);
 }
 
+/** @brief Write documents as PDF files to @a dir instead of printing them.
+
+    Pass an empty string to go back to printing. In PDF mode the batch runs
+    without print or confirmation dialogs, so it can be used unattended.
+ */
+void printMulticopyDocument::setPdfDirectory(QString dir)
+{
+  _data->_pdfDirectory = dir;
+}
+
+/** @brief Pre-render batches on worker threads while spooling.
+
+    The default comes from the PipelinedBatchPrinting metric.
+ */
+void printMulticopyDocument::setPipelined(bool pipelined)
+{
+  _data->_pipelined = pipelined;
+}
+
 void printMulticopyDocument::setPostPrivilege(QString priv)
 {
   _data->_postPrivilege = priv;
@@ -55,11 +55,15 @@ class printMulticopyDocument : public XDialog
     Q_INVOKABLE virtual int             id();
     Q_INVOKABLE virtual bool            isOkToPrint();
     Q_INVOKABLE virtual bool            isOnPrintedList(const int docid);
+    Q_INVOKABLE virtual bool            isPipelined();
     Q_INVOKABLE virtual bool            isSetup();
     Q_INVOKABLE virtual QWidget        *optionsWidget();
+    Q_INVOKABLE virtual QString         pdfDirectory();
     Q_INVOKABLE virtual void            populate();
                 virtual QString         reportKey();
     Q_INVOKABLE virtual void            setNumCopiesMetric(QString metric);
+    Q_INVOKABLE virtual void            setPdfDirectory(QString dir);
+    Q_INVOKABLE virtual void            setPipelined(bool pipelined);
     Q_INVOKABLE virtual void            setPostPrivilege(QString priv);
                 virtual void            setReportKey(QString key);
     Q_INVOKABLE virtual void            setSetup(bool setup);
@@ -91,6 +95,9 @@ class printMulticopyDocument : public XDialog
     virtual void languageChange();
 
   protected:
+    virtual bool printPrerendered(XSqlQuery *docq);
+    virtual void startPipeline(XSqlQuery &docinfoq);
+
     printMulticopyDocumentPrivate *_data;
 
     bool    _distributeInventory;
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "queryProfile.h"
+
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+
+#include "errorReporter.h"
+#include "guiclient.h"
+#include "preparedquery.h"
+#include "readreplica.h"
+#include "xtsettings.h"
+
+/** @brief Show how long the queries run by each window and each statement take.
+
+    The samples are collected by QueryTrace. Each row shows the number of
+    queries, their total, average and longest times, the rows they returned
+    and how many fell into each latency bucket. Export writes the recent
+    individual samples to a CSV file for analysis elsewhere. The status
+    line also shows how often PreparedQuery found a statement already
+    prepared.
+ */
+queryProfile::queryProfile(QWidget* parent, const char * name, Qt::WindowFlags flags)
+    : XWidget(parent, name, flags)
+{
+  setupUi(this);
+
+  QList<XTreeWidget*> lists;
+  lists << _sources << _statements;
+  foreach (XTreeWidget *list, lists)
+  {
+    list->addColumn(list == _sources ? tr("Window") : tr("Statement"),
+                                          -1, Qt::AlignLeft,  true, "name");
+    list->addColumn(tr("Count"),  _qtyColumn, Qt::AlignRight, true, "count");
+    list->addColumn(tr("Total ms"), _qtyColumn, Qt::AlignRight, true, "total");
+    list->addColumn(tr("Avg. ms"),  _qtyColumn, Qt::AlignRight, true, "average");
+    list->addColumn(tr("Max. ms"),  _qtyColumn, Qt::AlignRight, true, "max");
+    list->addColumn(tr("Rows"),     _qtyColumn, Qt::AlignRight, true, "rows");
+    QStringList buckets = QueryTrace::bucketLabels();
+    for (int i = 0; i < buckets.size(); i++)
+      list->addColumn(buckets.at(i), _qtyColumn, Qt::AlignRight, true,
+                      QString("bucket%1").arg(i));
+  }
+
+  _record->setChecked(QueryTrace::enabled());
+
+  connect(_clear,   SIGNAL(clicked()),     this, SLOT(sClear()));
+  connect(_export,  SIGNAL(clicked()),     this, SLOT(sExport()));
+  connect(_record,  SIGNAL(toggled(bool)), this, SLOT(sRecordToggled(bool)));
+  connect(_refresh, SIGNAL(clicked()),     this, SLOT(sFillList()));
+
+  sFillList();
+}
+
+queryProfile::~queryProfile()
+{
+  // no need to delete child widgets, Qt does it all for us
+}
+
+void queryProfile::languageChange()
+{
+  retranslateUi(this);
+}
+
+void queryProfile::sRecordToggled(bool y)
+{
+  QueryTrace::setEnabled(y);
+  xtsettingsSetValue("traceQueries", y);
+}
+
+void queryProfile::sClear()
+{
+  QueryTrace::clear();
+  sFillList();
+}
+
+void queryProfile::sExport()
+{
+  QString filename = QFileDialog::getSaveFileName(this, tr("Export Query Timings"),
+                                                  xtsettingsValue("queryProfile/exportDir").toString(),
+                                                  tr("CSV files (*.csv)"));
+  if (filename.isEmpty())
+    return;
+  if (QFileInfo(filename).suffix().isEmpty())
+    filename += ".csv";
+  xtsettingsSetValue("queryProfile/exportDir", QFileInfo(filename).absolutePath());
+
+  QFile   file(filename);
+  QString errmsg;
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    errmsg = file.errorString();
+  else if (! QueryTrace::exportTo(&file, &errmsg))
+    file.remove();
+
+  if (! errmsg.isEmpty())
+    ErrorReporter::error(QtCriticalMsg, this, tr("Error Exporting Query Timings"),
+                         tr("Could not write %1: %2").arg(filename, errmsg),
+                         __FILE__, __LINE__);
+}
+
+void queryProfile::sFillList()
+{
+  fill(_sources,    QueryTrace::bySource());
+  fill(_statements, QueryTrace::byStatement());
+  PreparedQuery::Stats cache = PreparedQuery::stats();
+  qint64 lookups = cache.hits + cache.misses;
+  _samples->setText(tr("%1 recent queries, %2 cached statements, %3% statement cache hits")
+                    .arg(QueryTrace::sampleCount())
+                    .arg(cache.statements)
+                    .arg(lookups ? 100.0 * cache.hits / lookups : 0.0, 0, 'f', 1)
+                    + (ReadReplica::isOpen() ? tr(", replica %1").arg(ReadReplica::status())
+                                             : QString()));
+}
+
+void queryProfile::fill(XTreeWidget *list, const QList<QueryTrace::Stats> &stats)
+{
+  list->clear();
+
+  XTreeWidgetItem *last = 0;
+  for (int i = 0; i < stats.size(); i++)
+  {
+    const QueryTrace::Stats &stat = stats.at(i);
+    last = new XTreeWidgetItem(list, last, i, QVariant(stat.name));
+    last->setToolTip(0, stat.name);
+    last->setNumber(1, stat.count,      "0");
+    last->setNumber(2, stat.totalMsecs, "0");
+    last->setNumber(3, stat.count ? (double)stat.totalMsecs / stat.count : 0.0, "1");
+    last->setNumber(4, stat.maxMsecs,   "0");
+    last->setNumber(5, stat.rows,       "0");
+    for (int b = 0; b < QUERYTRACEBUCKETS; b++)
+      last->setNumber(6 + b, stat.histogram[b], "0");
+  }
+
+  list->sortItems(2, Qt::DescendingOrder);
+}
@@ -0,0 +1,41 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef QUERYPROFILE_H
+#define QUERYPROFILE_H
+
+#include "xwidget.h"
+
+#include "querytrace.h"
+
+#include "ui_queryProfile.h"
+
+class queryProfile : public XWidget, public Ui::queryProfile
+{
+    Q_OBJECT
+
+public:
+    queryProfile(QWidget* parent = 0, const char * = 0, Qt::WindowFlags flags = 0);
+    ~queryProfile();
+
+public slots:
+    virtual void sClear();
+    virtual void sExport();
+    virtual void sFillList();
+
+protected slots:
+    virtual void languageChange();
+    virtual void sRecordToggled(bool);
+
+private:
+    void fill(XTreeWidget *list, const QList<QueryTrace::Stats> &stats);
+};
+
+#endif // QUERYPROFILE_H
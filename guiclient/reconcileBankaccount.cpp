@@ -11,11 +11,20 @@
 #include "reconcileBankaccount.h"
 
 #include <QApplication>
+#include <QCloseEvent>
 #include <QCursor>
+#include <QFile>
+#include <QFileDialog>
+#include <QMenu>
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QSqlError>
+#include <QRegExp>
+#include <QTextStream>
 #include <QVariant>
+#include <QVector>
+
+#include <math.h>
 
 #include <metasql.h>
 #include <parameter.h>
@@ -42,6 +51,9 @@ reconcileBankaccount::reconcileBankaccount(QWidget* parent, const char* name, Qt
     connect(_reconcile,	SIGNAL(clicked()),      this, SLOT(sReconcile()));
     connect(_save,	    SIGNAL(clicked()),      this, SLOT(sSave()));
     connect(_import,	    SIGNAL(clicked()),      this, SLOT(sImport()));
+    connect(_matchStatement, SIGNAL(clicked()),  this, SLOT(sMatchStatement()));
+    connect(_checks,    SIGNAL(populateMenu(QMenu*, QTreeWidgetItem*)), this, SLOT(sPopulateMenu(QMenu*, QTreeWidgetItem*)));
+    connect(_receipts,  SIGNAL(populateMenu(QMenu*, QTreeWidgetItem*)), this, SLOT(sPopulateMenu(QMenu*, QTreeWidgetItem*)));
     connect(_update,	SIGNAL(clicked()),      this, SLOT(populate()));
     connect(_startDate, SIGNAL(newDate(QDate)), this, SLOT(sDateChanged()));
     connect(_endDate,   SIGNAL(newDate(QDate)), this, SLOT(sDateChanged()));
@@ -66,6 +78,9 @@ reconcileBankaccount::reconcileBankaccount(QWidget* parent, const char* name, Qt
     _checks->addColumn(tr("Base Amount"), _bigMoneyColumn, Qt::AlignRight  , true, "base_amount");
     _checks->addColumn(tr("Amount"),      _bigMoneyColumn, Qt::AlignRight  , true, "amount");
 
+    _receipts->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    _checks->setSelectionMode(QAbstractItemView::ExtendedSelection);
+
     _clearedReceipts->setPrecision(omfgThis->moneyVal());
     _clearedChecks->setPrecision(omfgThis->moneyVal());
     _endBal2->setPrecision(omfgThis->moneyVal());
@@ -75,6 +90,14 @@ reconcileBankaccount::reconcileBankaccount(QWidget* parent, const char* name, Qt
     _bankrecid = -1;	// do this before _bankaccnt->populate()
     _bankaccntid = -1;	// do this before _bankaccnt->populate()
     _datesAreOK = false;
+    _checksCleared = 0.0;
+    _clearedBalance = 0.0;
+    _clearedDelta = 0.0;
+    _diffBalance = 0.0;
+    _endBalance = 0.0;
+    _menuList = 0;
+    _receiptsCleared = 0.0;
+
     
     _bankaccnt->populate("SELECT bankaccnt_id,"
 			 "       (bankaccnt_name || '-' || bankaccnt_descrip) "
@@ -107,6 +130,17 @@ void reconcileBankaccount::languageChange()
     retranslateUi(this);
 }
 
+void reconcileBankaccount::closeEvent(QCloseEvent *event)
+{
+  // leaving with unsent toggles would silently lose the user's work
+  if (! sFlushCleared())
+  {
+    event->ignore();
+    return;
+  }
+  XWidget::closeEvent(event);
+}
+
 void reconcileBankaccount::sCancel()
 {
   XSqlQuery reconcileCancel;
@@ -129,6 +163,8 @@ void reconcileBankaccount::sCancel()
 	return;
       }
 
+      _pending.clear();         // they're about to be deleted anyway
+
       reconcileCancel.prepare( "SELECT deleteBankReconciliation(:bankrecid) AS result;" );
       reconcileCancel.bindValue(":bankrecid", _bankrecid);
       reconcileCancel.exec();
@@ -155,6 +191,9 @@ void reconcileBankaccount::sCancel()
 
 bool reconcileBankaccount::sSave(bool closeWhenDone)
 {
+  if (! sFlushCleared())
+    return false;
+
   XSqlQuery reconcileSave;
   reconcileSave.prepare("SELECT count(*) AS num"
             "  FROM bankrec"
@@ -249,6 +288,9 @@ void reconcileBankaccount::sReconcile()
     return;
   }
 
+  if (! sFlushCleared())
+    return;
+
   double begBal = _openBal->localValue();
   double endBal = _endBal->localValue();
 
@@ -312,10 +354,11 @@ void reconcileBankaccount::sReconcile()
 */
 void reconcileBankaccount::populate()
 {
-  qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
+  // the lists are about to be rebuilt from the database so it has to be current
+  if (! sFlushCleared())
+    return;
 
-  double begBal = _openBal->localValue();
-  double endBal = _endBal->localValue();
+  qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
 
   int currid = -1;
 
@@ -437,12 +480,28 @@ void reconcileBankaccount::populate()
   if(_checks->currentItem())
     _checks->scrollToItem(_checks->currentItem());
 
+  populateBalances();
+
+  qApp->restoreOverrideCursor();
+}
+
+/* The cleared totals and balances come from aggregate queries that are
+   much cheaper than rebuilding the lists, so they are refreshed on their
+   own after each batch of cleared toggles.
+*/
+void reconcileBankaccount::populateBalances()
+{
+  MetaSQLQuery mrcp = mqlLoad("bankrec", "receipts");
+  MetaSQLQuery mchk = mqlLoad("bankrec", "checks");
+  ParameterList params;
+  params.append("bankaccntid", _bankaccnt->id());
+  params.append("bankrecid", _bankrecid);
   params.append("summary", true);
 
   // fill receipts cleared value
-  rcp = mrcp.toQuery(params);
+  XSqlQuery rcp = mrcp.toQuery(params);
   if (rcp.first())
-    _clearedReceipts->setDouble(rcp.value("cleared_amount").toDouble());
+    _receiptsCleared = rcp.value("cleared_amount").toDouble();
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
                                 rcp, __FILE__, __LINE__))
   {
@@ -450,9 +509,9 @@ void reconcileBankaccount::populate()
   }
 
   // fill checks cleared value
-  chk = mchk.toQuery(params);
+  XSqlQuery chk = mchk.toQuery(params);
   if (chk.first())
-    _clearedChecks->setDouble(chk.value("cleared_amount").toDouble());
+    _checksCleared = chk.value("cleared_amount").toDouble();
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
                                 chk, __FILE__, __LINE__))
   {
@@ -461,8 +520,8 @@ void reconcileBankaccount::populate()
 
   // calculate cleared balance
   MetaSQLQuery mbal = mqlLoad("bankrec", "clearedbalance");
-  params.append("endBal", endBal);
-  params.append("begBal", begBal);
+  params.append("endBal", _endBal->localValue());
+  params.append("begBal", _openBal->localValue());
   params.append("curr_id",   _currency->id());
   params.append("effective", _startDate->date());
   params.append("expires",   _endDate->date());
@@ -470,24 +529,40 @@ void reconcileBankaccount::populate()
 
   if(bal.first())
   {
-    _clearBal->setDouble(bal.value("cleared_amount").toDouble());
-    _endBal2->setDouble(bal.value("end_amount").toDouble());
-    _diffBal->setDouble(bal.value("diff_amount").toDouble());
-
-    QString stylesheet;
-
-    if(bal.value("diff_value").toDouble() != 0.0)
-      stylesheet = QString("* { color: %1; }").arg(namedColor("error").name());
-
-    _diffBal->setStyleSheet(stylesheet);
+    _clearedBalance = bal.value("cleared_amount").toDouble();
+    _diffBalance    = bal.value("diff_amount").toDouble();
+    _endBalance     = bal.value("end_amount").toDouble();
+    _clearedDelta   = 0.0;
+    showBalances();
   }
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
                                 bal, __FILE__, __LINE__))
   {
     return;
   }
+}
 
-  qApp->restoreOverrideCursor();
+/* Show the totals, including toggles that haven't been sent yet. Those are
+   folded into the cleared balance as _clearedDelta until the next
+   populateBalances() replaces the estimate with the database's figures.
+*/
+void reconcileBankaccount::showBalances()
+{
+  double cleared = _clearedBalance + _clearedDelta;
+  double diff    = _diffBalance - _clearedDelta;
+
+  _clearedReceipts->setDouble(_receiptsCleared);
+  _clearedChecks->setDouble(_checksCleared);
+  _clearBal->setDouble(cleared);
+  _endBal2->setDouble(_endBalance);
+  _diffBal->setDouble(diff);
+
+  QString stylesheet;
+
+  if (qRound64(diff * pow(10.0, omfgThis->moneyVal()->decimals())) != 0)
+    stylesheet = QString("* { color: %1; }").arg(namedColor("error").name());
+
+  _diffBal->setStyleSheet(stylesheet);
 }
 
 void reconcileBankaccount::sImport()
@@ -521,203 +596,391 @@ void reconcileBankaccount::sAddAdjustment()
   omfgThis->handleNewWindow(newdlg, Qt::ApplicationModal);
 }
 
+// journal entries show as a parent row with the cleared lines under it
+static void clearableItems(XTreeWidgetItem *item, QList<XTreeWidgetItem*> &items)
+{
+  if (item->childCount() == 0)
+  {
+    if (! items.contains(item))
+      items.append(item);
+    return;
+  }
+  for (int i = 0; i < item->childCount(); i++)
+    clearableItems(item->child(i), items);
+}
+
+static QString clearedSource(XTreeWidgetItem *item)
+{
+  switch (item->altId())
+  {
+    case 1: return "GL";
+    case 2: return "SL";
+    case 3: return "AD";
+  }
+  return QString();
+}
+
 void reconcileBankaccount::sReceiptsToggleCleared()
 {
-  XSqlQuery reconcileReceiptsToggleCleared;
   XTreeWidgetItem *item = (XTreeWidgetItem*)_receipts->currentItem();
-  XTreeWidgetItem *child = 0;
-  bool setto = true;
 
   if(0 == item)
     return;
 
   _receipts->scrollToItem(item);
 
-  if(item->altId() == 9)
-  {
-    setto = item->text(0) == tr("No");
-    for (int i = 0; i < item->childCount(); i++)
-    {
-      child = item->child(i);
-      if(child->text(0) != (setto ? tr("Yes") : tr("No")))
-      {
-        double rate = QLocale().toDouble(child->text(6));
-        double amount = QLocale().toDouble(child->text(7));
+  QList<XTreeWidgetItem*> items;
+  clearableItems(item, items);
+  setCleared(_receipts, items, item->text(0) != tr("Yes"), _allowEdit->isChecked());
+}
 
-        if (_allowEdit->isChecked() && child->text(0) != tr("Yes"))
-        {
-          ParameterList params;
-          params.append("transtype", "receipt");
-          params.append("bankaccntid", _bankaccnt->id());
-          params.append("bankrecid", _bankrecid);
-          params.append("sourceid", child->id());
-          if(child->altId()==1)
-            params.append("source", "GL");
-          else if(child->altId()==2)
-            params.append("source", "SL");
-          else if(child->altId()==3)
-            params.append("source", "AD");
-          toggleBankrecCleared newdlg(this, "", true);
-          newdlg.set(params);
-          newdlg.exec();
-        }
-        else
-        {
-          reconcileReceiptsToggleCleared.prepare("SELECT toggleBankrecCleared(:bankrecid, :source, :sourceid, :currrate, :baseamount) AS cleared");
-          reconcileReceiptsToggleCleared.bindValue(":bankrecid", _bankrecid);
-          reconcileReceiptsToggleCleared.bindValue(":sourceid", child->id());
-          if(child->altId()==1)
-            reconcileReceiptsToggleCleared.bindValue(":source", "GL");
-          else if(child->altId()==2)
-            reconcileReceiptsToggleCleared.bindValue(":source", "SL");
-          else if(child->altId()==3)
-            reconcileReceiptsToggleCleared.bindValue(":source", "AD");
-          reconcileReceiptsToggleCleared.bindValue(":currrate", rate);
-          reconcileReceiptsToggleCleared.bindValue(":baseamount", amount);
-          reconcileReceiptsToggleCleared.exec();
-          if(reconcileReceiptsToggleCleared.first())
-            child->setText(0, (reconcileReceiptsToggleCleared.value("cleared").toBool() ? tr("Yes") : tr("No") ));
-          else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
-                                        reconcileReceiptsToggleCleared, __FILE__, __LINE__))
-          {
-            return;
-          }
-        }
-      }
-    }
-    item->setText(0, (setto ? tr("Yes") : tr("No")));
-    populate();
-  }
-  else
+void reconcileBankaccount::sChecksToggleCleared()
+{
+  XTreeWidgetItem *item = (XTreeWidgetItem*)_checks->currentItem();
+
+  if(0 == item)
+    return;
+
+  _checks->scrollToItem(item);
+
+  QList<XTreeWidgetItem*> items;
+  clearableItems(item, items);
+  setCleared(_checks, items, item->text(0) != tr("Yes"), _allowEdit->isChecked());
+}
+
+void reconcileBankaccount::sPopulateMenu(QMenu *pMenu, QTreeWidgetItem *)
+{
+  _menuList = qobject_cast<XTreeWidget*>(sender());
+  if (! _menuList)
+    return;
+
+  pMenu->addAction(tr("Clear Selected"),   this, SLOT(sClearSelected()));
+  pMenu->addAction(tr("Unclear Selected"), this, SLOT(sUnclearSelected()));
+}
+
+void reconcileBankaccount::sClearSelected()
+{
+  if (! _menuList)
+    return;
+
+  QList<XTreeWidgetItem*> items;
+  foreach (XTreeWidgetItem *item, _menuList->selectedItems())
+    clearableItems(item, items);
+  setCleared(_menuList, items, true, _allowEdit->isChecked());
+}
+
+void reconcileBankaccount::sUnclearSelected()
+{
+  if (! _menuList)
+    return;
+
+  QList<XTreeWidgetItem*> items;
+  foreach (XTreeWidgetItem *item, _menuList->selectedItems())
+    clearableItems(item, items);
+  setCleared(_menuList, items, false, false);
+}
+
+/* Mark items cleared or not. The list and the totals change right away
+   but the database only sees the change when the queued toggles are
+   sent by sFlushCleared(), which happens when the user saves, reconciles,
+   refreshes, switches bank accounts or closes the window. Clicking through
+   a statement costs one query instead of a round trip and a full
+   repopulate per click.
+
+   When the user wants to edit the exchange rate or effective date the
+   toggleBankrecCleared dialog still handles each item that is being
+   cleared, since it writes to the database itself.
+*/
+void reconcileBankaccount::setCleared(XTreeWidget *list, const QList<XTreeWidgetItem*> &items, bool cleared, bool allowEdit)
+{
+  bool edited = false;
+  QList<XTreeWidgetItem*> parents;
+
+  foreach (XTreeWidgetItem *item, items)
   {
-    double rate = QLocale().toDouble(item->text(6));
-    double amount = QLocale().toDouble(item->text(7));
-    
-    if (_allowEdit->isChecked() && item->text(0) != tr("Yes"))
+    if ((item->text(0) == tr("Yes")) == cleared)
+      continue;
+
+    if (allowEdit && cleared)
     {
+      if (! sFlushCleared())
+        return;
+
       ParameterList params;
-      params.append("transtype", "receipt");
+      params.append("transtype", (list == _receipts) ? "receipt" : "check");
       params.append("bankaccntid", _bankaccnt->id());
       params.append("bankrecid", _bankrecid);
       params.append("sourceid", item->id());
-      if(item->altId()==1)
-        params.append("source", "GL");
-      else if(item->altId()==2)
-        params.append("source", "SL");
-      else if(item->altId()==3)
-        params.append("source", "AD");
+      params.append("source", clearedSource(item));
       toggleBankrecCleared newdlg(this, "", true);
       newdlg.set(params);
       newdlg.exec();
-      populate();
+      edited = true;
+      continue;
     }
-    else
-    {
-      reconcileReceiptsToggleCleared.prepare("SELECT toggleBankrecCleared(:bankrecid, :source, :sourceid, :currrate, :baseamount) AS cleared");
-      reconcileReceiptsToggleCleared.bindValue(":bankrecid", _bankrecid);
-      reconcileReceiptsToggleCleared.bindValue(":sourceid", item->id());
-      if(item->altId()==1)
-        reconcileReceiptsToggleCleared.bindValue(":source", "GL");
-      else if(item->altId()==2)
-        reconcileReceiptsToggleCleared.bindValue(":source", "SL");
-      else if(item->altId()==3)
-        reconcileReceiptsToggleCleared.bindValue(":source", "AD");
-      reconcileReceiptsToggleCleared.bindValue(":currrate", rate);
-      reconcileReceiptsToggleCleared.bindValue(":baseamount", amount);
-      reconcileReceiptsToggleCleared.exec();
-      if(reconcileReceiptsToggleCleared.first())
-      {
-        item->setText(0, (reconcileReceiptsToggleCleared.value("cleared").toBool() ? tr("Yes") : tr("No") ));
 
-        item = (XTreeWidgetItem*)item->QTreeWidgetItem::parent();
-        if(item != 0 && item->altId() == 9)
-        {
-          setto = true;
-          for (int i = 0; i < item->childCount(); i++)
-          {
-            setto = (setto && (item->child(i)->text(0) == tr("Yes")));
-          }
-          item->setText(0, (setto ? tr("Yes") : tr("No")));
-          populate();
-        }
-      }
-      else
-      {
-        populate();
-        if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
-                                      reconcileReceiptsToggleCleared, __FILE__, __LINE__))
-        {
-          return;
-        }
-      }
-    }
+    queueToggle(list, item);
+
+    XTreeWidgetItem *parent = (XTreeWidgetItem*)item->QTreeWidgetItem::parent();
+    if (parent && ! parents.contains(parent))
+      parents.append(parent);
+  }
+
+  if (edited)
+  {
+    populate();   // the dialog may have changed rates and amounts
+    return;
   }
+
+  foreach (XTreeWidgetItem *parent, parents)
+  {
+    bool setto = true;
+    for (int i = 0; setto && i < parent->childCount(); i++)
+      setto = (parent->child(i)->text(0) == tr("Yes"));
+    parent->setText(0, (setto ? tr("Yes") : tr("No")));
+  }
+
+  showBalances();
 }
 
-void reconcileBankaccount::sChecksToggleCleared()
+void reconcileBankaccount::queueToggle(XTreeWidget *list, XTreeWidgetItem *item)
 {
-  XSqlQuery reconcileChecksToggleCleared;
-  XTreeWidgetItem *item = (XTreeWidgetItem*)_checks->currentItem();
+  ClearedToggle toggle;
+  toggle.bankrecid  = _bankrecid;
+  toggle.item       = item;
+  toggle.source     = clearedSource(item);
+  toggle.sourceid   = item->id();
+  toggle.rate       = item->rawValue("doc_exchrate").toDouble();
+  toggle.baseamount = item->rawValue("base_amount").toDouble();
+  toggle.cleared    = (item->text(0) != tr("Yes"));
+
+  // toggleBankrecCleared() flips the state, so clicking an item twice
+  // before the batch is sent means there's nothing to send for it
+  QString key = QString("%1-%2").arg(toggle.source).arg(toggle.sourceid);
+  if (_pending.contains(key))
+    _pending.remove(key);
+  else
+    _pending.insert(key, toggle);
 
-  if(0 == item)
-    return;
+  item->setText(0, (toggle.cleared ? tr("Yes") : tr("No")));
 
-  _checks->scrollToItem(item);
+  double amount = item->rawValue("amount").toDouble();
+  if (! toggle.cleared)
+    amount = -amount;
+  if (list == _receipts)
+  {
+    _receiptsCleared += amount;
+    _clearedDelta    += amount;
+  }
+  else
+  {
+    _checksCleared   += amount;
+    _clearedDelta    -= amount;
+  }
+}
 
-  double rate = item->rawValue("doc_exchrate").toDouble();
-  double amount = item->rawValue("base_amount").toDouble();
-  
-  if (_allowEdit->isChecked() && item->text(0) != tr("Yes"))
-  {
-    ParameterList params;
-    params.append("transtype", "check");
-    params.append("bankaccntid", _bankaccnt->id());
-    params.append("bankrecid", _bankrecid);
-    params.append("sourceid", item->id());
-    if(item->altId()==1)
-      params.append("source", "GL");
-    else if(item->altId()==2)
-      params.append("source", "SL");
-    else if(item->altId()==3)
-      params.append("source", "AD");
-    toggleBankrecCleared newdlg(this, "", true);
-    newdlg.set(params);
-    newdlg.exec();
+/* Send the queued toggles as a single statement and refresh the balances.
+   The toggles are passed as parallel arrays so the server applies them all
+   or none without an explicit transaction on the shared connection. If the
+   statement fails the lists are rebuilt so they show what the database
+   really has.
+*/
+bool reconcileBankaccount::sFlushCleared()
+{
+  if (_pending.isEmpty())
+    return true;
+
+  QList<ClearedToggle> toggles = _pending.values();
+  _pending.clear();
+
+  QStringList bankrecids;
+  QStringList sources;
+  QStringList sourceids;
+  QStringList rates;
+  QStringList baseamounts;
+  QHash<QString, ClearedToggle> byKey;
+  foreach (const ClearedToggle &toggle, toggles)
+  {
+    bankrecids  << QString::number(toggle.bankrecid);
+    sources     << "\"" + QString(toggle.source).replace("\\", "\\\\").replace("\"", "\\\"") + "\"";
+    sourceids   << QString::number(toggle.sourceid);
+    rates       << QString::number(toggle.rate, 'g', 17);
+    baseamounts << QString::number(toggle.baseamount, 'g', 17);
+    byKey.insert(QString("%1-%2").arg(toggle.source).arg(toggle.sourceid), toggle);
+  }
+
+  XSqlQuery toggleq;
+  toggleq.prepare("SELECT source, sourceid,"
+                  "       toggleBankrecCleared(bankrecid, source, sourceid,"
+                  "                            currrate, baseamount) AS cleared"
+                  "  FROM (SELECT UNNEST(CAST(:bankrecids AS INTEGER[])) AS bankrecid,"
+                  "               UNNEST(CAST(:sources AS TEXT[])) AS source,"
+                  "               UNNEST(CAST(:sourceids AS INTEGER[])) AS sourceid,"
+                  "               UNNEST(CAST(:currrates AS NUMERIC[])) AS currrate,"
+                  "               UNNEST(CAST(:baseamounts AS NUMERIC[])) AS baseamount"
+                  "       ) AS toggles;");
+  toggleq.bindValue(":bankrecids",  "{" + bankrecids.join(",")  + "}");
+  toggleq.bindValue(":sources",     "{" + sources.join(",")     + "}");
+  toggleq.bindValue(":sourceids",   "{" + sourceids.join(",")   + "}");
+  toggleq.bindValue(":currrates",   "{" + rates.join(",")       + "}");
+  toggleq.bindValue(":baseamounts", "{" + baseamounts.join(",") + "}");
+  toggleq.exec();
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Saving Cleared Items"),
+                           toggleq, __FILE__, __LINE__))
+  {
     populate();
+    return false;
   }
-  else
+
+  while (toggleq.next())
+  {
+    QString key = QString("%1-%2").arg(toggleq.value("source").toString())
+                                  .arg(toggleq.value("sourceid").toInt());
+    if (! byKey.contains(key))
+      continue;
+
+    // someone else may have changed it since the list was filled
+    const ClearedToggle &toggle = byKey[key];
+    if (toggleq.value("cleared").toBool() != toggle.cleared)
+      toggle.item->setText(0, (toggleq.value("cleared").toBool() ? tr("Yes") : tr("No")));
+  }
+
+  populateBalances();
+  return true;
+}
+
+/* Clear the receipts and checks that match lines of a bank statement.
+   The statement is a CSV file with the date, reference and amount of each
+   line, deposits positive and withdrawals negative. Every line is hashed
+   by amount and reference and by amount and date, then both lists are
+   walked once, taking a line with the same reference before one with the
+   same date. Each statement line clears at most one item.
+*/
+void reconcileBankaccount::sMatchStatement()
+{
+  QString filename = QFileDialog::getOpenFileName(this, tr("Select Bank Statement"),
+                                                  QString(),
+                                                  tr("CSV files (*.csv);;All files (*)"));
+  if (filename.isEmpty())
+    return;
+
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
   {
-    reconcileChecksToggleCleared.prepare("SELECT toggleBankrecCleared(:bankrecid, :source, :sourceid, :currrate, :baseamount) AS cleared");
-    reconcileChecksToggleCleared.bindValue(":bankrecid", _bankrecid);
-    reconcileChecksToggleCleared.bindValue(":sourceid", item->id());
-    if(item->altId()==1)
-      reconcileChecksToggleCleared.bindValue(":source", "GL");
-    else if(item->altId()==2)
-      reconcileChecksToggleCleared.bindValue(":source", "SL");
-    else if(item->altId()==3)
-      reconcileChecksToggleCleared.bindValue(":source", "AD");
-    reconcileChecksToggleCleared.bindValue(":currrate", rate);
-    reconcileChecksToggleCleared.bindValue(":baseamount", amount);
-    reconcileChecksToggleCleared.exec();
-    if(reconcileChecksToggleCleared.first())
+    ErrorReporter::error(QtCriticalMsg, this, tr("Error Reading Bank Statement"),
+                         file.errorString(), __FILE__, __LINE__);
+    return;
+  }
+
+  QMultiHash<QString, int> byReference;
+  QMultiHash<QString, int> byDate;
+  QVector<bool>            used;
+  QRegExp                  fieldSep(",(?=(?:[^\"]*\"[^\"]*\")*[^\"]*$)");
+  QTextStream              in(&file);
+
+  while (! in.atEnd())
+  {
+    QStringList fields = in.readLine().split(fieldSep);
+    if (fields.size() < 3)
+      continue;
+    for (int i = 0; i < fields.size(); i++)
     {
-      item->setText(0, (reconcileChecksToggleCleared.value("cleared").toBool() ? tr("Yes") : tr("No") ));
-      populate();
+      fields[i] = fields.at(i).trimmed();
+      if (fields.at(i).startsWith('"') && fields.at(i).endsWith('"'))
+        fields[i] = fields.at(i).mid(1, fields.at(i).length() - 2).replace("\"\"", "\"");
     }
-    else
+
+    QDate date = QDate::fromString(fields.at(0), Qt::ISODate);
+    if (! date.isValid())
+      date = QLocale().toDate(fields.at(0), QLocale::ShortFormat);
+    bool   ok = false;
+    double amount = QLocale().toDouble(fields.at(2), &ok);
+    if (! ok)
+      amount = fields.at(2).toDouble(&ok);
+    if (! ok || amount == 0.0)
+      continue;   // probably a heading
+
+    QString side = (amount > 0) ? "R" : "C";
+    qint64  cents = qRound64(fabs(amount) * 100);
+    int     line  = used.size();
+    used.append(false);
+    if (! fields.at(1).isEmpty())
+      byReference.insert(QString("%1|%2|%3").arg(side).arg(cents).arg(fields.at(1).toUpper()), line);
+    if (date.isValid())
+      byDate.insert(QString("%1|%2|%3").arg(side).arg(cents).arg(date.toString(Qt::ISODate)), line);
+  }
+
+  if (used.isEmpty())
+  {
+    QMessageBox::warning(this, tr("No Statement Lines"),
+                         tr("<p>%1 does not contain any lines with a date, "
+                            "reference and amount.").arg(filename));
+    return;
+  }
+
+  int matched = 0;
+  QList<XTreeWidget*> lists;
+  lists << _receipts << _checks;
+  foreach (XTreeWidget *list, lists)
+  {
+    QString side = (list == _receipts) ? "R" : "C";
+    QList<XTreeWidgetItem*> items;
+    for (int i = 0; i < list->topLevelItemCount(); i++)
+      clearableItems(list->topLevelItem(i), items);
+
+    QList<XTreeWidgetItem*> toClear;
+    foreach (XTreeWidgetItem *item, items)
     {
-      populate();
-      if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Bank Reconciliation Information"),
-                                    reconcileChecksToggleCleared, __FILE__, __LINE__))
+      if (item->text(0) == tr("Yes"))
+        continue;
+
+      qint64  cents = qRound64(fabs(item->rawValue("amount").toDouble()) * 100);
+      QString refKey  = QString("%1|%2|%3").arg(side).arg(cents).arg(item->text(3).trimmed().toUpper());
+      QString dateKey = QString("%1|%2|%3").arg(side).arg(cents).arg(item->rawValue("transdate").toDate().toString(Qt::ISODate));
+
+      int line = -1;
+      foreach (int candidate, byReference.values(refKey))
+        if (! used.at(candidate)) { line = candidate; break; }
+      if (line < 0)
+        foreach (int candidate, byDate.values(dateKey))
+          if (! used.at(candidate)) { line = candidate; break; }
+
+      if (line >= 0)
       {
-        return;
+        used[line] = true;
+        toClear.append(item);
       }
     }
+
+    matched += toClear.size();
+    if (! toClear.isEmpty())
+    {
+      // matched lines are taken at the listed rate, not edited one by one
+      setCleared(list, toClear, true, false);
+    }
   }
+
+  if (! sFlushCleared())
+    return;
+
+  QMessageBox::information(this, tr("Statement Matched"),
+                           tr("<p>%1 of %2 statement lines matched and were "
+                              "marked cleared.").arg(matched).arg(used.size()));
 }
 
 void reconcileBankaccount::sBankaccntChanged()
 {
+  // queued toggles belong to the reconciliation being left, so stay on
+  // it if they can't be saved
+  if (! sFlushCleared())
+  {
+    bool blocked = _bankaccnt->blockSignals(true);
+    _bankaccnt->setId(_bankaccntid);
+    (void)_bankaccnt->blockSignals(blocked);
+    populate();
+    return;
+  }
+
   XSqlQuery reconcileBankaccntChanged;
   if(_bankrecid != -1)
   {
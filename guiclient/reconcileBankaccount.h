@@ -13,6 +13,8 @@
 
 #include "guiclient.h"
 
+#include <QHash>
+
 #include "xwidget.h"
 
 #include "ui_reconcileBankaccount.h"
@@ -33,20 +35,54 @@ public slots:
     virtual void sBankaccntChanged();
     virtual void sCancel();
     virtual void sChecksToggleCleared();
+    virtual void sClearSelected();
+    virtual bool sFlushCleared();
     virtual void sImport();
+    virtual void sMatchStatement();
+    virtual void sPopulateMenu(QMenu *, QTreeWidgetItem *);
     virtual void sReceiptsToggleCleared();
     virtual void sReconcile();
     virtual bool sSave(bool = true);
     virtual void sDateChanged();
+    virtual void sUnclearSelected();
+
+protected:
+    virtual void closeEvent(QCloseEvent *);
 
 protected slots:
     virtual void languageChange();
 
 private:
+    struct ClearedToggle
+    {
+      int              bankrecid;
+      XTreeWidgetItem *item;
+      QString          source;
+      int              sourceid;
+      double           rate;
+      double           baseamount;
+      bool             cleared;
+    };
+
+    void populateBalances();
+    void queueToggle(XTreeWidget *list, XTreeWidgetItem *item);
+    void setCleared(XTreeWidget *list, const QList<XTreeWidgetItem*> &items,
+                    bool cleared, bool allowEdit);
+    void showBalances();
+
     int _bankrecid;
 	int _bankaccntid;
     bool _datesAreOK;
 
+    double  _checksCleared;
+    double  _clearedBalance;
+    double  _clearedDelta;
+    double  _diffBalance;
+    double  _endBalance;
+    XTreeWidget *_menuList;
+    QHash<QString, ClearedToggle> _pending;
+    double  _receiptsCleared;
+
 };
 
 #endif // RECONCILEBANKACCOUNT_H
@@ -13,7 +13,7 @@
 #include <QVariant>
 #include <QMessageBox>
 #include "inputManager.h"
-#include "distributeInventory.h"
+#include "invTransactionBatch.h"
 #include "errorReporter.h"
 
 returnWoMaterialBatch::returnWoMaterialBatch(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
@@ -99,58 +99,51 @@ void returnWoMaterialBatch::sReturn()
          returnReturn.value("wo_status").toString() == "R" ||
          returnReturn.value("wo_status").toString() == "I")
       {
-        XSqlQuery rollback;
-        rollback.prepare("ROLLBACK;");
-  
         XSqlQuery items;
-        items.prepare("SELECT womatl_id,"
+        items.prepare("SELECT womatl_id, item_number,"
                       "       CASE WHEN wo_qtyord >= 0 THEN"
                       "         womatl_qtyiss"
                       "       ELSE"
                       "         ((womatl_qtyreq - womatl_qtyiss) * -1)"
                       "       END AS qty"
-                      "  FROM wo, womatl, itemsite"
+                      "  FROM wo, womatl, itemsite, item"
                       " WHERE((wo_id=womatl_wo_id)"
                       "   AND (womatl_itemsite_id=itemsite_id)"
+                      "   AND (itemsite_item_id=item_id)"
                       "   AND ( (wo_qtyord < 0) OR (womatl_issuemethod IN ('S','M')) )"
                       "   AND (womatl_wo_id=:wo_id))");
         items.bindValue(":wo_id", _wo->id());
         items.exec();
+
+        InvTransactionBatch batch("returnWoMaterial", ":womatl_id, :qty, 0, :date", this);
+        batch.setStopOnError(true);
         while(items.next())
         {
           if(items.value("qty").toDouble() == 0.0)
             continue;
 
-          returnReturn.exec("BEGIN;");	// because of possible lot, serial, or location distribution cancelations
-          returnReturn.prepare("SELECT returnWoMaterial(:womatl_id, :qty, 0, :date) AS result;");
-          returnReturn.bindValue(":womatl_id", items.value("womatl_id").toInt());
-          returnReturn.bindValue(":qty", items.value("qty").toDouble());
-          returnReturn.bindValue(":date",  _transDate->date());
-          returnReturn.exec();
-          if (returnReturn.first())
-          {
-            if (returnReturn.value("result").toInt() < 0)
-            {
-              rollback.exec();
-              ErrorReporter::error(QtCriticalMsg, this, tr("Error Returning Work Order Material Batch, W/O ID #%1")
-                                   .arg(_wo->id()),returnReturn, __FILE__, __LINE__);
-              return;
-            }
-            if (distributeInventory::SeriesAdjust(returnReturn.value("result").toInt(), this) == XDialog::Rejected)
-            {
-              rollback.exec();
-              QMessageBox::information( this, tr("Material Return"), tr("Transaction Canceled") );
-              return;
-            }
-          }
+          ParameterList lineParams;
+          lineParams.append("womatl_id", items.value("womatl_id").toInt());
+          lineParams.append("qty",       items.value("qty").toDouble());
+          lineParams.append("date",      _transDate->date());
+          batch.addLine(items.value("item_number").toString(), lineParams);
+        }
+        if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Returning Work Order Material Batch, W/O ID #%1")
+                                 .arg(_wo->id()), items, __FILE__, __LINE__))
+          return;
+
+        // stop at the first failed or canceled line
+        if (! batch.exec())
+        {
+          if (batch.canceled())
+            QMessageBox::information( this, tr("Material Return"), tr("Transaction Canceled") );
           else
-          {
-            rollback.exec();
             ErrorReporter::error(QtCriticalMsg, this, tr("Error Returning Work Order Material Batch, W/O ID #%1")
-                                 .arg(_wo->id()),returnReturn, __FILE__, __LINE__);\
-            return;
-          }
-          returnReturn.exec("COMMIT;");
+                                 .arg(_wo->id()),
+                                 tr("Item %1 failed with:\n%2")
+                                 .arg(batch.failed().value(0), batch.errors().value(0)),
+                                 __FILE__, __LINE__);
+          return;
         }
       }
     }
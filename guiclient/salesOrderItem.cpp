@@ -24,6 +24,7 @@
 #include "itemSourceList.h"
 #include "maintainItemCosts.h"
 #include "openPurchaseOrder.h"
+#include "preparedquery.h"
 #include "priceList.h"
 #include "reserveSalesOrderItem.h"
 #include "storedProcErrorLookup.h"
@@ -1780,7 +1781,6 @@ void salesOrderItem::sDeterminePrice()
 
 void salesOrderItem::sDeterminePrice(bool force)
 {
-  XSqlQuery salesDeterminePrice;
   // Determine if we can or should update the price
   if ( _mode == cView ||
        _mode == cViewQuote ||
@@ -1843,32 +1843,32 @@ void salesOrderItem::sDeterminePrice(bool force)
     _charVars.replace(QTY, _qtyOrdered->toDouble() * _qtyinvuomratio);
 
     QModelIndex idx1, idx2, idx3;
-    salesDeterminePrice.prepare("SELECT itemcharprice(:item_id,:char_id,:value,:cust_id,:shipto_id,:qty,:curr_id,:effective,:asof,:shipzone_id,:saletype_id)::numeric(16,4) AS price;");
+    PreparedQuery salesDeterminePrice("SELECT itemcharprice(:item_id,:char_id,:value,:cust_id,:shipto_id,:qty,:curr_id,:effective,:asof,:shipzone_id,:saletype_id)::numeric(16,4) AS price;");
 
     for (int i = 0; i < _itemchar->rowCount(); i++)
     {
       idx1 = _itemchar->index(i, CHAR_ID);
       idx2 = _itemchar->index(i, CHAR_VALUE);
       idx3 = _itemchar->index(i, CHAR_PRICE);
-      salesDeterminePrice.bindValue(":item_id", _item->id());
-      salesDeterminePrice.bindValue(":char_id", _itemchar->data(idx1, Qt::UserRole));
-      salesDeterminePrice.bindValue(":value", _itemchar->data(idx2, Qt::DisplayRole));
-      salesDeterminePrice.bindValue(":cust_id", _custid);
-      salesDeterminePrice.bindValue(":shipto_id", _shiptoid);
-      salesDeterminePrice.bindValue(":shipzone_id", _shipzoneid);
-      salesDeterminePrice.bindValue(":saletype_id", _saletypeid);
-      salesDeterminePrice.bindValue(":qty", _qtyOrdered->toDouble() * _qtyinvuomratio);
-      salesDeterminePrice.bindValue(":curr_id", _customerPrice->id());
-      salesDeterminePrice.bindValue(":effective", _customerPrice->effective());
-      salesDeterminePrice.bindValue(":asof", asOf);
-      salesDeterminePrice.exec();
-      if (salesDeterminePrice.first())
+      salesDeterminePrice->bindValue(":item_id", _item->id());
+      salesDeterminePrice->bindValue(":char_id", _itemchar->data(idx1, Qt::UserRole));
+      salesDeterminePrice->bindValue(":value", _itemchar->data(idx2, Qt::DisplayRole));
+      salesDeterminePrice->bindValue(":cust_id", _custid);
+      salesDeterminePrice->bindValue(":shipto_id", _shiptoid);
+      salesDeterminePrice->bindValue(":shipzone_id", _shipzoneid);
+      salesDeterminePrice->bindValue(":saletype_id", _saletypeid);
+      salesDeterminePrice->bindValue(":qty", _qtyOrdered->toDouble() * _qtyinvuomratio);
+      salesDeterminePrice->bindValue(":curr_id", _customerPrice->id());
+      salesDeterminePrice->bindValue(":effective", _customerPrice->effective());
+      salesDeterminePrice->bindValue(":asof", asOf);
+      salesDeterminePrice->exec();
+      if (salesDeterminePrice->first())
       {
-        _itemchar->setData(idx3, salesDeterminePrice.value("price").toString(), Qt::DisplayRole);
+        _itemchar->setData(idx3, salesDeterminePrice->value("price").toString(), Qt::DisplayRole);
         _itemchar->setData(idx3, QVariant(_charVars), Qt::UserRole);
       }
       else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Item Pricing Information"),
-                                    salesDeterminePrice, __FILE__, __LINE__))
+                                    *salesDeterminePrice, __FILE__, __LINE__))
       {
         return;
       }
@@ -0,0 +1,642 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "scriptAsyncQuery.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QScriptEngine>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <metasql.h>
+
+#include "guiclient.h"
+#include "querytrace.h"
+#include "workerconnection.h"
+#include "xsqlqueryproto.h"
+
+#define DEBUG false
+
+// database connections shared by all script queries, and how long an
+// unused one stays open
+#define MAXCONNECTIONS 4
+#define IDLEMSECS      (60 * 1000)
+
+// queries a single window may have running at once unless the
+// ScriptAsyncQueryLimit metric says otherwise; never all of the
+// connections, so one busy window can't starve the others
+#define DEFAULTMAXIMUM (MAXCONNECTIONS - 1)
+
+static int _maximumPerWindow = 0;
+static QHash<QObject*, int>     _active;
+static QList<ScriptAsyncQuery*> _pending;
+
+/* One query and its result. The GUI thread fills in the request and a
+   worker thread the result; _columns, _rows and _error are only read
+   after _done is set. A job whose ScriptAsyncQuery has gone away has no
+   _receiver and is deleted by the pool when its worker is done with it.
+ */
+class ScriptAsyncQueryJob
+{
+  public:
+    ScriptAsyncQueryJob(ScriptAsyncQuery *receiver, const QString &group,
+                        const QString &name, const QString &query,
+                        const ParameterList &params, const QString &source)
+      : _canceled(0),
+        _done(false),
+        _group(group),
+        _name(name),
+        _params(params),
+        _pid(0),
+        _query(query),
+        _receiver(receiver),
+        _source(source)
+    {
+    }
+
+    void run(QSqlDatabase &db)
+    {
+      QString text = _query;
+      if (! _group.isEmpty())
+      {
+        QSqlQuery mqlq(db);
+        mqlq.prepare("SELECT metasql_query"
+                     "  FROM metasql"
+                     " WHERE ((metasql_group=:group)"
+                     "    AND (metasql_name=:name))"
+                     " ORDER BY metasql_grade DESC LIMIT 1;");
+        mqlq.bindValue(":group", _group);
+        mqlq.bindValue(":name",  _name);
+        if (mqlq.exec() && mqlq.first())
+          text = mqlq.value(0).toString();
+        else if (mqlq.lastError().type() != QSqlError::NoError)
+          _error = mqlq.lastError().text();
+        else
+          _error = QObject::tr("Could not find the MetaSQL statement %1.%2")
+                     .arg(_group, _name);
+      }
+
+      if (_error.isEmpty() && ! _canceled.fetchAndAddOrdered(0))
+      {
+        MetaSQLQuery mql(text);
+        if (! mql.isValid())
+          _error = QObject::tr("Could not parse the MetaSQL statement");
+        else
+        {
+          QueryTrace::Timer timer(_source, _group.isEmpty() ? QString()
+                                                            : _group + "-" + _name);
+          XSqlQuery qry = mql.toQuery(_params, db);
+          timer.finish(qry, _params.count());
+          if (qry.lastError().type() != QSqlError::NoError)
+            _error = qry.lastError().text();
+          else
+          {
+            QSqlRecord record = qry.record();
+            for (int col = 0; col < record.count(); col++)
+              _columns.append(record.fieldName(col));
+
+            while (! _canceled.fetchAndAddOrdered(0) && qry.next())
+            {
+              QVariantList row;
+              for (int col = 0; col < _columns.size(); col++)
+                row.append(qry.value(col));
+              _rows.append(row);
+            }
+          }
+        }
+      }
+    }
+
+    QAtomicInt          _canceled;
+    QStringList         _columns;
+    bool                _done;
+    QString             _error;
+    QString             _group;
+    QString             _name;
+    ParameterList       _params;
+    int                 _pid;
+    QString             _query;
+    ScriptAsyncQuery   *_receiver;
+    QList<QVariantList> _rows;
+    QString             _source;
+};
+
+class ScriptAsyncQueryWorker : public QThread
+{
+  protected:
+    void run();
+};
+
+/* A few worker threads, each keeping its own database connection open,
+   shared by every script query in the application. Opening a PostgreSQL
+   connection costs more than most script queries, so threads are started
+   only when every running one is busy, up to MAXCONNECTIONS, and exit
+   after IDLEMSECS without work. _pid, _done and _receiver of a job, and
+   the pool's own members, are only touched with _mutex held.
+
+   Cancel requests are sent without _mutex held so the GUI thread never
+   waits on the server while a worker wants the lock. The backend's pid
+   is kept in _canceling until the request is sent, and started() holds
+   its worker back until then so the cancel can't hit the next query.
+ */
+class ScriptAsyncQueryPool
+{
+  public:
+    static void enqueue(ScriptAsyncQueryJob *job);
+    static void reconnect();
+    static void release(ScriptAsyncQueryJob *job);
+
+  private:
+    friend class ScriptAsyncQueryWorker;
+
+    static void                 cancelBackends(const QList<int> &pids);
+    static bool                 connection(WorkerConnection *&conn, int &generation);
+    static void                 finished(ScriptAsyncQueryJob *job);
+    static ScriptAsyncQueryJob *nextJob(ScriptAsyncQueryWorker *worker);
+    static void                 shutdown();
+    static void                 started(ScriptAsyncQueryJob *job, int pid);
+
+    static QList<int>                    _canceling;
+    static QWaitCondition                _canceled;
+    static WorkerConnection             *_conn;
+    static int                           _generation;
+    static int                           _idle;
+    static QMutex                        _mutex;
+    static QList<ScriptAsyncQueryJob*>   _queue;
+    static QList<ScriptAsyncQueryJob*>   _running;
+    static bool                          _stop;
+    static QWaitCondition                _work;
+    static QList<ScriptAsyncQueryWorker*> _workers;
+};
+
+QList<int>                     ScriptAsyncQueryPool::_canceling;
+QWaitCondition                 ScriptAsyncQueryPool::_canceled;
+WorkerConnection              *ScriptAsyncQueryPool::_conn = 0;
+int                            ScriptAsyncQueryPool::_generation = 0;
+int                            ScriptAsyncQueryPool::_idle = 0;
+QMutex                         ScriptAsyncQueryPool::_mutex;
+QList<ScriptAsyncQueryJob*>    ScriptAsyncQueryPool::_queue;
+QList<ScriptAsyncQueryJob*>    ScriptAsyncQueryPool::_running;
+bool                           ScriptAsyncQueryPool::_stop = false;
+QWaitCondition                 ScriptAsyncQueryPool::_work;
+QList<ScriptAsyncQueryWorker*> ScriptAsyncQueryPool::_workers;
+
+/* Ask the server to cancel whatever the given backends are running.
+   Call this from the GUI thread without _mutex held.
+ */
+void ScriptAsyncQueryPool::cancelBackends(const QList<int> &pids)
+{
+  QSqlDatabase db = QSqlDatabase::database(QSqlDatabase::defaultConnection, false);
+  if (db.isOpen())
+  {
+    QSqlQuery cancelq(db);
+    cancelq.prepare("SELECT pg_cancel_backend(:pid);");
+    foreach (int pid, pids)
+    {
+      cancelq.bindValue(":pid", pid);
+      cancelq.exec();
+    }
+  }
+
+  QMutexLocker locker(&_mutex);
+  foreach (int pid, pids)
+    _canceling.removeOne(pid);
+  _canceled.wakeAll();
+}
+
+/* Give a worker a copy of the current connection parameters if they
+   changed since it last looked. Returns true if the worker should close
+   and reopen its connection.
+ */
+bool ScriptAsyncQueryPool::connection(WorkerConnection *&conn, int &generation)
+{
+  QMutexLocker locker(&_mutex);
+  if (conn && generation == _generation)
+    return false;
+
+  delete conn;
+  conn       = new WorkerConnection(*_conn);
+  generation = _generation;
+  return true;
+}
+
+/* Queue a job, starting another worker if none is free. Call this from
+   the GUI thread; the first call captures the connection parameters.
+ */
+void ScriptAsyncQueryPool::enqueue(ScriptAsyncQueryJob *job)
+{
+  QMutexLocker locker(&_mutex);
+  if (! _conn)
+  {
+    _conn = new WorkerConnection();
+    qAddPostRoutine(shutdown);
+  }
+
+  _queue.append(job);
+  if (_queue.size() > _idle && _workers.size() < MAXCONNECTIONS)
+  {
+    ScriptAsyncQueryWorker *worker = new ScriptAsyncQueryWorker();
+    QObject::connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    _workers.append(worker);
+    worker->start();
+  }
+  _work.wakeOne();
+}
+
+/* Capture the connection parameters again, for example after the main
+   connection was reestablished. Workers reopen their connections before
+   their next job.
+ */
+void ScriptAsyncQueryPool::reconnect()
+{
+  WorkerConnection *conn = new WorkerConnection();
+
+  QMutexLocker locker(&_mutex);
+  if (! _conn)
+  {
+    delete conn;
+    return;
+  }
+  delete _conn;
+  _conn = conn;
+  _generation++;
+}
+
+/* The ScriptAsyncQuery no longer wants the result of job. A job that has
+   not started is dropped; a running one is canceled on the server and
+   deleted when its worker is done with it.
+ */
+void ScriptAsyncQueryPool::release(ScriptAsyncQueryJob *job)
+{
+  int pid = 0;
+  _mutex.lock();
+  job->_receiver = 0;
+  job->_canceled.fetchAndStoreOrdered(1);
+  if (_queue.removeAll(job) || job->_done)
+    delete job;
+  else if (job->_pid > 0)
+  {
+    pid = job->_pid;
+    _canceling.append(pid);
+  }
+  _mutex.unlock();
+
+  if (pid > 0)
+    cancelBackends(QList<int>() << pid);
+}
+
+void ScriptAsyncQueryPool::finished(ScriptAsyncQueryJob *job)
+{
+  QMutexLocker locker(&_mutex);
+  _running.removeAll(job);
+  job->_pid  = 0;
+  job->_done = true;
+  if (job->_receiver)
+    QMetaObject::invokeMethod(job->_receiver, "sWorkerFinished", Qt::QueuedConnection);
+  else
+    delete job;
+}
+
+ScriptAsyncQueryJob *ScriptAsyncQueryPool::nextJob(ScriptAsyncQueryWorker *worker)
+{
+  QMutexLocker locker(&_mutex);
+  while (! _stop && _queue.isEmpty())
+  {
+    _idle++;
+    bool woken = _work.wait(&_mutex, IDLEMSECS);
+    _idle--;
+    if (! woken && _queue.isEmpty())
+      break;
+  }
+
+  if (_stop || _queue.isEmpty())
+  {
+    _workers.removeAll(worker);
+    return 0;
+  }
+
+  return _queue.takeFirst();
+}
+
+/* Stop the workers at exit, canceling running queries first so a long
+   report doesn't hold up closing the application.
+ */
+void ScriptAsyncQueryPool::shutdown()
+{
+  QList<ScriptAsyncQueryWorker*> workers;
+  QList<int> pids;
+  _mutex.lock();
+  _stop = true;
+  foreach (ScriptAsyncQueryJob *job, _running)
+  {
+    job->_canceled.fetchAndStoreOrdered(1);
+    if (job->_pid > 0)
+    {
+      pids.append(job->_pid);
+      _canceling.append(job->_pid);
+    }
+  }
+  _work.wakeAll();
+  workers = _workers;
+  _mutex.unlock();
+
+  if (! pids.isEmpty())
+    cancelBackends(pids);
+
+  foreach (ScriptAsyncQueryWorker *worker, workers)
+    worker->wait();
+}
+
+void ScriptAsyncQueryPool::started(ScriptAsyncQueryJob *job, int pid)
+{
+  QMutexLocker locker(&_mutex);
+  while (_canceling.contains(pid))
+    _canceled.wait(&_mutex);
+  job->_pid = pid;
+  _running.append(job);
+}
+
+/* Keep one connection open while there is work. If a query fails and
+   the connection no longer answers, or the pool was told to reconnect,
+   it is reopened for the next job.
+ */
+void ScriptAsyncQueryWorker::run()
+{
+  WorkerConnection *conn = 0;
+  int          generation = -1;
+  QSqlDatabase db;
+  QString      errmsg;
+  int          pid = 0;
+
+  while (ScriptAsyncQueryJob *job = ScriptAsyncQueryPool::nextJob(this))
+  {
+    if (ScriptAsyncQueryPool::connection(conn, generation) && db.isValid())
+      WorkerConnection::close(db);
+    if (! db.isOpen())
+    {
+      if (db.isValid())
+        WorkerConnection::close(db);
+      db  = conn->open("scriptquery", &errmsg);
+      pid = 0;
+      if (db.isOpen())
+      {
+        QSqlQuery pidq(db);
+        if (pidq.exec("SELECT pg_backend_pid();") && pidq.first())
+          pid = pidq.value(0).toInt();
+      }
+    }
+
+    if (db.isOpen())
+    {
+      ScriptAsyncQueryPool::started(job, pid);
+      job->run(db);
+      if (! job->_error.isEmpty() && ! QSqlQuery(db).exec("SELECT 1;"))
+        WorkerConnection::close(db);
+    }
+    else
+      job->_error = errmsg;
+
+    ScriptAsyncQueryPool::finished(job);
+  }
+
+  if (db.isValid())
+    WorkerConnection::close(db);
+  delete conn;
+}
+
+/** @ingroup scriptapi
+
+    @class ScriptAsyncQuery
+
+    @brief Run a MetaSQL query without blocking the user interface.
+
+    ScriptToolbox::executeQueryAsync() and executeDbQueryAsync() create
+    one of these for each call. The query runs in a worker thread on one
+    of a few database connections shared by all script queries, so the
+    window stays responsive and no new connection is opened per query.
+    When it is done the callback is called on the GUI thread with the
+    result as an array of objects, like ScriptToolbox::executeQueryRecords(),
+    and an error message, which is empty on success.
+
+    Each window may have at most maximumPerWindow() queries running at
+    once, which is always fewer than the shared connections so other
+    windows can still get one. Later requests wait their turn. Closing the window cancels its
+    queries, including any that are still waiting, and their callbacks
+    are never called.
+
+    The object deletes itself after the callback returns or the query
+    is canceled, so scripts should not keep it around.
+ */
+ScriptAsyncQuery::ScriptAsyncQuery(QScriptEngine *engine, const QString &group,
+                                   const QString &name, const QString &query,
+                                   const ParameterList &params,
+                                   const QScriptValue &callback,
+                                   QObject *owner)
+  : QObject(owner ? owner : engine),
+    _callback(callback),
+    _canceled(false),
+    _engine(engine),
+    _finished(false),
+    _group(group),
+    _job(0),
+    _name(name),
+    _owner(owner ? owner : engine),
+    _params(params),
+    _query(query)
+{
+  setObjectName("ScriptAsyncQuery");
+
+  if (_active.value(_owner) < maximumPerWindow())
+    start();
+  else
+  {
+    if (DEBUG)
+      qDebug("ScriptAsyncQuery queued behind %d others for %s",
+             _active.value(_owner), qPrintable(_owner->objectName()));
+    _pending.append(this);
+  }
+}
+
+ScriptAsyncQuery::~ScriptAsyncQuery()
+{
+  // the owner is going away so there's no point starting its other queries
+  _pending.removeAll(this);
+  if (_job)
+    detachJob();
+}
+
+bool ScriptAsyncQuery::isActive() const
+{
+  return _job != 0;
+}
+
+bool ScriptAsyncQuery::isCanceled() const
+{
+  return _canceled;
+}
+
+bool ScriptAsyncQuery::isFinished() const
+{
+  return _finished;
+}
+
+QString ScriptAsyncQuery::lastError() const
+{
+  return _error;
+}
+
+/** @brief Return the result as an array of objects keyed by column name. */
+QScriptValue ScriptAsyncQuery::records() const
+{
+  QScriptValue result = _engine->newArray(_rows.size());
+  QList<QScriptString> names;
+  foreach (QString column, _columns)
+    names.append(_engine->toStringHandle(column));
+
+  for (int row = 0; row < _rows.size(); row++)
+  {
+    const QVariantList &values = _rows.at(row);
+    QScriptValue record = _engine->newObject();
+    for (int col = 0; col < names.size() && col < values.size(); col++)
+      record.setProperty(names.at(col), SqlValuetoScriptValue(_engine, values.at(col)));
+    result.setProperty(row, record);
+  }
+  return result;
+}
+
+/** @brief The number of queries one window may run at the same time.
+
+    This is the ScriptAsyncQueryLimit metric if it is set, but never more
+    than one less than the number of shared connections.
+ */
+int ScriptAsyncQuery::maximumPerWindow()
+{
+  if (_maximumPerWindow <= 0)
+  {
+    if (_metrics && _metrics->value("ScriptAsyncQueryLimit").toInt() > 0)
+      _maximumPerWindow = _metrics->value("ScriptAsyncQueryLimit").toInt();
+    else
+      _maximumPerWindow = DEFAULTMAXIMUM;
+  }
+  return qBound(1, _maximumPerWindow, MAXCONNECTIONS - 1);
+}
+
+/** @brief Reopen the shared query connections before their next query.
+
+    Call this after the main connection has been reestablished so the
+    workers pick up its current parameters and search_path.
+ */
+void ScriptAsyncQuery::reconnect()
+{
+  ScriptAsyncQueryPool::reconnect();
+}
+
+void ScriptAsyncQuery::setMaximumPerWindow(int max)
+{
+  _maximumPerWindow = max;
+}
+
+/** @brief Stop the query and discard its result.
+
+    The callback is not called. If the statement is already running on
+    the server it is canceled there too.
+ */
+void ScriptAsyncQuery::cancel()
+{
+  if (_finished || _canceled)
+    return;
+
+  _canceled = true;
+  _pending.removeAll(this);
+  if (_job)
+  {
+    detachJob();
+    startPending(_owner);
+  }
+
+  emit canceled();
+  deleteLater();
+}
+
+void ScriptAsyncQuery::sWorkerFinished()
+{
+  ScriptAsyncQueryJob *job = _job;
+  _job = 0;
+  if (! job)
+    return;
+
+  _columns = job->_columns;
+  _error   = job->_error;
+  _rows    = job->_rows;
+  delete job;
+
+  _active[_owner]--;
+  _finished = true;
+  startPending(_owner);
+
+  if (DEBUG)
+    qDebug("ScriptAsyncQuery::sWorkerFinished() %d rows, error [%s]",
+           _rows.size(), qPrintable(_error));
+
+  if (_callback.isFunction())
+  {
+    _callback.call(QScriptValue(), QScriptValueList() << records()
+                                                      << QScriptValue(_error));
+    if (_engine->hasUncaughtException())
+      qWarning("ScriptAsyncQuery callback failed at line %d: %s",
+               _engine->uncaughtExceptionLineNumber(),
+               qPrintable(_engine->uncaughtException().toString()));
+  }
+
+  if (_error.isEmpty())
+    emit finished();
+  else
+    emit failed(_error);
+
+  deleteLater();
+}
+
+/* Hand the job back to the pool. Nothing it produces is delivered. */
+void ScriptAsyncQuery::detachJob()
+{
+  ScriptAsyncQueryJob *job = _job;
+  _job = 0;
+  ScriptAsyncQueryPool::release(job);
+
+  if (--_active[_owner] <= 0)
+    _active.remove(_owner);
+}
+
+void ScriptAsyncQuery::start()
+{
+  _active[_owner]++;
+  _job = new ScriptAsyncQueryJob(this, _group, _name, _query, _params,
+                                 _owner->objectName());
+  ScriptAsyncQueryPool::enqueue(_job);
+}
+
+void ScriptAsyncQuery::startPending(QObject *owner)
+{
+  for (int i = 0; i < _pending.size() && _active.value(owner) < maximumPerWindow(); )
+  {
+    if (_pending.at(i)->_owner == owner)
+      _pending.takeAt(i)->start();
+    else
+      i++;
+  }
+  if (_active.value(owner) <= 0)
+    _active.remove(owner);
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SCRIPTASYNCQUERY_H__
+#define __SCRIPTASYNCQUERY_H__
+
+#include <QObject>
+#include <QScriptValue>
+#include <QStringList>
+#include <QVariant>
+
+#include <parameter.h>
+
+class QScriptEngine;
+class ScriptAsyncQueryJob;
+
+class ScriptAsyncQuery : public QObject
+{
+  Q_OBJECT
+
+  public:
+    ScriptAsyncQuery(QScriptEngine *engine, const QString &group,
+                     const QString &name, const QString &query,
+                     const ParameterList &params, const QScriptValue &callback,
+                     QObject *owner);
+    virtual ~ScriptAsyncQuery();
+
+    Q_INVOKABLE virtual bool         isActive()   const;
+    Q_INVOKABLE virtual bool         isCanceled() const;
+    Q_INVOKABLE virtual bool         isFinished() const;
+    Q_INVOKABLE virtual QString      lastError()  const;
+    Q_INVOKABLE virtual QScriptValue records()    const;
+
+    static int  maximumPerWindow();
+    static void reconnect();
+    static void setMaximumPerWindow(int max);
+
+  public slots:
+    virtual void cancel();
+
+  signals:
+    void canceled();
+    void failed(const QString &error);
+    void finished();
+
+  private slots:
+    void sWorkerFinished();
+
+  private:
+    void        detachJob();
+    void        start();
+    static void startPending(QObject *owner);
+
+    QScriptValue            _callback;
+    bool                    _canceled;
+    QStringList             _columns;
+    QScriptEngine          *_engine;
+    QString                 _error;
+    bool                    _finished;
+    QString                 _group;
+    ScriptAsyncQueryJob    *_job;
+    QString                 _name;
+    QObject                *_owner;
+    ParameterList           _params;
+    QString                 _query;
+    QList<QVariantList>     _rows;
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "scripttoolbox.h"
 #include "../scriptapi/qeventproto.h"
 #include "../scriptapi/parameterlistsetup.h"
+#include "../scriptapi/scriptcache.h"
 
 ScriptablePrivate::ScriptablePrivate(bool dialog, QWidget* parent)
   : _engine(0), _debugger(0), _scriptLoaded(false), _dialog(dialog), _parent(parent)
@@ -57,20 +58,14 @@ QScriptEngine *ScriptablePrivate::engine()
 void ScriptablePrivate::loadScript(const QString& oName)
 {
   qDebug() << "Looking for a script " << oName;
-  XSqlQuery scriptq;
-  scriptq.prepare("SELECT script_source, script_order"
-            "  FROM script"
-            " WHERE((script_name=:script_name)"
-            "   AND (script_enabled))"
-            " ORDER BY script_order;");
-  scriptq.bindValue(":script_name", oName);
-  scriptq.exec();
-  while(scriptq.next())
+  QList<QPair<int, QString> > scripts = ScriptCache::scripts(oName);
+  for (int i = 0; i < scripts.size(); i++)
   {
     if(engine())
     {
-      QString script = scriptHandleIncludes(scriptq.value("script_source").toString());
-      QScriptValue result = _engine->evaluate(script, _parent->objectName());
+      QString script = scriptHandleIncludes(scripts.at(i).second);
+      QScriptValue result = ScriptCache::evaluate(_engine, scripts.at(i).first,
+                                                  script, _parent->objectName());
       if (_engine->hasUncaughtException())
       {
         int line = _engine->uncaughtExceptionLineNumber();
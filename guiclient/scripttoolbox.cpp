@@ -39,6 +39,11 @@
 #include "creditCard.h"
 #include "creditcardprocessor.h"
 #include "mqlutil.h"
+#include "querytrace.h"
+#include "scriptAsyncQuery.h"
+#include "scriptcache.h"
+#include "uiFormCache.h"
+#include "xsqlqueryproto.h"
 #include "storedProcErrorLookup.h"
 #include "xdialog.h"
 #include "xmainwindow.h"
@@ -48,6 +53,18 @@
 #include "getscreen.h"
 #include "errorReporter.h"
 
+// run a script's query and record its timing against the script's window
+static XSqlQuery tracedQuery(QScriptEngine *engine, MetaSQLQuery &mql,
+                             const ParameterList &params,
+                             const QString &statement = QString())
+{
+  QueryTrace::Timer timer((engine && engine->parent()) ? engine->parent()->objectName() : QString(),
+                          statement);
+  XSqlQuery qry = mql.toQuery(params);
+  timer.finish(qry, params.count());
+  return qry;
+}
+
 /** @ingroup scriptapi
 
     @class ScriptToolbox
@@ -142,7 +159,7 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query)
 {
   ParameterList params;
   MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return tracedQuery(_engine, mql, params);
 }
 /** @example initMenu_executeQueryExample.js */
 
@@ -179,10 +196,53 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query)
 XSqlQuery ScriptToolbox::executeQuery(const QString & query, const ParameterList & params)
 {
   MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return tracedQuery(_engine, mql, params);
 }
 /** @example itemSiteViewItem.js */
 
+/** @brief Execute a MetaSQL query and return the whole result at once.
+
+  This behaves like executeQuery() but returns an array with one array of
+  column values per row instead of an XSqlQuery. Column values are
+  converted to native script types in C++, which is much faster than
+  walking the result with next() and value() from a script. Use
+  XSqlQuery.columns() or executeQueryRecords() if you need column names.
+
+  @param query  The text of the MetaSQL query to execute
+  @param params The list of parameters to pass to the MetaSQL parser
+
+  @return An array of arrays. If the query fails the array is empty.
+
+  @see executeQueryRecords
+  @see XSqlQueryProto::rows
+ */
+QScriptValue ScriptToolbox::executeQueryRows(const QString & query, const ParameterList & params)
+{
+  MetaSQLQuery mql(query);
+  XSqlQuery qry = tracedQuery(_engine, mql, params);
+  return XSqlQuerytoRows(_engine, qry);
+}
+
+/** @brief Execute a MetaSQL query and return the whole result at once.
+
+  Like executeQueryRows() but each row is an object whose properties are
+  the column names.
+
+  @param query  The text of the MetaSQL query to execute
+  @param params The list of parameters to pass to the MetaSQL parser
+
+  @return An array of objects. If the query fails the array is empty.
+
+  @see executeQueryRows
+  @see XSqlQueryProto::records
+ */
+QScriptValue ScriptToolbox::executeQueryRecords(const QString & query, const ParameterList & params)
+{
+  MetaSQLQuery mql(query);
+  XSqlQuery qry = tracedQuery(_engine, mql, params);
+  return XSqlQuerytoRecords(_engine, qry);
+}
+
 /** @brief Execute a simple query loaded from the @c metasql table.
 
   This loads a query string from the @c metasql table in the xTuple ERP
@@ -210,7 +270,7 @@ XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & n
 {
   ParameterList params;
   MetaSQLQuery mql = mqlLoad(group, name);
-  return mql.toQuery(params);
+  return tracedQuery(_engine, mql, params, group + "-" + name);
 }
 
 /** @brief Execute a MetaSQL query loaded from the @c metasql table.
@@ -252,10 +312,73 @@ XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & n
 XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & name, const ParameterList & params)
 {
   MetaSQLQuery mql = mqlLoad(group, name);
-  return mql.toQuery(params);
+  return tracedQuery(_engine, mql, params, group + "-" + name);
 }
 /** @example ccvoid.js */
 
+/** @brief Execute a MetaSQL query without waiting for the result.
+
+  The query runs on a separate database connection in the background so
+  the window stays responsive while the database works. When the query
+  is done @a callback is called with two arguments: an array of objects
+  keyed by column name, like executeQueryRecords() returns, and an error
+  message that is empty if the query succeeded.
+
+  @code
+  toolbox.executeQueryAsync("SELECT cust_number, cust_name FROM custinfo;",
+                            new Object, function(records, error) {
+    if (error)
+      QMessageBox.critical(mywindow, qsTr("Error"), error);
+    else
+      for (var i = 0; i < records.length; i++)
+        print(records[i].cust_number);
+  });
+  @endcode
+
+  The query cannot see uncommitted changes made on the main connection,
+  so do not use it inside an executeBegin()/executeCommit() block.
+  Queries are canceled when their window closes. Only a few run at once
+  for each window; the rest wait their turn.
+
+  @param query    The text of the MetaSQL query to execute
+  @param params   The list of parameters to pass to the MetaSQL parser
+  @param callback The function to call with the result
+  @param owner    The object whose lifetime bounds the query. This defaults
+                  to the window the script belongs to.
+
+  @return A ScriptAsyncQuery with cancel(), isActive() and the
+          finished(), failed() and canceled() signals. It deletes itself
+          once the callback has been called.
+
+  @see executeDbQueryAsync
+  @see ScriptAsyncQuery
+ */
+QObject * ScriptToolbox::executeQueryAsync(const QString & query, const ParameterList & params, const QScriptValue & callback, QObject * owner)
+{
+  return new ScriptAsyncQuery(_engine, QString(), QString(), query, params,
+                              callback, owner ? owner : _engine->parent());
+}
+
+/** @brief Execute a MetaSQL query from the @c metasql table without
+           waiting for the result.
+
+  This is executeQueryAsync() for a query stored in the @c metasql table.
+  The query text is loaded on the background connection too.
+
+  @param %group   The metasql_group value to use when searching for this query
+  @param name     The metasql_name value to use when searching for this query
+  @param params   The list of parameters to pass to the MetaSQL parser
+  @param callback The function to call with the result
+  @param owner    The object whose lifetime bounds the query
+
+  @see executeQueryAsync
+ */
+QObject * ScriptToolbox::executeDbQueryAsync(const QString & group, const QString & name, const ParameterList & params, const QScriptValue & callback, QObject * owner)
+{
+  return new ScriptAsyncQuery(_engine, group, name, QString(), params,
+                              callback, owner ? owner : _engine->parent());
+}
+
 /** @brief This is a convenience function that simply begins a database transaction.
  */
 XSqlQuery ScriptToolbox::executeBegin()
@@ -771,35 +894,11 @@ QWidget * ScriptToolbox::loadUi(const QString & screenName, QWidget * parent)
   if(screenName.isEmpty())
     return 0;
 
-  XSqlQuery qui;
-  qui.prepare("SELECT *"
-              "  FROM uiform"
-              " WHERE((uiform_name=:uiform_name)"
-              "   AND (uiform_enabled))"
-              " ORDER BY uiform_order DESC"
-              " LIMIT 1;");
-  qui.bindValue(":uiform_name", screenName);
-  qui.exec();
-  if(!qui.first())
-  {
+  QString errmsg;
+  QWidget *ui = UiFormCache::build(screenName, parent, &errmsg);
+  if (! ui)
     QMessageBox::critical(0, tr("Could Not Create Form"),
-                              tr("<p>Could not create the '%1' form. Either an "
-                                 "error occurred or the specified form does "
-                                 "not exist.").arg(screenName) );
-    return 0;
-  }
-
-  XUiLoader loader;
-  QByteArray ba = qui.value("uiform_source").toByteArray();
-  QBuffer uiFile(&ba);
-  if(!uiFile.open(QIODevice::ReadOnly))
-  {
-    QMessageBox::critical(0, tr("Could not load file"),
-        tr("There was an error loading the UI Form from the database."));
-    return 0;
-  }
-  QWidget *ui = loader.load(&uiFile, parent);
-  uiFile.close();
+                          tr("<p>%1").arg(errmsg));
 
   return ui;
 }
@@ -1289,37 +1388,18 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
     return returnVal;
   }
 
-  XSqlQuery screenq;
-  screenq.prepare("SELECT * "
-                  "  FROM uiform "
-                  " WHERE((uiform_name=:uiform_name)"
-                  "   AND (uiform_enabled))"
-                  " ORDER BY uiform_order DESC"
-                  " LIMIT 1;");
-  screenq.bindValue(":uiform_name", pname);
-  screenq.exec();
-  if (screenq.first())
+  QSqlError dberror;
+  if (! UiFormCache::source(pname, 0, &dberror).isEmpty())
   {
-    XUiLoader loader;
-    QByteArray ba = screenq.value("uiform_source").toString().toUtf8();
-    QBuffer uiFile(&ba);
-    if (!uiFile.open(QIODevice::ReadOnly))
-    {
-      QMessageBox::critical(0, tr("Could not load UI"),
-                            tr("<p>There was an error loading the UI Form "
-                               "from the database."));
-      return 0;
-    }
-    QWidget *ui = loader.load(&uiFile);
+    QString  errmsg;
+    QWidget *ui = UiFormCache::build(pname, 0, &errmsg);
     if (! ui)
     {
       QMessageBox::critical(0, tr("Could not load UI"),
-                            tr("<p>There was an error creating a window from "
-                               "the UI Form. It may be empty or invalid."));
+                            tr("<p>%1").arg(errmsg));
       return 0;
     }
     QSize size = ui->size();
-    uiFile.close();
 
     if (ui->inherits("QDialog"))
     {
@@ -1328,9 +1408,7 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
         modality = Qt::WindowModal;
     }
 
-    XMainWindow *window = new XMainWindow(parent,
-                                          screenq.value("uiform_name").toString().toLatin1().data(),
-                                          flags);
+    XMainWindow *window = new XMainWindow(parent, pname.toLatin1().data(), flags);
 
     window->setCentralWidget(ui);
     window->setWindowTitle(ui->windowTitle());
@@ -1365,7 +1443,7 @@ QWidget *ScriptToolbox::openWindow(QString pname, QWidget *parent, Qt::WindowMod
     _lastWindow = window;
   }
   else if (ErrorReporter::error(QtCriticalMsg, 0, tr("Error Opening New Window"),
-                                screenq, __FILE__, __LINE__))
+                                dberror, __FILE__, __LINE__))
   {
     return 0;
   }
@@ -1624,6 +1702,30 @@ QString ScriptToolbox::storedProcErrorLookup(const QString proc, const int resul
   return ::storedProcErrorLookup(proc, result);
 }
 
+/** @brief Return a table of compile and evaluate times for every script
+           loaded so far, slowest first.
+  */
+QString ScriptToolbox::scriptTimingReport()
+{
+  return ScriptCache::timingReport();
+}
+
+/** @brief Return a table of the time spent fetching and building each
+           screen from the %uiform table so far, slowest first.
+  */
+QString ScriptToolbox::uiFormTimingReport()
+{
+  return UiFormCache::timingReport();
+}
+
+/** @brief Log any script that takes longer than @a msecs milliseconds to
+           evaluate. Pass a negative value to turn the warning off.
+  */
+void ScriptToolbox::setSlowScriptThreshold(int msecs)
+{
+  ScriptCache::setSlowThreshold(msecs);
+}
+
 /** @brief This functions takes a regexp string and creates and returns a QRegExpValidator. */
 QObject * ScriptToolbox::customVal(const QString & ReqExp)
 {
@@ -96,8 +96,12 @@ class ScriptToolbox : public QObject
 
     XSqlQuery executeQuery(const QString & query);
     XSqlQuery executeQuery(const QString & query, const ParameterList & params);
+    QScriptValue executeQueryRows(const QString & query, const ParameterList & params);
+    QScriptValue executeQueryRecords(const QString & query, const ParameterList & params);
     XSqlQuery executeDbQuery(const QString & group, const QString & name);
     XSqlQuery executeDbQuery(const QString & group, const QString & name, const ParameterList & params);
+    QObject * executeQueryAsync(const QString & query, const ParameterList & params, const QScriptValue & callback, QObject * owner = 0);
+    QObject * executeDbQueryAsync(const QString & group, const QString & name, const ParameterList & params, const QScriptValue & callback, QObject * owner = 0);
     XSqlQuery executeBegin();
     XSqlQuery executeCommit();
     XSqlQuery executeRollback();
@@ -201,6 +205,9 @@ class ScriptToolbox : public QObject
     QObject *getCreditCardProcessor();
 
     QString storedProcErrorLookup(const QString proc, const int result);
+    QString scriptTimingReport();
+    QString uiFormTimingReport();
+    void    setSlowScriptThreshold(int msecs);
 
   private:
     QScriptEngine * _engine;
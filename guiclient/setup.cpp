@@ -16,6 +16,8 @@
 #include <QScriptEngineDebugger>
 
 #include "getscreen.h"
+#include "scriptcache.h"
+#include "uiFormCache.h"
 #include "scripttoolbox.h"
 #include "setup.h"
 #include "xt.h"
@@ -501,37 +503,14 @@ void setup::setCurrentIndex(XTreeWidgetItem* item)
     else
     {
       // No class, so look for an extension
-      XSqlQuery screenq;
-      screenq.prepare("SELECT * "
-                      "  FROM uiform "
-                      " WHERE((uiform_name=:uiform_name)"
-                      "   AND (uiform_enabled))"
-                      " ORDER BY uiform_order DESC"
-                      " LIMIT 1;");
-      screenq.bindValue(":uiform_name", uiName);
-      screenq.exec();
-      if (screenq.first())
-      {     
-        QUiLoader loader;
-        QByteArray ba = screenq.value("uiform_source").toByteArray();
-        QBuffer uiFile(&ba);
-        if (!uiFile.open(QIODevice::ReadOnly))
-          QMessageBox::critical(0, tr("Could not load UI"),
-                                tr("<p>There was an error loading the UI Form "
-                                   "from the database."));
-        w = loader.load(&uiFile);
+      QUiLoader loader;
+      w = UiFormCache::build(uiName, 0, 0, &loader);
+      if (w)
+      {
         w->setObjectName(uiName);
-        uiFile.close();
 
         // Load scripts if applicable
-        XSqlQuery scriptq;
-        scriptq.prepare("SELECT script_source, script_order"
-                        "  FROM script"
-                        " WHERE((script_name=:script_name)"
-                        "   AND (script_enabled))"
-                        " ORDER BY script_order;");
-        scriptq.bindValue(":script_name", uiName);
-        scriptq.exec();
+        QList<QPair<int, QString> > scripts = ScriptCache::scripts(uiName);
 
         QScriptEngine* engine = new QScriptEngine();
         if (_preferences->boolean("EnableScriptDebug"))
@@ -543,10 +522,11 @@ void setup::setCurrentIndex(XTreeWidgetItem* item)
         QScriptValue mywindow = engine->newQObject(w);
         engine->globalObject().setProperty("mywindow", mywindow);
 
-        while(scriptq.next())
+        for (int i = 0; i < scripts.size(); i++)
         {
-          QString script = scriptHandleIncludes(scriptq.value("script_source").toString());
-          QScriptValue result = engine->evaluate(script, uiName);
+          QString script = scriptHandleIncludes(scripts.at(i).second);
+          QScriptValue result = ScriptCache::evaluate(engine, scripts.at(i).first,
+                                                      script, uiName);
           if (engine->hasUncaughtException())
           {
             int line = engine->uncaughtExceptionLineNumber();
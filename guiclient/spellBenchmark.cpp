@@ -0,0 +1,299 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "spellBenchmark.h"
+
+#include <stdio.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextCodec>
+#include <QTextStream>
+#include <QThread>
+
+#include "guiclient.h"
+#include "../hunspell/hunspell.hxx"
+
+// run each test for at least this long
+#define MINMSECS 1000
+
+// most misspellings to time suggestions for
+#define MAXSUGGEST 200
+
+// checks the same words as the other threads, starting elsewhere in the list
+class SpellCheckThread : public QThread
+{
+  public:
+    SpellCheckThread(Hunspell *checker, const QList<QByteArray> &words, int first)
+      : checks(0), _checker(checker), _first(first), _words(words) {}
+
+    qint64 checks;
+
+  protected:
+    void run()
+    {
+      QElapsedTimer timer;
+      timer.start();
+      do
+      {
+        for (int i = 0; i < _words.size(); i++)
+          _checker->spell(_words.at((_first + i) % _words.size()).constData());
+        checks += _words.size();
+      } while (timer.elapsed() < MINMSECS);
+    }
+
+  private:
+    Hunspell          *_checker;
+    int                _first;
+    QList<QByteArray>  _words;
+};
+
+SpellBenchmark::SpellBenchmark(const QString &words, const QString &output, QObject *parent)
+  : QObject(parent),
+    _checker(0),
+    _codec(0),
+    _output(output),
+    _words(words)
+{
+  setObjectName("SpellBenchmark");
+}
+
+/** @brief Load the dictionary, run every test and write the results.
+
+    @return 0 on success, -1 if the dictionary, word file or output file
+            could not be opened
+ */
+int SpellBenchmark::run()
+{
+  QString dictionary = GUIClient::hunspell_dictionary();
+  if (! QFile::exists(dictionary + ".aff") || ! QFile::exists(dictionary + ".dic"))
+  {
+    fprintf(stderr, "%s\n", qPrintable(tr("Could not find the dictionary %1").arg(dictionary)));
+    return -1;
+  }
+
+  QFile out;
+  bool opened = _output.isEmpty() ? out.open(stdout, QIODevice::WriteOnly | QIODevice::Text)
+                                  : (out.setFileName(_output),
+                                     out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
+  if (! opened)
+  {
+    fprintf(stderr, "%s\n", qPrintable(tr("Could not open %1: %2")
+                                         .arg(_output, out.errorString())));
+    return -1;
+  }
+
+  QTextStream stream(&out);
+  stream << "test,words,checks,msecs,per_second,median_ms,p95_ms,max_ms\n";
+
+  QElapsedTimer timer;
+  timer.start();
+  QString image = GUIClient::hunspell_image(dictionary);
+  _checker = new Hunspell((dictionary + ".aff").toLatin1(), (dictionary + ".dic").toLatin1(),
+                          0, image.isEmpty() ? 0 : QFile::encodeName(image).constData());
+  stream << (_checker->is_image() ? "load image" : "load text") << ",0,0,"
+         << timer.elapsed() << ",0,,,\n";
+  stream.flush();
+
+  _codec = QTextCodec::codecForName(_checker->get_dic_encoding());
+  if (! _codec)
+    _codec = QTextCodec::codecForName("ISO8859-1");
+
+  QList<QByteArray> words = dictionaryWords(dictionary + ".dic");
+  check(stream, "dictionary", words);
+  checkThreads(stream, "dictionary", words);
+
+  // the same words with two letters swapped are mostly misses
+  QList<QByteArray> swapped;
+  foreach (QByteArray word, words)
+  {
+    if (word.size() > 3)
+    {
+      char c = word[1];
+      word[1] = word[2];
+      word[2] = c;
+      swapped.append(word);
+    }
+  }
+  check(stream, "swapped", swapped);
+
+  int result = 0;
+  QList<QByteArray> misspelled = swapped;
+  if (! _words.isEmpty())
+  {
+    QList<QByteArray> text = textWords(_words, _codec);
+    if (text.isEmpty())
+    {
+      fprintf(stderr, "%s\n", qPrintable(tr("Could not read any words from %1").arg(_words)));
+      result = -1;
+    }
+    else
+    {
+      check(stream, "text", text);
+      checkThreads(stream, "text", text);
+
+      QList<QByteArray> textMisspelled;
+      foreach (const QByteArray &word, text)
+      {
+        if (! _checker->spell(word.constData()) && ! textMisspelled.contains(word))
+          textMisspelled.append(word);
+      }
+      if (! textMisspelled.isEmpty())
+        misspelled = textMisspelled;
+    }
+  }
+  suggest(stream, misspelled);
+
+  delete _checker;
+  _checker = 0;
+  return result;
+}
+
+void SpellBenchmark::check(QTextStream &stream, const QString &test, const QList<QByteArray> &words)
+{
+  if (words.isEmpty())
+    return;
+
+  qint64 checks = 0;
+  QElapsedTimer timer;
+  timer.start();
+  do
+  {
+    for (int i = 0; i < words.size(); i++)
+      _checker->spell(words.at(i).constData());
+    checks += words.size();
+  } while (timer.elapsed() < MINMSECS);
+  qint64 elapsed = timer.elapsed();
+
+  stream << test << "," << words.size() << "," << checks << "," << elapsed << ","
+         << (elapsed ? checks * 1000 / elapsed : 0) << ",,,\n";
+  stream.flush();
+}
+
+/* The same checks in one thread per core, all sharing the one
+   dictionary the way GUIClient::hunspell_check_text() shares it.
+ */
+void SpellBenchmark::checkThreads(QTextStream &stream, const QString &test, const QList<QByteArray> &words)
+{
+  if (words.isEmpty())
+    return;
+
+  // at least two so a single core still shows what sharing costs
+  int threads = qMax(2, QThread::idealThreadCount());
+
+  QList<SpellCheckThread*> workers;
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < threads; i++)
+  {
+    workers.append(new SpellCheckThread(_checker, words, i * words.size() / threads));
+    workers.last()->start();
+  }
+
+  qint64 checks = 0;
+  foreach (SpellCheckThread *worker, workers)
+  {
+    worker->wait();
+    checks += worker->checks;
+    delete worker;
+  }
+  qint64 elapsed = timer.elapsed();
+
+  stream << test << " " << threads << " threads," << words.size() << "," << checks << ","
+         << elapsed << "," << (elapsed ? checks * 1000 / elapsed : 0) << ",,,\n";
+  stream.flush();
+}
+
+/* Suggestions are slow enough to time one word at a time. The first
+   request also builds the suggestion index, so it gets its own line.
+ */
+void SpellBenchmark::suggest(QTextStream &stream, const QList<QByteArray> &words)
+{
+  if (words.isEmpty())
+    return;
+
+  int step = qMax(1, words.size() / MAXSUGGEST);
+  QList<QByteArray> sample;
+  for (int i = 0; i < words.size() && sample.size() < MAXSUGGEST; i += step)
+    sample.append(words.at(i));
+
+  QElapsedTimer timer;
+  QList<double> msecs;
+  qint64 total = 0;
+  for (int i = 0; i < sample.size(); i++)
+  {
+    char **suggestions = 0;
+    timer.start();
+    int count = _checker->suggest(&suggestions, sample.at(i).constData());
+    qint64 elapsed = timer.nsecsElapsed();
+    _checker->free_list(&suggestions, count);
+
+    if (i == 0)
+      stream << "suggest first,1,1," << elapsed / 1000000 << ",0,,,\n";
+    else
+    {
+      msecs.append(elapsed / 1000000.0);
+      total += elapsed;
+    }
+  }
+
+  if (! msecs.isEmpty())
+  {
+    qSort(msecs);
+    stream << "suggest," << msecs.size() << "," << msecs.size() << ","
+           << total / 1000000 << ","
+           << (total ? msecs.size() * Q_INT64_C(1000000000) / total : 0) << ","
+           << QString::number(msecs.at(msecs.size() / 2), 'f', 2) << ","
+           << QString::number(msecs.at((msecs.size() - 1) * 95 / 100), 'f', 2) << ","
+           << QString::number(msecs.last(), 'f', 2) << "\n";
+  }
+  stream.flush();
+}
+
+// the stems on every line after the word count, without flags or morphology
+QList<QByteArray> SpellBenchmark::dictionaryWords(const QString &dicfile)
+{
+  QList<QByteArray> words;
+  QFile file(dicfile);
+  if (! file.open(QIODevice::ReadOnly))
+    return words;
+
+  file.readLine();
+  while (! file.atEnd())
+  {
+    QByteArray line = file.readLine().trimmed();
+    int end = 0;
+    while (end < line.size() && line.at(end) != '/' && line.at(end) != '\t' && line.at(end) != ' ')
+      end++;
+    if (end > 0)
+      words.append(line.left(end));
+  }
+  return words;
+}
+
+QList<QByteArray> SpellBenchmark::textWords(const QString &filename, QTextCodec *codec)
+{
+  QList<QByteArray> words;
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return words;
+
+  QTextStream in(&file);
+  QStringList tokens = in.readAll().split(QRegExp("[^\\w']+"), QString::SkipEmptyParts);
+  foreach (QString token, tokens)
+  {
+    token.remove(QRegExp("^'+|'+$"));
+    if (! token.isEmpty() && ! token.at(0).isDigit())
+      words.append(codec->fromUnicode(token));
+  }
+  return words;
+}
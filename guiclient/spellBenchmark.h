@@ -0,0 +1,65 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SPELLBENCHMARK_H__
+#define __SPELLBENCHMARK_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class Hunspell;
+class QTextCodec;
+class QTextStream;
+
+/* Time the bundled spell checker without logging in.
+
+   Built only when qmake is run with CONFIG+=benchmarks. Started by main()
+   when that client is run with -spellBenchmark, or with
+   -spellBenchmark=<file> to also check the words of a text file such as
+   exported comments. The dictionary for the current locale is loaded the
+   same way the client loads it, then every word of the dictionary, the
+   same words with two letters swapped and the words of the file are
+   each checked repeatedly for about a second. The dictionary words and
+   the words of the file are then checked again by one thread per core,
+   at least two, sharing the dictionary. Finally suggestions are
+   requested once for each of a sample of misspellings, taken from the
+   file when it has any.
+
+   One CSV line per test goes to the file named by -benchmarkOutput=, or
+   to stdout, with the number of distinct words, the number of checks,
+   the elapsed time and the checks per second, and for suggestions the
+   median, 95th percentile and longest time for one word.
+ */
+class SpellBenchmark : public QObject
+{
+  Q_OBJECT
+
+  public:
+    SpellBenchmark(const QString &words, const QString &output, QObject *parent = 0);
+
+    int run();
+
+  private:
+    void check(QTextStream &stream, const QString &test, const QList<QByteArray> &words);
+    void checkThreads(QTextStream &stream, const QString &test, const QList<QByteArray> &words);
+    void suggest(QTextStream &stream, const QList<QByteArray> &words);
+
+    static QList<QByteArray> dictionaryWords(const QString &dicfile);
+    static QList<QByteArray> textWords(const QString &file, QTextCodec *codec);
+
+    Hunspell   *_checker;
+    QTextCodec *_codec;
+    QString     _output;
+    QString     _words;
+};
+
+#endif
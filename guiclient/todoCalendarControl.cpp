@@ -12,6 +12,7 @@
 #include "guiclient.h"
 #include <parameter.h>
 #include <QDebug>
+#include <QStringList>
 #include <metasql.h>
 
 #include "todoListCalendar.h"
@@ -24,11 +25,33 @@ todoCalendarControl::todoCalendarControl(todoListCalendar * parent)
 
 QString todoCalendarControl::contents(const QDate & date)
 {
-  QString sql = "SELECT sum(count) AS result "
+  return fetchContents(date, date).value(date);
+}
+
+/* The list filters change what gets counted, so they're part of the key. */
+QString todoCalendarControl::cacheKey() const
+{
+  ParameterList params;
+  if(_list)
+    _list->setParams(params);
+
+  QStringList key;
+  for (int i = 0; i < params.count(); i++)
+    key << params.name(i) + "=" + params.value(i).toString();
+  return key.join("&");
+}
+
+/* Count the to-do items and project tasks due on each day of the range
+   with one grouped query instead of one count query per day.
+ */
+QMap<QDate, QString> todoCalendarControl::fetchContents(const QDate & start, const QDate & end)
+{
+  QString sql = "SELECT due, sum(count) AS result "
                 " FROM ( "
-                "  SELECT count(*) "
+                "  SELECT todoitem_due_date AS due, count(*) "
                 "  FROM todoitem() "
-                " WHERE((todoitem_due_date = <? value(\"date\") ?>)"
+                " WHERE((todoitem_due_date BETWEEN <? value(\"startDate\") ?>"
+                "                              AND <? value(\"endDate\") ?>)"
                 "  <? if not exists(\"completed\") ?>"
                 "   AND (todoitem_status != 'C')"
                 "  <? endif ?>"
@@ -39,10 +62,12 @@ QString todoCalendarControl::contents(const QDate & date)
                 "  <? endif ?>"
                 "  <? if exists(\"active\") ?>AND (todoitem_active) <? endif ?>"
                 "       ) "
+                "  GROUP BY todoitem_due_date "
                 " UNION ALL "
-                "  SELECT count(*) "
+                "  SELECT prjtask_due_date AS due, count(*) "
                 "  FROM prjtask() "
-                " WHERE((prjtask_due_date = <? value(\"date\") ?>)"
+                " WHERE((prjtask_due_date BETWEEN <? value(\"startDate\") ?>"
+                "                             AND <? value(\"endDate\") ?>)"
                 "  <? if not exists(\"completed\") ?>"
                 "   AND (prjtask_status != 'C')"
                 "  <? endif ?>"
@@ -51,21 +76,24 @@ QString todoCalendarControl::contents(const QDate & date)
                 "  <? elseif exists(\"usr_pattern\") ?>"
                 "   AND (prjtask_username ~ <? value(\"usr_pattern\") ?>) "
                 "  <? endif ?>"
-                "       ) "    
-                " ) data;";     
+                "       ) "
+                "  GROUP BY prjtask_due_date "
+                " ) data"
+                " GROUP BY due;";
 
   ParameterList params;
-  params.append("date", date);
+  params.append("startDate", start);
+  params.append("endDate",   end);
   if(_list)
     _list->setParams(params);
 
+  QMap<QDate, QString> result;
   MetaSQLQuery mql(sql);
   XSqlQuery qry = mql.toQuery(params);
-  if(qry.first())
+  while(qry.next())
   {
-    if(qry.value(0).toInt() != 0)
-      return qry.value(0).toString();
+    if(qry.value("result").toInt() != 0)
+      result.insert(qry.value("due").toDate(), qry.value("result").toString());
   }
-  return QString::null;
+  return result;
 }
-
@@ -25,6 +25,9 @@ class todoCalendarControl : public CalendarControl
     QString contents(const QDate &);
 
   protected:
+    QString cacheKey() const;
+    QMap<QDate, QString> fetchContents(const QDate &start, const QDate &end);
+
     todoListCalendar *_list;
 };
 
@@ -35,6 +35,7 @@ todoListCalendar::todoListCalendar(QWidget* parent, const char * name, Qt::Windo
   setupUi(this);
 
   todoCalendarControl * cc = new todoCalendarControl(this);
+  cc->setPrefetchMonths(1);
   QGraphicsScene * scene = new QGraphicsScene(this);
   calendar = new CalendarGraphicsItem(cc);
   calendar->setSelectedDay(QDate::currentDate());
@@ -58,11 +59,11 @@ todoListCalendar::todoListCalendar(QWidget* parent, const char * name, Qt::Windo
     close();
   }
 
-  connect(_active, SIGNAL(toggled(bool)), this, SLOT(sFillList()));
-  connect(_completed, SIGNAL(toggled(bool)), this, SLOT(sFillList()));
+  connect(_active, SIGNAL(toggled(bool)), this, SLOT(sFilterChanged()));
+  connect(_completed, SIGNAL(toggled(bool)), this, SLOT(sFilterChanged()));
   connect(_list, SIGNAL(populateMenu(QMenu*, QTreeWidgetItem*, int)), this, SLOT(sPopulateMenu(QMenu*)));
   connect(_list, SIGNAL(itemSelectionChanged()), this, SLOT(handlePrivs()));
-  connect(_usr, SIGNAL(updated()), this, SLOT(sFillList()));
+  connect(_usr, SIGNAL(updated()), this, SLOT(sFilterChanged()));
   connect(_usr, SIGNAL(updated()), this, SLOT(handlePrivs()));
 
 
@@ -365,6 +366,14 @@ void todoListCalendar::setParams(ParameterList &params)
 }
 
 void todoListCalendar::sFillList()
+{
+  // the calendar counts may be stale now
+  if (calendar && calendar->calendarControl())
+    calendar->calendarControl()->invalidate();
+  sFillList(_lastDate);
+}
+
+void todoListCalendar::sFilterChanged()
 {
   sFillList(_lastDate);
 }
@@ -53,6 +53,7 @@ class todoListCalendar : public XWidget, public Ui::todoListCalendar
     CalendarGraphicsItem * calendar;
 
   protected slots:
+    void sFilterChanged();
     void sPopulateMenu(QMenu*);
 };
 
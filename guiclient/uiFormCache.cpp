@@ -0,0 +1,242 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "uiFormCache.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QSqlError>
+#include <QStringList>
+#include <QWidget>
+#include <QXmlInputSource>
+#include <QXmlSimpleReader>
+
+#include <xsqlquery.h>
+
+#include "xuiloader.h"
+
+#define DEBUG false
+
+QHash<QString, UiFormCache::Entry> UiFormCache::_entries;
+
+UiFormCache::UiFormCache(QObject *parent)
+  : QObject(parent)
+{
+  setObjectName("UiFormCache");
+}
+
+/*! \brief Create a widget from the named screen in the uiform table.
+
+  \param name   The uiform_name to look for
+  \param parent The parent of the new widget
+  \param errmsg Set to a description of the problem if 0 is returned
+  \param loader Used to build the widget if given, otherwise an XUiLoader
+
+  \return The new widget or 0 if the screen does not exist or cannot
+          be built
+ */
+QWidget *UiFormCache::build(const QString &name, QWidget *parent,
+                            QString *errmsg, QUiLoader *loader)
+{
+  Entry *entry = fetch(name, errmsg, 0);
+  if (! entry)
+    return 0;
+
+  XUiLoader  xloader;
+  QByteArray ba = entry->source;
+  QBuffer    uiFile(&ba);
+  if (! uiFile.open(QIODevice::ReadOnly))
+  {
+    if (errmsg)
+      *errmsg = tr("There was an error loading the UI Form from the database.");
+    return 0;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  QWidget *ui = (loader ? loader : &xloader)->load(&uiFile, parent);
+  qint64 elapsed = timer.elapsed();
+  uiFile.close();
+
+  entry->builds++;
+  entry->buildMsecs += elapsed;
+  if (elapsed > entry->maxBuildMsecs)
+    entry->maxBuildMsecs = elapsed;
+
+  if (DEBUG)
+    qDebug() << "UiFormCache built" << name << "in" << elapsed << "ms";
+
+  if (! ui && errmsg)
+    *errmsg = tr("There was an error creating a window from the UI Form. "
+                 "It may be empty or invalid.");
+  return ui;
+}
+
+/*! \brief Return the compacted source of the named screen, or an empty
+           QByteArray if there is no enabled screen with that name.
+
+  \param name    The uiform_name to look for
+  \param errmsg  Set to a description of the problem if nothing is returned
+  \param dberror Set to the database error if the lookup itself failed
+ */
+QByteArray UiFormCache::source(const QString &name, QString *errmsg,
+                               QSqlError *dberror)
+{
+  Entry *entry = fetch(name, errmsg, dberror);
+  return entry ? entry->source : QByteArray();
+}
+
+UiFormCache::Entry *UiFormCache::fetch(const QString &name, QString *errmsg,
+                                       QSqlError *dberror)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  XSqlQuery uiq;
+  uiq.prepare("SELECT md5(uiform_source) AS uiform_hash,"
+              "       CASE WHEN (md5(uiform_source) = :known) THEN NULL"
+              "            ELSE uiform_source END AS uiform_source"
+              "  FROM uiform"
+              " WHERE((uiform_name=:uiform_name)"
+              "   AND (uiform_enabled))"
+              " ORDER BY uiform_order DESC"
+              " LIMIT 1;");
+  uiq.bindValue(":known",       _entries.value(name).hash);
+  uiq.bindValue(":uiform_name", name);
+  uiq.exec();
+  if (! uiq.first())
+  {
+    _entries.remove(name);
+    if (uiq.lastError().type() != QSqlError::NoError)
+    {
+      qWarning() << "UiFormCache could not fetch" << name << uiq.lastError().text();
+      if (dberror)
+        *dberror = uiq.lastError();
+    }
+    if (errmsg)
+      *errmsg = tr("Could not create the '%1' form. Either an error occurred "
+                   "or the specified form does not exist.").arg(name);
+    return 0;
+  }
+
+  Entry  &entry = _entries[name];
+  QString hash  = uiq.value("uiform_hash").toString();
+  if (hash != entry.hash)
+  {
+    QByteArray original = uiq.value("uiform_source").toString().toUtf8();
+    entry.hash         = hash;
+    entry.source       = compact(original);
+    entry.originalSize = original.size();
+    entry.fetches++;
+
+    if (DEBUG)
+      qDebug() << "UiFormCache fetched" << name << original.size() << "bytes,"
+               << entry.source.size() << "after compacting";
+  }
+  entry.fetchMsecs += timer.elapsed();
+
+  return &entry;
+}
+
+static void compactElement(QDomElement elem)
+{
+  // whitespace between child elements is formatting; whitespace that is
+  // the whole content of an element, as in <string> </string>, is data
+  bool mixed = false;
+  for (QDomNode child = elem.firstChild(); ! child.isNull(); child = child.nextSibling())
+    if (child.isElement())
+      mixed = true;
+
+  QDomNode child = elem.firstChild();
+  while (! child.isNull())
+  {
+    QDomNode next = child.nextSibling();
+    if (child.isComment() || child.isProcessingInstruction())
+      elem.removeChild(child);
+    else if (mixed && child.isText() && child.nodeValue().trimmed().isEmpty())
+      elem.removeChild(child);
+    else if (child.isElement())
+    {
+      QString tag = child.toElement().tagName();
+      // hints and designerdata only matter to Designer
+      if (tag == "hints" || tag == "designerdata" || tag == "comment")
+        elem.removeChild(child);
+      else
+        compactElement(child.toElement());
+    }
+    child = next;
+  }
+}
+
+/* Parse the Designer XML once and write it back without the parts
+   QUiLoader ignores. Anything that does not parse is returned as is so
+   QUiLoader can report the problem.
+ */
+QByteArray UiFormCache::compact(const QByteArray &source)
+{
+  QDomDocument     doc;
+  QString          errmsg;
+  int              line   = 0;
+  int              column = 0;
+  QXmlInputSource  input;
+  QXmlSimpleReader reader;
+  input.setData(source);
+  // the same settings as QDomDocument::setContent(source) except that
+  // whitespace-only text is kept for compactElement() to sort out
+  reader.setFeature("http://xml.org/sax/features/namespaces", false);
+  reader.setFeature("http://xml.org/sax/features/namespace-prefixes", true);
+  reader.setFeature("http://trolltech.com/xml/features/report-whitespace-only-CharData", true);
+  if (! doc.setContent(&input, &reader, &errmsg, &line, &column))
+  {
+    if (DEBUG)
+      qDebug() << "UiFormCache could not parse source at" << line << column << errmsg;
+    return source;
+  }
+
+  compactElement(doc.documentElement());
+  return doc.toByteArray(-1);
+}
+
+/*! \brief Return a plain-text table of per-screen fetch and build times,
+           slowest first.
+ */
+QString UiFormCache::timingReport()
+{
+  QList<QPair<qint64, QString> > order;
+  QHashIterator<QString, Entry> it(_entries);
+  while (it.hasNext())
+  {
+    it.next();
+    order.append(qMakePair(it.value().fetchMsecs + it.value().buildMsecs, it.key()));
+  }
+  qSort(order.begin(), order.end(), qGreater<QPair<qint64, QString> >());
+
+  QStringList lines;
+  lines << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+             .arg("name", -30).arg("fetches", 8).arg("fetch ms", 10)
+             .arg("builds", 8).arg("build ms", 10).arg("max ms", 8)
+             .arg("bytes", 10).arg("compact", 10);
+  for (int i = 0; i < order.size(); i++)
+  {
+    const Entry &entry = _entries[order.at(i).second];
+    lines << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+               .arg(order.at(i).second, -30)
+               .arg(entry.fetches, 8).arg(entry.fetchMsecs, 10)
+               .arg(entry.builds, 8).arg(entry.buildMsecs, 10)
+               .arg(entry.maxBuildMsecs, 8)
+               .arg(entry.originalSize, 10).arg(entry.source.size(), 10);
+  }
+
+  return lines.join("\n");
+}
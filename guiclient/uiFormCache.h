@@ -0,0 +1,72 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UIFORMCACHE_H__
+#define __UIFORMCACHE_H__
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class QSqlError;
+class QUiLoader;
+class QWidget;
+
+/* Process-wide cache of the screens stored in the uiform table.
+
+   The first request for a screen reads the enabled row with the highest
+   uiform_order and reduces its Designer XML to a compact form: comments,
+   designer-only hints and all formatting whitespace are dropped, so later
+   builds hand QUiLoader a much smaller document.
+
+   Like ScriptCache, every request asks the server which row is current
+   and for the md5 of its source, and the source itself is only sent if
+   that differs from the cached copy. Screens changed by package imports,
+   the updater or plain SQL are therefore picked up on the next request.
+
+   Fetching and building are timed separately; timingReport() shows
+   where the time goes for each screen.
+ */
+class UiFormCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static QWidget *build(const QString &name, QWidget *parent = 0,
+                          QString *errmsg = 0, QUiLoader *loader = 0);
+    static QByteArray source(const QString &name, QString *errmsg = 0,
+                             QSqlError *dberror = 0);
+
+    static QString timingReport();
+
+  private:
+    UiFormCache(QObject *parent = 0);
+
+    struct Entry {
+      Entry() : fetches(0), builds(0), fetchMsecs(0), buildMsecs(0), maxBuildMsecs(0),
+                originalSize(0) {}
+      QString    hash;
+      QByteArray source;
+      int        fetches;
+      int        builds;
+      qint64     fetchMsecs;
+      qint64     buildMsecs;
+      qint64     maxBuildMsecs;
+      int        originalSize;
+    };
+
+    static Entry     *fetch(const QString &name, QString *errmsg, QSqlError *dberror);
+    static QByteArray compact(const QByteArray &source);
+
+    static QHash<QString, Entry> _entries;
+};
+
+#endif
@@ -14,6 +14,24 @@
 
 #include "csutil.hxx"
 
+#if defined(_MSC_VER)
+#define HUNSPELL_THREAD __declspec(thread)
+#else
+#define HUNSPELL_THREAD __thread
+#endif
+
+// what the last affix check matched, for its caller to look at; one copy
+// per thread so several threads can check words with one AffixMgr
+struct affixscratch {
+  const char * pfxappnd;   // previous prefix for counting the syllables of prefix
+  const char * sfxappnd;   // previous suffix for counting a special syllables
+  FLAG         sfxflag;
+  SfxEntry *   sfx;
+  PfxEntry *   pfx;
+};
+
+static HUNSPELL_THREAD struct affixscratch scratch;
+
 AffixMgr::AffixMgr(const char * affpath, HashMgr** ptr, int * md, const char * key) 
 {
   // register hash manager and load affix data from aff file
@@ -64,8 +82,6 @@ AffixMgr::AffixMgr(const char * affpath, HashMgr** ptr, int * md, const char * k
   cpdvowels=NULL; // vowels (for calculating of Hungarian compounding limit, O(n) search! XXX)
   cpdvowels_utf16=NULL; // vowels for UTF-8 encoding (bsearch instead of O(n) search)
   cpdvowels_utf16_len=0; // vowels
-  pfxappnd=NULL; // previous prefix for counting the syllables of prefix BUG
-  sfxappnd=NULL; // previous suffix for counting a special syllables BUG
   cpdsyllablenum=NULL; // syllable count incrementing flag
   checknum=0; // checking numbers, and word with numbers
   wordchars=NULL; // letters + spec. word characters
@@ -89,9 +105,6 @@ AffixMgr::AffixMgr(const char * affpath, HashMgr** ptr, int * md, const char * k
   substandard = FLAG_NULL;
   fullstrip = 0;
 
-  sfx = NULL;
-  pfx = NULL;
-
   for (int i=0; i < SETSIZE; i++) {
      pStart[i] = NULL;
      sStart[i] = NULL;
@@ -1051,9 +1064,9 @@ struct hentry * AffixMgr::prefix_check(const char * word, int len, char in_compo
 {
     struct hentry * rv= NULL;
 
-    pfx = NULL;
-    pfxappnd = NULL;
-    sfxappnd = NULL;
+    scratch.pfx = NULL;
+    scratch.pfxappnd = NULL;
+    scratch.sfxappnd = NULL;
     
     // first handle the special case of 0 length prefixes
     PfxEntry * pe = pStart[0];
@@ -1069,7 +1082,7 @@ struct hentry * AffixMgr::prefix_check(const char * word, int len, char in_compo
                     // check prefix
                     rv = pe->checkword(word, len, in_compound, needflag);
                     if (rv) {
-                        pfx=pe; // BUG: pfx not stateless
+                        scratch.pfx=pe;
                         return rv;
                     }
              }
@@ -1093,7 +1106,7 @@ struct hentry * AffixMgr::prefix_check(const char * word, int len, char in_compo
             // check prefix
                   rv = pptr->checkword(word, len, in_compound, needflag);
                   if (rv) {
-                    pfx=pptr; // BUG: pfx not stateless
+                    scratch.pfx=pptr;
                     return rv;
                   }
              }
@@ -1112,8 +1125,8 @@ struct hentry * AffixMgr::prefix_check_twosfx(const char * word, int len,
 {
     struct hentry * rv= NULL;
 
-    pfx = NULL;
-    sfxappnd = NULL;
+    scratch.pfx = NULL;
+    scratch.sfxappnd = NULL;
     
     // first handle the special case of 0 length prefixes
     PfxEntry * pe = pStart[0];
@@ -1132,7 +1145,7 @@ struct hentry * AffixMgr::prefix_check_twosfx(const char * word, int len,
         if (isSubset(pptr->getKey(),word)) {
             rv = pptr->check_twosfx(word, len, in_compound, needflag);
             if (rv) {
-                pfx = pptr;
+                scratch.pfx = pptr;
                 return rv;
             }
             pptr = pptr->getNextEQ();
@@ -1153,8 +1166,8 @@ char * AffixMgr::prefix_check_morph(const char * word, int len, char in_compound
     char result[MAXLNLEN];
     result[0] = '\0';
 
-    pfx = NULL;
-    sfxappnd = NULL;
+    scratch.pfx = NULL;
+    scratch.sfxappnd = NULL;
     
     // first handle the special case of 0 length prefixes
     PfxEntry * pe = pStart[0];
@@ -1180,7 +1193,7 @@ char * AffixMgr::prefix_check_morph(const char * word, int len, char in_compound
               if ((in_compound != IN_CPD_NOT) || !((pptr->getCont() && 
                         (TESTAFF(pptr->getCont(), onlyincompound, pptr->getContLen()))))) {
                     mystrcat(result, st, MAXLNLEN);
-                    pfx = pptr;
+                    scratch.pfx = pptr;
                 }
                 free(st);
             }
@@ -1204,8 +1217,8 @@ char * AffixMgr::prefix_check_twosfx_morph(const char * word, int len,
     char result[MAXLNLEN];
     result[0] = '\0';
 
-    pfx = NULL;
-    sfxappnd = NULL;
+    scratch.pfx = NULL;
+    scratch.sfxappnd = NULL;
     
     // first handle the special case of 0 length prefixes
     PfxEntry * pe = pStart[0];
@@ -1228,7 +1241,7 @@ char * AffixMgr::prefix_check_twosfx_morph(const char * word, int len,
             if (st) {
                 mystrcat(result, st, MAXLNLEN);
                 free(st);
-                pfx = pptr;
+                scratch.pfx = pptr;
             }
             pptr = pptr->getNextEQ();
         } else {
@@ -1529,8 +1542,8 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
         ch = st[i];
         st[i] = '\0';
 
-        sfx = NULL;
-        pfx = NULL;
+        scratch.sfx = NULL;
+        scratch.pfx = NULL;
 
         // FIRST WORD
 
@@ -1558,11 +1571,11 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
              !(rv = prefix_check(st, i, hu_mov_rule ? IN_CPD_OTHER : IN_CPD_BEGIN, compoundflag))) {
                 if ((rv = suffix_check(st, i, 0, NULL, NULL, 0, NULL,
                         FLAG_NULL, compoundflag, hu_mov_rule ? IN_CPD_OTHER : IN_CPD_BEGIN)) && !hu_mov_rule &&
-                    sfx->getCont() &&
-                        ((compoundforbidflag && TESTAFF(sfx->getCont(), compoundforbidflag, 
-                            sfx->getContLen())) || (compoundend &&
-                        TESTAFF(sfx->getCont(), compoundend, 
-                            sfx->getContLen())))) {
+                    scratch.sfx->getCont() &&
+                        ((compoundforbidflag && TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                            scratch.sfx->getContLen())) || (compoundend &&
+                        TESTAFF(scratch.sfx->getCont(), compoundend, 
+                            scratch.sfx->getContLen())))) {
                         rv = NULL;
                 }
             }
@@ -1586,34 +1599,34 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
 
             // check non_compound flag in suffix and prefix
             if ((rv) && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundforbidflag, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundforbidflag, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundforbidflag, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }
 
             // check compoundend flag in suffix and prefix
             if ((rv) && !checked_prefix && compoundend && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundend, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundend, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundend, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundend, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }
 
             // check compoundmiddle flag in suffix and prefix
             if ((rv) && !checked_prefix && (wordnum==0) && compoundmiddle && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundmiddle, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundmiddle, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundmiddle, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundmiddle, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }
 
@@ -1663,9 +1676,9 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
          )
 // LANG_hu section: spec. Hungarian rule
          || ((!rv) && (langnum == LANG_hu) && hu_mov_rule && (rv = affix_check(st,i)) &&
-              (sfx && sfx->getCont() && ( // XXX hardwired Hungarian dic. codes
-                        TESTAFF(sfx->getCont(), (unsigned short) 'x', sfx->getContLen()) ||
-                        TESTAFF(sfx->getCont(), (unsigned short) '%', sfx->getContLen())
+              (scratch.sfx && scratch.sfx->getCont() && ( // XXX hardwired Hungarian dic. codes
+                        TESTAFF(scratch.sfx->getCont(), (unsigned short) 'x', scratch.sfx->getContLen()) ||
+                        TESTAFF(scratch.sfx->getCont(), (unsigned short) '%', scratch.sfx->getContLen())
                     )
                )
              )
@@ -1677,7 +1690,7 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
                 numsyllable += get_syllable(st, i);
 
                 // + 1 word, if syllable number of the prefix > 1 (hungarian convention)
-                if (pfx && (get_syllable(pfx->getKey(),strlen(pfx->getKey())) > 1)) wordnum++;
+                if (scratch.pfx && (get_syllable(scratch.pfx->getKey(),strlen(scratch.pfx->getKey())) > 1)) wordnum++;
             }
 // END of LANG_hu section
 
@@ -1765,12 +1778,12 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
             wordnum = oldwordnum2;
 
             // perhaps second word has prefix or/and suffix
-            sfx = NULL;
-            sfxflag = FLAG_NULL;
+            scratch.sfx = NULL;
+            scratch.sfxflag = FLAG_NULL;
             rv = (compoundflag) ? affix_check((word+i),strlen(word+i), compoundflag, IN_CPD_END) : NULL;
             if (!rv && compoundend) {
-                sfx = NULL;
-                pfx = NULL;
+                scratch.sfx = NULL;
+                scratch.pfx = NULL;
                 rv = affix_check((word+i),strlen(word+i), compoundend, IN_CPD_END);
             }
 
@@ -1789,12 +1802,12 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
 
             // check non_compound flag in suffix and prefix
             if ((rv) && 
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundforbidflag, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundforbidflag, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundforbidflag, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }
 
@@ -1802,7 +1815,7 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
             if ((rv) && (rv->astr) && (TESTAFF(rv->astr, forbiddenword, rv->alen) ||
                (is_sug && nosuggest && TESTAFF(rv->astr, nosuggest, rv->alen)))) return NULL;
 
-            // pfxappnd = prefix of word+i, or NULL
+            // scratch.pfxappnd = prefix of word+i, or NULL
             // calculate syllable number of prefix.
             // hungarian convention: when syllable number of prefix is more,
             // than 1, the prefix+word counts as two words.
@@ -1813,20 +1826,20 @@ struct hentry * AffixMgr::compound_check(const char * word, int len,
 
                 // - affix syllable num.
                 // XXX only second suffix (inflections, not derivations)
-                if (sfxappnd) {
-                    char * tmp = myrevstrdup(sfxappnd);
+                if (scratch.sfxappnd) {
+                    char * tmp = myrevstrdup(scratch.sfxappnd);
                     numsyllable -= get_syllable(tmp, strlen(tmp));
                     free(tmp);
                 }
 
                 // + 1 word, if syllable number of the prefix > 1 (hungarian convention)
-                if (pfx && (get_syllable(pfx->getKey(),strlen(pfx->getKey())) > 1)) wordnum++;
+                if (scratch.pfx && (get_syllable(scratch.pfx->getKey(),strlen(scratch.pfx->getKey())) > 1)) wordnum++;
 
                 // increment syllable num, if last word has a SYLLABLENUM flag
                 // and the suffix is beginning `s'
 
                 if (cpdsyllablenum) {
-                    switch (sfxflag) {
+                    switch (scratch.sfxflag) {
                         case 'c': { numsyllable+=2; break; }
                         case 'J': { numsyllable += 1; break; }
                         case 'I': { if (TESTAFF(rv->astr, 'J', rv->alen)) numsyllable += 1; break; }
@@ -1949,7 +1962,7 @@ int AffixMgr::compound_check_morph(const char * word, int len,
 
         ch = st[i];
         st[i] = '\0';
-        sfx = NULL;
+        scratch.sfx = NULL;
 
         // FIRST WORD
         *presult = '\0';
@@ -1988,11 +2001,11 @@ int AffixMgr::compound_check_morph(const char * word, int len,
              !(rv = prefix_check(st, i, hu_mov_rule ? IN_CPD_OTHER : IN_CPD_BEGIN, compoundflag))) {
                 if ((rv = suffix_check(st, i, 0, NULL, NULL, 0, NULL,
                         FLAG_NULL, compoundflag, hu_mov_rule ? IN_CPD_OTHER : IN_CPD_BEGIN)) && !hu_mov_rule &&
-                    sfx->getCont() &&
-                        ((compoundforbidflag && TESTAFF(sfx->getCont(), compoundforbidflag, 
-                            sfx->getContLen())) || (compoundend &&
-                        TESTAFF(sfx->getCont(), compoundend, 
-                            sfx->getContLen())))) {
+                    scratch.sfx->getCont() &&
+                        ((compoundforbidflag && TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                            scratch.sfx->getContLen())) || (compoundend &&
+                        TESTAFF(scratch.sfx->getCont(), compoundend, 
+                            scratch.sfx->getContLen())))) {
                         rv = NULL;
                 }
             }
@@ -2033,34 +2046,34 @@ int AffixMgr::compound_check_morph(const char * word, int len,
 
             // check non_compound flag in suffix and prefix
             if ((rv) && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundforbidflag, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundforbidflag, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundforbidflag, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                        scratch.sfx->getContLen())))) {
                     continue;
             }
 
             // check compoundend flag in suffix and prefix
             if ((rv) && !checked_prefix && compoundend && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundend, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundend, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundend, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundend, 
+                        scratch.sfx->getContLen())))) {
                     continue;
             }
 
             // check compoundmiddle flag in suffix and prefix
             if ((rv) && !checked_prefix && (wordnum==0) && compoundmiddle && !hu_mov_rule &&
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundmiddle, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundmiddle, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundmiddle, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundmiddle, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }       
 
@@ -2105,9 +2118,9 @@ int AffixMgr::compound_check_morph(const char * word, int len,
          )
 // LANG_hu section: spec. Hungarian rule
          || ((!rv) && (langnum == LANG_hu) && hu_mov_rule && (rv = affix_check(st,i)) &&
-              (sfx && sfx->getCont() && (
-                        TESTAFF(sfx->getCont(), (unsigned short) 'x', sfx->getContLen()) ||
-                        TESTAFF(sfx->getCont(), (unsigned short) '%', sfx->getContLen())
+              (scratch.sfx && scratch.sfx->getCont() && (
+                        TESTAFF(scratch.sfx->getCont(), (unsigned short) 'x', scratch.sfx->getContLen()) ||
+                        TESTAFF(scratch.sfx->getCont(), (unsigned short) '%', scratch.sfx->getContLen())
                     )                
                )
              )
@@ -2120,7 +2133,7 @@ int AffixMgr::compound_check_morph(const char * word, int len,
                 numsyllable += get_syllable(st, i);
 
                 // + 1 word, if syllable number of the prefix > 1 (hungarian convention)
-                if (pfx && (get_syllable(pfx->getKey(),strlen(pfx->getKey())) > 1)) wordnum++;
+                if (scratch.pfx && (get_syllable(scratch.pfx->getKey(),strlen(scratch.pfx->getKey())) > 1)) wordnum++;
             }
 // END of LANG_hu section
 
@@ -2224,14 +2237,14 @@ int AffixMgr::compound_check_morph(const char * word, int len,
             wordnum = oldwordnum2;
 
             // perhaps second word has prefix or/and suffix
-            sfx = NULL;
-            sfxflag = FLAG_NULL;
+            scratch.sfx = NULL;
+            scratch.sfxflag = FLAG_NULL;
 
             if (compoundflag) rv = affix_check((word+i),strlen(word+i), compoundflag); else rv = NULL;
 
             if (!rv && compoundend) {
-                sfx = NULL;
-                pfx = NULL;
+                scratch.sfx = NULL;
+                scratch.pfx = NULL;
                 rv = affix_check((word+i),strlen(word+i), compoundend);
             }
 
@@ -2257,12 +2270,12 @@ int AffixMgr::compound_check_morph(const char * word, int len,
 
             // check non_compound flag in suffix and prefix
             if ((rv) && 
-                ((pfx && pfx->getCont() &&
-                    TESTAFF(pfx->getCont(), compoundforbidflag, 
-                        pfx->getContLen())) ||
-                (sfx && sfx->getCont() &&
-                    TESTAFF(sfx->getCont(), compoundforbidflag, 
-                        sfx->getContLen())))) {
+                ((scratch.pfx && scratch.pfx->getCont() &&
+                    TESTAFF(scratch.pfx->getCont(), compoundforbidflag, 
+                        scratch.pfx->getContLen())) ||
+                (scratch.sfx && scratch.sfx->getCont() &&
+                    TESTAFF(scratch.sfx->getCont(), compoundforbidflag, 
+                        scratch.sfx->getContLen())))) {
                     rv = NULL;
             }
 
@@ -2279,20 +2292,20 @@ int AffixMgr::compound_check_morph(const char * word, int len,
 
                 // - affix syllable num.
                 // XXX only second suffix (inflections, not derivations)
-                if (sfxappnd) {
-                    char * tmp = myrevstrdup(sfxappnd);
+                if (scratch.sfxappnd) {
+                    char * tmp = myrevstrdup(scratch.sfxappnd);
                     numsyllable -= get_syllable(tmp, strlen(tmp));
                     free(tmp);
                 }
 
                 // + 1 word, if syllable number of the prefix > 1 (hungarian convention)
-                if (pfx && (get_syllable(pfx->getKey(),strlen(pfx->getKey())) > 1)) wordnum++;
+                if (scratch.pfx && (get_syllable(scratch.pfx->getKey(),strlen(scratch.pfx->getKey())) > 1)) wordnum++;
 
                 // increment syllable num, if last word has a SYLLABLENUM flag
                 // and the suffix is beginning `s'
 
                 if (cpdsyllablenum) {
-                    switch (sfxflag) {
+                    switch (scratch.sfxflag) {
                         case 'c': { numsyllable+=2; break; }
                         case 'J': { numsyllable += 1; break; }
                         case 'I': { if (rv && TESTAFF(rv->astr, 'J', rv->alen)) numsyllable += 1; break; }
@@ -2415,7 +2428,7 @@ struct hentry * AffixMgr::suffix_check (const char * word, int len,
                 rv = se->checkword(word,len, sfxopts, ppfx, wlst, maxSug, ns, (FLAG) cclass, 
                     needflag, (in_compound ? 0 : onlyincompound));
                 if (rv) {
-                    sfx=se; // BUG: sfx not stateless
+                    scratch.sfx=se;
                     return rv;
                 }
             }
@@ -2457,9 +2470,9 @@ struct hentry * AffixMgr::suffix_check (const char * word, int len,
                 rv = sptr->checkword(word,len, sfxopts, ppfx, wlst,
                     maxSug, ns, cclass, needflag, (in_compound ? 0 : onlyincompound));
                 if (rv) {
-                    sfx=sptr; // BUG: sfx not stateless
-                    sfxflag = sptr->getFlag(); // BUG: sfxflag not stateless
-                    if (!sptr->getCont()) sfxappnd=sptr->getKey(); // BUG: sfxappnd not stateless
+                    scratch.sfx=sptr;
+                    scratch.sfxflag = sptr->getFlag();
+                    if (!sptr->getCont()) scratch.sfxappnd=sptr->getKey();
                     return rv;
                 }
              }
@@ -2500,8 +2513,8 @@ struct hentry * AffixMgr::suffix_check_twosfx(const char * word, int len,
             {
                 rv = sptr->check_twosfx(word,len, sfxopts, ppfx, needflag);
                 if (rv) {
-                    sfxflag = sptr->getFlag(); // BUG: sfxflag not stateless
-                    if (!sptr->getCont()) sfxappnd=sptr->getKey(); // BUG: sfxappnd not stateless
+                    scratch.sfxflag = sptr->getFlag();
+                    if (!sptr->getCont()) scratch.sfxappnd=sptr->getKey();
                     return rv;
                 }
             }
@@ -2562,8 +2575,8 @@ char * AffixMgr::suffix_check_twosfx_morph(const char * word, int len,
             {
                 st = sptr->check_twosfx_morph(word,len, sfxopts, ppfx, needflag);
                 if (st) {
-                    sfxflag = sptr->getFlag(); // BUG: sfxflag not stateless
-                    if (!sptr->getCont()) sfxappnd=sptr->getKey(); // BUG: sfxappnd not stateless
+                    scratch.sfxflag = sptr->getFlag();
+                    if (!sptr->getCont()) scratch.sfxappnd=sptr->getKey();
                     strcpy(result2, st);
                     free(st);
 
@@ -2736,8 +2749,8 @@ struct hentry * AffixMgr::affix_check (const char * word, int len, const FLAG ne
     rv = suffix_check(word, len, 0, NULL, NULL, 0, NULL, FLAG_NULL, needflag, in_compound);
 
     if (havecontclass) {
-        sfx = NULL;
-        pfx = NULL;
+        scratch.sfx = NULL;
+        scratch.pfx = NULL;
         if (rv) return rv;
         // if still not found check all two-level suffixes
         rv = suffix_check_twosfx(word, len, 0, NULL, needflag);
@@ -2771,8 +2784,8 @@ char * AffixMgr::affix_check_morph(const char * word, int len, const FLAG needfl
     }
 
     if (havecontclass) {
-        sfx = NULL;
-        pfx = NULL;
+        scratch.sfx = NULL;
+        scratch.pfx = NULL;
         // if still not found check all two-level suffixes
         st = suffix_check_twosfx_morph(word, len, 0, NULL, needflag);
         if (st) {
@@ -3199,14 +3212,14 @@ int AffixMgr::get_checknum() const
 // return the value of prefix
 const char * AffixMgr::get_prefix() const
 {
-  if (pfx) return pfx->getKey();
+  if (scratch.pfx) return scratch.pfx->getKey();
   return NULL;
 }
 
 // return the value of suffix
 const char * AffixMgr::get_suffix() const
 {
-  return sfxappnd;
+  return scratch.sfxappnd;
 }
 
 // return the value of suffix
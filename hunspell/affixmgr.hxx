@@ -73,12 +73,7 @@ class LIBHUNSPELL_DLL_EXPORTED AffixMgr
   w_char *            cpdvowels_utf16;
   int                 cpdvowels_utf16_len;
   char *              cpdsyllablenum;
-  const char *        pfxappnd; // BUG: not stateless
-  const char *        sfxappnd; // BUG: not stateless
-  FLAG                sfxflag;  // BUG: not stateless
   char *              derived;  // BUG: not stateless
-  SfxEntry *          sfx;      // BUG: not stateless
-  PfxEntry *          pfx;      // BUG: not stateless
   int                 checknum;
   char *              wordchars;
   unsigned short *    wordchars_utf16;
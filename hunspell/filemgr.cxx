@@ -7,6 +7,14 @@
 
 #include "filemgr.hxx"
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HUNSPELL_MMAP
+#endif
+
 int FileMgr::fail(const char * err, const char * par) {
     fprintf(stderr, err, par);
     return -1;
@@ -15,6 +23,28 @@ int FileMgr::fail(const char * err, const char * par) {
 FileMgr::FileMgr(const char * file, const char * key) {
     linenum = 0;
     hin = NULL;
+    fin = NULL;
+    map = NULL;
+    mapsize = 0;
+    mappos = 0;
+#ifdef HUNSPELL_MMAP
+    // map plain files so large dictionaries are paged in by the kernel
+    // instead of being copied through stdio buffers
+    int fd = open(file, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void * p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                map = (char *) p;
+                mapsize = st.st_size;
+                madvise(p, mapsize, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if (map) return;
+    }
+#endif
     fin = fopen(file, "r");
     if (!fin) {
         // check hzipped file
@@ -31,6 +61,9 @@ FileMgr::FileMgr(const char * file, const char * key) {
 
 FileMgr::~FileMgr()
 {
+#ifdef HUNSPELL_MMAP
+    if (map) munmap(map, mapsize);
+#endif
     if (fin) fclose(fin);
     if (hin) delete hin;
 }
@@ -38,6 +71,17 @@ FileMgr::~FileMgr()
 char * FileMgr::getline() {
     const char * l;
     linenum++;
+    if (map && mappos < mapsize) {
+        // same semantics as fgets(in, BUFSIZE - 1, fin)
+        size_t len = mapsize - mappos;
+        if (len > BUFSIZE - 2) len = BUFSIZE - 2;
+        const char * nl = (const char *) memchr(map + mappos, '\n', len);
+        if (nl) len = nl - (map + mappos) + 1;
+        memcpy(in, map + mappos, len);
+        in[len] = '\0';
+        mappos += len;
+        return in;
+    }
     if (fin) return fgets(in, BUFSIZE - 1, fin);
     if (hin && (l = hin->getline())) return strcpy(in, l);
     linenum--;
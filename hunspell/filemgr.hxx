@@ -12,6 +12,9 @@ class LIBHUNSPELL_DLL_EXPORTED FileMgr
 protected:
     FILE * fin;
     Hunzip * hin;
+    char * map;            // memory mapped file, read in place when available
+    size_t mapsize;
+    size_t mappos;
     char in[BUFSIZE + 50]; // input buffer
     int fail(const char * err, const char * par);
     int linenum;
@@ -6,16 +6,51 @@
 #include <stdio.h> 
 #include <ctype.h>
 
+#include <stddef.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#define HUNSPELL_MMAP
+#endif
+
 #include "hashmgr.hxx"
 #include "csutil.hxx"
 #include "atypes.hxx"
 
+// entries are carved out of blocks of at least this many bytes
+#define ARENABLOCK   (256 * 1024)
+#define ARENAALIGN(n) (((n) + 7) & ~((size_t) 7))
+
+// the table grows when more than MAXLOAD percent of its slots are used
+#define MAXLOAD      70
+
+// release every arena block; each one starts with a link to the previous
+static void free_arena(char * arena)
+{
+  while (arena) {
+    char * prev;
+    memcpy(&prev, arena, sizeof(char *));
+    free(arena);
+    arena = prev;
+  }
+}
+
 // build a hash table from a munched word list
 
-HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
+HashMgr::HashMgr(const char * tpath, const char * apath, const char * key,
+  const char * ipath)
 {
   tablesize = 0;
+  tablecount = 0;
   tableptr = NULL;
+  wordptr = NULL;
+  wordalloc = 0;
+  arena = NULL;
+  arenanext = NULL;
+  arenaleft = 0;
   flag_mode = FLAG_CHAR;
   complexprefixes = 0;
   utf8 = 0;
@@ -30,17 +65,26 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
   aliasf = NULL;
   numaliasm = 0;
   aliasm = NULL;
+  image = NULL;
+  imagesize = 0;
+  imagemapped = 0;
+  modified = 0;
   forbiddenword = FORBIDDENWORD; // forbidden word signing flag
   load_config(apath, key);
-  int ec = load_tables(tpath, key);
+  int ec = 0;
+  if (key || !ipath || load_image(ipath, tpath, apath)) ec = load_tables(tpath, key);
   if (ec) {
     /* error condition - what should we do here */
     HUNSPELL_WARNING(stderr, "Hash Manager Error : %d\n",ec);
-    if (tableptr) {
-      free(tableptr);
-      tableptr = NULL;
-    }
+    if (tableptr && !in_image(tableptr)) free(tableptr);
+    tableptr = NULL;
+    if (wordptr && !in_image(wordptr)) free(wordptr);
+    wordptr = NULL;
+    wordalloc = 0;
+    free_arena(arena);
+    arena = NULL;
     tablesize = 0;
+    tablecount = 0;
   }
 }
 
@@ -48,22 +92,30 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
 HashMgr::~HashMgr()
 {
   if (tableptr) {
-    // now pass through hash table freeing up everything
-    // go through column by column of the table
+    // now pass through hash table freeing up the flag vectors;
+    // the entries themselves go with the arena or the image
     for (int i=0; i < tablesize; i++) {
-      struct hentry * pt = tableptr[i];
-      struct hentry * nt = NULL;
-      while(pt) {
-        nt = pt->next;
-        if (pt->astr && (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen))) free(pt->astr);
-        free(pt);
-        pt = nt;
+      for (struct hentry * pt = tableptr[i].entry; pt; pt = pt->next_homonym) {
+        if (pt->astr && !in_image(pt->astr) &&
+            (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen))) free(pt->astr);
       }
     }
-    free(tableptr);
+    if (!in_image(tableptr)) free(tableptr);
   }
+  if (wordptr && !in_image(wordptr)) free(wordptr);
+  free_arena(arena);
+  arena = NULL;
   tablesize = 0;
 
+  if (image) {
+#ifdef HUNSPELL_MMAP
+    if (imagemapped) munmap(image, imagesize);
+    else
+#endif
+    free(image);
+    image = NULL;
+  }
+
   if (aliasf) {
     for (int j = 0; j < (numaliasf); j++) free(aliasf[j]);
     free(aliasf);
@@ -100,26 +152,105 @@ HashMgr::~HashMgr()
 
 struct hentry * HashMgr::lookup(const char *word) const
 {
-    struct hentry * dp;
     if (tableptr) {
-       dp = tableptr[hash(word)];
-       if (!dp) return NULL;
-       for (  ;  dp != NULL;  dp = dp->next) {
-          if (strcmp(word, dp->word) == 0) return dp;
+       // linear probing; the stored hash rules out most slots without
+       // touching the entry
+       unsigned int h = hash(word);
+       unsigned int mask = tablesize - 1;
+       for (unsigned int i = h & mask; tableptr[i].entry; i = (i + 1) & mask) {
+          if (tableptr[i].fp == h && strcmp(word, tableptr[i].entry->word) == 0)
+             return tableptr[i].entry;
        }
     }
     return NULL;
 }
 
+// allocate the slots for about words words
+int HashMgr::init_table(int words)
+{
+    tablesize = 16;
+    while (tablesize < words * 100 / MAXLOAD + 1) tablesize *= 2;
+    tablecount = 0;
+    tableptr = (struct hslot *) calloc(tablesize, sizeof(struct hslot));
+    wordalloc = words > 0 ? words : 1;
+    wordptr = (struct hentry **) malloc(wordalloc * sizeof(struct hentry *));
+    if (!tableptr || !wordptr) {
+        free(tableptr);
+        free(wordptr);
+        tableptr = NULL;
+        wordptr = NULL;
+        tablesize = 0;
+        wordalloc = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// double the slots; entries stay where they are
+int HashMgr::grow_table()
+{
+    int newsize = tablesize * 2;
+    struct hslot * newtable = (struct hslot *) calloc(newsize, sizeof(struct hslot));
+    if (!newtable) return 1;
+    unsigned int mask = newsize - 1;
+    for (int i = 0; i < tablesize; i++) {
+        if (!tableptr[i].entry) continue;
+        unsigned int j = tableptr[i].fp & mask;
+        while (newtable[j].entry) j = (j + 1) & mask;
+        newtable[j] = tableptr[i];
+    }
+    if (!in_image(tableptr)) free(tableptr);
+    tableptr = newtable;
+    tablesize = newsize;
+    return 0;
+}
+
+// remember a new word for walk_hashtable(); the list in an image is
+// copied out the first time a word is added to it
+int HashMgr::append_word(struct hentry * hp)
+{
+    if (tablecount >= wordalloc || in_image(wordptr)) {
+        int newalloc = tablecount >= wordalloc ? wordalloc * 2 + 16 : wordalloc;
+        struct hentry ** newptr = (struct hentry **) malloc(newalloc * sizeof(struct hentry *));
+        if (!newptr) return 1;
+        if (tablecount) memcpy(newptr, wordptr, tablecount * sizeof(struct hentry *));
+        if (!in_image(wordptr)) free(wordptr);
+        wordptr = newptr;
+        wordalloc = newalloc;
+    }
+    wordptr[tablecount] = hp;
+    return 0;
+}
+
+// carve an entry out of the current arena block, starting a new one if needed
+struct hentry * HashMgr::alloc_entry(size_t size)
+{
+    size = ARENAALIGN(size);
+    if (size > arenaleft) {
+        size_t header = ARENAALIGN(sizeof(char *));
+        size_t blocksize = size + header > ARENABLOCK ? size + header : ARENABLOCK;
+        char * block = (char *) malloc(blocksize);
+        if (!block) return NULL;
+        memcpy(block, &arena, sizeof(char *));
+        arena = block;
+        arenanext = block + header;
+        arenaleft = blocksize - header;
+    }
+    struct hentry * hp = (struct hentry *) arenanext;
+    arenanext += size;
+    arenaleft -= size;
+    return hp;
+}
+
 // add a word to the hash table (private)
 int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
     int al, const char * desc, bool onlyupcase)
 {
-    bool upcasehomonym = false;
     int descl = desc ? (aliasm ? sizeof(short) : strlen(desc) + 1) : 0;
+    if (!tableptr && init_table(USERWORD)) return 1;
     // variable-length hash record with word and optional fields
-    struct hentry* hp = 
-	(struct hentry *) malloc (sizeof(struct hentry) + wbl + descl);
+    size_t size = sizeof(struct hentry) + wbl + descl;
+    struct hentry* hp = alloc_entry(size);
     if (!hp) return 1;
     char * hpw = hp->word;
     strcpy(hpw, word);
@@ -134,13 +265,12 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
         if (utf8) reverseword_utf(hpw); else reverseword(hpw);
     }
 
-    int i = hash(hpw);
+    unsigned int h = hash(hpw);
 
     hp->blen = (unsigned char) wbl;
     hp->clen = (unsigned char) wcl;
     hp->alen = (short) al;
     hp->astr = aff;
-    hp->next = NULL;      
     hp->next_homonym = NULL;
 
     // store the description string or its pointer
@@ -159,54 +289,57 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
 	if (strstr(HENTRY_DATA(hp), MORPH_PHON)) hp->var += H_OPT_PHON;
     } else hp->var = 0;
 
-       struct hentry * dp = tableptr[i];
-       if (!dp) {
-         tableptr[i] = hp;
-         return 0;
-       }
-       while (dp->next != NULL) {
-         if ((!dp->next_homonym) && (strcmp(hp->word, dp->word) == 0)) {
-    	    // remove hidden onlyupcase homonym
-            if (!onlyupcase) {
-		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
-		    dp->astr = hp->astr;
-		    dp->alen = hp->alen;
-		    free(hp);
-		    return 0;
-		} else {
-    		    dp->next_homonym = hp;
-    		}
-            } else {
-        	upcasehomonym = true;
-            }
-         }
-         dp=dp->next;
-       }
-       if (strcmp(hp->word, dp->word) == 0) {
-    	    // remove hidden onlyupcase homonym
-            if (!onlyupcase) {
-		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
-		    dp->astr = hp->astr;
-		    dp->alen = hp->alen;
-		    free(hp);
-		    return 0;
-		} else {
-    		    dp->next_homonym = hp;
-    		}
-            } else {
-        	upcasehomonym = true;
-            }
-       }
-       if (!upcasehomonym) {
-    	    dp->next = hp;
-       } else {
-    	    // remove hidden onlyupcase homonym
-    	    if (hp->astr) free(hp->astr);
-    	    free(hp);
-       }
+    if ((tablecount + 1) * 100 > tablesize * MAXLOAD && grow_table()) {
+        release_entry(hp, size);
+        return 1;
+    }
+
+    // find the slot holding this word, or the empty one it belongs in
+    unsigned int mask = tablesize - 1;
+    unsigned int i = h & mask;
+    while (tableptr[i].entry &&
+           (tableptr[i].fp != h || strcmp(hpw, tableptr[i].entry->word) != 0))
+        i = (i + 1) & mask;
+    if (!tableptr[i].entry) {
+        if (append_word(hp)) {
+            release_entry(hp, size);
+            return 1;
+        }
+        tableptr[i].fp = h;
+        tableptr[i].entry = hp;
+        tablecount++;
+        return 0;
+    }
+
+    // a known word: the new entry becomes its last homonym
+    struct hentry * dp = tableptr[i].entry;
+    while (dp->next_homonym) dp = dp->next_homonym;
+    if (!onlyupcase) {
+        // remove hidden onlyupcase homonym
+        if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
+            if (!in_image(dp->astr)) free(dp->astr);
+            dp->astr = hp->astr;
+            dp->alen = hp->alen;
+            release_entry(hp, size);
+            return 0;
+        }
+        dp->next_homonym = hp;
+    } else {
+        // remove hidden onlyupcase homonym
+        if (hp->astr) free(hp->astr);
+        release_entry(hp, size);
+    }
     return 0;
+}
+
+// give back the entry just taken from the arena
+void HashMgr::release_entry(struct hentry * hp, size_t size)
+{
+    size = ARENAALIGN(size);
+    if ((char *) hp + size == arenanext) {
+        arenanext -= size;
+        arenaleft += size;
+    }
 }     
 
 int HashMgr::add_hidden_capitalized_word(char * word, int wbl, int wcl,
@@ -256,6 +389,7 @@ int HashMgr::get_clen_and_captype(const char * word, int wbl, int * captype) {
 // remove word (personal dictionary function for standalone applications)
 int HashMgr::remove(const char * word)
 {
+    modified++;
     struct hentry * dp = lookup(word);
     while (dp) {
         if (dp->alen == 0 || !TESTAFF(dp->astr, forbiddenword, dp->alen)) {
@@ -302,6 +436,7 @@ int HashMgr::add(const char * word)
 {
     unsigned short * flags = NULL;
     int al = 0;
+    modified++;
     if (remove_forbidden_flag(word)) {
         int captype;
         int wbl = strlen(word);
@@ -316,6 +451,7 @@ int HashMgr::add_with_affix(const char * word, const char * example)
 {
     // detect captype and modify word length for UTF-8 encoding
     struct hentry * dp = lookup(example);
+    modified++;
     remove_forbidden_flag(word);
     if (dp && dp->astr) {
         int captype;
@@ -337,12 +473,11 @@ int HashMgr::add_with_affix(const char * word, const char * example)
 
 // walk the hash table entry by entry - null at end
 // initialize: col=-1; hp = NULL; hp = walk_hashtable(&col, hp);
+// words come in the order of wordptr, see sort_words()
 struct hentry * HashMgr::walk_hashtable(int &col, struct hentry * hp) const
 {  
-  if (hp && hp->next != NULL) return hp->next;
-  for (col++; col < tablesize; col++) {
-    if (tableptr[col]) return tableptr[col];
-  }
+  if (hp && hp->next_homonym != NULL) return hp->next_homonym;
+  if (++col < tablecount) return wordptr[col];
   // null at end and reset to start
   col = -1;
   return NULL;
@@ -376,22 +511,18 @@ int HashMgr::load_tables(const char * tpath, const char * key)
     // warning: dic file begins with byte order mark: possible incompatibility with old Hunspell versions
   }
 
-  tablesize = atoi(ts);
-  if (tablesize == 0) {
+  int words = atoi(ts);
+  if (words == 0) {
     HUNSPELL_WARNING(stderr, "error: line 1: missing or bad word count in the dic file\n");
     delete dict;
     return 4;
   }
-  tablesize = tablesize + 5 + USERWORD;
-  if ((tablesize %2) == 0) tablesize++;
 
   // allocate the hash table
-  tableptr = (struct hentry **) malloc(tablesize * sizeof(struct hentry *));
-  if (! tableptr) {
+  if (init_table(words + 5 + USERWORD)) {
     delete dict;
     return 3;
   }
-  for (int i=0; i<tablesize; i++) tableptr[i] = NULL;
 
   // loop through all words on much list and add to hash
   // table and create word and affix strings
@@ -470,22 +601,56 @@ int HashMgr::load_tables(const char * tpath, const char * key)
   }
 
   delete dict;
+  sort_words(words + 5 + USERWORD);
   return 0;
 }
 
-// the hash function is a simple load and rotate
-// algorithm borrowed
+/* put the words in the order the old chained hash table of the given size
+   walked them: by bucket, then as they were added. Words scoring the same
+   as an ngram suggestion are ranked by this order, so suggestions stay as
+   they were before the table changed. A counting sort keeps it stable. */
+void HashMgr::sort_words(int buckets)
+{
+    if ((buckets % 2) == 0) buckets++;
+    int * bucket = (int *) malloc(tablecount * sizeof(int));
+    int * first = (int *) calloc(buckets + 1, sizeof(int));
+    struct hentry ** sorted = (struct hentry **) malloc(wordalloc * sizeof(struct hentry *));
+    if (bucket && first && sorted) {
+        for (int k = 0; k < tablecount; k++) {
+            const char * word = wordptr[k]->word;
+            long hv = 0;
+            for (int i = 0; i < 4 && *word != 0; i++)
+                hv = (hv << 8) | (*word++);
+            while (*word != 0) {
+                ROTATE(hv, ROTATE_LEN);
+                hv ^= (*word++);
+            }
+            bucket[k] = (int) ((unsigned long) hv % buckets);
+            first[bucket[k] + 1]++;
+        }
+        for (int i = 0; i < buckets; i++) first[i + 1] += first[i];
+        for (int k = 0; k < tablecount; k++) sorted[first[bucket[k]]++] = wordptr[k];
+        free(wordptr);
+        wordptr = sorted;
+        sorted = NULL;
+    }
+    free(bucket);
+    free(first);
+    free(sorted);
+}
+
+// the full hash of a word, also kept in its slot as a fingerprint
 
-int HashMgr::hash(const char * word) const
+unsigned int HashMgr::hash(const char * word) const
 {
-    long  hv = 0;
-    for (int i=0; i < 4  &&  *word != 0; i++)
-        hv = (hv << 8) | (*word++);
+    // FNV-1a; the table is a power of two, so the low bits have to be
+    // as well mixed as the high ones
+    unsigned int hv = 2166136261U;
     while (*word != 0) {
-      ROTATE(hv,ROTATE_LEN);
-      hv ^= (*word++);
+      hv ^= (unsigned char) *word++;
+      hv *= 16777619U;
     }
-    return (unsigned long) hv % tablesize;
+    return hv;
 }
 
 int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af) {
@@ -926,3 +1091,309 @@ char * HashMgr::get_aliasm(int index) {
     HUNSPELL_WARNING(stderr, "error: bad morph. alias index: %d\n", index);
     return NULL;
 }
+
+/* Precompiled dictionary images
+
+   An image holds the finished hash table of one .dic file: the slot
+   array, the list of words in the order they were added, every hentry
+   with its word and description, and the affix flag vectors, all in one
+   block. The pointers inside are written for the
+   address IMAGE_BASE, so when the kernel can map the file there it is
+   used in place with no parsing, allocation or relocation, and its pages
+   are shared by every process using the same dictionary. Otherwise the
+   pointers are relocated in a private copy of the mapping.
+
+   The caller chooses where the image lives, normally a per-user cache
+   directory since the dictionary's own directory is rarely writable. The
+   image records the size and modification time of the .dic and .aff files
+   it was built from and the layout of the structures in it; a stale or
+   foreign image is ignored and the text dictionary is loaded instead, as
+   is one with any pointer outside the image.
+ */
+
+#define IMAGE_MAGIC   "HUNIMG4"
+#define IMAGE_ORDER   0x01020304
+#define IMAGE_ALIGN(n) ARENAALIGN(n)
+#define IMAGE_BASE    (sizeof(void *) == 8 ? (size_t) 0x2f0000000000ULL : (size_t) 0x58000000UL)
+
+struct image_header {
+    char               magic[8];
+    unsigned int       order;       // IMAGE_ORDER in the writer's byte order
+    unsigned int       ptrsize;
+    unsigned int       hentrysize;  // sizeof(struct hentry)
+    unsigned int       hslotsize;   // sizeof(struct hslot)
+    unsigned long long base;        // address the pointers were written for
+    unsigned long long size;        // whole image in bytes
+    long long          dicsize;
+    long long          dicmtime;
+    long long          affsize;
+    long long          affmtime;
+    int                tablesize;
+    int                tablecount;
+    int                flag_mode;
+    int                utf8;
+    int                complexprefixes;
+};
+
+static int image_stamp(const char * path, long long * size, long long * mtime)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return 1;
+    *size = (long long) st.st_size;
+    *mtime = (long long) st.st_mtime;
+    return 0;
+}
+
+// 1 if a whole entry, with its word and description, lies in [start, end)
+static int image_entry_ok(size_t hp, size_t start, size_t end)
+{
+    if (hp < start || hp >= end || (hp & (sizeof(void *) - 1)) ||
+        end - hp < offsetof(struct hentry, word) + 1) return 0;
+    struct hentry * ep = (struct hentry *) hp;
+    size_t word = hp + offsetof(struct hentry, word);
+    if (end - word < (size_t) ep->blen + 1 || ep->word[ep->blen] != '\0') return 0;
+    if (ep->var & H_OPT) {
+        size_t data = word + ep->blen + 1;
+        if (!memchr((const void *) data, '\0', end - data)) return 0;
+    }
+    return 1;
+}
+
+// size of an entry as stored in an image, with its description inline
+static size_t image_entry_size(struct hentry * hp)
+{
+    char * data = HENTRY_DATA(hp);
+    return IMAGE_ALIGN(offsetof(struct hentry, word) + hp->blen + 1 +
+                       (data ? strlen(data) + 1 : 0));
+}
+
+static size_t image_flags_size(struct hentry * hp)
+{
+    return (hp->astr && hp->alen > 0) ? IMAGE_ALIGN(hp->alen * sizeof(unsigned short)) : 0;
+}
+
+int HashMgr::in_image(const void * p) const
+{
+    return image && (const char *) p >= image && (const char *) p < image + imagesize;
+}
+
+int HashMgr::is_image() const
+{
+    return image != NULL;
+}
+
+// number of words added or removed since loading, so callers caching
+// anything derived from the table can tell when to rebuild it
+int HashMgr::get_modified() const
+{
+    return modified;
+}
+
+/* write the current hash table, loaded from tpath and apath, as an image
+   at ipath; only a table loaded from the text files can be saved */
+int HashMgr::save_image(const char * ipath, const char * tpath, const char * apath) const
+{
+    if (!tableptr || image || modified) return 1;
+
+    struct image_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (image_stamp(tpath, &hdr.dicsize, &hdr.dicmtime) ||
+        image_stamp(apath, &hdr.affsize, &hdr.affmtime)) return 1;
+    memcpy(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic));
+    hdr.order = IMAGE_ORDER;
+    hdr.ptrsize = sizeof(void *);
+    hdr.hentrysize = sizeof(struct hentry);
+    hdr.hslotsize = sizeof(struct hslot);
+    hdr.base = IMAGE_BASE;
+    hdr.tablesize = tablesize;
+    hdr.tablecount = tablecount;
+    hdr.flag_mode = flag_mode;
+    hdr.utf8 = utf8;
+    hdr.complexprefixes = complexprefixes;
+
+    size_t tableoff = IMAGE_ALIGN(sizeof(hdr));
+    size_t wordoff = tableoff + IMAGE_ALIGN(tablesize * sizeof(struct hslot));
+    size_t size = wordoff + IMAGE_ALIGN(tablecount * sizeof(struct hentry *));
+    for (int i = 0; i < tablesize; i++) {
+        for (struct hentry * hp = tableptr[i].entry; hp; hp = hp->next_homonym)
+            size += image_entry_size(hp) + image_flags_size(hp);
+    }
+    hdr.size = size;
+
+    char * buf = (char *) calloc(1, size);
+    if (!buf) return 1;
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    // words are stored in the order they were added, homonyms one after
+    // another, each followed by its flags
+    struct hslot * table = (struct hslot *) (buf + tableoff);
+    struct hentry ** words = (struct hentry **) (buf + wordoff);
+    size_t pos = wordoff + IMAGE_ALIGN(tablecount * sizeof(struct hentry *));
+    unsigned int mask = tablesize - 1;
+    for (int k = 0; k < tablecount; k++) {
+        unsigned int i = hash(wordptr[k]->word) & mask;
+        while (tableptr[i].entry != wordptr[k]) i = (i + 1) & mask;
+        table[i].fp = tableptr[i].fp;
+        table[i].entry = (struct hentry *) (IMAGE_BASE + pos);
+        words[k] = table[i].entry;
+
+        struct hentry * prev = NULL;
+        for (struct hentry * hp = wordptr[k]; hp; hp = hp->next_homonym) {
+            struct hentry * ep = (struct hentry *) (buf + pos);
+            char * data = HENTRY_DATA(hp);
+            ep->blen = hp->blen;
+            ep->clen = hp->clen;
+            ep->var = hp->var & ~H_OPT_ALIASM;   // aliased descriptions go inline
+            memcpy(ep->word, hp->word, hp->blen + 1);
+            if (data) strcpy(ep->word + hp->blen + 1, data);
+            if (prev) prev->next_homonym = (struct hentry *) (IMAGE_BASE + pos);
+            prev = ep;
+
+            size_t flagoff = pos + image_entry_size(hp);
+            if (image_flags_size(hp)) {
+                memcpy(buf + flagoff, hp->astr, hp->alen * sizeof(unsigned short));
+                ep->astr = (unsigned short *) (IMAGE_BASE + flagoff);
+                ep->alen = hp->alen;
+            }
+            pos = flagoff + image_flags_size(hp);
+        }
+    }
+
+    // write under another name first so other processes never map half a file
+    char * tmppath = (char *) malloc(strlen(ipath) + 5);
+    int ec = 1;
+    if (tmppath) {
+        strcpy(tmppath, ipath);
+        strcat(tmppath, ".tmp");
+        FILE * out = fopen(tmppath, "wb");
+        if (out) {
+            ec = (fwrite(buf, 1, size, out) != size);
+            if (fclose(out) != 0) ec = 1;
+            ::remove(ipath);
+            if (ec || rename(tmppath, ipath) != 0) {
+                ::remove(tmppath);
+                ec = 1;
+            }
+        }
+    }
+    free(tmppath);
+    free(buf);
+    return ec;
+}
+
+// use the image at ipath if it is current for tpath and apath; 0 on success
+int HashMgr::load_image(const char * ipath, const char * tpath, const char * apath)
+{
+    long long dicsize, dicmtime, affsize, affmtime;
+    if (image_stamp(tpath, &dicsize, &dicmtime) ||
+        image_stamp(apath, &affsize, &affmtime)) return 1;
+
+    FILE * in = fopen(ipath, "rb");
+    if (!in) return 1;
+
+    struct image_header hdr;
+    if (fread(&hdr, 1, sizeof(hdr), in) != sizeof(hdr) ||
+        memcmp(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.order != IMAGE_ORDER ||
+        hdr.ptrsize != sizeof(void *) ||
+        hdr.hentrysize != sizeof(struct hentry) || hdr.hslotsize != sizeof(struct hslot) ||
+        hdr.dicsize != dicsize || hdr.dicmtime != dicmtime ||
+        hdr.affsize != affsize || hdr.affmtime != affmtime ||
+        hdr.flag_mode != flag_mode || hdr.utf8 != utf8 ||
+        hdr.complexprefixes != complexprefixes ||
+        hdr.tablesize <= 0 || (hdr.tablesize & (hdr.tablesize - 1)) != 0 ||
+        hdr.tablecount < 0 || hdr.tablecount >= hdr.tablesize ||
+        hdr.size < IMAGE_ALIGN(sizeof(hdr)) + IMAGE_ALIGN(hdr.tablesize * sizeof(struct hslot)) +
+                   IMAGE_ALIGN(hdr.tablecount * sizeof(struct hentry *))) {
+        fclose(in);
+        return 1;
+    }
+
+    // a truncated file would fault when the missing pages are touched
+    struct stat st;
+    if (fstat(fileno(in), &st) != 0 || (unsigned long long) st.st_size != hdr.size) {
+        fclose(in);
+        return 1;
+    }
+
+#ifdef HUNSPELL_MMAP
+    // writable so words added at run time only copy the pages they touch
+    void * p = mmap((void *) (size_t) hdr.base, hdr.size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fileno(in), 0);
+    if (p != MAP_FAILED) {
+        image = (char *) p;
+        imagemapped = 1;
+    }
+#endif
+    if (!image) {
+        image = (char *) malloc(hdr.size);
+        if (image && (fseek(in, 0, SEEK_SET) != 0 ||
+                      fread(image, 1, hdr.size, in) != hdr.size)) {
+            free(image);
+            image = NULL;
+        }
+    }
+    fclose(in);
+    if (!image) return 1;
+    imagesize = hdr.size;
+
+    if (relocate_image(hdr.base)) {
+        HUNSPELL_WARNING(stderr, "warning: ignoring damaged dictionary image %s\n", ipath);
+#ifdef HUNSPELL_MMAP
+        if (imagemapped) munmap(image, imagesize);
+        else
+#endif
+        free(image);
+        image = NULL;
+        imagesize = 0;
+        imagemapped = 0;
+        return 1;
+    }
+
+    tablesize = hdr.tablesize;
+    tablecount = hdr.tablecount;
+    tableptr = (struct hslot *) (image + IMAGE_ALIGN(sizeof(hdr)));
+    wordptr = (struct hentry **) ((char *) tableptr + IMAGE_ALIGN(tablesize * sizeof(struct hslot)));
+    wordalloc = tablecount;
+    return 0;
+}
+
+/* move every pointer in the image from base to where it actually is,
+   checking that each one points inside the image; nothing is written when
+   the image is already at base. Homonyms are saved in increasing address
+   order, so a chain that goes backwards is damaged too. 0 on success */
+int HashMgr::relocate_image(size_t base)
+{
+    size_t delta = (size_t) image - base;
+    int count = (int) ((struct image_header *) image)->tablesize;
+    int wordcount = (int) ((struct image_header *) image)->tablecount;
+    struct hslot * table = (struct hslot *) (image + IMAGE_ALIGN(sizeof(struct image_header)));
+    struct hentry ** words = (struct hentry **) ((char *) table + IMAGE_ALIGN(count * sizeof(struct hslot)));
+    size_t start = (size_t) words + IMAGE_ALIGN(wordcount * sizeof(struct hentry *));
+    size_t end = (size_t) image + imagesize;
+    for (int k = 0; k < wordcount; k++) {
+        size_t entry = (size_t) words[k] + delta;
+        if (!image_entry_ok(entry, start, end)) return 1;
+        if (delta) words[k] = (struct hentry *) entry;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!table[i].entry) continue;
+        size_t entry = (size_t) table[i].entry + delta;
+        if (!image_entry_ok(entry, start, end)) return 1;
+        if (delta) table[i].entry = (struct hentry *) entry;
+        for (struct hentry * hp = table[i].entry; hp; hp = hp->next_homonym) {
+            if (hp->astr) {
+                size_t astr = (size_t) hp->astr + delta;
+                if (hp->alen <= 0 || astr < start || astr >= end ||
+                    (astr & (sizeof(unsigned short) - 1)) ||
+                    (end - astr) / sizeof(unsigned short) < (size_t) hp->alen) return 1;
+                if (delta) hp->astr = (unsigned short *) astr;
+            }
+            if (hp->next_homonym) {
+                size_t next = (size_t) hp->next_homonym + delta;
+                if (next <= (size_t) hp || !image_entry_ok(next, start, end)) return 1;
+                if (delta) hp->next_homonym = (struct hentry *) next;
+            }
+        }
+    }
+    return 0;
+}
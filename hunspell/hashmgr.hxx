@@ -12,8 +12,14 @@ enum flag { FLAG_CHAR, FLAG_LONG, FLAG_NUM, FLAG_UNI };
 
 class LIBHUNSPELL_DLL_EXPORTED HashMgr
 {
-  int               tablesize;
-  struct hentry **  tableptr;
+  int               tablesize; // slots, always a power of two
+  int               tablecount; // slots in use
+  struct hslot *    tableptr;
+  struct hentry **  wordptr;   // first homonym of each word, in the order added
+  int               wordalloc;
+  char *            arena;     // newest block entries are carved from
+  char *            arenanext;
+  size_t            arenaleft;
   int               userword;
   flag              flag_mode;
   int               complexprefixes;
@@ -31,14 +37,19 @@ class LIBHUNSPELL_DLL_EXPORTED HashMgr
   unsigned short *  aliasflen;
   int               numaliasm; // morphological desciption `compression' with aliases
   char **           aliasm;
+  char *            image;     // precompiled table, see save_image()
+  size_t            imagesize;
+  int               imagemapped;
+  int               modified;  // changes to the words since loading
 
 
 public:
-  HashMgr(const char * tpath, const char * apath, const char * key = NULL);
+  HashMgr(const char * tpath, const char * apath, const char * key = NULL,
+    const char * ipath = NULL);
   ~HashMgr();
 
   struct hentry * lookup(const char *) const;
-  int hash(const char *) const;
+  unsigned int hash(const char *) const;
   struct hentry * walk_hashtable(int & col, struct hentry * hp) const;
 
   int add(const char * word);
@@ -51,10 +62,22 @@ public:
   int get_aliasf(int index, unsigned short ** fvec, FileMgr * af);
   int is_aliasm();
   char * get_aliasm(int index);
+  int save_image(const char * ipath, const char * tpath, const char * apath) const;
+  int is_image() const;
+  int get_modified() const;
 
 private:
   int get_clen_and_captype(const char * word, int wbl, int * captype);
   int load_tables(const char * tpath, const char * key);
+  int init_table(int words);
+  int grow_table();
+  int append_word(struct hentry * hp);
+  void sort_words(int buckets);
+  struct hentry * alloc_entry(size_t size);
+  void release_entry(struct hentry * hp, size_t size);
+  int load_image(const char * ipath, const char * tpath, const char * apath);
+  int relocate_image(size_t base);
+  int in_image(const void * p) const;
   int add_word(const char * word, int wbl, int wcl, unsigned short * ap,
     int al, const char * desc, bool onlyupcase);
   int load_config(const char * affpath, const char * key);
@@ -23,10 +23,17 @@ struct hentry
   unsigned char clen; // word length in characters (different for UTF-8 enc.)
   short    alen;      // length of affix flag vector
   unsigned short * astr;  // affix flag vector
-  struct   hentry * next; // next word with same hash code
-  struct   hentry * next_homonym; // next homonym word (with same hash code)
+  struct   hentry * next_homonym; // next homonym word (same word, other flags)
   char     var;       // variable fields (only for special pronounciation yet)
   char     word[1];   // variable-length word (8-bit or UTF-8 encoding)
 };
 
+// slot of the open addressing word table: the full hash of the word
+// and the first of its homonyms (NULL for an empty slot)
+struct hslot
+{
+  unsigned int     fp;
+  struct hentry *  entry;
+};
+
 #endif
@@ -12,7 +12,8 @@
 #endif
 #include "csutil.hxx"
 
-Hunspell::Hunspell(const char * affpath, const char * dpath, const char * key)
+Hunspell::Hunspell(const char * affpath, const char * dpath, const char * key,
+  const char * ipath)
 {
     encoding = NULL;
     csconv = NULL;
@@ -22,7 +23,7 @@ Hunspell::Hunspell(const char * affpath, const char * dpath, const char * key)
     maxdic = 0;
 
     /* first set up the hash manager */
-    pHMgr[0] = new HashMgr(dpath, affpath, key);
+    pHMgr[0] = new HashMgr(dpath, affpath, key, ipath);
     if (pHMgr[0]) maxdic = 1;
 
     /* next set up the affix manager */
@@ -959,6 +960,7 @@ int Hunspell::suggest(char*** slst, const char * word)
       if (strcmp((*slst)[k], (*slst)[j]) == 0) {
         free((*slst)[j]);
         l--;
+        break;
       }
     }
     l++;
@@ -1303,6 +1305,18 @@ int Hunspell::remove(const char * word)
     return 0;
 }
 
+int Hunspell::save_image(const char * dpath, const char * ipath)
+{
+    if (pHMgr[0]) return (pHMgr[0])->save_image(ipath, dpath, affixpath);
+    return 1;
+}
+
+int Hunspell::is_image()
+{
+    if (pHMgr[0]) return (pHMgr[0])->is_image();
+    return 0;
+}
+
 const char * Hunspell::get_version()
 {
   return pAMgr->get_version();
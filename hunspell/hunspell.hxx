@@ -37,10 +37,12 @@ class LIBHUNSPELL_DLL_EXPORTED Hunspell
 public:
 
   /* Hunspell(aff, dic) - constructor of Hunspell class
-   * input: path of affix file and dictionary file
+   * input: path of affix file and dictionary file, and optionally of a
+   * precompiled image of the dictionary file (see save_image)
    */
 
-  Hunspell(const char * affpath, const char * dpath, const char * key = NULL);
+  Hunspell(const char * affpath, const char * dpath, const char * key = NULL,
+    const char * ipath = NULL);
   ~Hunspell();
 
   /* load extra dictionaries (only dic files) */
@@ -124,6 +126,20 @@ public:
 
   int remove(const char * word);
 
+  /* precompiled dictionary image (see HashMgr::save_image) */
+
+  /* write an image of the main dictionary, loaded from dpath, to ipath so
+   * the next Hunspell built from the same files and ipath maps it instead
+   * of parsing dpath; call before adding or removing words. Returns 0 on
+   * success.
+   */
+
+  int save_image(const char * dpath, const char * ipath);
+
+  /* 1 if the main dictionary was loaded from an image */
+
+  int is_image();
+
   /* other */
 
   /* get extra word characters definied in affix file for tokenization */
@@ -6,12 +6,63 @@
 #include <stdio.h> 
 #include <ctype.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#define HAVE_PTHREAD
+#endif
+
 #include "suggestmgr.hxx"
 #include "htypes.hxx"
 #include "csutil.hxx"
 
 const w_char W_VLINE = { '\0', '|' };
 
+// ngsuggest candidate index and scoring threads
+#define NGBUCKETS   (1 << 16)   // bigram buckets, a power of two
+#define NGTHREADS   4           // most threads scoring one word
+#define NGCHUNK     4096        // fewest candidates worth another thread
+#define NGNOPHON    (-1000000)  // no phonetic score for this candidate
+
+// a root word ngsuggest may offer, with its lowercase form
+struct ngcand {
+  struct hentry * hp;
+  int off;                 // lowercase form in ngindex.lower
+  int len;                 // characters in it, 0 if it could not be converted
+};
+
+// every root word of one dictionary ngsuggest may offer, lowercased
+// once, and for each bigram bucket the words containing it
+struct ngindex {
+  HashMgr * hmgr;
+  int modified;            // hmgr->get_modified() when this was built
+  int count;
+  struct ngcand * cand;
+  char * lower;            // w_char strings for UTF-8 dictionaries
+  int * start;             // NGBUCKETS + 1 offsets into post
+  int * post;              // candidates by bigram bucket
+  int * always;            // candidates too short to contain a bigram
+  int nalways;
+  struct ngindex * next;
+};
+
+// one thread's share of the candidates for one word
+struct ngjob {
+  SuggestMgr * mgr;
+  struct ngindex * idx;
+  const int * ids;
+  int count;
+  int * sc;
+  int * scphon;            // NGNOPHON where no phonetic score was computed
+  char word[MAXSWUTF8L];   // own copies, ngram() writes into its first argument
+  char target[MAXSWUTF8L];
+  const w_char * su1;
+  int l1;
+  int n;
+  phonetable * ph;
+  int nonbmp;
+};
+
 SuggestMgr::SuggestMgr(const char * tryme, int maxn, 
                        AffixMgr * aptr)
 {
@@ -33,6 +84,7 @@ SuggestMgr::SuggestMgr(const char * tryme, int maxn,
   utf8 = 0;
   langnum = 0;
   complexprefixes = 0;  
+  ngidx = NULL;
   
   maxSug = maxn;
   nosplitsugs = 0;
@@ -90,6 +142,11 @@ SuggestMgr::~SuggestMgr()
   ctry_utf = NULL;
   ctryl = 0;
   maxSug = 0;
+  while (ngidx) {
+    struct ngindex * next = ngidx->next;
+    ngindex_free(ngidx);
+    ngidx = next;
+  }
 #ifdef MOZILLA_CLIENT
   delete [] csconv;
 #endif
@@ -979,6 +1036,280 @@ int SuggestMgr::movechar_utf(char ** wlst, const w_char * word, int wl, int ns,
 }
 
 // generate a set of suggestions for very poorly spelled words
+// bucket of the bigram starting at character i of s, which is a
+// w_char string for UTF-8 dictionaries
+static inline unsigned int ngbucket(const char * s, int i, int utf8)
+{
+  unsigned int a, b;
+  if (utf8) {
+    const w_char * u = (const w_char *) s + i;
+    a = (u[0].h << 8) + u[0].l;
+    b = (u[1].h << 8) + u[1].l;
+  } else {
+    const unsigned char * u = (const unsigned char *) s + i;
+    a = u[0];
+    b = u[1];
+  }
+  unsigned int h = (a * 0x9E3779B1U) ^ (b * 0x85EBCA77U);
+  return (h ^ (h >> 16)) & (NGBUCKETS - 1);
+}
+
+// lowercase word into dest as ngram() would, returns its length in
+// characters; dest holds w_char for UTF-8 dictionaries
+int SuggestMgr::ngindex_lower(const char * word, char * dest)
+{
+  if (utf8) {
+    w_char * u = (w_char *) dest;
+    int len = u8_u16(u, MAXSWL, word);
+    if (len <= 0) return 0;
+    mkallsmall_utf(u, len, langnum);
+    return len;
+  }
+  int len = strlen(word);
+  if (len >= MAXSWUTF8L) return 0;
+  strcpy(dest, word);
+  mkallsmall(dest, csconv);
+  return len;
+}
+
+void SuggestMgr::ngindex_free(struct ngindex * idx)
+{
+  if (!idx) return;
+  free(idx->cand);
+  free(idx->lower);
+  free(idx->start);
+  free(idx->post);
+  free(idx->always);
+  free(idx);
+}
+
+// the index of pHMgr, built the first time and again after words
+// were added or removed
+struct ngindex * SuggestMgr::ngindex_get(HashMgr * pHMgr)
+{
+  struct ngindex ** link = &ngidx;
+  while (*link && (*link)->hmgr != pHMgr) link = &(*link)->next;
+  if (*link && (*link)->modified == pHMgr->get_modified()) return *link;
+
+  struct ngindex * idx = ngindex_build(pHMgr);
+  if (!idx) return NULL;
+  if (*link) {
+    idx->next = (*link)->next;
+    ngindex_free(*link);
+  }
+  *link = idx;
+  return idx;
+}
+
+struct ngindex * SuggestMgr::ngindex_build(HashMgr * pHMgr)
+{
+  struct ngindex * idx = (struct ngindex *) calloc(1, sizeof(struct ngindex));
+  if (!idx) return NULL;
+  idx->hmgr = pHMgr;
+  idx->modified = pHMgr->get_modified();
+
+  // the same root words ngsuggest used to walk, in the same order
+  int allocated = 0;
+  int size = 0;
+  int capacity = 0;
+  char buf[MAXSWUTF8L];
+  struct hentry * hp = NULL;
+  int col = -1;
+  while (0 != (hp = pHMgr->walk_hashtable(col, hp))) {
+    if ((hp->astr) && (pAMgr) && 
+       (TESTAFF(hp->astr, pAMgr->get_forbiddenword(), hp->alen) ||
+          TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
+          TESTAFF(hp->astr, pAMgr->get_nosuggest(), hp->alen) ||
+          TESTAFF(hp->astr, pAMgr->get_onlyincompound(), hp->alen))) continue;
+
+    int len = ngindex_lower(HENTRY_WORD(hp), buf);
+    int bytes = utf8 ? len * sizeof(w_char) : len;
+    if (idx->count == allocated) {
+      allocated = allocated ? 2 * allocated : 1024;
+      struct ngcand * cand = (struct ngcand *) realloc(idx->cand, allocated * sizeof(struct ngcand));
+      if (!cand) { ngindex_free(idx); return NULL; }
+      idx->cand = cand;
+    }
+    if (size + bytes > capacity) {
+      capacity = capacity ? 2 * capacity : 16384;
+      char * lower = (char *) realloc(idx->lower, capacity);
+      if (!lower) { ngindex_free(idx); return NULL; }
+      idx->lower = lower;
+    }
+    memcpy(idx->lower + size, buf, bytes);
+    idx->cand[idx->count].hp = hp;
+    idx->cand[idx->count].off = size;
+    idx->cand[idx->count].len = len;
+    idx->count++;
+    size += bytes;
+  }
+
+  // count the words in each bucket, then fill the buckets; a word with
+  // a special pronunciation is also found by the bigrams of that
+  idx->start = (int *) calloc(NGBUCKETS + 1, sizeof(int));
+  int * last = (int *) malloc(NGBUCKETS * sizeof(int));
+  int * fill = (int *) malloc(NGBUCKETS * sizeof(int));
+  if (!idx->start || !last || !fill) {
+    free(last);
+    free(fill);
+    ngindex_free(idx);
+    return NULL;
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    for (int b = 0; b < NGBUCKETS; b++) last[b] = -1;
+    idx->nalways = 0;
+    for (int i = 0; i < idx->count; i++) {
+      struct ngcand * c = idx->cand + i;
+      if (c->len < 2) {
+        if (pass) idx->always[idx->nalways] = i;
+        idx->nalways++;
+      }
+      for (int part = 0; part < 2; part++) {
+        const char * s = idx->lower + c->off;
+        int len = c->len;
+        if (part) {
+          char f[MAXSWUTF8L];
+          if (!(c->hp->var & H_OPT_PHON) || !copy_field(f, HENTRY_DATA(c->hp), MORPH_PHON)) break;
+          len = ngindex_lower(f, buf);
+          s = buf;
+        }
+        for (int k = 0; k + 1 < len; k++) {
+          unsigned int b = ngbucket(s, k, utf8);
+          if (last[b] == i) continue;
+          last[b] = i;
+          if (pass) idx->post[fill[b]++] = i;
+          else idx->start[b + 1]++;
+        }
+      }
+    }
+    if (pass == 0) {
+      for (int b = 0; b < NGBUCKETS; b++) {
+        idx->start[b + 1] += idx->start[b];
+        fill[b] = idx->start[b];
+      }
+      idx->post = (int *) malloc(idx->start[NGBUCKETS] * sizeof(int) + 1);
+      idx->always = (int *) malloc(idx->nalways * sizeof(int) + 1);
+      if (!idx->post || !idx->always) {
+        free(last);
+        free(fill);
+        ngindex_free(idx);
+        return NULL;
+      }
+    }
+  }
+  free(last);
+  free(fill);
+  return idx;
+}
+
+// the candidates sharing a bigram with the word, plus the short ones,
+// in dictionary order; every candidate if the word has no bigram.
+// returns their number, or -1 if out of memory
+int SuggestMgr::ngcandidates(struct ngindex * idx, const char * word,
+  const w_char * su1, int l1, int ** ids)
+{
+  int * list = (int *) malloc(idx->count * sizeof(int) + 1);
+  if (!list) return -1;
+  *ids = list;
+  if (l1 < 2) {
+    for (int i = 0; i < idx->count; i++) list[i] = i;
+    return idx->count;
+  }
+
+  unsigned char * seen = (unsigned char *) calloc(idx->count + 1, 1);
+  if (!seen) {
+    free(list);
+    *ids = NULL;
+    return -1;
+  }
+  const char * s = utf8 ? (const char *) su1 : word;
+  for (int k = 0; k + 1 < l1; k++) {
+    unsigned int b = ngbucket(s, k, utf8);
+    for (int p = idx->start[b]; p < idx->start[b + 1]; p++) seen[idx->post[p]] = 1;
+  }
+  for (int i = 0; i < idx->nalways; i++) seen[idx->always[i]] = 1;
+
+  int count = 0;
+  for (int i = 0; i < idx->count; i++) {
+    if (seen[i]) list[count++] = i;
+  }
+  free(seen);
+  return count;
+}
+
+void SuggestMgr::ngscore(struct ngjob * job)
+{
+  char f[MAXSWUTF8L];
+  char candidate[MAXSWUTF8L];
+  char target2[MAXSWUTF8L];
+  for (int i = 0; i < job->count; i++) {
+    struct ngcand * c = job->idx->cand + job->ids[i];
+    struct hentry * hp = c->hp;
+    int sc;
+    if (job->nonbmp)
+      sc = ngram(3, job->word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + NGRAM_LOWERING);
+    else
+      sc = ngram_lowered(3, job->word, job->su1, job->l1, job->idx->lower + c->off,
+        c->len, NGRAM_LONGER_WORSE);
+    sc += leftcommonsubstring(job->word, HENTRY_WORD(hp));
+
+    // check special pronounciation
+    if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
+      int sc2 = ngram(3, job->word, f, NGRAM_LONGER_WORSE + NGRAM_LOWERING) +
+        leftcommonsubstring(job->word, f);
+      if (sc2 > sc) sc = sc2;
+    }
+    job->sc[i] = sc;
+
+    job->scphon[i] = NGNOPHON;
+    if (job->ph && (sc > 2) && (abs(job->n - (int) hp->clen) <= 3)) {
+      strcpy(candidate, HENTRY_WORD(hp));
+      mkallcap(candidate, csconv);
+      phonet(candidate, target2, -1, *job->ph);
+      job->scphon[i] = 2 * ngram(3, job->target, target2, NGRAM_LONGER_WORSE);
+    }
+  }
+}
+
+static void * ngworker(void * arg)
+{
+  struct ngjob * job = (struct ngjob *) arg;
+  job->mgr->ngscore(job);
+  return NULL;
+}
+
+// how many threads should score this many candidates
+static int ngthreads(int count)
+{
+  int threads = 1;
+#ifdef HAVE_PTHREAD
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  threads = count / NGCHUNK;
+  if (threads > cpus) threads = cpus;
+  if (threads > NGTHREADS) threads = NGTHREADS;
+  if (threads < 1) threads = 1;
+#endif
+  return threads;
+}
+
+// score every job, the calling thread takes the first one
+static void ngrun(struct ngjob * jobs, int threads)
+{
+#ifdef HAVE_PTHREAD
+  pthread_t tid[NGTHREADS];
+  int started[NGTHREADS];
+  for (int t = 1; t < threads; t++)
+    started[t] = (pthread_create(&tid[t], NULL, ngworker, jobs + t) == 0);
+  ngworker(jobs);
+  for (int t = 1; t < threads; t++) {
+    if (started[t]) pthread_join(tid[t], NULL);
+    else ngworker(jobs + t);
+  }
+#else
+  for (int t = 0; t < threads; t++) ngworker(jobs + t);
+#endif
+}
+
 int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md)
 {
 
@@ -988,7 +1319,7 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
   int lp, lpphon;
   int nonbmp = 0;
 
-  // exhaustively search through all root words
+  // search the root words sharing a bigram with the word
   // keeping track of the MAX_ROOTS most similar root words
   struct hentry * roots[MAX_ROOTS];
   char * rootsphon[MAX_ROOTS];
@@ -1015,6 +1346,12 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     word = w2;
   }
 
+  // the indexes are built for the dictionary encoding, before the
+  // non-BMP case below switches to characters
+  struct ngindex ** ngidx_all = (struct ngindex **) malloc(md * sizeof(struct ngindex *) + 1);
+  if (!ngidx_all) return ns;
+  for (i = 0; i < md; i++) ngidx_all[i] = ngindex_get(pHMgr[i]);
+
   char mw[MAXSWUTF8L];
   w_char u8[MAXSWL];
   int nc = strlen(word);
@@ -1028,7 +1365,6 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
   }
 
   struct hentry* hp = NULL;
-  int col = -1;
   phonetable * ph = (pAMgr) ? pAMgr->get_phonetable() : NULL;
   char target[MAXSWUTF8L];
   char candidate[MAXSWUTF8L];
@@ -1038,54 +1374,73 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     phonet(candidate, target, n, *ph);
   }
 
-  for (i = 0; i < md; i++) {  
-  while (0 != (hp = (pHMgr[i])->walk_hashtable(col, hp))) {
-    if ((hp->astr) && (pAMgr) && 
-       (TESTAFF(hp->astr, pAMgr->get_forbiddenword(), hp->alen) ||
-          TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
-          TESTAFF(hp->astr, pAMgr->get_nosuggest(), hp->alen) ||
-          TESTAFF(hp->astr, pAMgr->get_onlyincompound(), hp->alen))) continue;
-
-    sc = ngram(3, word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + NGRAM_LOWERING) +
-	leftcommonsubstring(word, HENTRY_WORD(hp));
-
-    // check special pronounciation
-    if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
-	int sc2 = ngram(3, word, f, NGRAM_LONGER_WORSE + NGRAM_LOWERING) +
-	leftcommonsubstring(word, f);
-	if (sc2 > sc) sc = sc2;
+  for (i = 0; i < md; i++) {
+    struct ngindex * idx = ngidx_all[i];
+    int * ids = NULL;
+    int count = idx ? ngcandidates(idx, word, u8, nonbmp ? -1 : n, &ids) : -1;
+    int * scall = (count >= 0) ? (int *) malloc(2 * count * sizeof(int) + 1) : NULL;
+    int threads = ngthreads(count);
+    struct ngjob * jobs = (struct ngjob *) malloc(threads * sizeof(struct ngjob));
+    if (!scall || !jobs) {
+      free(ids);
+      free(scall);
+      free(jobs);
+      continue;
     }
-    
-    if (ph && (sc > 2) && (abs(n - (int) hp->clen) <= 3)) {
-	char target2[MAXSWUTF8L];
-        strcpy(candidate, HENTRY_WORD(hp));
-        mkallcap(candidate, csconv);
-        phonet(candidate, target2, -1, *ph);
-        scphon = 2 * ngram(3, target, target2, NGRAM_LONGER_WORSE);
-    }
-
-    if (sc > scores[lp]) {
-      scores[lp] = sc;  
-      roots[lp] = hp;
-      lval = sc;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scores[j] < lval) {
-          lp = j;
-          lval = scores[j];
-        }
+
+    // score in parallel, then pick the best in dictionary order so ties
+    // go the same way whatever the number of threads
+    for (int t = 0; t < threads; t++) {
+      struct ngjob * job = jobs + t;
+      int first = (int) ((long long) count * t / threads);
+      job->mgr = this;
+      job->idx = idx;
+      job->ids = ids + first;
+      job->count = (int) ((long long) count * (t + 1) / threads) - first;
+      job->sc = scall + first;
+      job->scphon = scall + count + first;
+      strcpy(job->word, word);
+      if (ph) strcpy(job->target, target);
+      job->su1 = u8;
+      job->l1 = n;
+      job->n = n;
+      job->ph = ph;
+      job->nonbmp = nonbmp;
     }
+    ngrun(jobs, threads);
+
+    for (int c = 0; c < count; c++) {
+      hp = idx->cand[ids[c]].hp;
+      sc = scall[c];
+      if (scall[count + c] != NGNOPHON) scphon = scall[count + c];
+
+      if (sc > scores[lp]) {
+        scores[lp] = sc;  
+        roots[lp] = hp;
+        lval = sc;
+        for (j=0; j < MAX_ROOTS; j++)
+          if (scores[j] < lval) {
+            lp = j;
+            lval = scores[j];
+          }
+      }
 
-    if (scphon > scoresphon[lpphon]) {
-      scoresphon[lpphon] = scphon;
-      rootsphon[lpphon] = HENTRY_WORD(hp);
-      lval = scphon;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scoresphon[j] < lval) {
-          lpphon = j;
-          lval = scoresphon[j];
-        }
+      if (scphon > scoresphon[lpphon]) {
+        scoresphon[lpphon] = scphon;
+        rootsphon[lpphon] = HENTRY_WORD(hp);
+        lval = scphon;
+        for (j=0; j < MAX_ROOTS; j++)
+          if (scoresphon[j] < lval) {
+            lpphon = j;
+            lval = scoresphon[j];
+          }
+      }
     }
-  }}
+    free(ids);
+    free(scall);
+    free(jobs);
+  }
+  free(ngidx_all);
 
   // find minimum threshhold for a passable suggestion
   // mangle original word three differnt ways
@@ -1713,6 +2068,63 @@ int SuggestMgr::ngram(int n, char * s1, const char * s2, int opt)
   return ns;
 }
 
+// ngram() for s1 and su1 converted once by the caller against a
+// candidate lowercased by ngindex_lower(); unlike ngram() it leaves s1
+// alone, so threads may share it
+int SuggestMgr::ngram_lowered(int n, const char * s1, const w_char * su1, int l1,
+  const char * s2, int l2, int opt)
+{
+  int nscore = 0;
+  int ns;
+
+  if (l2 <= 0) return 0;
+  if (utf8) {
+    const w_char * su2 = (const w_char *) s2;
+    for (int j = 1; j <= n; j++) {
+      ns = 0;
+      for (int i = 0; i <= (l1-j); i++) {
+        for (int l = 0; l <= (l2-j); l++) {
+            int k;
+            for (k = 0; (k < j); k++) {
+              const w_char * c1 = su1 + i + k;
+              const w_char * c2 = su2 + l + k;
+              if ((c1->l != c2->l) || (c1->h != c2->h)) break;
+            }
+            if (k == j) {
+                ns++;
+                break;
+            }
+        }
+      }
+      nscore = nscore + ns;
+      if (ns < 2) break;
+    }
+  } else {
+    for (int j = 1; j <= n; j++) {
+      ns = 0;
+      for (int i = 0; i <= (l1-j); i++) {
+        const char * p = s2;
+        const char * end = s2 + l2 - j + 1;
+        while (p < end && (p = (const char *) memchr(p, s1[i], end - p))) {
+          if (memcmp(p + 1, s1 + i + 1, j - 1) == 0) {
+            ns++;
+            break;
+          }
+          p++;
+        }
+      }
+      nscore = nscore + ns;
+      if (ns < 2) break;
+    }
+  }
+
+  ns = 0;
+  if (opt & NGRAM_LONGER_WORSE) ns = (l2-l1)-2;
+  if (opt & NGRAM_ANY_MISMATCH) ns = abs(l2-l1)-2;
+  ns = (nscore - ((ns > 0) ? ns : 0));
+  return ns;
+}
+
 // length of the left common substring of s1 and (decapitalised) s2
 int SuggestMgr::leftcommonsubstring(char * s1, const char * s2) {
   if (utf8) {
@@ -28,6 +28,9 @@
 
 enum { LCS_UP, LCS_LEFT, LCS_UPLEFT };
 
+struct ngindex;
+struct ngjob;
+
 class LIBHUNSPELL_DLL_EXPORTED SuggestMgr
 {
   char *          ckey;
@@ -46,6 +49,7 @@ class LIBHUNSPELL_DLL_EXPORTED SuggestMgr
   int             nosplitsugs;
   int             maxngramsugs;
   int             complexprefixes;
+  struct ngindex * ngidx;     // ngsuggest candidates, one per dictionary
 
 
 public:
@@ -62,6 +66,9 @@ public:
   char * suggest_gen(char ** pl, int pln, char * pattern);
   char * suggest_morph_for_spelling_error(const char * word);
 
+  // scores one share of the ngsuggest candidates, called by worker threads
+  void ngscore(struct ngjob * job);
+
 private:
    int testsug(char** wlst, const char * candidate, int wl, int ns, int cpdsuggest,
      int * timer, clock_t * timelimit);
@@ -94,6 +101,14 @@ private:
    int mapchars(char**, const char *, int, int);
    int map_related(const char *, char *, int, int, char ** wlst, int, int, const mapentry*, int, int *, clock_t *);
    int ngram(int n, char * s1, const char * s2, int opt);
+   int ngram_lowered(int n, const char * s1, const w_char * su1, int l1,
+     const char * s2, int l2, int opt);
+   struct ngindex * ngindex_get(HashMgr * pHMgr);
+   struct ngindex * ngindex_build(HashMgr * pHMgr);
+   void ngindex_free(struct ngindex * idx);
+   int ngindex_lower(const char * word, char * dest);
+   int ngcandidates(struct ngindex * idx, const char * word, const w_char * su1,
+     int l1, int ** ids);
    int mystrlen(const char * word);
    int leftcommonsubstring(char * s1, const char * s2);
    int commoncharacterpositions(char * s1, const char * s2, int * is_swap);
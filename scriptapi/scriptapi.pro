@@ -28,6 +28,7 @@ UI_DIR = tmp
 
 HEADERS += setupscriptapi.h \
     include.h \
+    scriptcache.h \
     scriptapi_internal.h \
     metasqlhighlighterproto.h \
     orreportproto.h \
@@ -151,6 +152,7 @@ HEADERS += setupscriptapi.h \
     xdatawidgetmapperproto.h \
     xsqltablemodelproto.h \
     xsqlqueryproto.h \
+    xtreewidgetitemproto.h \
     addressclustersetup.h \
     alarmssetup.h \
     char.h \
@@ -184,6 +186,7 @@ HEADERS += setupscriptapi.h \
 
 SOURCES += setupscriptapi.cpp \
     include.cpp \
+    scriptcache.cpp \
     metasqlhighlighterproto.cpp \
     orreportproto.cpp \
     parameterlistsetup.cpp \
@@ -306,6 +309,7 @@ SOURCES += setupscriptapi.cpp \
     xdatawidgetmapperproto.cpp \
     xsqltablemodelproto.cpp \
     xsqlqueryproto.cpp \
+    xtreewidgetitemproto.cpp \
     addressclustersetup.cpp \
     alarmssetup.cpp \
     char.cpp \
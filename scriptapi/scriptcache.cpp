@@ -0,0 +1,206 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "scriptcache.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QScriptEngine>
+#include <QStringList>
+#include <QVariant>
+
+#include <xsqlquery.h>
+
+#define DEBUG false
+
+// neither cache grows without bound if scripts are edited all day
+#define MAXENTRIES 1000
+
+QHash<QScriptEngine*, ScriptCache::Programs> ScriptCache::_programs;
+QHash<QString, ScriptCache::Scripts>         ScriptCache::_scripts;
+QHash<int, ScriptCache::Timing>              ScriptCache::_timings;
+int                                          ScriptCache::_slowThreshold = 500;
+
+/*! \brief Return the id and source of every enabled script with the given
+           name, in script_order.
+
+  The server first sends one hash over the ids and sources of those
+  scripts. The sources themselves are only read again if it changed.
+ */
+QList<QPair<int, QString> > ScriptCache::scripts(const QString &name)
+{
+  XSqlQuery hashq;
+  hashq.prepare("SELECT COALESCE(md5(string_agg(script_id || ':' || md5(script_source), ','"
+                "                               ORDER BY script_order, script_id)), '') AS hash"
+                "  FROM script"
+                " WHERE ((script_name=:script_name)"
+                "   AND  (script_enabled));");
+  hashq.bindValue(":script_name", name);
+  hashq.exec();
+  QString hash;
+  if (hashq.first())
+  {
+    hash = hashq.value("hash").toString();
+    if (_scripts.contains(name) && _scripts.value(name).hash == hash)
+      return _scripts.value(name).scripts;
+  }
+
+  Scripts entry;
+  entry.hash = hash;
+  XSqlQuery scriptq;
+  scriptq.prepare("SELECT script_id, script_source"
+                  "  FROM script"
+                  " WHERE ((script_name=:script_name)"
+                  "   AND  (script_enabled))"
+                  " ORDER BY script_order, script_id;");
+  scriptq.bindValue(":script_name", name);
+  scriptq.exec();
+  while (scriptq.next())
+    entry.scripts.append(qMakePair(scriptq.value("script_id").toInt(),
+                                   scriptq.value("script_source").toString()));
+
+  // don't remember anything the server could not vouch for
+  if (! hash.isEmpty() || entry.scripts.isEmpty())
+  {
+    if (_scripts.size() >= MAXENTRIES)
+      _scripts.clear();
+    _scripts.insert(name, entry);
+  }
+
+  return entry.scripts;
+}
+
+/*! \brief Return a QScriptProgram for source to run in engine, reusing an
+           earlier one if engine already ran the same script with the
+           same text.
+ */
+QScriptProgram ScriptCache::program(QScriptEngine *engine, int scriptid,
+                                    const QString &source,
+                                    const QString &fileName, int line)
+{
+  if (_programs.value(engine).engine.isNull())
+  {
+    // a new engine, or a new one where a deleted one used to be
+    Programs &fresh = _programs[engine];
+    fresh.programs.clear();
+    fresh.engine = engine;
+
+    QMutableHashIterator<QScriptEngine*, Programs> it(_programs);
+    while (it.hasNext())
+      if (it.next().value().engine.isNull())
+        it.remove();
+  }
+  Programs &programs = _programs[engine];
+
+  QString key = QString("%1:%2:%3:%4")
+                  .arg(scriptid).arg(fileName).arg(line)
+                  .arg(QString(QCryptographicHash::hash(source.toUtf8(),
+                                                         QCryptographicHash::Md5).toHex()));
+  if (programs.programs.contains(key))
+    return programs.programs.value(key);
+
+  if (programs.programs.size() >= MAXENTRIES)
+    programs.programs.clear();
+
+  QScriptProgram program(source, fileName, line);
+  programs.programs.insert(key, program);
+  _timings[scriptid].compiles++;
+
+  return program;
+}
+
+/*! \brief Evaluate the cached program for source in engine and record how
+           long it took.
+
+  QtScript compiles a program the first time it runs, so the first
+  evaluation of each program in each engine is reported separately from
+  the total.
+ */
+QScriptValue ScriptCache::evaluate(QScriptEngine *engine, int scriptid,
+                                   const QString &source,
+                                   const QString &fileName, int line)
+{
+  int compiles = _timings.value(scriptid).compiles;
+  QScriptProgram prog = program(engine, scriptid, source, fileName, line);
+  bool first = (_timings.value(scriptid).compiles != compiles);
+
+  QElapsedTimer timer;
+  timer.start();
+  QScriptValue result = engine->evaluate(prog);
+  qint64 elapsed = timer.elapsed();
+
+  Timing &timing = _timings[scriptid];
+  timing.name = fileName;
+  timing.evaluations++;
+  timing.totalMsecs += elapsed;
+  if (first)
+    timing.firstMsecs += elapsed;
+  if (elapsed > timing.maxMsecs)
+    timing.maxMsecs = elapsed;
+
+  if (_slowThreshold >= 0 && elapsed > _slowThreshold)
+    qWarning() << "script" << fileName << "(id" << scriptid << ") took"
+               << elapsed << "ms to evaluate" << (first ? "(first run)" : "");
+  else if (DEBUG)
+    qDebug() << "script" << fileName << "(id" << scriptid << ") took"
+             << elapsed << "ms to evaluate" << (first ? "(first run)" : "");
+
+  return result;
+}
+
+void ScriptCache::clear()
+{
+  _programs.clear();
+  _scripts.clear();
+}
+
+/*! \brief Evaluations slower than this many milliseconds are logged with
+           qWarning. A negative value turns the warning off.
+ */
+int ScriptCache::slowThreshold()
+{
+  return _slowThreshold;
+}
+
+void ScriptCache::setSlowThreshold(int msecs)
+{
+  _slowThreshold = msecs;
+}
+
+/*! \brief Return a plain-text table of per-script timings, slowest first. */
+QString ScriptCache::timingReport()
+{
+  QList<QPair<qint64, int> > order;
+  QHashIterator<int, Timing> it(_timings);
+  while (it.hasNext())
+  {
+    it.next();
+    order.append(qMakePair(it.value().totalMsecs, it.key()));
+  }
+  qSort(order.begin(), order.end(), qGreater<QPair<qint64, int> >());
+
+  QStringList lines;
+  lines << QString("%1 %2 %3 %4 %5 %6 %7")
+             .arg("id",        8).arg("name", -30).arg("compiles", 8)
+             .arg("runs",      8).arg("first ms", 10).arg("total ms", 10)
+             .arg("max ms",    8);
+  for (int i = 0; i < order.size(); i++)
+  {
+    const Timing &timing = _timings[order.at(i).second];
+    lines << QString("%1 %2 %3 %4 %5 %6 %7")
+               .arg(order.at(i).second, 8).arg(timing.name, -30)
+               .arg(timing.compiles, 8).arg(timing.evaluations, 8)
+               .arg(timing.firstMsecs, 10).arg(timing.totalMsecs, 10)
+               .arg(timing.maxMsecs, 8);
+  }
+
+  return lines.join("\n");
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SCRIPTCACHE_H__
+#define __SCRIPTCACHE_H__
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QPointer>
+#include <QScriptEngine>
+#include <QScriptProgram>
+#include <QScriptValue>
+#include <QString>
+
+/* Process-wide cache of script sources and compiled QScriptPrograms.
+
+   The scripts with a given name are remembered with one hash the server
+   computes over their ids and sources, so re-reading them while nothing
+   has changed transfers only that hash. Programs are keyed by script id
+   and a hash of the final text, so editing a script in the script table
+   simply misses the cache.
+
+   QtScript binds compiled code to the engine that first runs it and
+   recompiles a program evaluated in another engine, so programs are kept
+   per engine: each engine compiles a script once however many times it
+   includes it, and its programs are dropped once it is destroyed.
+
+   Each evaluation is timed. Scripts that take longer than
+   slowThreshold() milliseconds are logged and timingReport() summarizes
+   every script seen so far.
+ */
+class ScriptCache
+{
+  public:
+    static QList<QPair<int, QString> > scripts(const QString &name);
+
+    static QScriptValue evaluate(QScriptEngine *engine, int scriptid,
+                                 const QString &source,
+                                 const QString &fileName, int line = 1);
+    static QScriptProgram program(QScriptEngine *engine, int scriptid,
+                                  const QString &source,
+                                  const QString &fileName, int line = 1);
+
+    static void    clear();
+    static int     slowThreshold();
+    static void    setSlowThreshold(int msecs);
+    static QString timingReport();
+
+  private:
+    struct Programs {
+      QPointer<QScriptEngine>        engine;
+      QHash<QString, QScriptProgram> programs;
+    };
+
+    struct Scripts {
+      QString                     hash;
+      QList<QPair<int, QString> > scripts;
+    };
+
+    struct Timing {
+      Timing() : compiles(0), evaluations(0), firstMsecs(0), totalMsecs(0), maxMsecs(0) {}
+      QString name;
+      int     compiles;
+      int     evaluations;
+      qint64  firstMsecs;
+      qint64  totalMsecs;
+      qint64  maxMsecs;
+    };
+
+    static QHash<QScriptEngine*, Programs> _programs;
+    static QHash<QString, Scripts>         _scripts;
+    static QHash<int, Timing>              _timings;
+    static int                             _slowThreshold;
+};
+
+#endif
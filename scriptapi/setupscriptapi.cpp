@@ -172,6 +172,7 @@
 #include "xsqltablemodelproto.h"
 #include "xsqlqueryproto.h"
 #include "xtreewidget.h"
+#include "xtreewidgetitemproto.h"
 #include "xvariantsetup.h"
 #include "xwebsync.h"
 
@@ -351,6 +352,7 @@ void setupScriptApi(QScriptEngine *engine)
   setupXt(engine);
   setupXTreeWidget(engine);
   setupXTreeWidgetItem(engine);
+  setupXTreeWidgetItemProto(engine);
   setupXVariant(engine);
   setupXWebSync(engine);
 }
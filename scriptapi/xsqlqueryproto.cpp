@@ -11,6 +11,7 @@
 #include "xsqlqueryproto.h"
 
 #include <QSqlError>
+#include <QSqlField>
 
 void setupXSqlQueryProto(QScriptEngine *engine)
 {
@@ -52,6 +53,100 @@ QScriptValue constructXSqlQuery(QScriptContext *context, QScriptEngine  *engine)
   return engine->toScriptValue(obj);
 }
 
+/* Convert one column value to the closest native script type here
+   instead of boxing a QVariant for the script to unwrap. fieldType is
+   the column's type from the QSqlRecord if the caller knows it; with
+   QSql::HighPrecision the driver returns numeric columns as strings,
+   which scripts still expect as numbers.
+ */
+QScriptValue SqlValuetoScriptValue(QScriptEngine *engine, const QVariant &value, QVariant::Type fieldType)
+{
+  if (value.isNull())
+    return QScriptValue(QScriptValue::NullValue);
+
+  if (value.type() == QVariant::String &&
+      (fieldType == QVariant::Double || fieldType == QVariant::LongLong))
+  {
+    bool ok = false;
+    double number = value.toDouble(&ok);
+    if (ok)
+      return QScriptValue(number);
+  }
+
+  switch ((int)value.type())
+  {
+    case QMetaType::Bool:
+      return QScriptValue(value.toBool());
+    case QMetaType::Char:
+    case QMetaType::Short:
+    case QMetaType::Int:
+      return QScriptValue(value.toInt());
+    case QMetaType::UChar:
+    case QMetaType::UShort:
+    case QMetaType::UInt:
+      return QScriptValue(value.toUInt());
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Float:
+    case QMetaType::Double:
+      return QScriptValue(value.toDouble());
+    case QMetaType::QString:
+      return QScriptValue(value.toString());
+    case QMetaType::QDate:
+    case QMetaType::QDateTime:
+      return engine->newDate(value.toDateTime());
+    case QMetaType::QTime:
+      return QScriptValue(value.toTime().toString(Qt::ISODate));
+    default:
+      return engine->newVariant(value);
+  }
+}
+
+/* Read up to max rows (all of them if max < 0) after the current position
+   as an array of arrays of column values. The query is left on the last
+   row read, so calling again returns the next chunk and an empty array
+   means there is nothing left.
+ */
+QScriptValue XSqlQuerytoRows(QScriptEngine *engine, XSqlQuery &query, int max)
+{
+  QScriptValue result = engine->newArray();
+  QSqlRecord record = query.record();
+  int columns = record.count();
+  quint32 row = 0;
+  while ((max < 0 || (int)row < max) && query.next())
+  {
+    QScriptValue values = engine->newArray(columns);
+    for (int col = 0; col < columns; col++)
+      values.setProperty(col, SqlValuetoScriptValue(engine, query.value(col),
+                                                    record.field(col).type()));
+    result.setProperty(row++, values);
+  }
+  return result;
+}
+
+/* Like XSqlQuerytoRows but each row is an object keyed by column name. */
+QScriptValue XSqlQuerytoRecords(QScriptEngine *engine, XSqlQuery &query, int max)
+{
+  QScriptValue result = engine->newArray();
+  QSqlRecord record = query.record();
+  QList<QScriptString> names;
+  for (int col = 0; col < record.count(); col++)
+    names.append(engine->toStringHandle(record.fieldName(col)));
+
+  quint32 row = 0;
+  while ((max < 0 || (int)row < max) && query.next())
+  {
+    QScriptValue values = engine->newObject();
+    for (int col = 0; col < names.size(); col++)
+      values.setProperty(names.at(col), SqlValuetoScriptValue(engine, query.value(col),
+                                                              record.field(col).type()));
+    result.setProperty(row++, values);
+  }
+  return result;
+}
+
 XSqlQueryProto::XSqlQueryProto(QObject * parent) : QObject(parent)
 {
 }
@@ -183,6 +278,42 @@ QVariantMap XSqlQueryProto::lastError()
   return m;
 }
 
+/** Return the result's column names as an array. */
+QScriptValue XSqlQueryProto::columns()
+{
+  QScriptValue result = engine()->newArray();
+  XSqlQuery *item = qscriptvalue_cast<XSqlQuery*>(thisObject());
+  if (item)
+  {
+    QSqlRecord record = item->record();
+    for (int col = 0; col < record.count(); col++)
+      result.setProperty(col, QScriptValue(record.fieldName(col)));
+  }
+  return result;
+}
+
+/** Return up to max rows, or all remaining rows, as an array of arrays.
+    This replaces a next()/value() loop with a single call.
+ */
+QScriptValue XSqlQueryProto::rows(int max)
+{
+  XSqlQuery *item = qscriptvalue_cast<XSqlQuery*>(thisObject());
+  if (item)
+    return XSqlQuerytoRows(engine(), *item, max);
+  return engine()->newArray();
+}
+
+/** Return up to max rows, or all remaining rows, as an array of objects
+    keyed by column name.
+ */
+QScriptValue XSqlQueryProto::records(int max)
+{
+  XSqlQuery *item = qscriptvalue_cast<XSqlQuery*>(thisObject());
+  if (item)
+    return XSqlQuerytoRecords(engine(), *item, max);
+  return engine()->newArray();
+}
+
 QString XSqlQueryProto::toString() const
 {
   XSqlQuery *item = qscriptvalue_cast<XSqlQuery*>(thisObject());
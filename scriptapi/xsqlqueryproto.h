@@ -23,6 +23,9 @@ Q_DECLARE_METATYPE(XSqlQuery)
 
 void setupXSqlQueryProto(QScriptEngine *engine);
 QScriptValue constructXSqlQuery(QScriptContext *context, QScriptEngine *engine);
+QScriptValue SqlValuetoScriptValue(QScriptEngine *engine, const QVariant &value, QVariant::Type fieldType = QVariant::Invalid);
+QScriptValue XSqlQuerytoRows(QScriptEngine *engine, XSqlQuery &query, int max = -1);
+QScriptValue XSqlQuerytoRecords(QScriptEngine *engine, XSqlQuery &query, int max = -1);
 
 class XSqlQueryProto : public QObject, public QScriptable
 {
@@ -48,6 +51,10 @@ class XSqlQueryProto : public QObject, public QScriptable
 
     Q_INVOKABLE QVariantMap lastError();
 
+    Q_INVOKABLE QScriptValue columns();
+    Q_INVOKABLE QScriptValue rows(int max = -1);
+    Q_INVOKABLE QScriptValue records(int max = -1);
+
     Q_INVOKABLE int findFirst(int, int);
     Q_INVOKABLE int findFirst(const QString &, int);
     Q_INVOKABLE int findFirst(const QString &, const QString &);
@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2012 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -9,8 +9,11 @@
  */
 
 #include "xtreewidgetitemproto.h"
-#include "xtreewidget.h"
 
+/* XTreeWidgetItems aren't QObjects. XTreeWidgetItemtoScriptValue wraps
+   the pointer in a variant and this prototype, shared by every item in
+   the engine, forwards script calls to it.
+ */
 void setupXTreeWidgetItemProto(QScriptEngine *engine)
 {
   QScriptValue itemproto = engine->newQObject(new XTreeWidgetItemProto(engine));
@@ -30,35 +33,45 @@ int XTreeWidgetItemProto::altId() const
   return -1;
 }
 
-int XTreeWidgetItemProto::id()    const
+XTreeWidgetItem *XTreeWidgetItemProto::child(int idx) const
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
-    return item->id();
-  return -1;
+    return item->child(idx);
+  return 0;
 }
 
-void XTreeWidgetItemProto::setAltId(const int pId)
+int XTreeWidgetItemProto::childCount() const
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
-    return item->setAltId(pId);
+    return item->childCount();
+  return 0;
 }
 
-void XTreeWidgetItemProto::setId(const int pId)
+int XTreeWidgetItemProto::columnCount() const
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
-    return item->setId(pId);
+    return item->columnCount();
+  return 0;
 }
 
-XTreeWidgetItem *XTreeWidgetItemProto::child(int idx) const
+QVariant XTreeWidgetItemProto::data(int column, int role) const
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
-    return item->child(idx);
-  return 0;
-}    
+    return item->data(column, role);
+  return QVariant();
+}
+
+int XTreeWidgetItemProto::id() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return item->id();
+  return -1;
+}
 
 int XTreeWidgetItemProto::id(const QString p)
 {
@@ -68,6 +81,38 @@ int XTreeWidgetItemProto::id(const QString p)
   return -1;
 }
 
+bool XTreeWidgetItemProto::isExpanded() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return item->isExpanded();
+  return false;
+}
+
+bool XTreeWidgetItemProto::isHidden() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return item->isHidden();
+  return false;
+}
+
+bool XTreeWidgetItemProto::isSelected() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return item->isSelected();
+  return false;
+}
+
+XTreeWidgetItem *XTreeWidgetItemProto::parent() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return dynamic_cast<XTreeWidgetItem*>(item->QTreeWidgetItem::parent());
+  return 0;
+}
+
 QVariant XTreeWidgetItemProto::rawValue(const QString pName)
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
@@ -76,14 +121,78 @@ QVariant XTreeWidgetItemProto::rawValue(const QString pName)
   return QVariant();
 }
 
-void XTreeWidgetItemProto::setText(int pColumn, const QVariant & pVariant)
+void XTreeWidgetItemProto::setAltId(int pId)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setAltId(pId);
+}
+
+void XTreeWidgetItemProto::setData(int column, int role, const QVariant &value)
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
-    item->setText(pColumn, pVariant.toString());
+    item->setData(column, role, value);
 }
 
-void XTreeWidgetItemProto::setTextColor(int column, const QColor & color)
+void XTreeWidgetItemProto::setDate(int column, const QVariant date)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setDate(column, date);
+}
+
+void XTreeWidgetItemProto::setExpanded(bool expand)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setExpanded(expand);
+}
+
+void XTreeWidgetItemProto::setHidden(bool hide)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setHidden(hide);
+}
+
+void XTreeWidgetItemProto::setId(int pId)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setId(pId);
+}
+
+void XTreeWidgetItemProto::setNumber(int column, const QVariant value, const QString role)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setNumber(column, value, role);
+}
+
+bool XTreeWidgetItemProto::setNumericRole(int column, const QString role)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return item->setNumericRole(column, role);
+  return false;
+}
+
+void XTreeWidgetItemProto::setSelected(bool select)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setSelected(select);
+}
+
+void XTreeWidgetItemProto::setText(int pColumn, const QVariant &pVariant)
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    item->setText(pColumn, pVariant);
+}
+
+void XTreeWidgetItemProto::setTextColor(int column, const QColor &color)
 {
   XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
   if (item)
@@ -113,6 +222,14 @@ QString XTreeWidgetItemProto::text(const QString &pColumn) const
   return QString();
 }
 
+XTreeWidget *XTreeWidgetItemProto::treeWidget() const
+{
+  XTreeWidgetItem *item = qscriptvalue_cast<XTreeWidgetItem*>(thisObject());
+  if (item)
+    return qobject_cast<XTreeWidget*>(item->treeWidget());
+  return 0;
+}
+
 QString XTreeWidgetItemProto::toString() const
 {
   QString returnVal = QString("XTreeWidgetItem");
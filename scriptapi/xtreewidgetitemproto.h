@@ -1,7 +1,7 @@
 /*
  * This file is part of the xTuple ERP: PostBooks Edition, a free and
  * open source Enterprise Resource Planning software suite,
- * Copyright (c) 1999-2012 by OpenMFG LLC, d/b/a xTuple.
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
  * It is licensed to you under the Common Public Attribution License
  * version 1.0, the full text of which (including xTuple-specific Exhibits)
  * is available at www.xtuple.com/CPAL.  By using this software, you agree
@@ -14,9 +14,7 @@
 #include <QObject>
 #include <QtScript>
 
-class XTreeWidgetItem;
-
-Q_DECLARE_METATYPE(XTreeWidgetItem*)
+#include "xtreewidget.h"
 
 void setupXTreeWidgetItemProto(QScriptEngine *engine);
 
@@ -24,25 +22,36 @@ class XTreeWidgetItemProto : public QObject, public QScriptable
 {
   Q_OBJECT
 
-  Q_PROPERTY(int id    READ id    WRITE setId    DESIGNABLE false)
-  Q_PROPERTY(int altId READ altId WRITE setAltId DESIGNABLE false)
-
   public:
     XTreeWidgetItemProto(QObject *parent = 0);
 
-    int  altId() const;
-    int  id()    const;
-    void setAltId(const int pId);
-    void setId(const int pId);
-
-    Q_INVOKABLE virtual XTreeWidgetItem *child(int idx) const;
-    Q_INVOKABLE virtual int              id(const QString);
-    Q_INVOKABLE virtual QVariant         rawValue(const QString);
-    Q_INVOKABLE virtual void             setText(int, const QVariant &);
-    Q_INVOKABLE virtual void             setTextColor(int column, const QColor & color);
-    Q_INVOKABLE virtual void             setTextColor(const QColor &);
-    Q_INVOKABLE virtual QString          text(int p)           const;
-    Q_INVOKABLE virtual QString          text(const QString &) const;
+    Q_INVOKABLE int              altId() const;
+    Q_INVOKABLE XTreeWidgetItem *child(int idx) const;
+    Q_INVOKABLE int              childCount() const;
+    Q_INVOKABLE int              columnCount() const;
+    Q_INVOKABLE QVariant         data(int column, int role) const;
+    Q_INVOKABLE int              id() const;
+    Q_INVOKABLE int              id(const QString);
+    Q_INVOKABLE bool             isExpanded() const;
+    Q_INVOKABLE bool             isHidden() const;
+    Q_INVOKABLE bool             isSelected() const;
+    Q_INVOKABLE XTreeWidgetItem *parent() const;
+    Q_INVOKABLE QVariant         rawValue(const QString);
+    Q_INVOKABLE void             setAltId(int pId);
+    Q_INVOKABLE void             setData(int column, int role, const QVariant &value);
+    Q_INVOKABLE void             setDate(int column, const QVariant date);
+    Q_INVOKABLE void             setExpanded(bool expand);
+    Q_INVOKABLE void             setHidden(bool hide);
+    Q_INVOKABLE void             setId(int pId);
+    Q_INVOKABLE void             setNumber(int column, const QVariant value, const QString role);
+    Q_INVOKABLE bool             setNumericRole(int column, const QString role);
+    Q_INVOKABLE void             setSelected(bool select);
+    Q_INVOKABLE void             setText(int, const QVariant &);
+    Q_INVOKABLE void             setTextColor(int column, const QColor &color);
+    Q_INVOKABLE void             setTextColor(const QColor &);
+    Q_INVOKABLE QString          text(int p)           const;
+    Q_INVOKABLE QString          text(const QString &) const;
+    Q_INVOKABLE XTreeWidget     *treeWidget() const;
 
   public slots:
     virtual QString toString() const;
@@ -235,7 +235,7 @@ void setupPeriodListViewItem(QScriptEngine *engine)
 PeriodListViewItem::PeriodListViewItem( PeriodsListView *parent, XTreeWidgetItem *itm, int pId,
                         QDate pStartDate, QDate pEndDate,
                         QString s0, QString s1 ) :
-XTreeWidgetItem(parent, itm, pId, QVariant(s0), QVariant(s1))
+QObject(), XTreeWidgetItem(parent, itm, pId, QVariant(s0), QVariant(s1))
 {
   _startDate = pStartDate;
   _endDate = pEndDate;
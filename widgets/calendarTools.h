@@ -94,7 +94,7 @@ class XTUPLEWIDGETS_EXPORT PeriodsListView : public XTreeWidget
 
 void setupPeriodListViewItem(QScriptEngine *engine);
 
-class XTUPLEWIDGETS_EXPORT PeriodListViewItem : public XTreeWidgetItem
+class XTUPLEWIDGETS_EXPORT PeriodListViewItem : public QObject, public XTreeWidgetItem
 {
   Q_OBJECT
 
@@ -106,6 +106,11 @@ class XTUPLEWIDGETS_EXPORT PeriodListViewItem : public XTreeWidgetItem
     Q_INVOKABLE inline QDate startDate() { return _startDate; }
     Q_INVOKABLE inline QDate endDate()   { return _endDate;   }
 
+    // XTreeWidgetItem isn't a QObject so expose what scripts used to get from it
+    Q_INVOKABLE inline int     id()    const { return XTreeWidgetItem::id();    }
+    Q_INVOKABLE inline int     altId() const { return XTreeWidgetItem::altId(); }
+    Q_INVOKABLE inline QString text(int column) const { return XTreeWidgetItem::text(column); }
+
   private:
     QDate _startDate;
     QDate _endDate;
@@ -17,6 +17,7 @@
 #include <QSqlError>
 
 #include "xsqlquery.h"
+#include "preparedquery.h"
 #include "xcombobox.h"
 #include "format.h"
 #include "xdoublevalidator.h"
@@ -745,22 +746,21 @@ void CurrDisplay::sValueBaseChanged(double newValue)
     }
     else
     {
-	XSqlQuery convertVal;
-	convertVal.prepare("SELECT currToLocal(:curr_id, :value, :date) "
-			     " AS localValue;");
-	convertVal.bindValue(":curr_id", id());
-	convertVal.bindValue(":value", newValue);
-	convertVal.bindValue(":date", _effective);
-	convertVal.exec();
-	if (convertVal.first())
+	PreparedQuery convertVal("SELECT currToLocal(:curr_id, :value, :date) "
+			         " AS localValue;");
+	convertVal->bindValue(":curr_id", id());
+	convertVal->bindValue(":value", newValue);
+	convertVal->bindValue(":date", _effective);
+	convertVal->exec();
+	if (convertVal->first())
 	{
-	    _valueLocal = convertVal.value("localValue").toDouble();
+	    _valueLocal = convertVal->value("localValue").toDouble();
 	    sZeroErrorCount(id(), effective());
 	    _localKnown = true;
 	}
-	else if (convertVal.lastError().type() != QSqlError::NoError)
+	else if (convertVal->lastError().type() != QSqlError::NoError)
 	{
-	    if (convertVal.lastError().databaseText().contains("No exchange rate"))
+	    if (convertVal->lastError().databaseText().contains("No exchange rate"))
 	    {
               emit noConversionRate();
               sNoConversionRate(this, id(), effective(), "sValueBaseChanged");
@@ -769,7 +769,7 @@ void CurrDisplay::sValueBaseChanged(double newValue)
 	      QMessageBox::critical(this, tr("A System Error occurred at %1::%2.")
 				    .arg(__FILE__)
 				    .arg(__LINE__),
-				    convertVal.lastError().databaseText());
+				    convertVal->lastError().databaseText());
 	    _localKnown = false;
 	}
     }
@@ -809,22 +809,21 @@ void CurrDisplay::sValueLocalChanged(double newValue)
     }
     else
     {
-	XSqlQuery convertVal;
-	convertVal.prepare("SELECT currToBase(:curr_id, :value, :date) "
-			   " AS baseValue;");
-	convertVal.bindValue(":curr_id", id());
-	convertVal.bindValue(":value", newValue);
-	convertVal.bindValue(":date", _effective);
-	convertVal.exec();
-	if (convertVal.first())
+	PreparedQuery convertVal("SELECT currToBase(:curr_id, :value, :date) "
+			         " AS baseValue;");
+	convertVal->bindValue(":curr_id", id());
+	convertVal->bindValue(":value", newValue);
+	convertVal->bindValue(":date", _effective);
+	convertVal->exec();
+	if (convertVal->first())
 	{
-	    _valueBase = convertVal.value("baseValue").toDouble();
+	    _valueBase = convertVal->value("baseValue").toDouble();
 	      sZeroErrorCount(id(), effective());
 	      _baseKnown = true;
 	}
-	else if (convertVal.lastError().type() != QSqlError::NoError)
+	else if (convertVal->lastError().type() != QSqlError::NoError)
 	{
-	    if (convertVal.lastError().databaseText().contains("No exchange rate"))
+	    if (convertVal->lastError().databaseText().contains("No exchange rate"))
 	    {
               emit noConversionRate();
               sNoConversionRate(this, id(), effective(), "sValueLocalChanged");
@@ -833,7 +832,7 @@ void CurrDisplay::sValueLocalChanged(double newValue)
 	      QMessageBox::critical(this, tr("A System Error occurred at %1::%2.")
 				    .arg(__FILE__)
 				    .arg(__LINE__),
-				    convertVal.lastError().databaseText());
+				    convertVal->lastError().databaseText());
 	    _baseKnown = false;
 	}
     }
@@ -957,24 +956,23 @@ double CurrDisplay::convert(const int from, const int to, const double amount, c
   if (from == to)
     return amount;
 
-  XSqlQuery convq;
-  convq.prepare("SELECT currToCurr(:from, :to, :amount, :date) AS result;");
-  convq.bindValue(":from",   from);
-  convq.bindValue(":to",     to);
-  convq.bindValue(":amount", amount);
-  convq.bindValue(":date",   date);
-  convq.exec();
-  if (convq.first())
-    return convq.value("result").toDouble();
-  else if (convq.lastError().type() != QSqlError::NoError)
+  PreparedQuery convq("SELECT currToCurr(:from, :to, :amount, :date) AS result;");
+  convq->bindValue(":from",   from);
+  convq->bindValue(":to",     to);
+  convq->bindValue(":amount", amount);
+  convq->bindValue(":date",   date);
+  convq->exec();
+  if (convq->first())
+    return convq->value("result").toDouble();
+  else if (convq->lastError().type() != QSqlError::NoError)
   {
-    if (convq.lastError().databaseText().contains("No exchange rate"))
+    if (convq->lastError().databaseText().contains("No exchange rate"))
       sNoConversionRate(0, from, date, "convert");
     else
       QMessageBox::critical(0, tr("A System Error occurred at %1::%2.")
 			    .arg(__FILE__)
 			    .arg(__LINE__),
-			    convq.lastError().databaseText());
+			    convq->lastError().databaseText());
   }
   return 0.0;
 }
@@ -15,6 +15,7 @@
 
 #include <QString>
 #include <QAction>
+#include <QPair>
 
 class XSqlQuery;
 
@@ -32,6 +33,7 @@ class GuiClientInterface
     virtual const QStringList hunspell_suggest(const QString word) = 0;
     virtual int hunspell_add(const QString word) = 0;
     virtual int hunspell_ignore(const QString word) = 0;
+    virtual QList<QPair<int, int> > hunspell_check_text(const QString &text) = 0;
 };
 
 #endif
@@ -0,0 +1,331 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "imagecache.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QImageWriter>
+#include <QRunnable>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QThreadPool>
+#include <QVariant>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+#include <quuencode.h>
+#include <xsqlquery.h>
+
+#define DEBUG false
+
+// default size of the in-memory cache of decoded images, in kilobytes
+#define DEFAULTMAXCOST (64 * 1024)
+
+/* Where the bytes of one image come from: a file in the on-disk cache
+   or the uuencoded image_data column.
+ */
+class ImageSource
+{
+  public:
+    ImageSource() : onDisk(false) {}
+
+    QString    cacheFile;
+    QString    encoded;
+    bool       onDisk;
+    QByteArray raw;
+
+    QImage decode()
+    {
+      if (onDisk)
+      {
+        QFile file(cacheFile);
+        if (file.open(QIODevice::ReadOnly))
+          raw = file.readAll();
+      }
+      else if (raw.isEmpty() && ! encoded.isEmpty())
+        raw = QUUDecode(encoded);
+
+      QImage image;
+      image.loadFromData(raw);
+
+      // a corrupt cache file would otherwise be read again on every request
+      if (onDisk && image.isNull())
+      {
+        qWarning("ImageCache removing unreadable cache file %s",
+                 qPrintable(cacheFile));
+        QFile::remove(cacheFile);
+      }
+
+      // write to a temp file and rename so other clients never see a partial file
+      if (! onDisk && ! cacheFile.isEmpty() && ! image.isNull())
+      {
+        QFile tmp(cacheFile + ".tmp");
+        if (tmp.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+          tmp.write(raw);
+          tmp.close();
+          if (! tmp.rename(cacheFile))
+            tmp.remove();
+        }
+      }
+
+      return image;
+    }
+};
+
+/* Decodes one image on a QThreadPool thread and hands the result back to
+   the cache on the GUI thread.
+ */
+class ImageDecoder : public QRunnable
+{
+  public:
+    ImageDecoder(int imageid, const ImageSource &source)
+      : _imageid(imageid),
+        _source(source)
+    {
+    }
+
+    void run()
+    {
+      QImage image = _source.decode();
+      QMetaObject::invokeMethod(ImageCache::instance(), "sDecoded",
+                                Qt::QueuedConnection,
+                                Q_ARG(int,    _imageid),
+                                Q_ARG(QImage, image));
+    }
+
+  private:
+    int         _imageid;
+    ImageSource _source;
+};
+
+ImageCache *ImageCache::_instance = 0;
+
+/** @class ImageCache
+
+    @brief A process-wide cache of decoded images from the image table.
+
+    Decoding the uuencoded image_data of a large product photo takes long
+    enough to notice, so ImageCache keeps recently used images in memory,
+    least recently used first out, keyed by image_id. The raw image bytes
+    are also kept on disk, named by image_id and the md5 of image_data, so
+    a later session only needs to ask the server for the hash.
+
+    Use image() when the picture is needed right away, or request() to
+    decode it on a background thread and wait for imageReady() or
+    imageFailed(). Call invalidate() after changing or deleting an image.
+ */
+ImageCache::ImageCache(QObject *parent)
+  : QObject(parent)
+{
+  _images.setMaxCost(DEFAULTMAXCOST);
+
+#if QT_VERSION >= 0x050000
+  QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+  QString base = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+  QSqlDatabase db = QSqlDatabase::database();
+  if (! base.isEmpty() && db.isValid())
+  {
+    QString dbkey = QCryptographicHash::hash(QString("%1:%2/%3")
+                                               .arg(db.hostName())
+                                               .arg(db.port())
+                                               .arg(db.databaseName()).toUtf8(),
+                                             QCryptographicHash::Md5).toHex();
+    QDir dir(base + "/images/" + dbkey);
+    if (dir.exists() || dir.mkpath(dir.path()))
+      _cacheDir = dir.path();
+  }
+}
+
+ImageCache *ImageCache::instance()
+{
+  if (! _instance)
+    _instance = new ImageCache(qApp);
+  return _instance;
+}
+
+/** @brief Return the full-size image, decoding it on the calling thread if
+           it is not already in memory.
+ */
+QImage ImageCache::image(int imageid)
+{
+  if (_images.contains(imageid))
+    return *_images.object(imageid);
+
+  ImageSource source;
+  if (! fetch(imageid, source))
+    return QImage();
+
+  QImage result = source.decode();
+  insert(imageid, result);
+
+  return result;
+}
+
+/** @brief Start decoding an image in the background.
+
+    The image data are read from the database or disk cache on the calling
+    thread; decoding happens on a worker thread.
+
+    @return true if the image is already cached, in which case imageReady()
+            is not emitted; false if the caller should wait for imageReady()
+            or imageFailed()
+ */
+bool ImageCache::request(int imageid)
+{
+  if (_images.contains(imageid))
+    return true;
+
+  if (_pending.contains(imageid))
+    return false;
+
+  ImageSource source;
+  if (! fetch(imageid, source))
+  {
+    QMetaObject::invokeMethod(this, "imageFailed", Qt::QueuedConnection,
+                              Q_ARG(int, imageid));
+    return false;
+  }
+
+  _pending.insert(imageid);
+  QThreadPool::globalInstance()->start(new ImageDecoder(imageid, source));
+
+  return false;
+}
+
+/** @brief Bind the :image_data parameter of @a qry to a uuencoded PNG copy
+           of @a image.
+
+    @return false if @a image could not be converted to PNG, in which case
+            nothing is bound
+ */
+bool ImageCache::bindImageData(XSqlQuery &qry, const QImage &image)
+{
+  QBuffer      buffer;
+  QImageWriter writer;
+  buffer.open(QIODevice::ReadWrite);
+  writer.setDevice(&buffer);
+  writer.setFormat("PNG");
+  if (! writer.write(image))
+  {
+    qWarning("ImageCache could not write image: %s",
+             qPrintable(writer.errorString()));
+    return false;
+  }
+  buffer.close();
+
+  qry.bindValue(":image_data", QUUEncode(buffer));
+
+  return true;
+}
+
+/** @brief Forget the image, for example after it has been saved or deleted.
+
+    The disk cache needs no help since its files are named by the md5 of
+    the image data.
+ */
+void ImageCache::invalidate(int imageid)
+{
+  _images.remove(imageid);
+}
+
+/** @brief Limit the memory used by decoded images to about @a kilobytes.
+ */
+void ImageCache::setMaxCost(int kilobytes)
+{
+  _images.setMaxCost(kilobytes);
+}
+
+void ImageCache::sDecoded(int imageid, QImage image)
+{
+  _pending.remove(imageid);
+
+  if (image.isNull())
+  {
+    qWarning("ImageCache could not decode image %d", imageid);
+    emit imageFailed(imageid);
+    return;
+  }
+
+  insert(imageid, image);
+
+  emit imageReady(imageid);
+}
+
+QString ImageCache::cacheFileName(int imageid, const QString &hash) const
+{
+  if (_cacheDir.isEmpty() || hash.isEmpty())
+    return QString();
+  return QString("%1/%2-%3").arg(_cacheDir).arg(imageid).arg(hash);
+}
+
+/* Find the image data for imageid. When there is an on-disk cache, ask the
+   server for the md5 of the data first so we only transfer the image if
+   it has not been seen before or has changed.
+ */
+bool ImageCache::fetch(int imageid, ImageSource &source)
+{
+  if (! _cacheDir.isEmpty())
+  {
+    XSqlQuery hashq;
+    hashq.prepare("SELECT md5(image_data) AS hash FROM image WHERE image_id=:image_id;");
+    hashq.bindValue(":image_id", imageid);
+    hashq.exec();
+    if (! hashq.first())
+      return false;
+
+    source.cacheFile = cacheFileName(imageid, hashq.value("hash").toString());
+    if (QFile::exists(source.cacheFile))
+    {
+      source.onDisk = true;
+      return true;
+    }
+  }
+
+  XSqlQuery dataq;
+  dataq.prepare("SELECT image_data FROM image WHERE image_id=:image_id;");
+  dataq.bindValue(":image_id", imageid);
+  dataq.exec();
+  if (! dataq.first())
+  {
+    if (dataq.lastError().type() != QSqlError::NoError)
+      qWarning("ImageCache could not read image %d: %s", imageid,
+               qPrintable(dataq.lastError().text()));
+    return false;
+  }
+
+  source.encoded = dataq.value("image_data").toString();
+
+  if (DEBUG)
+    qDebug("ImageCache::fetch(%d) got %d encoded bytes", imageid,
+           source.encoded.size());
+
+  return true;
+}
+
+void ImageCache::insert(int imageid, const QImage &image)
+{
+#if QT_VERSION >= 0x050a00
+  qint64 bytes = image.sizeInBytes();
+#else
+  qint64 bytes = image.byteCount();
+#endif
+  if (! image.isNull())
+    _images.insert(imageid, new QImage(image), qMax(int(bytes / 1024), 1));
+}
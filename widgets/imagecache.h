@@ -0,0 +1,62 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+#include "widgets.h"
+
+class ImageSource;
+class XSqlQuery;
+
+class XTUPLEWIDGETS_EXPORT ImageCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static ImageCache *instance();
+
+    virtual QImage image(int imageid);
+    virtual bool   request(int imageid);
+
+    virtual bool   bindImageData(XSqlQuery &qry, const QImage &image);
+    virtual void   invalidate(int imageid);
+    virtual void   setMaxCost(int kilobytes);
+
+  signals:
+    void imageReady(int imageid);
+    void imageFailed(int imageid);
+
+  protected:
+    ImageCache(QObject *parent = 0);
+
+  private slots:
+    void sDecoded(int imageid, QImage image);
+
+  private:
+    QString cacheFileName(int imageid, const QString &hash) const;
+    bool    fetch(int imageid, ImageSource &source);
+    void    insert(int imageid, const QImage &image);
+
+    QString                 _cacheDir;
+    QCache<int, QImage>     _images;
+    QSet<int>               _pending;
+
+    static ImageCache *_instance;
+};
+
+#endif
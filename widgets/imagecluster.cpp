@@ -13,7 +13,7 @@
 #include <QPixmap>
 #include <QScrollArea>
 
-#include <quuencode.h>
+#include "imagecache.h"
 
 #define DEBUG   false
 
@@ -34,6 +34,9 @@ ImageCluster::ImageCluster(QWidget* pParent, const char* pName) :
   _name->hide();
 
   _nullPixmap = QPixmap();
+
+  connect(ImageCache::instance(), SIGNAL(imageReady(int)), this, SLOT(sImageReady(int)));
+  connect(ImageCache::instance(), SIGNAL(imageFailed(int)), this, SLOT(sImageFailed(int)));
 }
 
 void ImageCluster::clear()
@@ -57,28 +60,42 @@ void ImageCluster::sRefresh()
     _image->setText(tr("picture here"));
     _image->setPixmap(_nullPixmap);
   }
+  else if (ImageCache::instance()->request(id()))
+    sImageReady(id());
   else
   {
-    XSqlQuery data;
-    data.prepare("SELECT image_data FROM image WHERE image_id=:image_id");
-    data.bindValue(":image_id", id());
-    data.exec();
-    if (data.first())
-    {
-      if (DEBUG)
-        qDebug("ImageCluster::sRefresh() has picture %s, %d",
-               qPrintable(_description->text().right(128)),
-               data.value("image_data").toString().length());
-      QImage tmpImage;
-      tmpImage.loadFromData(QUUDecode(data.value("image_data").toString()));
-      _image->setPixmap(QPixmap::fromImage(tmpImage));
-    }
+    if (DEBUG)
+      qDebug("ImageCluster::sRefresh() waiting for picture %d", id());
+    _image->setPixmap(_nullPixmap);
+    _image->setText(tr("Loading..."));
   }
 
   if (DEBUG)
     qDebug("ImageCluster::sRefresh() returning");
 }
 
+void ImageCluster::sImageReady(int imageid)
+{
+  if (imageid != id())
+    return;
+
+  QImage image = ImageCache::instance()->image(imageid);
+  if (DEBUG)
+    qDebug("ImageCluster::sImageReady() has picture %d, %dx%d",
+           imageid, image.width(), image.height());
+  _image->setPixmap(QPixmap::fromImage(image));
+}
+
+void ImageCluster::sImageFailed(int imageid)
+{
+  if (imageid != id())
+    return;
+
+  if (DEBUG)
+    qDebug("ImageCluster::sImageFailed() could not load picture %d", imageid);
+  _image->clear();
+}
+
 void ImageCluster::setNumberVisible(const bool p)
 {
   _number->setVisible(p);
@@ -70,6 +70,8 @@ class XTUPLEWIDGETS_EXPORT ImageCluster : public VirtualCluster
       virtual void setNumberVisible(const bool p);
 
   protected slots:
+      virtual void sImageFailed(int imageid);
+      virtual void sImageReady(int imageid);
 
   private:
     QLabel *_image;
@@ -21,7 +21,8 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QScrollArea>
-#include <quuencode.h>
+
+#include "imagecache.h"
 
 imageview::imageview(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : QDialog(parent, fl)
@@ -124,7 +125,7 @@ void imageview::set(const ParameterList &pParams)
 void imageview::populate()
 {
   XSqlQuery image;
-  image.prepare( "SELECT image_name, image_descrip, image_data "
+  image.prepare( "SELECT image_name, image_descrip "
                  "FROM image "
                  "WHERE (image_id=:image_id);" );
   image.bindValue(":image_id", _imageviewid);
@@ -134,7 +135,7 @@ void imageview::populate()
     _name->setText(image.value("image_name").toString());
     _descrip->setText(image.value("image_descrip").toString());
 
-    __imageview.loadFromData(QUUDecode(image.value("image_data").toString()));
+    __imageview = ImageCache::instance()->image(_imageviewid);
     _imageview->setPixmap(QPixmap::fromImage(__imageview));
   }
 }
@@ -156,24 +157,6 @@ void imageview::sSave()
       if (imageid.first())
         _imageviewid = imageid.value("_image_id").toInt();
 //  ToDo
- 
-      QImageWriter imageIo;
-      QBuffer  imageBuffer;
-      QString  imageString;
-
-      imageBuffer.open(QIODevice::ReadWrite);
-      imageIo.setDevice(&imageBuffer);
-      imageIo.setFormat("PNG");
-
-      if (!imageIo.write(__imageview))
-      {
-//  ToDo - should issue an error here
-        reject();
-        return;
-      }
-
-      imageBuffer.close();
-      imageString = QUUEncode(imageBuffer);
 
       newImage.prepare( "INSERT INTO image "
                         "(image_id, image_name, image_descrip, image_data) "
@@ -182,7 +165,13 @@ void imageview::sSave()
       newImage.bindValue(":image_id", _imageviewid);
       newImage.bindValue(":image_name", _name->text());
       newImage.bindValue(":image_descrip", _descrip->toPlainText());
-      newImage.bindValue(":image_data", imageString);
+      if (! ImageCache::instance()->bindImageData(newImage, __imageview))
+      {
+        QMessageBox::critical(this, tr("Error Saving Image"),
+          tr("There was an error trying to save the image.") );
+        reject();
+        return;
+      }
     }
   }
   else if (_mode == cEdit)
@@ -196,6 +185,7 @@ void imageview::sSave()
   }
 
   newImage.exec();
+  ImageCache::instance()->invalidate(_imageviewid);
 
   done(_imageviewid);
 }
@@ -9,6 +9,8 @@
  */
 
 #include <QApplication>
+#include <QCache>
+#include <QHash>
 #include <QMessageBox>
 #include <QSqlRecord>
 #include <QStandardItemEditorCreator>
@@ -21,8 +23,58 @@
 
 #define DEBUG false
 
+// how long, in seconds, a resolved item number or barcode may be reused
+#define RESOLUTION_TTL 300
+
+static QCache<QString, ItemResolution> _itemResolutions(500);
+static QHash<int, QHash<QString, ItemResolution> > _itemBarcodes;  // by site
+
 QString buildItemLineEditQuery(const QString, const QStringList, const QString, const unsigned int, bool);
 QString buildItemLineEditTitle(const unsigned int, const QString);
+QStringList itemTypeCodes(const unsigned int);
+
+QStringList itemTypeCodes(const unsigned int pType)
+{
+  QStringList types;
+
+  if (pType & ItemLineEdit::cPurchased)
+    types << "P";
+
+  if (pType & ItemLineEdit::cManufactured)
+    types << "M";
+
+  if (pType & ItemLineEdit::cPhantom)
+    types << "F";
+
+  if (pType & ItemLineEdit::cBreeder)
+    types << "B";
+
+  if (pType & ItemLineEdit::cCoProduct)
+    types << "C";
+
+  if (pType & ItemLineEdit::cByProduct)
+    types << "Y";
+
+  if (pType & ItemLineEdit::cReference)
+    types << "R";
+
+  if (pType & ItemLineEdit::cCosting)
+    types << "S";
+
+  if (pType & ItemLineEdit::cTooling)
+    types << "T";
+
+  if (pType & ItemLineEdit::cOutsideProcess)
+    types << "O";
+
+  if (pType & ItemLineEdit::cPlanning)
+    types << "L";
+
+  if (pType & ItemLineEdit::cKit)
+    types << "K";
+
+  return types;
+}
 
 QString buildItemLineEditQuery(const QString pPre, const QStringList pClauses, const QString pPost, const unsigned int pType, bool unionAlias)
 {
@@ -31,12 +83,13 @@ QString buildItemLineEditQuery(const QString pPre, const QStringList pClauses, c
   if (unionAlias) 
   {
     sql = pPre + " FROM ("
-                 "   SELECT item_id, item_number, item_descrip1, item_descrip2, "
+                 "   SELECT item_id, item_number, item_number AS item_master_number, "
+                 "      item_descrip1, item_descrip2, "
                  "      item_upccode, item_type, item_fractional, item_config, item_inv_uom_id, "
                  "      item_sold, item_active "
                  "   FROM item "
                  "   UNION "
-                 "   SELECT item_id, itemalias_number, "
+                 "   SELECT item_id, itemalias_number, item_number, "
                  "     CASE WHEN LENGTH(itemalias_descrip1) > 1 THEN itemalias_descrip1 ELSE item_descrip1 END, "
                  "     CASE WHEN LENGTH(itemalias_descrip2) > 1 THEN itemalias_descrip1 ELSE item_descrip2 END, "
                  "      item_upccode, item_type, item_fractional, item_config, item_inv_uom_id,"
@@ -75,42 +128,8 @@ QString buildItemLineEditQuery(const QString pPre, const QStringList pClauses, c
   if (pType & ItemLineEdit::cAllItemTypes_Mask)
   {
     QStringList types;
-
-    if (pType & ItemLineEdit::cPurchased)
-      types << "'P'";
-
-    if (pType & ItemLineEdit::cManufactured)
-      types << "'M'";
-
-    if (pType & ItemLineEdit::cPhantom)
-      types << "'F'";
-
-    if (pType & ItemLineEdit::cBreeder)
-      types << "'B'";
-
-    if (pType & ItemLineEdit::cCoProduct)
-      types << "'C'";
-
-    if (pType & ItemLineEdit::cByProduct)
-      types << "'Y'";
-
-    if (pType & ItemLineEdit::cReference)
-      types << "'R'";
-
-    if (pType & ItemLineEdit::cCosting)
-      types << "'S'";
-
-    if (pType & ItemLineEdit::cTooling)
-      types << "'T'";
-
-    if (pType & ItemLineEdit::cOutsideProcess)
-      types << "'O'";
-
-    if (pType & ItemLineEdit::cPlanning)
-      types << "'L'";
-
-    if (pType & ItemLineEdit::cKit)
-      types << "'K'";
+    foreach (QString code, itemTypeCodes(pType))
+      types << "'" + code + "'";
 
     if (!types.isEmpty())
       clauses << QString("(item_type IN (" + types.join(",") + "))");
@@ -273,6 +292,7 @@ ItemLineEdit::ItemLineEdit(QWidget* pParent, const char* pName) :
   _id = -1;
   _configured = false;
   _fractional = false;
+  _barcodeWarehousid = -1;
   _delegate = new ItemLineEditDelegate(this);
 
   connect(_aliasAct, SIGNAL(triggered()), this, SLOT(sAlias()));
@@ -431,35 +451,20 @@ void ItemLineEdit::silentSetId(const int pId)
 
   if (found)
   {
-    if (completer())
-    {
-      disconnect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
-      static_cast<QSqlQueryModel* >(completer()->model())->setQuery(QSqlQuery());
-    }
-
-    _itemNumber = item.value("item_number").toString();
-    _uom        = item.value("uom_name").toString();
-    _itemType   = item.value("item_type").toString();
-    _configured = item.value("item_config").toBool();
-    _fractional = item.value("item_fractional").toBool();
-    _upc        = item.value("item_upccode").toString();
-    _id         = pId;
-    _valid      = true;
-
-    setText(item.value("item_number").toString());
-    emit aliasChanged("");
-    emit typeChanged(_itemType);
-    emit descrip1Changed(item.value("item_descrip1").toString());
-    emit descrip2Changed(item.value("item_descrip2").toString());
-    emit uomChanged(item.value("uom_name").toString());
-    emit configured(item.value("item_config").toBool());
-    emit fractional(item.value("item_fractional").toBool());
-    emit upcChanged(item.value("item_upccode").toString());
-    
-    emit valid(true);
-
-    if (completer())
-      connect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
+    ItemResolution r;
+    r.id         = pId;
+    r.warehousid = -1;
+    r.number     = item.value("item_number").toString();
+    r.descrip1   = item.value("item_descrip1").toString();
+    r.descrip2   = item.value("item_descrip2").toString();
+    r.uom        = item.value("uom_name").toString();
+    r.type       = item.value("item_type").toString();
+    r.upc        = item.value("item_upccode").toString();
+    r.configured = item.value("item_config").toBool();
+    r.fractional = item.value("item_fractional").toBool();
+    r.sold       = false;
+    r.active     = false;
+    setResolution(r);
   }
   else
   {
@@ -502,6 +507,73 @@ void ItemLineEdit::setItemsiteid(int pItemsiteid)
   if (DEBUG)
     qDebug("%s::setItemsiteId(%d) entered",
            qPrintable(objectName()), pItemsiteid);
+
+  // resolve the item site and its item together unless a custom query
+  // decides which items are valid
+  if (! _useQuery && ! _useValidationQuery && pItemsiteid > 0)
+  {
+    QString key = resolutionKey(QString("itemsite:%1").arg(pItemsiteid));
+    ItemResolution *cached = _itemResolutions.object(key);
+    if (cached && cached->loaded.secsTo(QDateTime::currentDateTime()) < RESOLUTION_TTL)
+    {
+      ItemResolution r = *cached;
+      bool changed = (r.id != _id);
+      setResolution(r);
+      if (changed)
+      {
+        emit privateIdChanged(_id);
+        emit newId(_id);
+      }
+      emit warehouseIdChanged(r.warehousid);
+      return;
+    }
+
+    XSqlQuery item;
+    QString pre( "SELECT DISTINCT item_id, item_number, item_descrip1, item_descrip2,"
+                 "                uom_name, item_type, item_config, item_fractional, item_upccode,"
+                 "                item_sold, item_active,"
+                 "                (SELECT itemsite_warehous_id"
+                 "                   FROM itemsite"
+                 "                  WHERE (itemsite_id=:itemsite_id)) AS warehous_id");
+    QStringList clauses = _extraClauses;
+    clauses << "(item_id=(SELECT itemsite_item_id"
+               "            FROM itemsite"
+               "           WHERE (itemsite_id=:itemsite_id)))";
+    item.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, false));
+    item.bindValue(":itemsite_id", pItemsiteid);
+    item.exec();
+    if (item.first())
+    {
+      ItemResolution *r = new ItemResolution;
+      r->id         = item.value("item_id").toInt();
+      r->warehousid = item.value("warehous_id").toInt();
+      r->number     = item.value("item_number").toString();
+      r->matched    = r->number;
+      r->descrip1   = item.value("item_descrip1").toString();
+      r->descrip2   = item.value("item_descrip2").toString();
+      r->uom        = item.value("uom_name").toString();
+      r->type       = item.value("item_type").toString();
+      r->upc        = item.value("item_upccode").toString();
+      r->configured = item.value("item_config").toBool();
+      r->fractional = item.value("item_fractional").toBool();
+      r->sold       = item.value("item_sold").toBool();
+      r->active     = item.value("item_active").toBool();
+      r->loaded     = QDateTime::currentDateTime();
+
+      bool changed = (r->id != _id);
+      int  warehousid = r->warehousid;
+      setResolution(*r);
+      _itemResolutions.insert(key, r);
+      if (changed)
+      {
+        emit privateIdChanged(_id);
+        emit newId(_id);
+      }
+      emit warehouseIdChanged(warehousid);
+      return;
+    }
+  }
+
   XSqlQuery itemsite;
   itemsite.prepare( "SELECT itemsite_item_id, itemsite_warehous_id "
                     "FROM itemsite "
@@ -852,37 +924,99 @@ void ItemLineEdit::sParse()
     }
     else
     {
-      XSqlQuery item;
-
-      QString pre( "SELECT DISTINCT item_id, item_number AS number, "
-                   "(item_descrip1 || ' ' || item_descrip2) AS name, "
-                   "item_upccode AS description " );
+      QString searchString = text().trimmed().toUpper();
+
+      // scanned barcodes for the site this widget preloaded resolve from
+      // memory until they are RESOLUTION_TTL old
+      QHash<QString, ItemResolution> barcodes = _itemBarcodes.value(_barcodeWarehousid);
+      QHash<QString, ItemResolution>::const_iterator barcode = barcodes.constFind(searchString);
+      if (barcode != barcodes.constEnd() &&
+          barcode->loaded.secsTo(QDateTime::currentDateTime()) < RESOLUTION_TTL &&
+          canResolveInMemory(*barcode))
+      {
+        ItemResolution r = *barcode;
+        bool changed = (r.id != _id);
+        setResolution(r);
+        if (changed)
+        {
+          emit privateIdChanged(_id);
+          emit newId(_id);
+        }
+        return;
+      }
 
-      QStringList clauses;
-      // first check item number
-      clauses = _extraClauses;
-      clauses << "(POSITION(:searchString IN item_number) = 1)";
-      item.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
-                               .replace(";"," ORDER BY item_number LIMIT 1;"));
-      item.bindValue(":searchString", QString(text().trimmed().toUpper()));
-      item.exec();
-      if (item.first())
+      // so do recent lookups of the same text with the same filters
+      QString key = resolutionKey(searchString);
+      ItemResolution *cached = _itemResolutions.object(key);
+      if (cached && cached->loaded.secsTo(QDateTime::currentDateTime()) < RESOLUTION_TTL)
       {
-        setId(item.value("item_id").toInt());
-        if(_itemNumber != item.value("number").toString())
-          emit aliasChanged(item.value("number").toString());
+        ItemResolution r = *cached;
+        bool changed = (r.id != _id);
+        setResolution(r);
+        if (changed)
+        {
+          emit privateIdChanged(_id);
+          emit newId(_id);
+        }
         return;
       }
-      // item number not found, check upccode
+
+      // otherwise look for the number, UPC and aliases in one query,
+      // preferring exact matches over prefixes
+      XSqlQuery item;
+      QString pre( "SELECT DISTINCT item_id, item_number, item_master_number,"
+                   "                item_descrip1, item_descrip2, uom_name, item_type,"
+                   "                item_config, item_fractional, item_upccode,"
+                   "                item_sold, item_active,"
+                   "       CASE WHEN (item_number=:searchString) THEN 0"
+                   "            WHEN (item_upccode=:searchString) THEN 1"
+                   "            WHEN (POSITION(:searchString IN item_number) = 1) THEN 2"
+                   "            ELSE 3"
+                   "       END AS matchrank" );
+
+      QStringList clauses;
       clauses = _extraClauses;
-      clauses << "(POSITION(:searchString IN item_upccode) = 1)";
+      clauses << "((POSITION(:searchString IN item_number) = 1)"
+                 " OR (POSITION(:searchString IN item_upccode) = 1))";
       item.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
-                   .replace(";"," ORDER BY item_number LIMIT 1;"));
-      item.bindValue(":searchString", QString(text().trimmed().toUpper()));
+                   .replace(";"," ORDER BY matchrank, item_number LIMIT 1;"));
+      item.bindValue(":searchString", searchString);
       item.exec();
       if (item.first())
       {
-        setId(item.value("item_id").toInt());
+        // an alias carries its own descriptions, so show the item itself
+        if (item.value("item_number") != item.value("item_master_number"))
+        {
+          setId(item.value("item_id").toInt());
+          if(_itemNumber != item.value("item_number").toString())
+            emit aliasChanged(item.value("item_number").toString());
+          return;
+        }
+
+        ItemResolution *r = new ItemResolution;
+        r->id         = item.value("item_id").toInt();
+        r->warehousid = -1;
+        r->number     = item.value("item_number").toString();
+        r->matched    = searchString;
+        r->descrip1   = item.value("item_descrip1").toString();
+        r->descrip2   = item.value("item_descrip2").toString();
+        r->uom        = item.value("uom_name").toString();
+        r->type       = item.value("item_type").toString();
+        r->upc        = item.value("item_upccode").toString();
+        r->configured = item.value("item_config").toBool();
+        r->fractional = item.value("item_fractional").toBool();
+        r->sold       = item.value("item_sold").toBool();
+        r->active     = item.value("item_active").toBool();
+        r->loaded     = QDateTime::currentDateTime();
+
+        bool changed = (r->id != _id);
+        setResolution(*r);
+        _itemResolutions.insert(key, r);
+        if (changed)
+        {
+          emit privateIdChanged(_id);
+          emit newId(_id);
+        }
         return;
       }
       if (_x_metrics->boolean("AutoItemSearch"))
@@ -906,6 +1040,135 @@ void ItemLineEdit::addExtraClause(const QString & pClause)
   _extraClauses << pClause;
 }
 
+/* Load the UPC codes of every item stocked at the given site so scanning
+   them into this widget resolves without a query. Codes that are also an
+   item number or alias are left out, since typing those must still find
+   the number. Widgets preloading the same site share the codes.
+ */
+void ItemLineEdit::preloadBarcodes(int warehousid)
+{
+  _barcodeWarehousid = warehousid;
+  _itemBarcodes.remove(warehousid);
+  if (warehousid < 0)
+    return;
+
+  XSqlQuery barcodes;
+  barcodes.prepare("SELECT item_id, item_number, item_descrip1, item_descrip2,"
+                   "       uom_name, item_type, item_config, item_fractional,"
+                   "       UPPER(item_upccode) AS item_upccode, item_sold, item_active"
+                   "  FROM item"
+                   "  JOIN uom ON (uom_id=item_inv_uom_id)"
+                   " WHERE (COALESCE(item_upccode, '') != '')"
+                   "   AND (item_id IN (SELECT itemsite_item_id"
+                   "                      FROM itemsite"
+                   "                     WHERE ((itemsite_warehous_id=:warehous_id)"
+                   "                        AND (itemsite_active))))"
+                   "   AND (UPPER(item_upccode) NOT IN (SELECT UPPER(item_number) FROM item))"
+                   "   AND (UPPER(item_upccode) NOT IN (SELECT UPPER(itemalias_number) FROM itemalias));");
+  barcodes.bindValue(":warehous_id", warehousid);
+  barcodes.exec();
+  QDateTime now = QDateTime::currentDateTime();
+  QHash<QString, ItemResolution> &sitecodes = _itemBarcodes[warehousid];
+  while (barcodes.next())
+  {
+    ItemResolution r;
+    r.id         = barcodes.value("item_id").toInt();
+    r.warehousid = warehousid;
+    r.number     = barcodes.value("item_number").toString();
+    r.matched    = barcodes.value("item_upccode").toString();
+    r.descrip1   = barcodes.value("item_descrip1").toString();
+    r.descrip2   = barcodes.value("item_descrip2").toString();
+    r.uom        = barcodes.value("uom_name").toString();
+    r.type       = barcodes.value("item_type").toString();
+    r.upc        = barcodes.value("item_upccode").toString();
+    r.configured = barcodes.value("item_config").toBool();
+    r.fractional = barcodes.value("item_fractional").toBool();
+    r.sold       = barcodes.value("item_sold").toBool();
+    r.active     = barcodes.value("item_active").toBool();
+    r.loaded     = now;
+    sitecodes.insert(r.matched, r);
+  }
+  if (DEBUG)
+    qDebug("%s::preloadBarcodes(%d) loaded %d barcodes",
+           qPrintable(objectName()), warehousid, sitecodes.size());
+}
+
+void ItemLineEdit::clearResolutionCache()
+{
+  invalidateResolutions();
+}
+
+/* Forget every resolved item number and preloaded barcode, for example
+   because an item was changed or deactivated. Widgets look the items up
+   again the next time they are entered.
+ */
+void ItemLineEdit::invalidateResolutions()
+{
+  _itemResolutions.clear();
+  _itemBarcodes.clear();
+}
+
+/* A preloaded barcode can only stand in for the query if every filter
+   this widget applies can be checked without the database.
+ */
+bool ItemLineEdit::canResolveInMemory(const ItemResolution &r) const
+{
+  if (! _extraClauses.isEmpty() ||
+      (_type & (cLocationControlled | cLotSerialControlled | cDefaultLocation |
+                cActive | cHasBom | cUsedOnBom)))
+    return false;
+
+  QStringList types = itemTypeCodes(_type);
+  if (! types.isEmpty() && ! types.contains(r.type))
+    return false;
+  if ((_type & cSold) && ! r.sold)
+    return false;
+  if ((_type & cItemActive) && ! r.active)
+    return false;
+
+  return true;
+}
+
+QString ItemLineEdit::resolutionKey(const QString &pText) const
+{
+  return QString::number(_type) + "|" + _extraClauses.join("|") + "|" + pText;
+}
+
+void ItemLineEdit::setResolution(const ItemResolution &r)
+{
+  _parsed = true;
+
+  if (completer())
+  {
+    disconnect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
+    static_cast<QSqlQueryModel* >(completer()->model())->setQuery(QSqlQuery());
+  }
+
+  _itemNumber = r.number;
+  _uom        = r.uom;
+  _itemType   = r.type;
+  _configured = r.configured;
+  _fractional = r.fractional;
+  _upc        = r.upc;
+  _id         = r.id;
+  _valid      = true;
+
+  setText(r.number);
+  emit aliasChanged("");
+  emit typeChanged(_itemType);
+  emit descrip1Changed(r.descrip1);
+  emit descrip2Changed(r.descrip2);
+  emit uomChanged(r.uom);
+  emit configured(r.configured);
+  emit fractional(r.fractional);
+  emit upcChanged(r.upc);
+
+  emit valid(true);
+
+  if (completer())
+    connect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
+}
+
 ItemCluster::ItemCluster(QWidget* pParent, const char* pName) :
     VirtualCluster(pParent, pName)
 {
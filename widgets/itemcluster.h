@@ -15,6 +15,7 @@
 #include "qstringlist.h"
 #include <parameter.h>
 
+#include <QDateTime>
 #include <QItemDelegate>
 #include <QStyleOptionViewItem>
 
@@ -81,6 +82,26 @@ private:
     QStringList _extraClauses;
 };
 
+// What ItemLineEdit needs to show an item, as resolved from a number,
+// UPC, alias, item site, or the preloaded barcodes for a site
+struct ItemResolution
+{
+  int       id;
+  int       warehousid;
+  QString   number;
+  QString   matched;
+  QString   descrip1;
+  QString   descrip2;
+  QString   uom;
+  QString   type;
+  QString   upc;
+  bool      configured;
+  bool      fractional;
+  bool      sold;
+  bool      active;
+  QDateTime loaded;
+};
+
 class XTUPLEWIDGETS_EXPORT ItemLineEdit : public VirtualClusterLineEdit
 {
   Q_OBJECT
@@ -164,6 +185,11 @@ friend class ItemLineEditDelegate;
     Q_INVOKABLE bool    isConfigured();
     Q_INVOKABLE bool    isFractional();
 
+    Q_INVOKABLE void preloadBarcodes(int warehousid);
+    Q_INVOKABLE void clearResolutionCache();
+
+    static void invalidateResolutions();
+
   public slots:
     void sHandleCompleter();
     void sInfo();
@@ -201,6 +227,9 @@ friend class ItemLineEditDelegate;
 
   private:
     void constructor();
+    bool canResolveInMemory(const ItemResolution &) const;
+    QString resolutionKey(const QString &) const;
+    void setResolution(const ItemResolution &);
 
     ItemLineEditDelegate *_delegate;
     QString _sql;
@@ -216,6 +245,7 @@ friend class ItemLineEditDelegate;
     bool    _fractional;
     bool    _useQuery;
     bool    _useValidationQuery;
+    int     _barcodeWarehousid;
 };
 
 class ItemLineEditDelegate : public QItemDelegate
@@ -266,6 +296,7 @@ class XTUPLEWIDGETS_EXPORT ItemCluster : public VirtualCluster
     Q_INVOKABLE inline QStringList getExtraClauseList() const       { return static_cast<ItemLineEdit*>(_number)->getExtraClauseList(); }
     Q_INVOKABLE inline void clearExtraClauseList()                  { static_cast<ItemLineEdit*>(_number)->clearExtraClauseList();      }
     Q_INVOKABLE ItemLineEdit *itemLineEdit() { return static_cast<ItemLineEdit*>(_number); }
+    Q_INVOKABLE inline void preloadBarcodes(int warehousid)         { static_cast<ItemLineEdit*>(_number)->preloadBarcodes(warehousid); }
 
     void setOrientation(Qt::Orientation orientation);
 
@@ -150,6 +150,7 @@ SOURCES += widgets.cpp \
     filterSave.cpp \
     glCluster.cpp \
     imageAssignment.cpp \
+    imagecache.cpp \
     imagecluster.cpp \
     imageview.cpp \
     incidentCluster.cpp \
@@ -205,6 +206,8 @@ SOURCES += widgets.cpp \
     xtextedit.cpp \
     xtreeview.cpp \
     xtreewidget.cpp \
+    xtreewidgetexporter.cpp \
+    xtreewidgetfindindex.cpp \
     xtreewidgetprogress.cpp \
     xurllabel.cpp \
 
@@ -245,6 +248,7 @@ HEADERS += widgets.h \
     filtersave.h \
     glcluster.h \
     imageAssignment.h \
+    imagecache.h \
     imagecluster.h \
     imageview.h \
     incidentcluster.h \
@@ -301,6 +305,8 @@ HEADERS += widgets.h \
     xtextedit.h \
     xtreeview.h \
     xtreewidget.h \
+    xtreewidgetexporter.h \
+    xtreewidgetfindindex.h \
     xtreewidgetprogress.h \
     xurllabel.h \
 
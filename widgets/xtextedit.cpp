@@ -173,29 +173,8 @@ void XTextEditHighlighter::highlightBlock(const QString &text)
        && enableSpellPref && textEdit->spellEnabled()
        && textEdit->isEnabled() && !textEdit->isReadOnly())
     {
-      QString widgetText = text.simplified();
-      if (!widgetText.isEmpty())
-      {
-         QStringList widgetWords = widgetText.split(QRegExp("([^\\w,^\\\\]|(?=\\\\))+"),
-                                                       QString::SkipEmptyParts);
-         foreach(QString word, widgetWords)
-         {            
-            if (word.length() > 1 && !word.startsWith('\\'))
-            {
-                if (_guiClientInterface->hunspell_check(word) < 1)
-                {
-                   int wordCount = text.count(QRegExp("\\b" + word + "\\b"));
-                   //loop through all repeated words in Line Edit
-                   int wordStartPos=-1;
-                   for (int repeatCount=0;repeatCount < wordCount; ++repeatCount)
-                   {
-                     wordStartPos = text.indexOf(QRegExp("\\b" + word + "\\b"),wordStartPos+1);
-                     if (wordStartPos>=0)
-                         setFormat(wordStartPos, word.length(), _spellCheckFormat);
-                   }
-                }
-             }
-          }
-       }
+      QList<QPair<int, int> > misspelled = _guiClientInterface->hunspell_check_text(text);
+      for (int i = 0; i < misspelled.size(); ++i)
+        setFormat(misspelled.at(i).first, misspelled.at(i).second, _spellCheckFormat);
     }   
 }
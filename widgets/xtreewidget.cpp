@@ -40,6 +40,8 @@
 #include <QtScript>
 #include <QMessageBox>
 
+#include "xtreewidgetexporter.h"
+#include "xtreewidgetfindindex.h"
 #include "xtreewidgetprogress.h"
 #include "xtsettings.h"
 #include "xsqlquery.h"
@@ -120,8 +122,10 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   _last       = 0;
   for (int i = 0; i < ROWROLE_COUNT; i++)
     _rowRole[i] = 0;
+  _exporter = 0;
   _progress = 0;
   _subtotals = 0;
+  _findIndex = new XTreeWidgetFindIndex(this);
 
   setUniformRowHeights(true); //#13439 speed improvement if all rows are known to be the same height
   setContextMenuPolicy(Qt::CustomContextMenu);
@@ -176,6 +180,9 @@ XTreeWidget::~XTreeWidget()
 {
   qApp->restoreOverrideCursor();
 
+  delete _findIndex;
+  _findIndex = 0;
+
   cleanupAfterPopulate();
 
   if (_subtotals)
@@ -330,6 +337,9 @@ void XTreeWidget::populateWorker()
       for (int ref = 0; ref < _roles.size(); ++ref)
         (*_colRole)[ref] = new int[COLROLE_COUNT];
 
+      // rows only store a scale if it differs from what the header says
+      _colScale.fill(-1, _roles.size());
+
       if (! _subtotals)
       {
         _subtotals = new QList<QMap<int, double> *>();
@@ -409,6 +419,9 @@ void XTreeWidget::populateWorker()
           }
         }
 
+        if (headerItem()->data(wcol, Xt::ScaleRole).isValid())
+          _colScale[wcol] = headerItem()->data(wcol, Xt::ScaleRole).toInt();
+
         // Negative NUMERIC ROLE => default for column instead of column index
         // see below
         if (!(*_colRole)[wcol][COLROLE_NUMERIC] &&
@@ -478,12 +491,12 @@ void XTreeWidget::populateWorker()
                 qDebug("%s::populate() with id %d altId %d indent %d lastindent %d",
                 qPrintable(objectName()), id, altId, indent, lastindent);
 
-      QObject *parentItem = 0;
+      XTreeWidgetItem *parentItem = 0;   // 0 => top level
       XTreeWidgetItem *previousItem = _last;
       _last = new XTreeWidgetItem((XTreeWidgetItem*)0, id, altId);
 
       if (indent == 0)
-        parentItem = this;
+        parentItem = 0;
       else if (lastindent < indent)
         parentItem = previousItem;
       else if (lastindent == indent)
@@ -494,13 +507,8 @@ void XTreeWidget::populateWorker()
         while (prev &&
                prev->data(0, Xt::IndentRole).toInt() >= indent)
           prev = (XTreeWidgetItem *)(prev->QTreeWidgetItem::parent());
-        if (prev)
-          parentItem = prev;
-        else
-          parentItem = this;
+        parentItem = prev;
       }
-      else
-        parentItem = this;
 
       if (_rowRole[ROWROLE_INDENT])
         _last->setData(0, Xt::IndentRole, indent);
@@ -546,9 +554,10 @@ void XTreeWidget::populateWorker()
           }
         }
 
-        if ((*_colRole)[col][COLROLE_NUMERIC] ||
-            (*_colRole)[col][COLROLE_RUNNING] ||
-            (*_colRole)[col][COLROLE_TOTAL])
+        if (((*_colRole)[col][COLROLE_NUMERIC] ||
+             (*_colRole)[col][COLROLE_RUNNING] ||
+             (*_colRole)[col][COLROLE_TOTAL]) &&
+            scale != _colScale.at(col))
           _last->setData(col, Xt::ScaleRole, scale);
 
         /* if qtdisplayrole IS NULL then let the raw value shine through.
@@ -642,8 +651,6 @@ void XTreeWidget::populateWorker()
           if (!alignment.isNull())
             _last->setData(col, Qt::TextAlignmentRole, alignment);
         }
-        else
-          _last->setData(col, Qt::TextAlignmentRole, headerItem()->textAlignment(col));
 
         if ((*_colRole)[col][COLROLE_TOOLTIP])
         {
@@ -734,16 +741,11 @@ void XTreeWidget::populateWorker()
         _last->setHidden(true);
       }
 
-      if (qobject_cast<XTreeWidget*>(parentItem))
-      {
-        //#13439 optimization - do not add items to 'this' until the very end
-        if(parentItem == this)
-          topLevelItems.append(_last);
-        else
-          qobject_cast<XTreeWidget*>(parentItem)->addTopLevelItem(_last);
-      }
-      else if (qobject_cast<XTreeWidgetItem*>(parentItem))
-        qobject_cast<XTreeWidgetItem*>(parentItem)->addChild(_last);
+      //#13439 optimization - do not add items to 'this' until the very end
+      if (parentItem)
+        parentItem->addChild(_last);
+      else
+        topLevelItems.append(_last);
 
     } while (pQuery.next());
 
@@ -1565,12 +1567,14 @@ void XTreeWidget::sExport()
   QString   path = xtsettingsValue(_settingsName + "/exportPath").toString();
   QString selectedFilter;
   QFileInfo fi(QFileDialog::getSaveFileName(this, tr("Export Save Filename"), path,
-                                            tr("Text CSV (*.csv);;Text VCF (*.vcf);;Text (*.txt);;ODF Text Document (*.odt);;HTML Document (*.html)"), &selectedFilter));
+                                            tr("Text CSV (*.csv);;Text VCF (*.vcf);;Text (*.txt);;ODF Spreadsheet (*.ods);;ODF Text Document (*.odt);;HTML Document (*.html)"), &selectedFilter));
   QString defaultSuffix;
   if(selectedFilter.contains("csv"))
     defaultSuffix = ".csv";
   else if(selectedFilter.contains("vcf"))
     defaultSuffix = ".vcf";
+  else if(selectedFilter.contains("ods"))
+    defaultSuffix = ".ods";
   else if(selectedFilter.contains("odt"))
     defaultSuffix = ".odt";
   else if(selectedFilter.contains("html"))
@@ -1580,39 +1584,32 @@ void XTreeWidget::sExport()
 
   if (!fi.filePath().isEmpty())
   {
-    QTextDocument       *doc = new QTextDocument();
-    QTextDocumentWriter writer;
     if (fi.suffix().isEmpty())
       fi.setFile(fi.filePath() += defaultSuffix);
     xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
-    writer.setFileName(fi.filePath());
 
-    if (fi.suffix() == "txt")
+    // everything but vcards is streamed to the file a batch of rows at a time
+    XTreeWidgetExporter::Format format;
+    if (XTreeWidgetExporter::formatForSuffix(fi.suffix(), &format))
     {
-      doc->setPlainText(toTxt());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "csv")
-    {
-      doc->setPlainText(toCsv());
-      writer.setFormat("plaintext");
+      if (_exporter)
+        _exporter->cancel();
+
+      if (! _progress)
+      {
+        _progress = new XTreeWidgetProgress(this);
+        connect(_progress, SIGNAL(cancel()), &_workingTimer, SLOT(stop()));
+      }
+      _exporter = new XTreeWidgetExporter(this, fi.filePath(), format, _progress);
+      _exporter->start();
     }
     else if (fi.suffix() == "vcf")
     {
-      doc->setPlainText(toVcf());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "odt")
-    {
-      doc->setHtml(toHtml());
-      writer.setFormat("odf");
-    }
-    else if (fi.suffix() == "html")
-    {
-      doc->setHtml(toHtml());
-      writer.setFormat("HTML");
+      QTextDocument       doc;
+      QTextDocumentWriter writer(fi.filePath(), "plaintext");
+      doc.setPlainText(toVcf());
+      writer.write(&doc);
     }
-    writer.write(doc);
   }
 }
 
@@ -1847,55 +1844,55 @@ XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidgetItem *p
   return 0;
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *itm, int pId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *itm, int pId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(itm)
 {
   constructor(pId, -1, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *itm, int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *itm, int pId, int pAltId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(itm)
 {
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, int pId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, int pId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent)
 {
   constructor(pId, -1, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, int pId, int pAltId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent)
 {
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, XTreeWidgetItem *itm, int pId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent, itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, XTreeWidgetItem *itm, int pId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent, itm)
 {
   constructor(pId, -1, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, XTreeWidgetItem *itm, int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent, itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidget *pParent, XTreeWidgetItem *itm, int pId, int pAltId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent, itm)
 {
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm, int pId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent, itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm, int pId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent, itm)
 {
   constructor(pId, -1, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm, int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 ) :
-  QObject(), QTreeWidgetItem(pParent, itm)
+XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm, int pId, int pAltId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 ) :
+  QTreeWidgetItem(pParent, itm)
 {
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
-void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 )
+void XTreeWidgetItem::constructor(int pId, int pAltId, const QVariant &v0, const QVariant &v1, const QVariant &v2, const QVariant &v3, const QVariant &v4, const QVariant &v5, const QVariant &v6, const QVariant &v7, const QVariant &v8, const QVariant &v9, const QVariant &v10 )
 {
   _id    = pId;
   _altId = pAltId;
@@ -1932,13 +1929,20 @@ void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1,
 
   if (!v10.isNull())
     setText(10, v10);
+}
 
-  if (treeWidget())
-  {
-    QTreeWidgetItem *header = treeWidget()->headerItem();
-    for (int i = 0; i < header->columnCount(); i++)
-      setTextAlignment(i, header->textAlignment(i));
-  }
+/* Fall back to the header for the roles every row in a column shares
+   instead of storing a copy in each row.
+ */
+QVariant XTreeWidgetItem::data(int colidx, int role) const
+{
+  QVariant value = QTreeWidgetItem::data(colidx, role);
+  if (! value.isValid() &&
+      (role == Qt::TextAlignmentRole || role == Xt::ScaleRole) &&
+      treeWidget() && treeWidget()->headerItem() != this)
+    return treeWidget()->headerItem()->data(colidx, role);
+
+  return value;
 }
 
 int XTreeWidgetItem::id(const QString p)
@@ -2023,21 +2027,32 @@ double XTreeWidgetItem::totalForItem(const int pcol, const int pset) const
   return total;
 }
 
+/* Items aren't QObjects. Wrap the pointer in a variant; the default
+   prototype for XTreeWidgetItem* supplies the methods scripts call.
+ */
 QScriptValue XTreeWidgetItemtoScriptValue(QScriptEngine *engine, XTreeWidgetItem *const &item)
 {
-  return engine->newQObject(item);
+  if (! item)
+    return engine->nullValue();
+  // keep the slots and properties of subclasses like PeriodListViewItem
+  if (QObject *obj = dynamic_cast<QObject *>(item))
+    return engine->newQObject(obj);
+  return engine->newVariant(qVariantFromValue(item));
 }
 
 void XTreeWidgetItemfromScriptValue(const QScriptValue &obj, XTreeWidgetItem * &item)
 {
-  item = qobject_cast<XTreeWidgetItem *>(obj.toQObject());
+  if (obj.isQObject())  // subclasses like PeriodListViewItem are QObjects
+    item = dynamic_cast<XTreeWidgetItem *>(obj.toQObject());
+  else
+    item = obj.toVariant().value<XTreeWidgetItem *>();
 }
 
 QScriptValue XTreeWidgetItemListtoScriptValue(QScriptEngine *engine, QList<XTreeWidgetItem *> const &cpplist)
 {
   QScriptValue scriptlist = engine->newArray(cpplist.size());
   for (int i = 0; i < cpplist.size(); i++)
-    scriptlist.setProperty(i, engine->newQObject(cpplist.at(i)));
+    scriptlist.setProperty(i, XTreeWidgetItemtoScriptValue(engine, cpplist.at(i)));
   return scriptlist;
 }
 
@@ -2047,7 +2062,8 @@ void XTreeWidgetItemListfromScriptValue(const QScriptValue &scriptlist, QList<XT
   int listlen = scriptlist.property("length").toInt32();
   for (int i = 0; i < listlen; i++)
   {
-    XTreeWidgetItem *tmp = qobject_cast<XTreeWidgetItem *>(scriptlist.property(i).toQObject());
+    XTreeWidgetItem *tmp = 0;
+    XTreeWidgetItemfromScriptValue(scriptlist.property(i), tmp);
     cpplist.append(tmp);
   }
 }
@@ -2333,22 +2349,49 @@ void XTreeWidget::sCopyColumnToClipboard()
   clipboard->setMimeData(mime);
 }
 
+/** @brief Select the first row whose text contains @a pTarget.
+
+    The comparison ignores case and accents and looks at child rows as well
+    as top-level rows. By default only the first column is searched; see
+    setSearchColumn(). Successive calls that extend the previous target
+    only re-examine the rows that already matched.
+ */
 void XTreeWidget::sSearch(const QString &pTarget)
 {
-  clearSelection();
-  int i;
-  for (i = 0; i < topLevelItemCount(); i++)
-  {
-    // Currently this only looks at the first column
-    if (topLevelItem(i)->text(0).contains(pTarget, Qt::CaseInsensitive))
-      break;
-  }
+  _findIndex->find(pTarget);
+}
 
-  if (i < topLevelItemCount())
-  {
-    setCurrentItem(topLevelItem(i));
-    scrollToItem(topLevelItem(i));
-  }
+/** @brief Select the next row matching the last sSearch() target. */
+void XTreeWidget::sSearchNext()
+{
+  _findIndex->findNext();
+}
+
+/** @brief The column sSearch() looks at, or -1 for all visible columns. */
+int XTreeWidget::searchColumn() const
+{
+  return _findIndex->column();
+}
+
+void XTreeWidget::setSearchColumn(int column)
+{
+  _findIndex->setColumn(column);
+}
+
+/** @brief Whether sSearch() hides the rows that do not match. */
+bool XTreeWidget::searchFilters() const
+{
+  return _findIndex->filtering();
+}
+
+void XTreeWidget::setSearchFilters(bool filter)
+{
+  _findIndex->setFiltering(filter);
+}
+
+QList<XTreeWidgetItem *> XTreeWidget::searchMatches() const
+{
+  return _findIndex->matches();
 }
 
 QString XTreeWidget::toTxt() const
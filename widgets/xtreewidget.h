@@ -15,6 +15,7 @@
 #include <QTreeWidgetItem>
 #include <QVariant>
 #include <QVector>
+#include <QPointer>
 #include <QTimer>
 #include <QHeaderView> //#13251
 
@@ -57,91 +58,95 @@ class QAction;
 class QMenu;
 class QScriptEngine;
 class XTreeWidget;
+class XTreeWidgetExporter;
+class XTreeWidgetFindIndex;
 class XTreeWidgetProgress;
 
 void  setupXTreeWidgetItem(QScriptEngine *engine);
 void  setupXTreeWidget(QScriptEngine *engine);
 
-class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetItem
+/* Not a QObject so big lists don't pay for one per row. Scripts reach
+   items through XTreeWidgetItemProto. Text alignment and the column's
+   default scale come from the header item unless the row sets its own.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QTreeWidgetItem
 {
-  Q_OBJECT
-
   friend class XTreeWidget;
 
   public:
-    XTreeWidgetItem(XTreeWidgetItem *, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidgetItem *, int, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidget *, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidget *, int, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidget *, XTreeWidgetItem *, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidget *, XTreeWidgetItem *, int, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidgetItem *, XTreeWidgetItem *, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-    XTreeWidgetItem(XTreeWidgetItem *, XTreeWidgetItem *, int, int, QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant(),
-                    QVariant = QVariant(), QVariant = QVariant() );
-
-    Q_INVOKABLE virtual void    setText(int, const QVariant&);
-    Q_INVOKABLE virtual QString text(int p) const { return QTreeWidgetItem::text(p); }
-    Q_INVOKABLE virtual QString text(const QString&) const;
-    Q_INVOKABLE inline void     setTextColor(int column, const QColor &color) { QTreeWidgetItem::setTextColor(column, color); }
-    Q_INVOKABLE void                    setTextColor(const QColor&);
-
-    Q_INVOKABLE inline int              id() const        { return _id;    }
-    Q_INVOKABLE inline int              altId() const     { return _altId; }
-    Q_INVOKABLE inline void             setId(int pId)    { _id = pId;     }
-    Q_INVOKABLE inline void             setAltId(int pId) { _altId = pId;  }
-
-    Q_INVOKABLE inline QVariant         data(int colidx,    int role) const { return QTreeWidgetItem::data(colidx, role); }
-    Q_INVOKABLE inline void             setData(int colidx, int role, const QVariant &val) { QTreeWidgetItem::setData(colidx, role, val); }
-    Q_INVOKABLE virtual QVariant        rawValue(const QString colname);
-    Q_INVOKABLE virtual int             id(const QString);
-
-    Q_INVOKABLE virtual void            setDate(int pColIdx, const QVariant pDate);
-    Q_INVOKABLE virtual void            setNumber(int pColIdx, const QVariant pValue, const QString pRole);
-    Q_INVOKABLE virtual bool            setNumericRole(int pColIdx, const QString pRole);
-
-    virtual bool operator               <(const XTreeWidgetItem &other) const;
-    virtual bool operator               ==(const XTreeWidgetItem &other) const;
-
-    Q_INVOKABLE inline XTreeWidgetItem  *child(int idx) const
+    XTreeWidgetItem(XTreeWidgetItem *, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidgetItem *, int, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidget *, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidget *, int, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidget *, XTreeWidgetItem *, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidget *, XTreeWidgetItem *, int, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidgetItem *, XTreeWidgetItem *, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+    XTreeWidgetItem(XTreeWidgetItem *, XTreeWidgetItem *, int, int, const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant(),
+                    const QVariant & = QVariant(), const QVariant & = QVariant() );
+
+    virtual void     setText(int, const QVariant&);
+    virtual QString  text(int p) const { return QTreeWidgetItem::text(p); }
+    virtual QString  text(const QString&) const;
+    inline void      setTextColor(int column, const QColor &color) { QTreeWidgetItem::setTextColor(column, color); }
+    void             setTextColor(const QColor&);
+
+    inline int       id() const        { return _id;    }
+    inline int       altId() const     { return _altId; }
+    inline void      setId(int pId)    { _id = pId;     }
+    inline void      setAltId(int pId) { _altId = pId;  }
+
+    virtual QVariant data(int colidx, int role) const;
+    inline void      setData(int colidx, int role, const QVariant &val) { QTreeWidgetItem::setData(colidx, role, val); }
+    virtual QVariant rawValue(const QString colname);
+    virtual int      id(const QString);
+
+    virtual void     setDate(int pColIdx, const QVariant pDate);
+    virtual void     setNumber(int pColIdx, const QVariant pValue, const QString pRole);
+    virtual bool     setNumericRole(int pColIdx, const QString pRole);
+
+    virtual bool operator <(const XTreeWidgetItem &other) const;
+    virtual bool operator ==(const XTreeWidgetItem &other) const;
+
+    inline XTreeWidgetItem *child(int idx) const
     {
       QTreeWidgetItem *item = QTreeWidgetItem::child(idx);
       return ((XTreeWidgetItem *)item);
@@ -153,9 +158,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
     virtual double totalForItem(const int, const int) const;
 
   private:
-    void constructor( int, int, QVariant, QVariant, QVariant,
-                      QVariant, QVariant, QVariant, QVariant,
-                      QVariant, QVariant, QVariant, QVariant );
+    void constructor( int, int, const QVariant &, const QVariant &,
+                      const QVariant &, const QVariant &, const QVariant &,
+                      const QVariant &, const QVariant &, const QVariant &,
+                      const QVariant &, const QVariant &, const QVariant & );
 
     int _id;
     int _altId;
@@ -208,6 +214,12 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid);
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid);
 
+    Q_INVOKABLE int                      searchColumn() const;
+    Q_INVOKABLE bool                     searchFilters() const;
+    Q_INVOKABLE QList<XTreeWidgetItem *> searchMatches() const;
+    Q_INVOKABLE void                     setSearchColumn(int column);
+    Q_INVOKABLE void                     setSearchFilters(bool filter);
+
     Q_INVOKABLE QString toTxt() const;
     Q_INVOKABLE QString toCsv() const;
     Q_INVOKABLE QString toVcf() const;
@@ -267,6 +279,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sCopyCellToClipboard();
     void  sCopyColumnToClipboard();
     void  sSearch(const QString&);
+    void  sSearchNext();
 
   signals:
     void  valid(bool);
@@ -336,12 +349,15 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
 
     QVector<int>    *_colIdx;
     QVector<int *>  *_colRole;
+    QVector<int>     _colScale;
     int              _fieldCount;
     XTreeWidgetItem *_last;
     int              _rowRole[ROWROLE_COUNT];
     void             cleanupAfterPopulate();
+    QPointer<XTreeWidgetExporter> _exporter;
     XTreeWidgetProgress *_progress;
     QList<QMap<int, double> *> *_subtotals;
+    XTreeWidgetFindIndex *_findIndex;
 
   private slots:
     void  sSelectionChanged();
@@ -0,0 +1,492 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetexporter.h"
+
+#include <QColor>
+#include <QDate>
+#include <QDateTime>
+#include <QLocale>
+#include <QRegExp>
+#include <QStringList>
+#if QT_VERSION < 0x050000
+#include <QTextDocument>
+#endif
+
+#include <cmath>
+
+#include "errorReporter.h"
+#include "xtreewidget.h"
+#include "xtreewidgetprogress.h"
+#include "zipwriter.h"
+
+#define DEBUG false
+
+// rows written per pass through the event loop
+#define EXPORTROWS 500
+
+static QString escaped(const QString &text)
+{
+#if QT_VERSION >= 0x050000
+  return text.toHtmlEscaped();
+#else
+  return Qt::escape(text);
+#endif
+}
+
+/* Text for an OpenDocument <text:p>. Line breaks and tabs need elements of
+   their own and most control characters are not legal XML at all.
+ */
+static QString odfText(const QString &text)
+{
+  QString result;
+  QString esc = escaped(text);
+  result.reserve(esc.size());
+  for (int i = 0; i < esc.size(); i++)
+  {
+    QChar c = esc.at(i);
+    if (c == '\n')
+      result += "<text:line-break/>";
+    else if (c == '\t')
+      result += "<text:tab/>";
+    else if (c.unicode() >= 0x20)
+      result += c;
+  }
+  return result;
+}
+
+/* Write the visible contents of an XTreeWidget straight to a file.
+
+   The old export built the whole list as a QString, parsed that into a
+   QTextDocument, and only then wrote the file, which for big lists took
+   several copies of the data and froze the window until it was done.
+   XTreeWidgetExporter walks the rows once, EXPORTROWS at a time from a
+   zero-length timer, and appends each batch to the file so the window
+   stays responsive and the memory used doesn't grow with the list.
+
+   The rows are read on the GUI thread because QTreeWidgetItems are not
+   safe to touch from anywhere else. If the list is cleared, sorted, or
+   has rows removed while the export is running, the export is abandoned
+   and the partial file deleted rather than writing a mix of old and new
+   data. The exporter deletes itself when it finishes.
+ */
+XTreeWidgetExporter::XTreeWidgetExporter(XTreeWidget *parent, const QString &filename,
+                                         Format format, XTreeWidgetProgress *progress)
+  : QObject(parent),
+    _file(filename),
+    _format(format),
+    _next(0),
+    _progress(progress),
+    _rows(0),
+    _running(false),
+    _tree(parent),
+    _zip(0)
+{
+  setObjectName("XTreeWidgetExporter");
+
+  _timer.setInterval(0);
+  connect(&_timer, SIGNAL(timeout()), this, SLOT(sWork()));
+
+  QAbstractItemModel *model = _tree->model();
+  connect(model, SIGNAL(modelAboutToBeReset()),                      this, SLOT(sAbort()));
+  connect(model, SIGNAL(layoutAboutToBeChanged()),                   this, SLOT(sAbort()));
+  connect(model, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)), this, SLOT(sAbort()));
+
+  if (_progress)
+    connect(_progress, SIGNAL(cancel()), this, SLOT(cancel()));
+}
+
+XTreeWidgetExporter::~XTreeWidgetExporter()
+{
+  if (_running)
+  {
+    _file.close();
+    _file.remove();
+  }
+  delete _zip;
+  _zip = 0;
+}
+
+QString XTreeWidgetExporter::errorString() const
+{
+  return _error;
+}
+
+bool XTreeWidgetExporter::isRunning() const
+{
+  return _running;
+}
+
+bool XTreeWidgetExporter::formatForSuffix(const QString &suffix, Format *format)
+{
+  QString s = suffix.toLower();
+  if (s == "csv")
+    *format = Csv;
+  else if (s == "html" || s == "htm")
+    *format = Html;
+  else if (s == "ods")
+    *format = Ods;
+  else if (s == "odt")
+    *format = Odt;
+  else if (s == "txt")
+    *format = Text;
+  else
+    return false;
+
+  return true;
+}
+
+bool XTreeWidgetExporter::start()
+{
+  if (_running)
+    return true;
+
+  _columns.clear();
+  QTreeWidgetItem *header = _tree->headerItem();
+  for (int col = 0; col < header->columnCount(); col++)
+    if (! _tree->isColumnHidden(col))
+      _columns.append(col);
+
+  if (! _file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    _error = _file.errorString();
+    finish(false);
+    return false;
+  }
+
+  _running = true;
+  _rows    = 0;
+  _next    = _tree->topLevelItem(0);
+
+  if (_format == Ods || _format == Odt)
+  {
+    QString title = _tree->window()->windowTitle();
+    title.remove(QRegExp("[\\[\\]*?:/\\\\]"));
+    if (title.trimmed().isEmpty())
+      title = tr("Export");
+
+    _zip = new ZipWriter(&_file);
+    if (! _zip->addFile("mimetype", _format == Ods ?
+                                    "application/vnd.oasis.opendocument.spreadsheet" :
+                                    "application/vnd.oasis.opendocument.text", false) ||
+        ! _zip->beginFile("content.xml"))
+    {
+      _error = _zip->errorString();
+      finish(false);
+      return false;
+    }
+
+    _buffer = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<office:document-content"
+                      " xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\""
+                      " xmlns:table=\"urn:oasis:names:tc:opendocument:xmlns:table:1.0\""
+                      " xmlns:text=\"urn:oasis:names:tc:opendocument:xmlns:text:1.0\""
+                      " office:version=\"1.2\">\n"
+                      "<office:body>\n%1\n"
+                      "<table:table table:name=\"%2\">\n"
+                      "<table:table-column table:number-columns-repeated=\"%3\"/>\n"
+                      "<table:table-header-rows>\n")
+                .arg(_format == Ods ? "<office:spreadsheet>" : "<office:text>")
+                .arg(escaped(title))
+                .arg(qMax(_columns.size(), 1));
+    _buffer += "<table:table-row>";
+    foreach (int col, _columns)
+      _buffer += "<table:table-cell office:value-type=\"string\"><text:p>" +
+                 odfText(header->text(col)) + "</text:p></table:table-cell>";
+    _buffer += "</table:table-row>\n</table:table-header-rows>\n";
+  }
+  else if (_format == Html)
+  {
+    _buffer = QString("<!DOCTYPE html>\n<html>\n<head>\n"
+                      "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\"/>\n"
+                      "<title>%1</title>\n</head>\n<body>\n"
+                      "<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n"
+                      "<thead><tr>")
+                .arg(escaped(_tree->window()->windowTitle()));
+    foreach (int col, _columns)
+      _buffer += "<th style=\"background-color:#d3d3d3\">" +
+                 escaped(header->text(col)) + "</th>";
+    _buffer += "</tr></thead>\n<tbody>\n";
+  }
+  else if (_format == Csv)
+  {
+    QStringList cells;
+    foreach (int col, _columns)
+      cells << header->text(col).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
+    _buffer = cells.join(",") + "\r\n";
+  }
+  else
+  {
+    foreach (int col, _columns)
+      _buffer += header->text(col).replace("\r\n"," ") + "\t";
+    _buffer += "\r\n";
+  }
+
+  if (! flush())
+  {
+    finish(false);
+    return false;
+  }
+
+  if (_progress)
+  {
+    _progress->setValue(0);
+    _progress->setMaximum(qMax(_tree->topLevelItemCount(), 1));
+    _progress->show();
+  }
+
+  if (DEBUG)
+    qDebug("%s::start() exporting %d top level rows to %s",
+           qPrintable(objectName()), _tree->topLevelItemCount(),
+           qPrintable(_file.fileName()));
+
+  _timer.start();
+  return true;
+}
+
+void XTreeWidgetExporter::cancel()
+{
+  if (_running)
+  {
+    _error.clear();
+    finish(false);
+  }
+}
+
+void XTreeWidgetExporter::sAbort()
+{
+  if (_running)
+  {
+    _error = tr("The list changed while it was being exported.");
+    finish(false);
+  }
+}
+
+void XTreeWidgetExporter::sWork()
+{
+  for (int cnt = 0; _next && cnt < EXPORTROWS; cnt++)
+  {
+    XTreeWidgetItem *item = _next;
+    _next = (XTreeWidgetItem *)_tree->itemBelow(item);
+
+    switch (_format)
+    {
+      case Ods:
+      case Odt:
+        _buffer += "<table:table-row>";
+        foreach (int col, _columns)
+          _buffer += cell(item, col);
+        _buffer += "</table:table-row>\n";
+        break;
+
+      case Html:
+        _buffer += "<tr>";
+        foreach (int col, _columns)
+          _buffer += cell(item, col);
+        _buffer += "</tr>\n";
+        break;
+
+      case Csv:
+        for (int i = 0; i < _columns.size(); i++)
+        {
+          if (i)
+            _buffer += ",";
+          _buffer += cell(item, _columns.at(i));
+        }
+        _buffer += "\r\n";
+        break;
+
+      case Text:
+        foreach (int col, _columns)
+          _buffer += cell(item, col) + "\t";
+        _buffer += "\r\n";
+        break;
+    }
+    _rows++;
+  }
+
+  if (! flush())
+  {
+    finish(false);
+    return;
+  }
+
+  if (_next)
+  {
+    if (_progress)
+    {
+      QTreeWidgetItem *top = _next;
+      while (top->parent())
+        top = top->parent();
+      _progress->setValue(_tree->indexOfTopLevelItem(top));
+    }
+    return;
+  }
+
+  if (_format == Ods || _format == Odt)
+    _buffer += QString("</table:table>\n%1\n</office:body>\n</office:document-content>\n")
+                 .arg(_format == Ods ? "</office:spreadsheet>" : "</office:text>");
+  else if (_format == Html)
+    _buffer += "</tbody>\n</table>\n</body>\n</html>\n";
+
+  finish(flush());
+}
+
+QString XTreeWidgetExporter::cell(XTreeWidgetItem *item, int column) const
+{
+  QString text = item->text(column);
+
+  if (_format == Text)
+    return text;
+
+  if (_format == Csv)
+  {
+    if (item->data(column, Qt::DisplayRole).type() == QVariant::String)
+      return "\"" + text.replace("\"","\"\"") + "\"";
+    return text.replace("\"","\"\"");
+  }
+
+  if (_format == Html)
+  {
+    QString style;
+    QVariant background = item->data(column, Qt::BackgroundRole);
+    if (background.isValid())
+      style += "background-color:" + background.value<QColor>().name() + ";";
+    QVariant foreground = item->data(column, Qt::ForegroundRole);
+    if (foreground.isValid())
+      style += "color:" + foreground.value<QColor>().name() + ";";
+    QString font = item->data(column, Qt::FontRole).toString();
+    if (! font.isEmpty())
+      style += "font-family:" + font + ";";
+
+    return (style.isEmpty() ? QString("<td>") :
+                              QString("<td style=\"%1\">").arg(escaped(style))) +
+           escaped(text) + "</td>";
+  }
+
+  // Ods and Odt: give the cell the type of the raw value when the text
+  // shown is that value, so spreadsheets can sort and sum the column
+  if (text.isEmpty())
+    return "<table:table-cell/>";
+
+  QString  attrs = "office:value-type=\"string\"";
+  QVariant raw   = item->data(column, Xt::RawRole);
+  if (! raw.isNull())
+  {
+    switch (raw.type())
+    {
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+      case QVariant::ULongLong:
+      case QVariant::Double:
+      {
+        bool   ok        = false;
+        double shown     = QLocale().toDouble(text, &ok);
+        double value     = raw.toDouble();
+        double tolerance = 0.5 * pow(10.0, -item->data(column, Xt::ScaleRole).toInt()) + 1e-9;
+        QString number   = raw.type() == QVariant::Double ?
+                           QString::number(value, 'g', 15) : raw.toString();
+        if (ok && fabs(shown - value) <= tolerance)
+          attrs = QString("office:value-type=\"float\" office:value=\"%1\"").arg(number);
+        else if (ok && fabs(shown - value * 100.0) <= tolerance)
+          attrs = QString("office:value-type=\"percentage\" office:value=\"%1\"").arg(number);
+        break;
+      }
+
+      case QVariant::Date:
+        if (raw.toDate().isValid())
+          attrs = QString("office:value-type=\"date\" office:date-value=\"%1\"")
+                    .arg(raw.toDate().toString(Qt::ISODate));
+        break;
+
+      case QVariant::DateTime:
+        if (raw.toDateTime().isValid())
+          attrs = QString("office:value-type=\"date\" office:date-value=\"%1\"")
+                    .arg(raw.toDateTime().toString("yyyy-MM-ddThh:mm:ss"));
+        break;
+
+      case QVariant::Bool:
+        attrs = QString("office:value-type=\"boolean\" office:boolean-value=\"%1\"")
+                  .arg(raw.toBool() ? "true" : "false");
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return "<table:table-cell " + attrs + "><text:p>" + odfText(text) +
+         "</text:p></table:table-cell>";
+}
+
+void XTreeWidgetExporter::finish(bool ok)
+{
+  _timer.stop();
+
+  if (_zip)
+  {
+    if (ok)
+    {
+      QString manifest = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                 "<manifest:manifest xmlns:manifest=\"urn:oasis:names:tc:opendocument:xmlns:manifest:1.0\" manifest:version=\"1.2\">\n"
+                                 " <manifest:file-entry manifest:full-path=\"/\" manifest:version=\"1.2\" manifest:media-type=\"%1\"/>\n"
+                                 " <manifest:file-entry manifest:full-path=\"content.xml\" manifest:media-type=\"text/xml\"/>\n"
+                                 "</manifest:manifest>\n")
+                           .arg(_format == Ods ? "application/vnd.oasis.opendocument.spreadsheet" :
+                                                 "application/vnd.oasis.opendocument.text");
+      ok = _zip->endFile() &&
+           _zip->addFile("META-INF/manifest.xml", manifest.toUtf8()) &&
+           _zip->close();
+      if (! ok)
+        _error = _zip->errorString();
+    }
+    delete _zip;
+    _zip = 0;
+  }
+
+  if (_file.isOpen())
+    _file.close();
+  if (! ok)
+    _file.remove();
+
+  _running = false;
+  _buffer.clear();
+
+  if (_progress)
+    _progress->hide();
+
+  if (DEBUG)
+    qDebug("%s::finish(%d) after %d rows", qPrintable(objectName()), ok, _rows);
+
+  if (! ok && ! _error.isEmpty())
+    ErrorReporter::error(QtCriticalMsg, _tree, tr("Export Failed"),
+                         tr("Could not export to %1:\n%2")
+                           .arg(_file.fileName(), _error),
+                         __FILE__, __LINE__);
+
+  emit finished(ok);
+  deleteLater();
+}
+
+bool XTreeWidgetExporter::flush()
+{
+  if (_buffer.isEmpty())
+    return true;
+
+  QByteArray data = _buffer.toUtf8();
+  _buffer.clear();
+
+  bool ok = _zip ? _zip->write(data) : (_file.write(data) == data.size());
+  if (! ok)
+    _error = _zip ? _zip->errorString() : _file.errorString();
+
+  return ok;
+}
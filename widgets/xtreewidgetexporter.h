@@ -0,0 +1,71 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETEXPORTER_H
+#define XTREEWIDGETEXPORTER_H
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class XTreeWidget;
+class XTreeWidgetItem;
+class XTreeWidgetProgress;
+class ZipWriter;
+
+class XTreeWidgetExporter : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum Format { Csv, Html, Ods, Odt, Text };
+
+    XTreeWidgetExporter(XTreeWidget *parent, const QString &filename,
+                        Format format, XTreeWidgetProgress *progress = 0);
+    ~XTreeWidgetExporter();
+
+    virtual QString errorString() const;
+    virtual bool    isRunning()   const;
+
+    static bool formatForSuffix(const QString &suffix, Format *format);
+
+  public slots:
+    virtual void cancel();
+    virtual bool start();
+
+  signals:
+    void finished(bool ok);
+
+  private slots:
+    void sAbort();
+    void sWork();
+
+  private:
+    QString cell(XTreeWidgetItem *item, int column) const;
+    void    finish(bool ok);
+    bool    flush();
+
+    QString               _buffer;
+    QList<int>            _columns;
+    QString               _error;
+    QFile                 _file;
+    Format                _format;
+    XTreeWidgetItem      *_next;
+    QPointer<XTreeWidgetProgress> _progress;
+    int                   _rows;
+    bool                  _running;
+    QTimer                _timer;
+    XTreeWidget          *_tree;
+    ZipWriter            *_zip;
+};
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetfindindex.h"
+
+#include <QHeaderView>
+#include <QThread>
+
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+// lists with more cells than this get their index built on a worker thread
+#define THREADEDCELLS 20000
+
+/* Normalizes a snapshot of the item text. This runs on a worker thread so
+   it must not touch the tree or its items, only the copied strings.
+ */
+class XTreeWidgetFindIndexBuilder : public QThread
+{
+  public:
+    XTreeWidgetFindIndexBuilder(int generation, const QVector<QStringList> &text,
+                                QObject *parent)
+      : QThread(parent),
+        _generation(generation),
+        _text(text)
+    {
+    }
+
+    void run()
+    {
+      for (int row = 0; row < _text.size(); row++)
+      {
+        QStringList &cols = _text[row];
+        for (int col = 0; col < cols.size(); col++)
+          cols[col] = XTreeWidgetFindIndex::normalize(cols.at(col));
+      }
+    }
+
+    int                  _generation;
+    QVector<QStringList> _text;
+};
+
+/** @class XTreeWidgetFindIndex
+
+    @brief A per-column text index used by XTreeWidget::sSearch().
+
+    The index holds a lowercase, accent-free copy of the display text of
+    every row, including children of indented lists, in display order.
+    It is built the first time a search runs after the list changes and
+    is thrown away whenever the model changes.
+
+    Searches that extend the previous target only look at the rows that
+    matched before, so typing into a search field narrows the match list
+    instead of rescanning the whole list. The index can also hide rows
+    that do not match, keeping the parents of matching children visible.
+ */
+XTreeWidgetFindIndex::XTreeWidgetFindIndex(XTreeWidget *parent)
+  : QObject(parent),
+    _builder(0),
+    _column(0),
+    _current(-1),
+    _filtering(false),
+    _filterApplied(false),
+    _generation(0),
+    _keepId(-1),
+    _ready(false),
+    _tree(parent)
+{
+  QAbstractItemModel *model = _tree->model();
+  connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)),  this, SLOT(invalidate()));
+  connect(model, SIGNAL(layoutChanged()),                        this, SLOT(invalidate()));
+  connect(model, SIGNAL(modelAboutToBeReset()),                  this, SLOT(invalidate()));
+  connect(model, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)), this, SLOT(invalidate()));
+  connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)),    this, SLOT(invalidate()));
+  connect(_tree, SIGNAL(populated()),                            this, SLOT(refresh()));
+  connect(_tree, SIGNAL(resorted()),                             this, SLOT(refresh()));
+}
+
+XTreeWidgetFindIndex::~XTreeWidgetFindIndex()
+{
+  if (_builder)
+  {
+    _builder->wait();
+    delete _builder;
+    _builder = 0;
+  }
+}
+
+/** @brief The column searched by find(), or -1 for all visible columns. */
+int XTreeWidgetFindIndex::column() const
+{
+  return _column;
+}
+
+bool XTreeWidgetFindIndex::filtering() const
+{
+  return _filtering;
+}
+
+bool XTreeWidgetFindIndex::isReady() const
+{
+  return _ready;
+}
+
+QList<XTreeWidgetItem*> XTreeWidgetFindIndex::matches() const
+{
+  QList<XTreeWidgetItem*> result;
+  foreach (int row, _matchRows)
+    result.append(_items.at(row));
+  return result;
+}
+
+QString XTreeWidgetFindIndex::target() const
+{
+  return _target;
+}
+
+/** @brief Reduce @a text to the form stored in the index.
+
+    The text is case-folded, decomposed so accented letters match their
+    unaccented forms, stripped of combining marks, and has its whitespace
+    simplified.
+ */
+QString XTreeWidgetFindIndex::normalize(const QString &text)
+{
+  QString decomposed = text.normalized(QString::NormalizationForm_KD);
+  QString result;
+  result.reserve(decomposed.size());
+  for (int i = 0; i < decomposed.size(); i++)
+  {
+    QChar c = decomposed.at(i);
+    if (c.category() != QChar::Mark_NonSpacing)
+      result.append(c.toCaseFolded());
+  }
+  return result.simplified();
+}
+
+/** @brief Find the first row matching @a target and make it current.
+
+    If the index is still being built on a worker thread the search is
+    remembered and run when the index is ready; found() is emitted then.
+
+    @return The first matching item, or 0 if nothing matched or the search
+            is pending.
+ */
+XTreeWidgetItem *XTreeWidgetFindIndex::find(const QString &target)
+{
+  return search(target, -1);
+}
+
+/* Run find(), but if the item with keepId is among the matches make it
+   current instead of the first match.
+ */
+XTreeWidgetItem *XTreeWidgetFindIndex::search(const QString &target, int keepId)
+{
+  _target = target;
+  QString normalized = normalize(target);
+
+  if (normalized.isEmpty())
+  {
+    _searched.clear();
+    _matchRows.clear();
+    _current = -1;
+    _keepId  = -1;
+    restoreHidden();
+    return 0;
+  }
+
+  if (! _ready)
+  {
+    build();
+    if (! _ready)
+    {
+      _keepId = keepId;   // for refresh() once the index is built
+      return 0;
+    }
+  }
+  _keepId = -1;
+
+  QVector<int> candidates;
+  bool narrowing = ! _searched.isEmpty() && normalized.startsWith(_searched);
+  if (! narrowing)
+  {
+    candidates.reserve(_items.size());
+    for (int row = 0; row < _items.size(); row++)
+      candidates.append(row);
+  }
+  else
+    candidates = _matchRows;
+
+  _matchRows.clear();
+  foreach (int row, candidates)
+    if (matchesRow(row, normalized))
+      _matchRows.append(row);
+  _searched = normalized;
+  _current  = -1;
+  for (int i = 0; keepId >= 0 && i < _matchRows.size(); i++)
+    if (_items.at(_matchRows.at(i))->id() == keepId)
+    {
+      _current = i - 1;   // findNext() moves to it
+      break;
+    }
+
+  if (DEBUG)
+    qDebug("XTreeWidgetFindIndex::find(%s) %d of %d candidates match",
+           qPrintable(target), _matchRows.size(), candidates.size());
+
+  if (_filtering)
+    applyFilter();
+
+  return findNext();
+}
+
+/** @brief Make the next match after the current one the current item,
+           wrapping around at the end of the list.
+ */
+XTreeWidgetItem *XTreeWidgetFindIndex::findNext()
+{
+  _tree->clearSelection();
+  if (_matchRows.isEmpty())
+    return 0;
+
+  _current = (_current + 1) % _matchRows.size();
+  XTreeWidgetItem *item = _items.at(_matchRows.at(_current));
+  _tree->setCurrentItem(item);
+  _tree->scrollToItem(item);
+  emit found(item);
+
+  return item;
+}
+
+/** @brief Drop the index because the list contents or order changed.
+
+    Rows hidden by filtering are shown again first, while the items still
+    exist. The target and the id of the current item are kept so
+    refresh() can repeat the search without losing the user's place.
+ */
+void XTreeWidgetFindIndex::invalidate()
+{
+  if (! _ready && ! _builder)
+    return;
+
+  XTreeWidgetItem *current = static_cast<XTreeWidgetItem*>(_tree->currentItem());
+  if (_keepId < 0 && current)
+    _keepId = current->id();
+
+  restoreHidden();
+  _generation++;
+  _ready = false;
+  _items.clear();
+  _hidden.clear();
+  _parentRow.clear();
+  _text.clear();
+  _matchRows.clear();
+  _searched.clear();
+  _current = -1;
+}
+
+/** @brief Repeat the last search against the current list contents.
+
+    The item that was current before the list changed stays current if
+    it still matches; otherwise the first match is selected.
+ */
+void XTreeWidgetFindIndex::refresh()
+{
+  if (! _target.isEmpty())
+    search(_target, _keepId);
+}
+
+void XTreeWidgetFindIndex::setColumn(int column)
+{
+  if (column == _column)
+    return;
+  _column = column;
+  _searched.clear();
+  refresh();
+}
+
+void XTreeWidgetFindIndex::setFiltering(bool filter)
+{
+  _filtering = filter;
+  if (_filtering)
+    applyFilter();
+  else
+    restoreHidden();
+}
+
+void XTreeWidgetFindIndex::sBuilt()
+{
+  XTreeWidgetFindIndexBuilder *builder = _builder;
+  _builder = 0;
+  if (! builder)
+    return;
+
+  if (builder->_generation == _generation)
+  {
+    _text  = builder->_text;
+    _ready = true;
+  }
+  builder->deleteLater();
+
+  if (_ready)
+    refresh();
+  else if (! _target.isEmpty())
+    build();    // the list changed while we were busy
+}
+
+/* Snapshot the tree in display order. Item text has to be read on the GUI
+   thread but the normalization, which is most of the work, does not.
+ */
+void XTreeWidgetFindIndex::build()
+{
+  if (_builder)
+    return;
+
+  _items.clear();
+  _hidden.clear();
+  _parentRow.clear();
+  _text.clear();
+
+  int columns = _tree->columnCount();
+  QList<QPair<QTreeWidgetItem*, int> > stack;
+  for (int i = _tree->topLevelItemCount() - 1; i >= 0; i--)
+    stack.append(qMakePair((QTreeWidgetItem*)_tree->topLevelItem(i), -1));
+
+  while (! stack.isEmpty())
+  {
+    QPair<QTreeWidgetItem*, int> entry = stack.takeLast();
+    XTreeWidgetItem *item = static_cast<XTreeWidgetItem*>(entry.first);
+    int row = _items.size();
+
+    QStringList cols;
+    for (int col = 0; col < columns; col++)
+      cols.append(item->text(col));
+
+    _items.append(item);
+    _hidden.append(item->isHidden());
+    _parentRow.append(entry.second);
+    _text.append(cols);
+
+    for (int i = item->childCount() - 1; i >= 0; i--)
+      stack.append(qMakePair(item->QTreeWidgetItem::child(i), row));
+  }
+
+  if (_items.size() * columns < THREADEDCELLS)
+  {
+    for (int row = 0; row < _text.size(); row++)
+      for (int col = 0; col < _text.at(row).size(); col++)
+        _text[row][col] = normalize(_text.at(row).at(col));
+    _ready = true;
+  }
+  else
+  {
+    _builder = new XTreeWidgetFindIndexBuilder(_generation, _text, this);
+    _text.clear();
+    connect(_builder, SIGNAL(finished()), this, SLOT(sBuilt()), Qt::QueuedConnection);
+    _builder->start(QThread::LowPriority);
+  }
+}
+
+bool XTreeWidgetFindIndex::matchesRow(int row, const QString &target) const
+{
+  if (_hidden.at(row))
+    return false;
+
+  const QStringList &cols = _text.at(row);
+  if (_column >= 0)
+    return _column < cols.size() && cols.at(_column).contains(target);
+
+  for (int col = 0; col < cols.size(); col++)
+    if (! _tree->isColumnHidden(col) && cols.at(col).contains(target))
+      return true;
+
+  return false;
+}
+
+void XTreeWidgetFindIndex::applyFilter()
+{
+  if (! _ready || _searched.isEmpty())
+  {
+    restoreHidden();
+    return;
+  }
+
+  QVector<bool> show(_items.size(), false);
+  foreach (int row, _matchRows)
+    for (int r = row; r >= 0 && ! show.at(r); r = _parentRow.at(r))
+      show[r] = true;
+
+  for (int row = 0; row < _items.size(); row++)
+    _items.at(row)->setHidden(_hidden.at(row) || ! show.at(row));
+  _filterApplied = true;
+}
+
+void XTreeWidgetFindIndex::restoreHidden()
+{
+  if (! _filterApplied)
+    return;
+
+  for (int row = 0; row < _items.size(); row++)
+    _items.at(row)->setHidden(_hidden.at(row));
+  _filterApplied = false;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2016 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETFINDINDEX_H
+#define XTREEWIDGETFINDINDEX_H
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class XTreeWidget;
+class XTreeWidgetItem;
+class XTreeWidgetFindIndexBuilder;
+
+class XTreeWidgetFindIndex : public QObject
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetFindIndex(XTreeWidget *parent);
+    ~XTreeWidgetFindIndex();
+
+    virtual int                     column()    const;
+    virtual bool                    filtering() const;
+    virtual bool                    isReady()   const;
+    virtual QList<XTreeWidgetItem*> matches()   const;
+    virtual QString                 target()    const;
+
+    static QString normalize(const QString &text);
+
+  public slots:
+    virtual XTreeWidgetItem *find(const QString &target);
+    virtual XTreeWidgetItem *findNext();
+    virtual void             invalidate();
+    virtual void             refresh();
+    virtual void             setColumn(int column);
+    virtual void             setFiltering(bool filter);
+
+  signals:
+    void found(XTreeWidgetItem *item);
+
+  private slots:
+    void sBuilt();
+
+  private:
+    void build();
+    bool matchesRow(int row, const QString &target) const;
+    void applyFilter();
+    void restoreHidden();
+    XTreeWidgetItem *search(const QString &target, int keepId);
+
+    XTreeWidgetFindIndexBuilder *_builder;
+    int                      _column;
+    int                      _current;
+    bool                     _filtering;
+    bool                     _filterApplied;
+    int                      _generation;
+    QVector<bool>            _hidden;
+    QVector<XTreeWidgetItem*> _items;
+    int                      _keepId;
+    QVector<int>             _matchRows;
+    QVector<int>             _parentRow;
+    bool                     _ready;
+    QString                  _searched;
+    QString                  _target;
+    QVector<QStringList>     _text;
+    XTreeWidget             *_tree;
+};
+
+#endif